@@ -19,6 +19,11 @@
 
 namespace bridge {
 
+const unsigned int AbstractMeshBridge::IndexBits;
+const AbstractMeshBridge::Index AbstractMeshBridge::IndexFlagHi;
+const AbstractMeshBridge::Index AbstractMeshBridge::IndexFlagLo;
+const AbstractMeshBridge::Index AbstractMeshBridge::IndexMask;
+
 AbstractMeshBridge::~AbstractMeshBridge()
 {
 }
@@ -15,6 +15,7 @@
  * You should have received a copy of the GNU Affero General Public License
  * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <cstdint>
 #include <boost/utility.hpp>
 
 namespace bridge {
@@ -42,29 +43,54 @@ public:
     } __attribute__((aligned(16)));
 
     
-    /** Basic index type for triangulation. */
+    /** Basic index type for triangulation.
+      *
+      * Indices are 32 bits wide, unless FRVIEW_INDEX64 is defined (the
+      * INDEX64 build option), which makes them 64 bits wide for meshes with
+      * more than 2^30-1 vertices, normals or cells.
+      */
+#ifdef FRVIEW_INDEX64
+    typedef uint64_t Index;
+#else
     typedef unsigned int Index;
+#endif
+
+    /** Number of bits in an index. */
+    static const unsigned int IndexBits = 8u*sizeof(Index);
+
+    /** Upper bit of an index, used for flags. */
+    static const Index IndexFlagHi = Index(1u) << (IndexBits-1u);
+
+    /** Second upper bit of an index, used for flags. */
+    static const Index IndexFlagLo = Index(1u) << (IndexBits-2u);
+
+    /** Mask for the part of an index that remains when the two flag bits are removed.
+      *
+      * This is also the largest index that can carry flags, and a cell index
+      * equal to the mask denotes no cell.
+      */
+    static const Index IndexMask = IndexFlagLo - 1u;
 
     /** Helper struct used for polygon tessellation.
       *
-      * Everything is currently encoded as an uint32, where the two upper bits
+      * The vertex index is encoded in an Index, where the two upper bits
       * are used to signal the presence of a cell boundary, used for line
-      * drawing. Maximum vertex index is thus restricted to 2^30-1.
+      * drawing. Maximum vertex index is thus restricted to IndexMask.
       */
     struct Segment {
         inline Segment() {}
         inline Segment( Index normal, Index vertex, Index flags )
-            : m_normal( normal ), m_value( vertex | (flags<<30u) )
+            : m_normal( normal ), m_value( vertex | (flags<<(IndexBits-2u)) )
         {}
 
-        inline void clearEdges() { m_value = m_value & (~(3u<<30u)); }
-        inline void setEdges(bool edge_a, bool edge_b ) { m_value = (m_value & (~(3u<<30u))) | (edge_a?(1u<<30u):0) | (edge_b?(1u<<31u):0); }
+        inline void clearEdges() { m_value = m_value & IndexMask; }
+        inline void setEdges(bool edge_a, bool edge_b ) { m_value = (m_value & IndexMask) | (edge_a?IndexFlagLo:0u) | (edge_b?IndexFlagHi:0u); }
         inline Index normal() const { return m_normal; }
-        inline Index vertex() const { return m_value & (~(3u<<30u)); }
-        inline bool edgeA() const { return (m_value & (1u<<30u)) != 0u; }
-        inline bool edgeB() const { return (m_value & (1u<<31u)) != 0u; }
-        unsigned int    m_normal;
-        unsigned int    m_value;
+        inline Index vertex() const { return m_value & IndexMask; }
+        inline bool edgeA() const { return (m_value & IndexFlagLo) != 0u; }
+        inline bool edgeB() const { return (m_value & IndexFlagHi) != 0u; }
+        Index           m_normal;
+        Index           m_value;
     };    
     
     virtual
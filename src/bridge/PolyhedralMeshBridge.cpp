@@ -18,11 +18,14 @@
 #include <math.h>
 #include <algorithm>
 #include <iterator>
+#include <limits>
+#include <stdexcept>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/string_cast.hpp>
 #include "utils/Logger.hpp"
 #include "utils/PerfTimer.hpp"
+#include "utils/ThreadPool.hpp"
 #ifdef __SSE2__
 #include <xmmintrin.h>
 #endif
@@ -36,6 +39,47 @@
 
 namespace {
     const std::string package = "bridge.PolyhedralMeshBridge";
+
+/** Polygons with up to this many corners are triangulated without heap allocations. */
+const size_t scratch_corners = 16;
+
+/** Scratch array on the stack, or on the heap if more than Capacity items are needed. */
+template<typename T, size_t Capacity>
+class ScratchArray
+{
+public:
+    explicit ScratchArray( const size_t n )
+        : m_data( m_local )
+    {
+        if( Capacity < n ) {
+            m_heap.resize( n );
+            m_data = m_heap.data();
+        }
+    }
+
+    inline T& operator[]( const size_t i ) { return m_data[i]; }
+
+    inline T* data() { return m_data; }
+
+private:
+    T               m_local[ Capacity ];
+    std::vector<T>  m_heap;
+    T*              m_data;
+};
+
+/** Spread the lower 21 bits of a value to every third bit, for Morton codes. */
+inline uint64_t
+spreadBits( uint64_t v )
+{
+    v = v & 0x1fffffull;
+    v = (v | (v << 32u)) & 0x1f00000000ffffull;
+    v = (v | (v << 16u)) & 0x1f0000ff0000ffull;
+    v = (v | (v <<  8u)) & 0x100f00f00f00f00full;
+    v = (v | (v <<  4u)) & 0x10c30c30c30c30c3ull;
+    v = (v | (v <<  2u)) & 0x1249249249249249ull;
+    return v;
+}
+
 }
 
 namespace bridge {
@@ -49,6 +93,9 @@ PolyhedralMeshBridge::PolyhedralMeshBridge( bool triangulate )
       m_tri_info( NULL ),
       m_tri_vtx( NULL )
 {
+    static const Real maxf = std::numeric_limits<Real>::max();
+    m_bounds[0] = Real4(  maxf,  maxf,  maxf );
+    m_bounds[1] = Real4( -maxf, -maxf, -maxf );
     allocTriangleChunks();
     m_polygon_offset.push_back( 0u );
 }
@@ -78,8 +125,212 @@ PolyhedralMeshBridge::~PolyhedralMeshBridge()
     }
 }
 
+PolyhedralMeshBridge::Mark
+PolyhedralMeshBridge::mark() const
+{
+    Mark mark;
+    mark.m_vertices  = m_vertices.size();
+    mark.m_normals   = m_normals.size();
+    mark.m_edges     = m_edges.size();
+    mark.m_polygons  = m_polygon_offset.size() - 1u;
+    mark.m_indices   = m_polygon_vtx_ix.size();
+    mark.m_triangles = m_tri_N;
+    return mark;
+}
+
 void
-PolyhedralMeshBridge::reserveVertices( unsigned int N )
+PolyhedralMeshBridge::merge( const std::vector<const PolyhedralMeshBridge*>&  shards,
+                             const std::vector<Mark>&                         from,
+                             const std::vector< std::vector<Index> >&         vertex_maps,
+                             utils::ThreadPool*                               pool )
+{
+    const size_t S = shards.size();
+
+    // Offsets of the output of each shard in this bridge.
+    std::vector<Index> vertex_offset( S+1 );
+    std::vector<Index> normal_offset( S+1 );
+    std::vector<Index> edge_offset( S+1 );
+    std::vector<Index> polygon_offset( S+1 );
+    std::vector<Index> index_offset( S+1 );
+    vertex_offset[0]  = m_vertices.size();
+    normal_offset[0]  = m_normals.size();
+    edge_offset[0]    = m_edges.size();
+    polygon_offset[0] = m_polygon_offset.size() - 1u;
+    index_offset[0]   = m_polygon_vtx_ix.size();
+    for( size_t s=0; s<S; s++ ) {
+        const PolyhedralMeshBridge& shard = *shards[s];
+        vertex_offset[s+1]  = vertex_offset[s]  + (shard.m_vertices.size() - from[s].m_vertices);
+        normal_offset[s+1]  = normal_offset[s]  + (shard.m_normals.size() - from[s].m_normals);
+        edge_offset[s+1]    = edge_offset[s]    + (shard.m_edges.size() - from[s].m_edges);
+        polygon_offset[s+1] = polygon_offset[s] + (shard.m_polygon_offset.size() - 1u - from[s].m_polygons);
+        index_offset[s+1]   = index_offset[s]   + (shard.m_polygon_vtx_ix.size() - shard.m_polygon_offset[ from[s].m_polygons ]);
+    }
+    if( (IndexMask < vertex_offset[S]) || (IndexMask < normal_offset[S]) ) {
+        throw std::runtime_error( "PolyhedralMeshBridge::merge: too many vertices or normals for the index type" );
+    }
+    m_vertices.resize( vertex_offset[S] );
+    m_normals.resize( normal_offset[S] );
+    m_edges.resize( edge_offset[S] );
+    m_polygon_info.resize( 2*polygon_offset[S] );
+    m_polygon_offset.resize( polygon_offset[S] + 1u );
+    m_polygon_vtx_ix.resize( index_offset[S] );
+    m_polygon_nrm_ix.resize( index_offset[S] );
+
+    utils::ThreadPool& threads = pool != NULL ? *pool : utils::ThreadPool::instance();
+    threads.run( S, [&]( size_t s )
+    {
+        const PolyhedralMeshBridge& shard = *shards[s];
+        const Mark& mark = from[s];
+        const std::vector<Index>& vertex_map = vertex_maps[s];
+        const Index vo = vertex_offset[s];
+        const Index no = normal_offset[s];
+
+        auto vertex = [&]( const Index v ) -> Index
+        {
+            if( mark.m_vertices <= v ) {
+                return vo + (v - mark.m_vertices);
+            }
+            if( vertex_map[v] == ~Index(0u) ) {
+                throw std::runtime_error( "PolyhedralMeshBridge::merge: reference to vertex outside of shard" );
+            }
+            return vertex_map[v];
+        };
+        // normal indices carry edge flags in the two upper bits.
+        auto normal = [&]( const Index n ) -> Index
+        {
+            const Index ix = n & IndexMask;
+            if( ix < mark.m_normals ) {
+                throw std::runtime_error( "PolyhedralMeshBridge::merge: reference to normal outside of shard" );
+            }
+            return (n & ~IndexMask) | (no + (ix - mark.m_normals));
+        };
+
+        std::copy( shard.m_vertices.begin() + mark.m_vertices, shard.m_vertices.end(),
+                   m_vertices.begin() + vo );
+        std::copy( shard.m_normals.begin() + mark.m_normals, shard.m_normals.end(),
+                   m_normals.begin() + no );
+
+        Edge* edges = m_edges.data() + edge_offset[s];
+        for( size_t i=mark.m_edges; i<shard.m_edges.size(); i++ ) {
+            Edge e = shard.m_edges[i];
+            e.m_cp[0] = vertex( e.m_cp[0] );
+            e.m_cp[1] = vertex( e.m_cp[1] );
+            *edges++ = e;
+        }
+
+        std::copy( shard.m_polygon_info.begin() + 2*mark.m_polygons, shard.m_polygon_info.end(),
+                   m_polygon_info.begin() + 2*polygon_offset[s] );
+        const Index first = shard.m_polygon_offset[ mark.m_polygons ];
+        const Index polygons = shard.m_polygon_offset.size() - 1u;
+        for( Index p=mark.m_polygons; p<polygons; p++ ) {
+            m_polygon_offset[ polygon_offset[s] + (p - mark.m_polygons) + 1u ] =
+                    index_offset[s] + (shard.m_polygon_offset[p+1] - first);
+        }
+        for( size_t i=first; i<shard.m_polygon_vtx_ix.size(); i++ ) {
+            m_polygon_vtx_ix[ index_offset[s] + (i - first) ] = vertex( shard.m_polygon_vtx_ix[i] );
+            m_polygon_nrm_ix[ index_offset[s] + (i - first) ] = normal( shard.m_polygon_nrm_ix[i] );
+        }
+    } );
+
+    // Triangle chunks are full except for the last one.
+    for( size_t s=0; s<S; s++ ) {
+        const PolyhedralMeshBridge& shard = *shards[s];
+        auto nt = shard.m_tri_nrm_ix_chunks.begin();
+        auto it = shard.m_tri_info_chunks.begin();
+        auto vt = shard.m_tri_vtx_chunks.begin();
+        for( Index t=0; t < shard.m_tri_N; t += m_chunk_size, ++nt, ++it, ++vt ) {
+            const Index n = (shard.m_tri_N - t) < m_chunk_size ? (shard.m_tri_N - t) : m_chunk_size;
+            for( Index i=0; i<n; i++ ) {
+                if( t + i < from[s].m_triangles ) {
+                    continue;
+                }
+                if( m_tri_chunk_N == m_chunk_size ) {
+                    allocTriangleChunks();
+                }
+                for( Index k=0; k<3; k++ ) {
+                    const Index v = (*vt)[ 3*i + k ];
+                    m_tri_vtx[ 3*m_tri_chunk_N + k ] = from[s].m_vertices <= v
+                                                     ? vertex_offset[s] + (v - from[s].m_vertices)
+                                                     : vertex_maps[s][v];
+                    m_tri_nrm_ix[ 3*m_tri_chunk_N + k ] = normal_offset[s] + ((*nt)[ 3*i + k ] - from[s].m_normals);
+                }
+                m_tri_info[ 2*m_tri_chunk_N + 0 ] = (*it)[ 2*i + 0 ];
+                m_tri_info[ 2*m_tri_chunk_N + 1 ] = (*it)[ 2*i + 1 ];
+                m_tri_chunk_N++;
+                m_tri_N++;
+            }
+        }
+    }
+}
+
+void
+PolyhedralMeshBridge::extract( Part&                       part,
+                               const Mark&                 from,
+                               const std::vector<Index>&   cell_ranges ) const
+{
+    const Mark to = mark();
+    if( (to.m_vertices < from.m_vertices) || (to.m_normals < from.m_normals) ||
+        (to.m_polygons < from.m_polygons) || (to.m_indices < from.m_indices) )
+    {
+        throw std::runtime_error( "PolyhedralMeshBridge: mark is past the output" );
+    }
+    part.m_from = from;
+    part.m_reserved.m_vertices  = m_vertices.capacity();
+    part.m_reserved.m_normals   = m_normals.capacity();
+    part.m_reserved.m_edges     = m_edges.capacity();
+    part.m_reserved.m_polygons  = m_polygon_offset.capacity() - 1u;
+    part.m_reserved.m_indices   = m_polygon_vtx_ix.capacity();
+    part.m_reserved.m_triangles = m_tri_N;
+    part.m_cell_count = m_cell_index.size();
+    part.m_bounds[0] = m_bounds[0];
+    part.m_bounds[1] = m_bounds[1];
+
+    part.m_vertices.assign( m_vertices.begin() + from.m_vertices, m_vertices.end() );
+    part.m_normals.assign( m_normals.begin() + from.m_normals, m_normals.end() );
+    part.m_polygon_info.assign( m_polygon_info.begin() + 2*from.m_polygons, m_polygon_info.end() );
+    part.m_polygon_offset.assign( m_polygon_offset.begin() + from.m_polygons + 1u, m_polygon_offset.end() );
+    part.m_polygon_vtx_ix.assign( m_polygon_vtx_ix.begin() + from.m_indices, m_polygon_vtx_ix.end() );
+    part.m_polygon_nrm_ix.assign( m_polygon_nrm_ix.begin() + from.m_indices, m_polygon_nrm_ix.end() );
+
+    part.m_cell_ranges = cell_ranges;
+    part.m_cell_index.clear();
+    part.m_cell_corner.clear();
+    for( size_t r=0; r+1<cell_ranges.size(); r+=2 ) {
+        const Index b = cell_ranges[r];
+        const Index e = cell_ranges[r+1];
+        if( (e < b) || (m_cell_index.size() < e) ) {
+            throw std::runtime_error( "PolyhedralMeshBridge: cell range out of range" );
+        }
+        part.m_cell_index.insert( part.m_cell_index.end(),
+                                  m_cell_index.begin() + b, m_cell_index.begin() + e );
+        part.m_cell_corner.insert( part.m_cell_corner.end(),
+                                   m_cell_corner.begin() + 8*b, m_cell_corner.begin() + 8*e );
+    }
+}
+
+void
+PolyhedralMeshBridge::growBounds( const Real4& minimum, const Real4& maximum )
+{
+    for( unsigned int k=0; k<3; k++ ) {
+        m_bounds[0].v[k] = std::min( m_bounds[0].v[k], minimum.v[k] );
+        m_bounds[1].v[k] = std::max( m_bounds[1].v[k], maximum.v[k] );
+    }
+}
+
+void
+PolyhedralMeshBridge::reserve( const Mark& sizes )
+{
+    m_vertices.reserve( m_vertices.size() + sizes.m_vertices );
+    m_normals.reserve( m_normals.size() + sizes.m_normals );
+    m_edges.reserve( m_edges.size() + sizes.m_edges );
+    m_polygon_info.reserve( m_polygon_info.size() + 2*sizes.m_polygons );
+    m_polygon_offset.reserve( m_polygon_offset.size() + sizes.m_polygons );
+    m_polygon_vtx_ix.reserve( m_polygon_vtx_ix.size() + sizes.m_indices );
+    m_polygon_nrm_ix.reserve( m_polygon_nrm_ix.size() + sizes.m_indices );
+}
+
+void
+PolyhedralMeshBridge::reserveVertices( Index N )
 {
     m_vertices.reserve( N );
 }
@@ -108,6 +359,9 @@ PolyhedralMeshBridge::Index
 PolyhedralMeshBridge::addVertex( const Real4 pos  )
 {
     Index r = m_vertices.size();
+    if( IndexMask < r ) {
+        throw std::runtime_error( "PolyhedralMeshBridge: too many vertices for the index type" );
+    }
     m_vertices.push_back( pos );
     return r;
 }
@@ -115,9 +369,12 @@ PolyhedralMeshBridge::addVertex( const Real4 pos  )
 PolyhedralMeshBridge::Index
 PolyhedralMeshBridge::addNormal( const Real4 dir )
 {
-    Logger log = getLogger( package + ".addNormal" );
+    static const Logger log = getLogger( package + ".addNormal" );
 
     Index i = m_normals.size();
+    if( IndexMask < i ) {
+        throw std::runtime_error( "PolyhedralMeshBridge: too many normals for the index type" );
+    }
 //    LOGGER_DEBUG( log,  i << " = " << dir.x() << ", " << dir.y() << ", " << dir.z() << ", " << dir.w() );
 
     m_normals.push_back( dir );
@@ -125,13 +382,13 @@ PolyhedralMeshBridge::addNormal( const Real4 dir )
 }
 
 
-unsigned int
+PolyhedralMeshBridge::Index
 PolyhedralMeshBridge::vertices() const
 {
     return m_vertices.size();
 }
 
-unsigned int
+PolyhedralMeshBridge::Index
 PolyhedralMeshBridge::cellCount() const
 {
     return m_cell_index.size();
@@ -140,6 +397,9 @@ PolyhedralMeshBridge::cellCount() const
 void
 PolyhedralMeshBridge::setCellCount( const PolyhedralMeshBridge::Index N )
 {
+    if( IndexMask < N ) {
+        throw std::runtime_error( "PolyhedralMeshBridge: too many cells for the index type" );
+    }
     m_cell_index.resize( N );
     m_cell_corner.resize( 8*N );
 }
@@ -309,24 +569,24 @@ PolyhedralMeshBridge::addPolygon( const Interface interface,
                             const Segment* segments,
                             const Index no )
 {
-    uint N = no;
-    Logger log = getLogger( package + ".addPolygon" );
+    Index N = no;
     if( N < 3 ) {
+        Logger log = getLogger( package + ".addPolygon" );
         LOGGER_ERROR( log, "Got polygon with " << N << " vertices." );
         return;
     }
 
-    uint cell_a = interface.m_value[0];
-    uint cell_b = interface.m_value[1];
+    Index cell_a = interface.m_value[0];
+    Index cell_b = interface.m_value[1];
 
-    std::vector<uint> vtx_ix( N );
-    std::vector<uint> nrm_ix( N );
-    std::vector<glm::vec3> pos(N);
-    for(uint i=0; i<N; i++ ) {
+    ScratchArray<Index,scratch_corners> vtx_ix( N );
+    ScratchArray<Index,scratch_corners> nrm_ix( N );
+    ScratchArray<glm::vec3,scratch_corners> pos( N );
+    for(Index i=0; i<N; i++ ) {
         vtx_ix[i] = segments[i].vertex();
         nrm_ix[i] = segments[i].normal()
-                  | (segments[i].edgeA() ? 0x80000000 : 0u)
-                  | (segments[i].edgeB() ? 0x40000000 : 0u);
+                  | (segments[i].edgeA() ? IndexFlagHi : 0u)
+                  | (segments[i].edgeB() ? IndexFlagLo : 0u);
         pos[i] = glm::vec3( m_vertices[ vtx_ix[i] ].x(),
                             m_vertices[ vtx_ix[i] ].y(),
                             m_vertices[ vtx_ix[i] ].z() );
@@ -335,7 +595,7 @@ PolyhedralMeshBridge::addPolygon( const Interface interface,
     // compute approximate normal and barycenter
     // Newell's method (GPU gems III)
     glm::vec3 n(0.f);
-    for(uint i=0; i<N; i++) {
+    for(Index i=0; i<N; i++) {
         glm::vec3 q = pos[i];
         glm::vec3 r = pos[(i+1)%N];
         n += glm::vec3( (q.y-r.y)*(q.z+r.z),
@@ -345,7 +605,7 @@ PolyhedralMeshBridge::addPolygon( const Interface interface,
 
     // Check if polygon is convex
     bool convex = true;
-    for( uint i=0; i<N && convex; i++ ) {
+    for( Index i=0; i<N && convex; i++ ) {
         glm::vec3 q = pos[i];
         glm::vec3 r = pos[(i+2)%N];
         glm::vec3 b = r - q;
@@ -354,143 +614,157 @@ PolyhedralMeshBridge::addPolygon( const Interface interface,
         if( glm::dot( pos[(i+1)%N], m ) - d < std::numeric_limits<float>::epsilon() ) {
             convex = false;
         }
-        for( uint k=3; k<N && convex; k++) {
+        for( Index k=3; k<N && convex; k++) {
             if( glm::dot( pos[(i+k)%N], m ) - d > -std::numeric_limits<float>::epsilon() ) {
                 convex = false;
             }
         }
     }
     if( convex ) {
-        cell_a = cell_a | 0x40000000;
-        cell_b = cell_b | 0x40000000;
+        cell_a = cell_a | IndexFlagLo;
+        cell_b = cell_b | IndexFlagLo;
     }
 
     if( !m_triangulate ) {
         m_polygon_info.push_back( cell_a );
         m_polygon_info.push_back( cell_b );
-        std::copy_n( nrm_ix.begin(), N, std::back_inserter( m_polygon_nrm_ix ) );
-        std::copy_n( vtx_ix.begin(), N, std::back_inserter( m_polygon_vtx_ix ) );
+        m_polygon_nrm_ix.insert( m_polygon_nrm_ix.end(), nrm_ix.data(), nrm_ix.data() + N );
+        m_polygon_vtx_ix.insert( m_polygon_vtx_ix.end(), vtx_ix.data(), vtx_ix.data() + N );
         m_polygon_offset.push_back( m_polygon_vtx_ix.size() );
+        return;
     }
-    else {
 
-        uint s = 0;
-        if( N > 3) {
-            if( N > 4 ) {
-                glm::vec3 b(0.f);
-                for(uint i=0; i<N; i++) {
-                    b += pos[i];
-                }
-                b = (1.f/N)*b;
-                glm::vec3 na = glm::abs(n);
-                glm::vec3 m;
-                if( (na.x < na.y) && (na.x < na.z) ) {
-                    m = glm::vec3( 1.f, 0.f, 0.f );
-                }
-                else if( na.y < na.z ) {
-                    m = glm::vec3( 0.f, 1.f, 0.f );
-                }
-                else {
-                    m = glm::vec3( 0.f, 0.f, 1.f );
-                }
-                glm::vec3 u = glm::normalize( m - (glm::dot(m,n)/glm::dot(n,n))*n );
-                glm::vec3 v = glm::normalize( glm::cross( n,u ) );
-                // project to plane
-                std::vector<glm::vec2> pos2( N );
-                for( uint i=0; i<N; i++ ) {
-                    glm::vec3 t = pos[i]-b;
-                    pos2[i] = glm::vec2( glm::dot(u, t), glm::dot(v, t) );
-                }
+    // Emit a triangle, the normal index of a corner carries the flags of the
+    // edge from the corner to the next.
+    auto triangle = [&]( const Index v0, const Index v1, const Index v2,
+                         const Index n0, const Index n1, const Index n2 )
+    {
+        m_polygon_info.push_back( cell_a );
+        m_polygon_info.push_back( cell_b );
+        m_polygon_nrm_ix.push_back( n0 );
+        m_polygon_nrm_ix.push_back( n1 );
+        m_polygon_nrm_ix.push_back( n2 );
+        m_polygon_vtx_ix.push_back( v0 );
+        m_polygon_vtx_ix.push_back( v1 );
+        m_polygon_vtx_ix.push_back( v2 );
+        m_polygon_offset.push_back( m_polygon_vtx_ix.size() );
+    };
+
+    if( N == 3 ) {
+        triangle( vtx_ix[0], vtx_ix[1], vtx_ix[2],
+                  nrm_ix[0], nrm_ix[1], nrm_ix[2] );
+        return;
+    }
 
-                while( N > 4 ) {
-                    glm::uvec3 ear(0,1,2);
-                    // Search backwards so we minimize the amount data shift
-                    for(uint i=N; i>0; i--) {
-                        glm::uvec3 j( i-1, i%N, (i+1)%N );
-                        glm::vec2 a = pos2[ j.x ];
-                        glm::vec2 b = pos2[ j.y ];
-                        glm::vec2 c = pos2[ j.z ];
-                        glm::vec2 ab = b-a;
-                        glm::vec2 ac = c-a;
-                        float det = (ab.x*ac.y) - (ac.x*ab.y);
-                        // Is current triangle a convex corner?
-                        if( det > 1e-6 ) {
-                            bool success = true;
-                            // Is current triangle void of other points?
-                            for(uint k=3; k<N; k++) {
-                                uint l = (j.x+k)%N;
-                                glm::vec2 p = pos2[ l ];
-
-                                if( ((p.x-a.x)*ab.y) - (ab.x*(p.y-a.y)) > 0.f ) {   // ab
-                                    if( ((p.x-c.x)*ac.y) - (ac.x*(p.y-c.y)) < 0.f ) {   // ca
-                                        glm::vec2 bc = c-b;
-                                        if( ((p.x-b.x)*bc.y) - (bc.x*(p.y-b.y)) > 0.f ) {   // bc
-                                            success = false;
-                                            break;
-                                        }
-                                    }
+    // Corners of the quad that remains when ears are clipped off.
+    Index quad[4] = { 0, 1, 2, 3 };
+    if( N > 4 ) {
+        glm::vec3 b(0.f);
+        for(Index i=0; i<N; i++) {
+            b += pos[i];
+        }
+        b = (1.f/N)*b;
+        glm::vec3 na = glm::abs(n);
+        glm::vec3 m;
+        if( (na.x < na.y) && (na.x < na.z) ) {
+            m = glm::vec3( 1.f, 0.f, 0.f );
+        }
+        else if( na.y < na.z ) {
+            m = glm::vec3( 0.f, 1.f, 0.f );
+        }
+        else {
+            m = glm::vec3( 0.f, 0.f, 1.f );
+        }
+        glm::vec3 u = glm::normalize( m - (glm::dot(m,n)/glm::dot(n,n))*n );
+        glm::vec3 v = glm::normalize( glm::cross( n,u ) );
+        // project to plane
+        ScratchArray<glm::vec2,scratch_corners> pos2( N );
+        for( Index i=0; i<N; i++ ) {
+            glm::vec3 t = pos[i]-b;
+            pos2[i] = glm::vec2( glm::dot(u, t), glm::dot(v, t) );
+        }
+
+        // The remaining corners are linked in a ring instead of being shifted
+        // down in the arrays as ears are clipped off.
+        ScratchArray<Index,scratch_corners> next( N );
+        ScratchArray<Index,scratch_corners> prev( N );
+        for( Index i=0; i<N; i++ ) {
+            next[i] = (i+1)%N;
+            prev[i] = (i+N-1)%N;
+        }
+        Index first = 0;
+
+        while( N > 4 ) {
+            // Search the tips of the ears backwards from the first remaining
+            // corner, which is the order of a search backwards from the end
+            // of the arrays after shifting.
+            Index ear = next[ first ];
+            Index tip = first;
+            for( Index i=0; i<N; i++, tip = prev[tip] ) {
+                const glm::vec2 a = pos2[ prev[tip] ];
+                const glm::vec2 b = pos2[ tip ];
+                const glm::vec2 c = pos2[ next[tip] ];
+                glm::vec2 ab = b-a;
+                glm::vec2 ac = c-a;
+                float det = (ab.x*ac.y) - (ac.x*ab.y);
+                // Is current triangle a convex corner?
+                if( det > 1e-6 ) {
+                    bool success = true;
+                    // Is current triangle void of other points?
+                    for( Index l=next[ next[tip] ]; l!=prev[tip]; l=next[l] ) {
+                        glm::vec2 p = pos2[ l ];
+
+                        if( ((p.x-a.x)*ab.y) - (ab.x*(p.y-a.y)) > 0.f ) {   // ab
+                            if( ((p.x-c.x)*ac.y) - (ac.x*(p.y-c.y)) < 0.f ) {   // ca
+                                glm::vec2 bc = c-b;
+                                if( ((p.x-b.x)*bc.y) - (bc.x*(p.y-b.y)) > 0.f ) {   // bc
+                                    success = false;
+                                    break;
                                 }
                             }
-                            if( success ) {
-                                ear = j;
-                                break;
-                            }
                         }
                     }
-
-                    // emit ear
-                    m_polygon_info.push_back( cell_a );
-                    m_polygon_info.push_back( cell_b );
-                    m_polygon_nrm_ix.push_back( nrm_ix[ ear.x ] );
-                    m_polygon_nrm_ix.push_back( nrm_ix[ ear.y ] );
-                    m_polygon_nrm_ix.push_back( nrm_ix[ ear.x ] & 0x3fffffffu );
-                    m_polygon_vtx_ix.push_back( vtx_ix[ ear.x ] );
-                    m_polygon_vtx_ix.push_back( vtx_ix[ ear.y ] );
-                    m_polygon_vtx_ix.push_back( vtx_ix[ ear.z ] );
-                    m_polygon_offset.push_back( m_polygon_vtx_ix.size() );
-
-                    // Decrease polygon count and shift data
-                    N--;
-                    nrm_ix[ ear.x ] = nrm_ix[ ear.x ] & 0x3fffffffu;
-                    for( uint k=ear.y; k<N; k++ ) {
-                        nrm_ix[k] = nrm_ix[k+1];
-                        vtx_ix[k] = vtx_ix[k+1];
-                        pos2[k] = pos2[k+1];
+                    if( success ) {
+                        ear = tip;
+                        break;
                     }
                 }
             }
-            glm::vec3 ab = pos[1]-pos[0];
-            glm::vec3 bc = pos[2]-pos[1];
-            glm::vec3 cd = pos[3]-pos[2];
-            glm::vec3 da = pos[0]-pos[3];
-            float c0 = glm::dot( glm::cross( ab, bc ), glm::cross( cd, da ) );
-            float c1 = glm::dot( glm::cross( bc, cd ), glm::cross( da, ab ) );
-            if( c1 > c0 ) {
-                s = 1;
+
+            // emit ear and unlink its tip
+            const Index e0 = prev[ ear ];
+            const Index e2 = next[ ear ];
+            triangle( vtx_ix[ e0 ], vtx_ix[ ear ], vtx_ix[ e2 ],
+                      nrm_ix[ e0 ], nrm_ix[ ear ], nrm_ix[ e0 ] & IndexMask );
+            nrm_ix[ e0 ] = nrm_ix[ e0 ] & IndexMask;
+            next[ e0 ] = e2;
+            prev[ e2 ] = e0;
+            if( ear == first ) {
+                first = e2;
             }
-            // emit first triangle of quad
-            m_polygon_info.push_back( cell_a );
-            m_polygon_info.push_back( cell_b );
-            m_polygon_nrm_ix.push_back( nrm_ix[ 2+s     ] );
-            m_polygon_nrm_ix.push_back( nrm_ix[ (3+s)%4 ] );
-            m_polygon_nrm_ix.push_back( nrm_ix[ 0+s     ]  & 0x3fffffffu );
-            m_polygon_vtx_ix.push_back( vtx_ix[ 2+s     ] );
-            m_polygon_vtx_ix.push_back( vtx_ix[ (3+s)%4 ] );
-            m_polygon_vtx_ix.push_back( vtx_ix[ 0+s     ] );
-            m_polygon_offset.push_back( m_polygon_vtx_ix.size() );
-
-            nrm_ix[ 2+s ] = nrm_ix[ 2+s ] & 0x3fffffffu;
+            N--;
         }
-        m_polygon_info.push_back( cell_a );
-        m_polygon_info.push_back( cell_b );
-        m_polygon_nrm_ix.push_back( nrm_ix[ 0+s ] );
-        m_polygon_nrm_ix.push_back( nrm_ix[ 1+s ] );
-        m_polygon_nrm_ix.push_back( nrm_ix[ 2+s ] );
-        m_polygon_vtx_ix.push_back( vtx_ix[ 0+s ] );
-        m_polygon_vtx_ix.push_back( vtx_ix[ 1+s ] );
-        m_polygon_vtx_ix.push_back( vtx_ix[ 2+s ] );
-        m_polygon_offset.push_back( m_polygon_vtx_ix.size() );
+        quad[0] = first;
+        quad[1] = next[ quad[0] ];
+        quad[2] = next[ quad[1] ];
+        quad[3] = next[ quad[2] ];
     }
+
+    glm::vec3 ab = pos[1]-pos[0];
+    glm::vec3 bc = pos[2]-pos[1];
+    glm::vec3 cd = pos[3]-pos[2];
+    glm::vec3 da = pos[0]-pos[3];
+    float c0 = glm::dot( glm::cross( ab, bc ), glm::cross( cd, da ) );
+    float c1 = glm::dot( glm::cross( bc, cd ), glm::cross( da, ab ) );
+    const Index s = c1 > c0 ? 1 : 0;
+    const Index q0 = quad[ 0+s ];
+    const Index q1 = quad[ 1+s ];
+    const Index q2 = quad[ 2+s ];
+    const Index q3 = quad[ (3+s)%4 ];
+    triangle( vtx_ix[ q2 ], vtx_ix[ q3 ], vtx_ix[ q0 ],
+              nrm_ix[ q2 ], nrm_ix[ q3 ], nrm_ix[ q0 ] & IndexMask );
+    triangle( vtx_ix[ q0 ], vtx_ix[ q1 ], vtx_ix[ q2 ],
+              nrm_ix[ q0 ], nrm_ix[ q1 ], nrm_ix[ q2 ] & IndexMask );
 }
 
 
@@ -498,18 +772,18 @@ void
 PolyhedralMeshBridge::addTriangle( const Interface interface,
                              const Segment s0, const Segment s1, const Segment s2 )
 {
-    Logger log = getLogger( package + ".foo" );
+    static const Logger log = getLogger( package + ".addTriangle" );
     if( m_tri_chunk_N == m_chunk_size ) {
         allocTriangleChunks();
     }
-    unsigned int flags_a =
-            (s0.edgeA() ? 1u<<30u : 0u ) |
-            (s1.edgeA() ? 1u<<29u : 0u ) |
-            (s2.edgeA() ? 1u<<28u : 0u );
-    unsigned int flags_b =
-            (s0.edgeB() ? 1u<<30u : 0u ) |
-            (s1.edgeB() ? 1u<<29u : 0u ) |
-            (s2.edgeB() ? 1u<<28u : 0u );
+    const Index flags_a =
+            (s0.edgeA() ? IndexFlagLo    : 0u ) |
+            (s1.edgeA() ? IndexFlagLo>>1 : 0u ) |
+            (s2.edgeA() ? IndexFlagLo>>2 : 0u );
+    const Index flags_b =
+            (s0.edgeB() ? IndexFlagLo    : 0u ) |
+            (s1.edgeB() ? IndexFlagLo>>1 : 0u ) |
+            (s2.edgeB() ? IndexFlagLo>>2 : 0u );
 
 #if 0
     Segment segments[4] = { s0, s1, s2 };
@@ -621,21 +895,21 @@ PolyhedralMeshBridge::addEdge( const Index ix0, const Index ix1,
          const Index cell_c, const Index cell_d )
 {
 #ifdef EXTRACT_EDGE_GEOMETRY
-    Logger log = getLogger( package + ".addEdge" );
+    static const Logger log = getLogger( package + ".addEdge" );
 
     // Make sure that edge is not degenerate
     LOGGER_INVARIANT_NOT_EQUAL( log, ix0, ix1 );
     // Make sure that we don't have the same cell on both sides of a pillar face
-    if( (cell_a!= ~0u) && (cell_c != ~0u) ) {
+    if( (cell_a != ~Index(0u)) && (cell_c != ~Index(0u)) ) {
         LOGGER_INVARIANT_NOT_EQUAL( log, cell_a, cell_c );
     }
-    if( (cell_a!= ~0u) && (cell_d != ~0u) ) {
+    if( (cell_a != ~Index(0u)) && (cell_d != ~Index(0u)) ) {
         LOGGER_INVARIANT_NOT_EQUAL( log, cell_a, cell_d );
     }
-    if( (cell_a!= ~0u) && (cell_c != ~0u) ) {
+    if( (cell_a != ~Index(0u)) && (cell_c != ~Index(0u)) ) {
         LOGGER_INVARIANT_NOT_EQUAL( log, cell_b, cell_c );
     }
-    if( (cell_b!= ~0u) && (cell_d != ~0u) ) {
+    if( (cell_b != ~Index(0u)) && (cell_d != ~Index(0u)) ) {
         LOGGER_INVARIANT_NOT_EQUAL( log, cell_b, cell_d );
     }
 
@@ -652,11 +926,234 @@ PolyhedralMeshBridge::addEdge( const Index ix0, const Index ix1,
 
 
 
+void
+PolyhedralMeshBridge::reorder( utils::ThreadPool* pool )
+{
+    Logger log = getLogger( package + ".reorder" );
+    LOGGER_DEBUG( log, "Reordering cells and vertices... " );
+    PerfTimer start;
+
+    utils::ThreadPool& threads = pool != NULL ? *pool : utils::ThreadPool::instance();
+    const size_t tasks = 4*threads.concurrency();
+
+    // run body( begin, end ) concurrently over ranges of [0,n).
+    auto parallel = [&]( const size_t n, const std::function<void(size_t,size_t)>& body )
+    {
+        const size_t range = (n + tasks - 1)/tasks;
+        threads.run( tasks, [&]( size_t t ) {
+            const size_t b = std::min( n, t*range );
+            const size_t e = std::min( n, b + range );
+            if( b < e ) {
+                body( b, e );
+            }
+        } );
+    };
+
+    const Index cells = m_cell_index.size();
+    const Index vertices = m_vertices.size();
+    const Index polygons = m_polygon_offset.size() - 1u;
+
+    // --- cells along a Morton curve through the centroids, with the same
+    //     scale along all axes so that the curve follows the geometry.
+    Real4 minimum, maximum;
+    boundingBox( minimum, maximum );
+    Real extent = 0.f;
+    for( unsigned int k=0; k<3; k++ ) {
+        extent = std::max( extent, maximum.v[k] - minimum.v[k] );
+    }
+    const Real scale = extent > 0.f ? Real( (1u<<21u) - 1u ) / extent : 0.f;
+
+    std::vector< std::pair<uint64_t,Index> > codes( cells );
+    parallel( cells, [&]( size_t b, size_t e ) {
+        for( size_t i=b; i<e; i++ ) {
+            const Index* corner = m_cell_corner.data() + 8*i;
+            uint64_t code = 0u;
+            for( unsigned int k=0; k<3; k++ ) {
+                Real c = 0.f;
+                for( unsigned int l=0; l<8; l++ ) {
+                    c += m_vertices[ corner[l] ].v[k];
+                }
+                const Real q = scale*( 0.125f*c - minimum.v[k] );
+                const uint64_t u = q > 0.f ? std::min( uint64_t( q ), uint64_t( (1u<<21u) - 1u ) ) : 0u;
+                code = code | (spreadBits( u ) << k);
+            }
+            codes[i] = std::make_pair( code, Index(i) );
+        }
+    } );
+    std::sort( codes.begin(), codes.end() );
+
+    std::vector<Index> cell_rank( cells );      // new index of each cell
+    for( Index i=0; i<cells; i++ ) {
+        cell_rank[ codes[i].second ] = i;
+    }
+
+    // cell index with flags in the bits above mask, a cell equal to mask is no cell.
+    auto cell = [&]( const Index value, const Index mask ) -> Index
+    {
+        const Index c = value & mask;
+        if( (c == mask) || (cells <= c) ) {
+            return value;
+        }
+        return (value & ~mask) | cell_rank[c];
+    };
+
+    {
+        std::vector<Index> cell_index( cells );
+        std::vector<Index> cell_corner( 8*cells );
+        std::vector<Index> cell_order( cells );
+        parallel( cells, [&]( size_t b, size_t e ) {
+            for( size_t i=b; i<e; i++ ) {
+                const Index o = codes[i].second;
+                cell_index[i] = m_cell_index[o];
+                std::copy( m_cell_corner.begin() + 8*o, m_cell_corner.begin() + 8*o + 8,
+                           cell_corner.begin() + 8*i );
+                cell_order[i] = m_cell_order.empty() ? o : m_cell_order[o];
+            }
+        } );
+        m_cell_index.swap( cell_index );
+        m_cell_corner.swap( cell_corner );
+        m_cell_order.swap( cell_order );
+    }
+    codes.clear();
+    codes.shrink_to_fit();
+
+    // --- polygons sorted by the first of their cells, stable to keep
+    //     the polygons of a cell in the order they were produced.
+    std::vector< std::pair<Index,Index> > polygon_keys( polygons );
+    parallel( polygons, [&]( size_t b, size_t e ) {
+        for( size_t p=b; p<e; p++ ) {
+            const Index a = cell( m_polygon_info[2*p+0], IndexMask ) & IndexMask;
+            const Index c = cell( m_polygon_info[2*p+1], IndexMask ) & IndexMask;
+            polygon_keys[p] = std::make_pair( std::min( a, c ), Index(p) );
+        }
+    } );
+    std::sort( polygon_keys.begin(), polygon_keys.end() );
+    {
+        std::vector<Index> polygon_info( 2*polygons );
+        std::vector<Index> polygon_offset( polygons + 1u );
+        polygon_offset[0] = 0u;
+        for( Index p=0; p<polygons; p++ ) {
+            const Index o = polygon_keys[p].second;
+            polygon_offset[p+1] = polygon_offset[p] + (m_polygon_offset[o+1] - m_polygon_offset[o]);
+        }
+        std::vector<Index> polygon_vtx_ix( m_polygon_vtx_ix.size() );
+        std::vector<Index> polygon_nrm_ix( m_polygon_nrm_ix.size() );
+        parallel( polygons, [&]( size_t b, size_t e ) {
+            for( size_t p=b; p<e; p++ ) {
+                const Index o = polygon_keys[p].second;
+                polygon_info[2*p+0] = cell( m_polygon_info[2*o+0], IndexMask );
+                polygon_info[2*p+1] = cell( m_polygon_info[2*o+1], IndexMask );
+                std::copy( m_polygon_vtx_ix.begin() + m_polygon_offset[o],
+                           m_polygon_vtx_ix.begin() + m_polygon_offset[o+1],
+                           polygon_vtx_ix.begin() + polygon_offset[p] );
+                std::copy( m_polygon_nrm_ix.begin() + m_polygon_offset[o],
+                           m_polygon_nrm_ix.begin() + m_polygon_offset[o+1],
+                           polygon_nrm_ix.begin() + polygon_offset[p] );
+            }
+        } );
+        m_polygon_info.swap( polygon_info );
+        m_polygon_offset.swap( polygon_offset );
+        m_polygon_vtx_ix.swap( polygon_vtx_ix );
+        m_polygon_nrm_ix.swap( polygon_nrm_ix );
+    }
+    polygon_keys.clear();
+    polygon_keys.shrink_to_fit();
+
+    // --- vertices in the order of first use, unused vertices last.
+    std::vector<Index> vertex_rank( vertices, ~Index(0u) );
+    Index next = 0u;
+    auto touch = [&]( const Index v )
+    {
+        if( vertex_rank[v] == ~Index(0u) ) {
+            vertex_rank[v] = next++;
+        }
+    };
+    for( Index i=0; i<8*cells; i++ ) {
+        touch( m_cell_corner[i] );
+    }
+    for( size_t i=0; i<m_polygon_vtx_ix.size(); i++ ) {
+        touch( m_polygon_vtx_ix[i] );
+    }
+    for( size_t i=0; i<m_edges.size(); i++ ) {
+        touch( m_edges[i].m_cp[0] );
+        touch( m_edges[i].m_cp[1] );
+    }
+    {
+        auto vt = m_tri_vtx_chunks.begin();
+        for( Index t=0; t < m_tri_N; t += m_chunk_size, ++vt ) {
+            const Index n = (m_tri_N - t) < m_chunk_size ? (m_tri_N - t) : m_chunk_size;
+            for( Index i=0; i<3*n; i++ ) {
+                touch( (*vt)[i] );
+            }
+        }
+    }
+    for( Index v=0; v<vertices; v++ ) {
+        touch( v );
+    }
+
+    {
+        std::vector<Real4> vertices_new( vertices );
+        parallel( vertices, [&]( size_t b, size_t e ) {
+            for( size_t v=b; v<e; v++ ) {
+                vertices_new[ vertex_rank[v] ] = m_vertices[v];
+            }
+        } );
+        m_vertices.swap( vertices_new );
+    }
+    parallel( 8*cells, [&]( size_t b, size_t e ) {
+        for( size_t i=b; i<e; i++ ) {
+            m_cell_corner[i] = vertex_rank[ m_cell_corner[i] ];
+        }
+    } );
+    parallel( m_polygon_vtx_ix.size(), [&]( size_t b, size_t e ) {
+        for( size_t i=b; i<e; i++ ) {
+            m_polygon_vtx_ix[i] = vertex_rank[ m_polygon_vtx_ix[i] ];
+        }
+    } );
+    parallel( m_edges.size(), [&]( size_t b, size_t e ) {
+        for( size_t i=b; i<e; i++ ) {
+            Edge& edge = m_edges[i];
+            edge.m_cp[0] = vertex_rank[ edge.m_cp[0] ];
+            edge.m_cp[1] = vertex_rank[ edge.m_cp[1] ];
+            for( unsigned int k=0; k<4; k++ ) {
+                edge.m_cells[k] = cell( edge.m_cells[k], IndexMask );
+            }
+        }
+    } );
+    {
+        // addTriangle() keeps edge flags in IndexFlagLo and the two bits below.
+        const Index tri_cell_mask = (IndexFlagLo>>2) - 1u;
+        auto it = m_tri_info_chunks.begin();
+        auto vt = m_tri_vtx_chunks.begin();
+        for( Index t=0; t < m_tri_N; t += m_chunk_size, ++it, ++vt ) {
+            const Index n = (m_tri_N - t) < m_chunk_size ? (m_tri_N - t) : m_chunk_size;
+            for( Index i=0; i<2*n; i++ ) {
+                (*it)[i] = cell( (*it)[i], tri_cell_mask );
+            }
+            for( Index i=0; i<3*n; i++ ) {
+                (*vt)[i] = vertex_rank[ (*vt)[i] ];
+            }
+        }
+    }
+
+    PerfTimer stop;
+    LOGGER_DEBUG( log, "Reordering cells and vertices... done (" << ((1000.0)*PerfTimer::delta( start, stop)) << "ms)" );
+}
+
 void
 PolyhedralMeshBridge::process()
 {
     Logger log = getLogger( package + ".process" );
 
+#ifdef FRVIEW_REORDER_MESH
+    if( hasPartListener() ) {
+        LOGGER_DEBUG( log, "Parts have been passed on, keeping the order." );
+    }
+    else {
+        reorder();
+    }
+#endif
+
 #ifdef zCHECK_INVARIANTS
     std::vector<unsigned int> indices(3);
     std::vector<CellSanityChecker> cells( cellCount() );
@@ -18,6 +18,7 @@
 #pragma once
 #include <vector>
 #include <list>
+#include <functional>
 #include "utils/Logger.hpp"
 #include "bridge/AbstractMeshBridge.hpp"
 
@@ -27,12 +28,20 @@ namespace render {
     }
 }
 
+namespace utils {
+    class ThreadPool;
+}
+
 namespace bridge {
 
+class PolyhedralMeshCache;
+class PolyhedralMeshCounter;
+
 class PolyhedralMeshBridge
         : public AbstractMeshBridge
 {
     friend class render::mesh::PolyhedralMeshGPUModel;
+    friend class PolyhedralMeshCache;
 public:
     /** Explicit edge.
      *
@@ -68,22 +77,148 @@ public:
                           const Orientation orientation,
                           const bool fault = false )
         {   bool boundary =
-                    ((cell_a & 0x3fffffffu) == 0x3fffffffu) ||
-                    ((cell_b & 0x3fffffffu) == 0x3fffffffu);
+                    ((cell_a & IndexMask) == IndexMask) ||
+                    ((cell_b & IndexMask) == IndexMask);
             bool internal_fault = !boundary && fault;
 
 
-            m_value[0] = (cell_a & 0x3fffffffu)  | (internal_fault?(1u<<31u):0 );
-            m_value[1] = (cell_b & 0x3fffffffu) | (internal_fault?(1u<<31u):0 );
+            m_value[0] = (cell_a & IndexMask)  | (internal_fault?IndexFlagHi:0u );
+            m_value[1] = (cell_b & IndexMask) | (internal_fault?IndexFlagHi:0u );
         }
-        unsigned int    m_value[2] __attribute__((aligned(8)));
+        Index           m_value[2] __attribute__((aligned(8)));
+    };
+
+
+    /** Sizes of the output arrays at some point during tessellation. */
+    struct Mark {
+        Index   m_vertices;
+        Index   m_normals;
+        Index   m_edges;
+        Index   m_polygons;
+        Index   m_indices;      ///< Vertex (and normal) indices of the polygons.
+        Index   m_triangles;
+    };
+
+    /** Output added between two marks, see extract().
+      *
+      * Vertex, normal and cell indices refer to the bridge the part was
+      * extracted from, so parts can be appended in order to rebuild its
+      * output, see render::mesh::PolyhedralMeshGPUModel::append().
+      */
+    struct Part {
+        Mark                        m_from;             ///< Output of the bridge before the part.
+        Mark                        m_reserved;         ///< Output the bridge has room for, a hint of the final size.
+        Index                       m_cell_count;       ///< Number of cells of the bridge.
+        Real4                       m_bounds[2];        ///< Box that all vertices lie within, empty if unknown, see growBounds().
+        std::vector<Real4>          m_vertices;
+        std::vector<Real4>          m_normals;
+        std::vector<Index>          m_polygon_info;
+        std::vector<Index>          m_polygon_offset;   ///< Offset past the last index of each polygon.
+        std::vector<Index>          m_polygon_vtx_ix;
+        std::vector<Index>          m_polygon_nrm_ix;
+        std::vector<Index>          m_cell_ranges;      ///< Begin and end of each range of cells in the part.
+        std::vector<Index>          m_cell_index;       ///< Global index of the cells in the ranges.
+        std::vector<Index>          m_cell_corner;      ///< Corners of the cells in the ranges.
     };
 
+    /** Notification that a part of the output is complete, see setPartListener().
+      *
+      * The argument holds the begin and end of each range of cells that were
+      * set since the previous notification.
+      */
+    typedef std::function<void( const std::vector<Index>& cell_ranges )> PartListener;
+
+    /** Stand-in that counts the output, see cornerpoint::Tessellator. */
+    typedef PolyhedralMeshCounter Counter;
 
     PolyhedralMeshBridge( bool triangulate );
 
     ~PolyhedralMeshBridge();
 
+    bool
+    triangulate() const { return m_triangulate; }
+
+    /** Current sizes of the output arrays. */
+    Mark
+    mark() const;
+
+    /** Append the output that shards have produced after a mark.
+      *
+      * Used to assemble a tessellation built in bands by concurrent
+      * tessellators, see cornerpoint::Tessellator. The vertices and normals
+      * of each shard after its mark are appended in shard order, and the
+      * edges and polygons after the mark are appended with their vertex and
+      * normal indices rebased. Cell indices are kept as is. The shards are
+      * copied concurrently.
+      *
+      * \param[in] shards       Bridges with the same triangulate setting.
+      * \param[in] from         Output of each shard before this is skipped.
+      * \param[in] vertex_maps  Index in this bridge of each vertex of a shard
+      *                         before its mark, ~Index(0) if it has none.
+      * \param[in] pool         Threads to use, NULL selects
+      *                         utils::ThreadPool::instance().
+      * \throws std::runtime_error if the output after a mark refers to a
+      *         vertex without an index in this bridge or to a normal before
+      *         the mark, or if the merged output has more vertices or normals
+      *         than an index can address.
+      */
+    void
+    merge( const std::vector<const PolyhedralMeshBridge*>&  shards,
+           const std::vector<Mark>&                         from,
+           const std::vector< std::vector<Index> >&         vertex_maps,
+           utils::ThreadPool*                               pool = NULL );
+
+    /** Set a function to notify whenever a part of the output is complete.
+      *
+      * Lets the output be shown while it is produced, e.g., cornerpoint::Tessellator
+      * notifies after each band of rows. When notified, all polygons refer to
+      * vertices and normals that exist, and the cells in the ranges are set.
+      * Polygons may refer to cells that are not set yet. The listener is
+      * called from the producing threads, but never concurrently.
+      */
+    void
+    setPartListener( const PartListener& listener ) { m_part_listener = listener; }
+
+    /** True if a part listener is set, i.e., if producers should notify. */
+    bool
+    hasPartListener() const { return (bool)m_part_listener; }
+
+    /** Notify the part listener, if any, that the output so far is complete. */
+    void
+    partDone( const std::vector<Index>& cell_ranges ) const
+    { if( m_part_listener ) { m_part_listener( cell_ranges ); } }
+
+    /** Copy the output added after a mark, and the cells in some ranges.
+      *
+      * Triangles and edges are not copied.
+      *
+      * \param[out] part         The output, replaces the contents.
+      * \param[in]  from         Output before this is skipped.
+      * \param[in]  cell_ranges  Begin and end of each range of cells to copy.
+      */
+    void
+    extract( Part&                       part,
+             const Mark&                 from,
+             const std::vector<Index>&   cell_ranges ) const;
+
+    /** Reserve room for the given output in addition to the current output.
+      *
+      * With the exact sizes, e.g., from a PolyhedralMeshCounter, the arrays
+      * are never reallocated while the output is added.
+      */
+    void
+    reserve( const Mark& sizes );
+
+    /** Grow the box that the vertices are known to lie within.
+      *
+      * Lets parts be given a coordinate frame before all vertices exist, see
+      * extract(). The box is empty (minimum larger than maximum) unless a
+      * producer knows the extent of its output up front, e.g.,
+      * cornerpoint::Tessellator.
+      */
+    void
+    growBounds( const Real4& minimum, const Real4& maximum );
+
     void
     reserveVertices( Index N );
 
@@ -158,7 +293,34 @@ public:
     void
     boundingBox( Real4& minimum, Real4& maximum ) const;
 
-
+    /** Original index of each cell, empty if the cells have not been reordered, see reorder(). */
+    const std::vector<Index>&
+    cellOrder() const { return m_cell_order; }
+
+    /** Renumber cells and vertices for locality of reference.
+      *
+      * Cells are sorted along a Morton curve through their centroids,
+      * polygons are sorted by the first of their cells, and vertices are
+      * numbered in the order the cells, polygons, edges and triangles first
+      * use them. All index arrays are remapped and flags are kept. Global cell
+      * indices move with their cells, and cellOrder() records the permutation
+      * so that data in the original cell order, e.g., fields, can follow.
+      *
+      * Parts that have been passed to the part listener refer to the old
+      * order, so reordering is only meaningful when no listener is set.
+      *
+      * \param[in] pool  Threads to use, NULL selects
+      *                  utils::ThreadPool::instance().
+      */
+    void
+    reorder( utils::ThreadPool* pool = NULL );
+
+    /** Finish the output.
+      *
+      * If built with FRVIEW_REORDER_MESH defined (the REORDER_MESH build
+      * option) and no part listener is set, the output is reordered, see
+      * reorder().
+      */
     void
     process();
 
@@ -166,8 +328,10 @@ protected:
     bool                        m_triangulate;
     std::vector<Real4>          m_vertices;
     std::vector<Real4>          m_normals;
-    std::vector<unsigned int>   m_cell_index;
-    std::vector<unsigned int>   m_cell_corner;
+    Real4                       m_bounds[2];
+    std::vector<Index>          m_cell_index;
+    std::vector<Index>          m_cell_corner;
+    std::vector<Index>          m_cell_order;
 
     std::vector<Edge>           m_edges;
 
@@ -185,6 +349,7 @@ protected:
     std::list<Index*>           m_tri_nrm_ix_chunks;
     std::list<Index*>           m_tri_info_chunks;
     std::list<Index*>           m_tri_vtx_chunks;
+    PartListener                m_part_listener;
 
     void
     allocTriangleChunks();
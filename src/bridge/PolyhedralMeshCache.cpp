@@ -0,0 +1,478 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ *
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "utils/Logger.hpp"
+#include "utils/PerfTimer.hpp"
+#include "utils/ThreadPool.hpp"
+#include "bridge/PolyhedralMeshBridge.hpp"
+#include "bridge/PolyhedralMeshCache.hpp"
+
+namespace bridge {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+const string package = "bridge.PolyhedralMeshCache";
+
+const char cache_magic[8] = { 'F', 'R', 'V', 'T', 'E', 'S', 'S', '\0' };
+
+/** Alignment of each array in the file, a page to make mapped arrays aligned. */
+const uint64_t section_alignment = 4096u;
+
+/** The arrays of a bridge, in file order. */
+enum Section {
+    SECTION_VERTICES = 0,
+    SECTION_NORMALS,
+    SECTION_CELL_INDEX,
+    SECTION_CELL_CORNER,
+    SECTION_CELL_ORDER,
+    SECTION_EDGES,
+    SECTION_POLYGON_INFO,
+    SECTION_POLYGON_OFFSET,
+    SECTION_POLYGON_VTX_IX,
+    SECTION_POLYGON_NRM_IX,
+    SECTION_TRIANGLE_VTX,
+    SECTION_TRIANGLE_NRM_IX,
+    SECTION_TRIANGLE_INFO,
+    SECTION_N
+};
+
+struct CacheSection {
+    uint64_t    m_offset;   ///< Byte offset from start of file, multiple of section_alignment.
+    uint64_t    m_size;     ///< Size in bytes.
+};
+
+/** Sidecar file header, the sections follow at aligned offsets. */
+struct CacheHeader {
+    char            m_magic[8];
+    uint32_t        m_version;
+    uint32_t        m_index_size;
+    uint32_t        m_real4_size;
+    uint32_t        m_edge_size;
+    uint32_t        m_triangulate;
+    uint32_t        m_sections;
+    uint64_t        m_key;
+    CacheSection    m_section[ SECTION_N ];
+    char            m_padding[ 8 ];
+};
+
+static_assert( sizeof(CacheHeader) == 256, "CacheHeader is not 256 bytes" );
+
+bool
+writeAll( int fd, const void* data, size_t bytes )
+{
+    const char* p = reinterpret_cast<const char*>( data );
+    while( bytes > 0 ) {
+        ssize_t n = write( fd, p, bytes );
+        if( n < 0 ) {
+            if( errno == EINTR ) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+inline
+uint64_t
+mix( uint64_t h, uint64_t v )
+{
+    h ^= v * 0x9e3779b97f4a7c15ull;
+    h = (h << 31u) | (h >> 33u);
+    return h * 0xbf58476d1ce4e5b9ull;
+}
+
+/** True if each index, with the bits above mask removed, is less than N,
+  * or equal to mask when that denotes no element.
+  */
+template<typename Index>
+bool
+indicesInRange( const Index*    ix,
+                const uint64_t  n,
+                const Index     mask,
+                const uint64_t  N,
+                const bool      allow_mask )
+{
+    for( uint64_t i=0; i<n; i++ ) {
+        const Index c = ix[i] & mask;
+        if( (N <= c) && !(allow_mask && (c == mask)) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename T>
+void
+copySection( vector<T>& dst, const char* map, const CacheSection& section )
+{
+    const T* src = reinterpret_cast<const T*>( map + section.m_offset );
+    dst.assign( src, src + section.m_size/sizeof(T) );
+}
+
+} // of anonymous namespace
+
+
+string
+PolyhedralMeshCache::path( const string& file )
+{
+    return file + ".frvtess";
+}
+
+uint64_t
+PolyhedralMeshCache::hash( const void* bytes, size_t n, uint64_t seed )
+{
+    const unsigned char* p = reinterpret_cast<const unsigned char*>( bytes );
+    uint64_t h[4] = { seed ^ 0x243f6a8885a308d3ull,
+                      seed ^ 0x13198a2e03707344ull,
+                      seed ^ 0xa4093822299f31d0ull,
+                      seed ^ 0x082efa98ec4e6c89ull };
+    size_t i = 0;
+    for( ; i+32 <= n; i+= 32 ) {
+        uint64_t v[4];
+        memcpy( v, p + i, 32 );
+        h[0] = mix( h[0], v[0] );
+        h[1] = mix( h[1], v[1] );
+        h[2] = mix( h[2], v[2] );
+        h[3] = mix( h[3], v[3] );
+    }
+    uint64_t r = mix( mix( h[0], h[1] ), mix( h[2], h[3] ) );
+    for( ; i<n; i++ ) {
+        r = mix( r, p[i] );
+    }
+    return mix( r, n );
+}
+
+bool
+PolyhedralMeshCache::load( PolyhedralMeshBridge&    bridge,
+                           const string&            file,
+                           const uint64_t           key )
+{
+    typedef PolyhedralMeshBridge::Index Index;
+    Logger log = getLogger( package + ".load" );
+
+    const PolyhedralMeshBridge::Mark mark = bridge.mark();
+    if( (mark.m_vertices != 0) || (mark.m_normals != 0) || (mark.m_edges != 0)
+            || (mark.m_polygons != 0) || (mark.m_triangles != 0) || (bridge.cellCount() != 0) )
+    {
+        LOGGER_WARN( log, "Bridge is not empty, ignoring cache." );
+        return false;
+    }
+
+    const string cache_path = path( file );
+    int fd = open( cache_path.c_str(), O_RDONLY );
+    if( fd < 0 ) {
+        return false;
+    }
+    struct stat finfo;
+    if( (fstat( fd, &finfo ) != 0) || ((size_t)finfo.st_size < sizeof(CacheHeader)) ) {
+        close( fd );
+        return false;
+    }
+    const uint64_t bytes = finfo.st_size;
+
+    // Check the header before mapping the arrays, a stale cache may be large.
+    CacheHeader header;
+    if( pread( fd, &header, sizeof(header), 0 ) != (ssize_t)sizeof(header) ) {
+        close( fd );
+        return false;
+    }
+    bool valid = (memcmp( header.m_magic, cache_magic, 8 ) == 0 )
+              && (header.m_version == version )
+              && (header.m_index_size == sizeof(Index) )
+              && (header.m_real4_size == sizeof(PolyhedralMeshBridge::Real4) )
+              && (header.m_edge_size == sizeof(PolyhedralMeshBridge::Edge) )
+              && (header.m_triangulate == (bridge.triangulate() ? 1u : 0u) )
+              && (header.m_sections == SECTION_N )
+              && (header.m_key == key );
+    const size_t element_size[ SECTION_N ] = {
+        sizeof(PolyhedralMeshBridge::Real4),
+        sizeof(PolyhedralMeshBridge::Real4),
+        sizeof(Index),
+        sizeof(Index),
+        sizeof(Index),
+        sizeof(PolyhedralMeshBridge::Edge),
+        sizeof(Index),
+        sizeof(Index),
+        sizeof(Index),
+        sizeof(Index),
+        sizeof(Index),
+        sizeof(Index),
+        sizeof(Index)
+    };
+    uint64_t count[ SECTION_N ];
+    for( unsigned int s=0; valid && s<SECTION_N; s++ ) {
+        const CacheSection& section = header.m_section[s];
+        valid = ((section.m_offset % section_alignment) == 0u)
+             && (section.m_offset >= sizeof(CacheHeader))
+             && (section.m_offset <= bytes)
+             && (section.m_size <= bytes - section.m_offset)
+             && ((section.m_size % element_size[s]) == 0u);
+        count[s] = section.m_size / element_size[s];
+    }
+    if( valid ) {
+        valid = (count[ SECTION_CELL_CORNER ] == 8u*count[ SECTION_CELL_INDEX ])
+             && (count[ SECTION_CELL_INDEX ] > 0u)
+             && ((count[ SECTION_CELL_ORDER ] == 0u) || (count[ SECTION_CELL_ORDER ] == count[ SECTION_CELL_INDEX ]))
+             && (count[ SECTION_POLYGON_OFFSET ] > 0u)
+             && (count[ SECTION_POLYGON_INFO ] == 2u*(count[ SECTION_POLYGON_OFFSET ]-1u))
+             && (count[ SECTION_POLYGON_VTX_IX ] == count[ SECTION_POLYGON_NRM_IX ])
+             && (count[ SECTION_TRIANGLE_VTX ] == count[ SECTION_TRIANGLE_NRM_IX ])
+             && (count[ SECTION_TRIANGLE_INFO ]*3u == count[ SECTION_TRIANGLE_VTX ]*2u)
+             && ((count[ SECTION_TRIANGLE_VTX ] % 3u) == 0u);
+    }
+    if( !valid ) {
+        close( fd );
+        LOGGER_DEBUG( log, "Cache " << cache_path << " is stale, ignoring." );
+        return false;
+    }
+
+    void* map = mmap( NULL, bytes, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if( map == MAP_FAILED ) {
+        LOGGER_WARN( log, "mmap() of " << cache_path << " failed: " << strerror(errno) );
+        return false;
+    }
+    madvise( map, bytes, MADV_WILLNEED );
+    const char* base = reinterpret_cast<const char*>( map );
+
+    PerfTimer start;
+    {
+        const Index* offset = reinterpret_cast<const Index*>( base + header.m_section[ SECTION_POLYGON_OFFSET ].m_offset );
+        const uint64_t polygons = count[ SECTION_POLYGON_OFFSET ] - 1u;
+        valid = offset[0] == 0u;
+        for( uint64_t i=0; valid && i<polygons; i++ ) {
+            valid = offset[i] <= offset[i+1];
+        }
+        valid = valid && (offset[ polygons ] == count[ SECTION_POLYGON_VTX_IX ]);
+    }
+    if( valid ) {
+        // A damaged payload must not reach the GPU models, so every index
+        // has to refer to an existing vertex, normal or cell. Flags are
+        // masked off, and a cell equal to the mask denotes no cell.
+        const Index none = ~Index(0u);
+        const Index tri_cell_mask = (PolyhedralMeshBridge::IndexFlagLo>>2) - 1u;
+        const Index mask = PolyhedralMeshBridge::IndexMask;
+        const uint64_t vertices = count[ SECTION_VERTICES ];
+        const uint64_t normals = count[ SECTION_NORMALS ];
+        const uint64_t cells = count[ SECTION_CELL_INDEX ];
+        vector<char> in_range( SECTION_N, 1 );
+        utils::ThreadPool::instance().run( SECTION_N, [&]( size_t s ) {
+            const Index* ix = reinterpret_cast<const Index*>( base + header.m_section[s].m_offset );
+            const uint64_t n = count[s];
+            bool ok = true;
+            switch( s ) {
+            case SECTION_CELL_CORNER:       ok = indicesInRange( ix, n, none, vertices, false ); break;
+            case SECTION_CELL_ORDER:        ok = indicesInRange( ix, n, none, cells, false ); break;
+            case SECTION_POLYGON_INFO:      ok = indicesInRange( ix, n, mask, cells, true ); break;
+            case SECTION_POLYGON_VTX_IX:    ok = indicesInRange( ix, n, none, vertices, false ); break;
+            case SECTION_POLYGON_NRM_IX:    ok = indicesInRange( ix, n, mask, normals, false ); break;
+            case SECTION_TRIANGLE_VTX:      ok = indicesInRange( ix, n, none, vertices, false ); break;
+            case SECTION_TRIANGLE_NRM_IX:   ok = indicesInRange( ix, n, mask, normals, false ); break;
+            case SECTION_TRIANGLE_INFO:     ok = indicesInRange( ix, n, tri_cell_mask, cells, true ); break;
+            case SECTION_EDGES:
+            {
+                const PolyhedralMeshBridge::Edge* edges = reinterpret_cast<const PolyhedralMeshBridge::Edge*>( ix );
+                for( uint64_t i=0; ok && i<n; i++ ) {
+                    ok = indicesInRange( edges[i].m_cp, 2u, none, vertices, false )
+                      && indicesInRange( edges[i].m_cells, 4u, mask, cells, true );
+                }
+            }
+                break;
+            default:
+                break;
+            }
+            in_range[s] = ok ? 1 : 0;
+        } );
+        valid = std::find( in_range.begin(), in_range.end(), 0 ) == in_range.end();
+    }
+    if( !valid ) {
+        munmap( map, bytes );
+        LOGGER_WARN( log, "Cache " << cache_path << " is corrupt, ignoring." );
+        return false;
+    }
+
+    // The arrays are independent, copy them concurrently.
+    const uint64_t triangles = count[ SECTION_TRIANGLE_INFO ] / 2u;
+    utils::ThreadPool::instance().run( SECTION_TRIANGLE_VTX + 1u, [&]( size_t s ) {
+        const CacheSection& section = header.m_section[s];
+        switch( s ) {
+        case SECTION_VERTICES:       copySection( bridge.m_vertices, base, section ); break;
+        case SECTION_NORMALS:        copySection( bridge.m_normals, base, section ); break;
+        case SECTION_CELL_INDEX:     copySection( bridge.m_cell_index, base, section ); break;
+        case SECTION_CELL_CORNER:    copySection( bridge.m_cell_corner, base, section ); break;
+        case SECTION_CELL_ORDER:     copySection( bridge.m_cell_order, base, section ); break;
+        case SECTION_EDGES:          copySection( bridge.m_edges, base, section ); break;
+        case SECTION_POLYGON_INFO:   copySection( bridge.m_polygon_info, base, section ); break;
+        case SECTION_POLYGON_OFFSET: copySection( bridge.m_polygon_offset, base, section ); break;
+        case SECTION_POLYGON_VTX_IX: copySection( bridge.m_polygon_vtx_ix, base, section ); break;
+        case SECTION_POLYGON_NRM_IX: copySection( bridge.m_polygon_nrm_ix, base, section ); break;
+        default:
+        {
+            // Triangles are kept in chunks of fixed size.
+            const Index* vtx = reinterpret_cast<const Index*>( base + header.m_section[ SECTION_TRIANGLE_VTX ].m_offset );
+            const Index* nrm = reinterpret_cast<const Index*>( base + header.m_section[ SECTION_TRIANGLE_NRM_IX ].m_offset );
+            const Index* info = reinterpret_cast<const Index*>( base + header.m_section[ SECTION_TRIANGLE_INFO ].m_offset );
+            for( uint64_t t=0; t<triangles; ) {
+                if( bridge.m_tri_chunk_N == PolyhedralMeshBridge::m_chunk_size ) {
+                    bridge.allocTriangleChunks();
+                }
+                const uint64_t room = PolyhedralMeshBridge::m_chunk_size - bridge.m_tri_chunk_N;
+                const uint64_t n = (triangles - t) < room ? (triangles - t) : room;
+                memcpy( bridge.m_tri_vtx + 3*bridge.m_tri_chunk_N, vtx + 3*t, sizeof(Index)*3*n );
+                memcpy( bridge.m_tri_nrm_ix + 3*bridge.m_tri_chunk_N, nrm + 3*t, sizeof(Index)*3*n );
+                memcpy( bridge.m_tri_info + 2*bridge.m_tri_chunk_N, info + 2*t, sizeof(Index)*2*n );
+                bridge.m_tri_chunk_N += n;
+                bridge.m_tri_N += n;
+                t += n;
+            }
+        }
+            break;
+        }
+    } );
+    munmap( map, bytes );
+    PerfTimer stop;
+
+    LOGGER_DEBUG( log, "Loaded tessellation of " << bridge.cellCount() << " cells and "
+                  << (count[ SECTION_POLYGON_OFFSET ]-1u) << " polygons from " << cache_path
+                  << " (" << (1000.0*PerfTimer::delta( start, stop )) << "ms)" );
+    return true;
+}
+
+bool
+PolyhedralMeshCache::store( const string&               file,
+                            const uint64_t              key,
+                            const PolyhedralMeshBridge& bridge )
+{
+    typedef PolyhedralMeshBridge::Index Index;
+    Logger log = getLogger( package + ".store" );
+
+    const string cache_path = path( file );
+    const string tmp_path = cache_path + ".tmp" + std::to_string( (long long)getpid() );
+
+    CacheHeader header;
+    memset( &header, 0, sizeof(header) );
+    memcpy( header.m_magic, cache_magic, 8 );
+    header.m_version     = version;
+    header.m_index_size  = sizeof(Index);
+    header.m_real4_size  = sizeof(PolyhedralMeshBridge::Real4);
+    header.m_edge_size   = sizeof(PolyhedralMeshBridge::Edge);
+    header.m_triangulate = bridge.triangulate() ? 1u : 0u;
+    header.m_sections    = SECTION_N;
+    header.m_key         = key;
+
+    const void* data[ SECTION_N ] = {
+        bridge.m_vertices.data(),
+        bridge.m_normals.data(),
+        bridge.m_cell_index.data(),
+        bridge.m_cell_corner.data(),
+        bridge.m_cell_order.data(),
+        bridge.m_edges.data(),
+        bridge.m_polygon_info.data(),
+        bridge.m_polygon_offset.data(),
+        bridge.m_polygon_vtx_ix.data(),
+        bridge.m_polygon_nrm_ix.data(),
+        NULL,   // triangles are written chunk by chunk
+        NULL,
+        NULL
+    };
+    const uint64_t size[ SECTION_N ] = {
+        sizeof(PolyhedralMeshBridge::Real4)*bridge.m_vertices.size(),
+        sizeof(PolyhedralMeshBridge::Real4)*bridge.m_normals.size(),
+        sizeof(Index)*bridge.m_cell_index.size(),
+        sizeof(Index)*bridge.m_cell_corner.size(),
+        sizeof(Index)*bridge.m_cell_order.size(),
+        sizeof(PolyhedralMeshBridge::Edge)*bridge.m_edges.size(),
+        sizeof(Index)*bridge.m_polygon_info.size(),
+        sizeof(Index)*bridge.m_polygon_offset.size(),
+        sizeof(Index)*bridge.m_polygon_vtx_ix.size(),
+        sizeof(Index)*bridge.m_polygon_nrm_ix.size(),
+        sizeof(Index)*3u*bridge.m_tri_N,
+        sizeof(Index)*3u*bridge.m_tri_N,
+        sizeof(Index)*2u*bridge.m_tri_N
+    };
+    uint64_t offset = sizeof(CacheHeader);
+    for( unsigned int s=0; s<SECTION_N; s++ ) {
+        offset = section_alignment*((offset + section_alignment - 1u)/section_alignment);
+        header.m_section[s].m_offset = offset;
+        header.m_section[s].m_size = size[s];
+        offset += size[s];
+    }
+
+    int fd = open( tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    if( fd < 0 ) {
+        LOGGER_DEBUG( log, "Unable to create " << tmp_path << ": " << strerror(errno) );
+        return false;
+    }
+    PerfTimer start;
+    const vector<char> zeros( section_alignment, 0 );
+    bool success = writeAll( fd, &header, sizeof(header) );
+    uint64_t position = sizeof(header);
+    for( unsigned int s=0; success && s<SECTION_N; s++ ) {
+        success = writeAll( fd, zeros.data(), header.m_section[s].m_offset - position );
+        position = header.m_section[s].m_offset + size[s];
+        if( s < SECTION_TRIANGLE_VTX ) {
+            success = success && writeAll( fd, data[s], size[s] );
+            continue;
+        }
+        const std::list<Index*>& chunks = s == SECTION_TRIANGLE_VTX    ? bridge.m_tri_vtx_chunks
+                                        : s == SECTION_TRIANGLE_NRM_IX ? bridge.m_tri_nrm_ix_chunks
+                                        :                                bridge.m_tri_info_chunks;
+        const Index stride = s == SECTION_TRIANGLE_INFO ? 2u : 3u;
+        Index t = 0;
+        for( auto it=chunks.begin(); success && (t < bridge.m_tri_N); ++it ) {
+            const Index n = (bridge.m_tri_N - t) < PolyhedralMeshBridge::m_chunk_size
+                          ? (bridge.m_tri_N - t) : PolyhedralMeshBridge::m_chunk_size;
+            success = writeAll( fd, *it, sizeof(Index)*stride*n );
+            t += n;
+        }
+    }
+    if( close( fd ) != 0 ) {
+        success = false;
+    }
+    if( success && (rename( tmp_path.c_str(), cache_path.c_str() ) != 0) ) {
+        success = false;
+    }
+    if( !success ) {
+        LOGGER_WARN( log, "Failed to write " << cache_path << ": " << strerror(errno) );
+        unlink( tmp_path.c_str() );
+        return false;
+    }
+    PerfTimer stop;
+    LOGGER_DEBUG( log, "Wrote tessellation of " << bridge.cellCount() << " cells to " << cache_path
+                  << " (" << (offset>>20u) << "MB, "
+                  << (1000.0*PerfTimer::delta( start, stop )) << "ms)" );
+    return true;
+}
+
+
+} // of namespace bridge
@@ -0,0 +1,105 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ *
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <string>
+#include <stdint.h>
+
+namespace bridge {
+
+class PolyhedralMeshBridge;
+
+/** Persistent sidecar cache of a finished tessellation.
+  *
+  * The cache is stored next to the file the geometry was read from (see
+  * path()), and holds the arrays of a processed PolyhedralMeshBridge. Each
+  * array starts on a page boundary, so the file can be mapped and the arrays
+  * copied out directly. A cache is identified by a key that the data source
+  * computes from the contents of its geometry (see
+  * dataset::PolyhedralDataInterface::geometryKey) combined with the
+  * tessellation options, a stale or foreign cache is never used.
+  */
+class PolyhedralMeshCache
+{
+public:
+    /** Current on-disk format version, bump when the layout or the
+      * tessellator output changes.
+      */
+    static const uint32_t   version = 2u;
+
+    /** Tessellations with fewer cells than this are not worth caching. */
+    static const uint32_t   minimum_cells = 10000u;
+
+    /** Returns the path of the sidecar cache for the file at path. */
+    static
+    std::string
+    path( const std::string& file );
+
+    /** Hash a buffer of bytes.
+      *
+      * Processes 32 bytes per iteration in four independent lanes, so hashing
+      * the corner-point arrays of a large grid is cheap compared to reading
+      * them.
+      *
+      * \param[in] bytes  Start of buffer.
+      * \param[in] n      Number of bytes in buffer.
+      * \param[in] seed   Initial value, used to chain several buffers.
+      */
+    static
+    uint64_t
+    hash( const void* bytes, size_t n, uint64_t seed = 0u );
+
+    /** Try to load a cached tessellation.
+      *
+      * \param[out] bridge  A newly created bridge which receives the
+      *                     tessellation, its triangulate setting is part of the
+      *                     key.
+      * \param[in]  file    Path of the source file (not the sidecar).
+      * \param[in]  key     Key of the geometry, see
+      *                     dataset::PolyhedralDataInterface::geometryKey.
+      * \returns True if a valid cache matching key was found and loaded.
+      * \note Never throws, a missing, stale or damaged cache just returns
+      *       false and leaves bridge untouched. Indices that are out of range
+      *       count as damage.
+      */
+    static
+    bool
+    load( PolyhedralMeshBridge&     bridge,
+          const std::string&        file,
+          const uint64_t            key );
+
+    /** Store a tessellation in the cache.
+      *
+      * The sidecar is written to a temporary file and atomically renamed into
+      * place, so concurrent readers never see a partial cache.
+      *
+      * \param[in]  file    Path of the source file (not the sidecar).
+      * \param[in]  key     Key of the geometry.
+      * \param[in]  bridge  A processed tessellation.
+      * \returns True if the cache was written.
+      * \note Never throws, failure (e.g. read-only directory or full disk) is
+      *       only logged.
+      */
+    static
+    bool
+    store( const std::string&           file,
+           const uint64_t               key,
+           const PolyhedralMeshBridge&  bridge );
+
+};
+
+} // of namespace bridge
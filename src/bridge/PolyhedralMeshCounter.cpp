@@ -0,0 +1,72 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ * 
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *  
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bridge/PolyhedralMeshCounter.hpp"
+
+namespace bridge {
+
+PolyhedralMeshCounter::PolyhedralMeshCounter( bool triangulate )
+    : m_triangulate( triangulate ),
+      m_normals( 0u ),
+      m_edges( 0u ),
+      m_polygons( 0u ),
+      m_indices( 0u )
+{
+}
+
+PolyhedralMeshCounter::Mark
+PolyhedralMeshCounter::mark() const
+{
+    Mark mark;
+    mark.m_vertices  = m_vertices.size();
+    mark.m_normals   = m_normals;
+    mark.m_edges     = m_edges;
+    mark.m_polygons  = m_polygons;
+    mark.m_indices   = m_indices;
+    mark.m_triangles = 0u;
+    return mark;
+}
+
+void
+PolyhedralMeshCounter::addEdge( const Index ix0, const Index ix1,
+                                const Index cell_a, const Index cell_b,
+                                const Index cell_c, const Index cell_d )
+{
+#ifdef EXTRACT_EDGE_GEOMETRY
+    m_edges++;
+#endif
+}
+
+void
+PolyhedralMeshCounter::addPolygon( const Interface interface,
+                                   const Segment* segments,
+                                   const Index N )
+{
+    if( N < 3 ) {
+        return;
+    }
+    if( m_triangulate ) {
+        m_polygons += N-2;
+        m_indices += 3*(N-2);
+    }
+    else {
+        m_polygons++;
+        m_indices += N;
+    }
+}
+
+} // of namespace bridge
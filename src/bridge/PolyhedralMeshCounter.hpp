@@ -0,0 +1,117 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ * 
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *  
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <vector>
+#include "bridge/PolyhedralMeshBridge.hpp"
+
+namespace bridge {
+
+/** Counts the output a PolyhedralMeshBridge would get, without storing it.
+  *
+  * Stands in for the bridge in the counting pass of cornerpoint::Tessellator,
+  * which tessellates the grid once to find the exact sizes of the output
+  * arrays, so that the bridge can be sized once before the real pass. Only
+  * the vertex positions are stored, as the tessellator reads them back.
+  * Polygons are counted as the bridge splits them, see addPolygon().
+  */
+class PolyhedralMeshCounter
+        : public AbstractMeshBridge
+{
+public:
+    typedef PolyhedralMeshBridge::Orientation   Orientation;
+    typedef PolyhedralMeshBridge::Interface     Interface;
+    typedef PolyhedralMeshBridge::Mark          Mark;
+    static const Orientation ORIENTATION_I = PolyhedralMeshBridge::ORIENTATION_I;
+    static const Orientation ORIENTATION_J = PolyhedralMeshBridge::ORIENTATION_J;
+    static const Orientation ORIENTATION_K = PolyhedralMeshBridge::ORIENTATION_K;
+
+    /** A counter needs no counting pass of its own. */
+    typedef PolyhedralMeshCounter               Counter;
+
+    PolyhedralMeshCounter( bool triangulate );
+
+    bool
+    triangulate() const { return m_triangulate; }
+
+    /** Sizes of the output arrays the bridge would have. */
+    Mark
+    mark() const;
+
+    /** Counted output is never delivered in parts. */
+    bool
+    hasPartListener() const
+    { return false; }
+
+    void
+    partDone( const std::vector<Index>& cell_ranges ) const
+    {}
+
+    Index
+    vertices() const
+    { return m_vertices.size(); }
+
+    const Real4&
+    vertex( const Index ix ) const
+    { return m_vertices[ix]; }
+
+    Index
+    addVertex( const Real4 pos )
+    { m_vertices.push_back( pos ); return m_vertices.size()-1u; }
+
+    Index
+    addNormal( const Real4 dir )
+    { return m_normals++; }
+
+    void
+    addEdge( const Index ix0, const Index ix1,
+             const Index cell_a, const Index cell_b,
+             const Index cell_c, const Index cell_d );
+
+    void
+    setCell( const Index index,
+             const Index global_index,
+             const Index vertex_0,
+             const Index vertex_1,
+             const Index vertex_2,
+             const Index vertex_3,
+             const Index vertex_4,
+             const Index vertex_5,
+             const Index vertex_6,
+             const Index vertex_7 )
+    {}
+
+    /** Count a polygon as PolyhedralMeshBridge::addPolygon stores it.
+      *
+      * Polygons with less than three corners are dropped, and when
+      * triangulating, a polygon with N corners becomes N-2 triangles.
+      */
+    void
+    addPolygon( const Interface interface,
+                const Segment* segments,
+                const Index N );
+
+protected:
+    bool                m_triangulate;
+    std::vector<Real4>  m_vertices;
+    Index               m_normals;
+    Index               m_edges;
+    Index               m_polygons;
+    Index               m_indices;
+};
+
+} // of namespace bridge
@@ -17,6 +17,7 @@
 
 #include "PillarFloorSampler.hpp"
 #include "bridge/PolyhedralMeshBridge.hpp"
+#include "bridge/PolyhedralMeshCounter.hpp"
 
 namespace cornerpoint {
 
@@ -98,6 +99,8 @@ PillarFloorSampler<Tessellation>::normal( const Real u, const Real v, const Real
 }
 
 template class PillarFloorSampler< bridge::PolyhedralMeshBridge >;
+template class PillarFloorSampler< bridge::PolyhedralMeshCounter >;
 template PillarFloorSampler< bridge::PolyhedralMeshBridge >::PillarFloorSampler( const float*, const float*, const float*, const float*);
+template PillarFloorSampler< bridge::PolyhedralMeshCounter >::PillarFloorSampler( const float*, const float*, const float*, const float*);
 
 } // of namespace cornerpoint
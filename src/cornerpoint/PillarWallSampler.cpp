@@ -17,6 +17,7 @@
 
 #include "PillarWallSampler.hpp"
 #include "bridge/PolyhedralMeshBridge.hpp"
+#include "bridge/PolyhedralMeshCounter.hpp"
 
 namespace cornerpoint {
 
@@ -97,6 +98,8 @@ PillarWallSampler<Tessellation>::normal( const Real u, const Real w )
 
 
 template class PillarWallSampler< bridge::PolyhedralMeshBridge >;
+template class PillarWallSampler< bridge::PolyhedralMeshCounter >;
 template PillarWallSampler< bridge::PolyhedralMeshBridge >::PillarWallSampler( const float*, const float*);
+template PillarWallSampler< bridge::PolyhedralMeshCounter >::PillarWallSampler( const float*, const float*);
 
 } // of namespace cornerpoint
@@ -25,13 +25,16 @@
 #include <glm/gtx/string_cast.hpp>
 #include "utils/Logger.hpp"
 #include "utils/PerfTimer.hpp"
+#include "utils/ThreadPool.hpp"
 #include "cornerpoint/Tessellator.hpp"
 #include "cornerpoint/PillarFloorSampler.hpp"
 #include "cornerpoint/PillarWallSampler.hpp"
+#include "cornerpoint/WallLineCrossings.hpp"
 #ifdef CHECK_INVARIANTS
 #include "CellSanityChecker.hpp"
 #endif
 #include "bridge/PolyhedralMeshBridge.hpp"
+#include "bridge/PolyhedralMeshCounter.hpp"
 
 namespace cornerpoint {
     using std::vector;
@@ -40,10 +43,46 @@ namespace cornerpoint {
 template<typename Tessellation>
 const typename Tessellator<Tessellation>::Index Tessellator<Tessellation>::IllegalIndex = (~(typename Tessellator<Tessellation>::Index)0u);
 template<typename Tessellation>
-Tessellator<Tessellation>::Tessellator( Tessellation& tessellation )
-    : m_tessellation( tessellation )
+Tessellator<Tessellation>::Tessellator( Tessellation& tessellation, utils::ThreadPool* pool )
+    : m_tessellation( tessellation ),
+      m_pool( pool ),
+      m_band_rows( 0 ),
+      m_rx( 1 ),
+      m_ry( 1 ),
+      m_rz( 1 )
 {}
 
+template<typename Tessellation>
+Tessellator<Tessellation>::Progress::Progress( boost::shared_ptr<tinia::model::ExposedModel> model,
+                                               const std::string& what_key,
+                                               const std::string& progress_key,
+                                               const std::string& what,
+                                               const Index rows )
+    : m_model( model ),
+      m_what_key( what_key ),
+      m_progress_key( progress_key ),
+      m_what( what ),
+      m_rows( rows ),
+      m_done( 0 ),
+      m_percent( -1 )
+{}
+
+template<typename Tessellation>
+void
+Tessellator<Tessellation>::Progress::row()
+{
+    std::lock_guard<std::mutex> guard( m_lock );
+    m_done++;
+    int percent = (100*m_done)/m_rows;
+    if( percent != m_percent ) {
+        m_percent = percent;
+        std::stringstream o;
+        o << m_what << "... (" << percent << "%)";
+        m_model->updateElement<std::string>( m_what_key, o.str() );
+        m_model->updateElement<int>( m_progress_key, percent );
+    }
+}
+
 // pillar layout
 //   p(i-1,j-1) ----- p(i  ,j-1) ----- p(i+1,j-1) --> i (inner loop)
 //      |                 |||               |
@@ -126,30 +165,330 @@ Tessellator<Tessellation>::tessellate( boost::shared_ptr<tinia::model::ExposedMo
                                                   const Index             nr,
                                                   const vector<SrcReal>&  coord,
                                                   const vector<SrcReal>&  zcorn,
-                                                  const vector<int>&      actnum )
+                                                  const utils::ActiveCells& active_cells,
+                                                  const utils::ActiveCells* tessellated_cells,
+                                                  const Index             cell_offset,
+                                                  const Index*            global_index )
 {
     Logger log = getLogger( package + ".triangulate" );
 
-    static const Index chain_offset_stride = 4*nz+1;
+    Grid grid;
+    grid.m_src_nx = nx;
+    grid.m_src_ny = ny;
+    grid.m_src_nz = nz;
+    grid.m_rx = m_rx;
+    grid.m_ry = m_ry;
+    grid.m_rz = m_rz;
+    grid.m_nx = m_rx*nx;
+    grid.m_ny = m_ry*ny;
+    grid.m_nz = m_rz*nz;
+    grid.m_refined = (m_rx != 1) || (m_ry != 1) || (m_rz != 1);
+    grid.m_coord = coord.data();
+    grid.m_zcorn = zcorn.data();
+    grid.m_active_cells = &active_cells;
+    grid.m_column_cells = tessellated_cells != NULL ? tessellated_cells : &active_cells;
+    grid.m_cell_offset = cell_offset;
+    grid.m_global_index = global_index;
+
+    // enumeration of active cells is different from how we traverse the grid,
+    // the compact index of a cell is the prefix sum of active cells before it,
+    // which is evaluated by rank when a row is fetched. Columns without any
+    // cells to tessellate are found up front and skipped by the sweep.
+    grid.m_column_cells->summarizeColumns( grid.m_columns, (size_t)nx*ny );
+    const Index active_count = m_rx*m_ry*m_rz*active_cells.count();
+    m_tessellation.setCellCount( cell_offset + active_count );
+    m_tessellation.addNormal( Real4( 1.f, 0.f, 0.f ) );
+    Real4 minimum, maximum;
+    if( bounds( minimum, maximum, grid ) ) {
+        m_tessellation.growBounds( minimum, maximum );
+    }
+
+    LOGGER_DEBUG( log, "active cells = " << active_count <<
+                       " ("  << ((100.f*active_cells.count())/active_cells.size()) << "%)." );
+    if( grid.m_refined ) {
+        LOGGER_DEBUG( log, "refining " << nx << "x" << ny << "x" << nz << " grid to "
+                      << grid.m_nx << "x" << grid.m_ny << "x" << grid.m_nz << "." );
+    }
+
+    // Bands produce exactly the output of a single sweep, so the output is
+    // the same for any number of threads. With a single thread, the halos
+    // and the merge would only add work.
+    utils::ThreadPool& pool = m_pool != NULL ? *m_pool : utils::ThreadPool::instance();
+    const Index rows = grid.m_ny+1;
+    Index band_rows = m_band_rows;
+    if( band_rows == 0u ) {
+        band_rows = pool.concurrency() > 1u ? std::max( Index(32u), (rows+63u)/64u ) : rows;
+    }
+    band_rows = std::max( Index(2u), band_rows );
+    const Index bands = (rows + band_rows - 1u)/band_rows;
 
-    // enumeration of active cells is different from how we traverse the grid.
-    vector<Index> cell_map( nx*ny*nz, IllegalIndex );
-    Index active_cells = 0;
-    for( size_t i=0; i<actnum.size(); i++ ) {
-        if( actnum[i] != 0 ) {
-            cell_map[i] = active_cells++;
+    PerfTimer start;
+
+    // Size the output exactly if the tessellation can be counted, growing
+    // the arrays as output is added copies them and may need twice the
+    // memory of the output.
+    vector<BandSize> sizes;
+    if( count( sizes, grid, rows, band_rows, model, what_key, progress_key ) ) {
+        typename Tessellation::Mark total = typename Tessellation::Mark();
+        for( Index b=0; b<bands; b++ ) {
+            const typename Tessellation::Mark& t = sizes[b].m_total;
+            const typename Tessellation::Mark& m = sizes[b].m_mark;
+            total.m_vertices += t.m_vertices - m.m_vertices;
+            total.m_normals  += t.m_normals  - m.m_normals;
+            total.m_edges    += t.m_edges    - m.m_edges;
+            total.m_polygons += t.m_polygons - m.m_polygons;
+            total.m_indices  += t.m_indices  - m.m_indices;
         }
+        m_tessellation.reserve( total );
+        PerfTimer stop;
+        LOGGER_DEBUG( log, "Counting output... done (" << PerfTimer::delta( start, stop ) << " secs): "
+                      << total.m_vertices << " vertices, " << total.m_polygons << " polygons, "
+                      << total.m_indices << " indices." );
+    }
+    else {
+        m_tessellation.reserveVertices( m_tessellation.vertices() + 8*active_count );
+        m_tessellation.reserveEdges( 12*active_count );
+        m_tessellation.reserveTriangles( 2*6*active_count );
     }
-    m_tessellation.setCellCount( active_cells );
-    m_tessellation.reserveVertices( 8*active_cells );
-    m_tessellation.reserveEdges( 12*active_cells );
-    m_tessellation.reserveTriangles( 2*6*active_cells );
 
-    m_tessellation.addNormal( Real4( 1.f, 0.f, 0.f ) );
+    Progress progress( model, what_key, progress_key, "Tessellating grid", rows );
 
-    LOGGER_DEBUG( log, "active cells = " << active_cells <<
-                       " ("  << ((100.f*active_cells)/actnum.size()) << "%)." );
+    LOGGER_DEBUG( log, "Tessellating grid in " << bands << " bands..." );
 
+    if( bands == 1 ) {
+        tessellateRows( NULL, grid, 0, rows, progress );
+    }
+    else {
+        // Bands are merged in order as soon as the bands before them are
+        // done, by the thread that finishes the last of them, so merging
+        // overlaps the tessellation and the output can be delivered in parts.
+        std::vector<Band> band( bands );
+        std::vector<bool> done( bands, false );
+        size_t merged = 0;
+        bool merging = false;
+        std::mutex merge_lock;
+        Seam seam;
+        double merge_time = 0.0;
+        pool.run( bands, [&]( size_t b )
+        {
+            band[b].m_shard.reset( new Tessellation( m_tessellation.triangulate() ) );
+            if( !sizes.empty() ) {
+                band[b].m_shard->reserve( sizes[b].m_total );
+                band[b].m_cells.reserve( 10*sizes[b].m_cells );
+            }
+            Tessellator<Tessellation> shard_tessellator( *band[b].m_shard );
+            shard_tessellator.tessellateRows( &band[b],
+                                              grid,
+                                              b*band_rows,
+                                              std::min( rows, Index((b+1)*band_rows) ),
+                                              progress );
+
+            std::unique_lock<std::mutex> lock( merge_lock );
+            done[b] = true;
+            if( merging ) {
+                return; // picked up by the merging thread.
+            }
+            merging = true;
+            while( (merged < bands) && done[merged] ) {
+                size_t end = merged;
+                while( (end < bands) && done[end] ) {
+                    end++;
+                }
+                lock.unlock();
+                PerfTimer merge_start;
+                mergeBands( band, merged, end, seam );
+                PerfTimer merge_stop;
+                // band b sweeps cell rows [b*band_rows-1, (b+1)*band_rows-1)
+                partDone( grid,
+                          merged == 0 ? 0u : Index(merged*band_rows - 1u),
+                          std::min( grid.m_ny, Index(end*band_rows - 1u) ) );
+                lock.lock();
+                merge_time += PerfTimer::delta( merge_start, merge_stop );
+                merged = end;
+            }
+            merging = false;
+        } );
+        LOGGER_DEBUG( log, "Merging bands... done (" << merge_time << " secs)" );
+    }
+    PerfTimer stop;
+    LOGGER_DEBUG( log, "Tessellating grid... done (" << PerfTimer::delta(start, stop) << " secs)" );
+
+}
+
+template<typename Tessellation>
+template<typename Counter>
+bool
+Tessellator<Tessellation>::count( std::vector<BandSize>&                          sizes,
+                                  const Grid&                                     grid,
+                                  const Index                                     rows,
+                                  const Index                                     band_rows,
+                                  boost::shared_ptr<tinia::model::ExposedModel>   model,
+                                  const std::string&                              what_key,
+                                  const std::string&                              progress_key,
+                                  Counter*                                        )
+{
+    typedef Tessellator<Counter> CountingTessellator;
+
+    const Index bands = (rows + band_rows - 1u)/band_rows;
+    typename CountingTessellator::Progress progress( model, what_key, progress_key, "Counting output", rows );
+    sizes.resize( bands );
+
+    utils::ThreadPool& pool = m_pool != NULL ? *m_pool : utils::ThreadPool::instance();
+    pool.run( bands, [&]( size_t b )
+    {
+        Counter counter( m_tessellation.triangulate() );
+        CountingTessellator counting_tessellator( counter );
+        typename CountingTessellator::Band band;
+        band.m_defer_cells = false;
+        counting_tessellator.tessellateRows( bands > 1 ? &band : NULL,
+                                             grid,
+                                             b*band_rows,
+                                             std::min( rows, Index((b+1)*band_rows) ),
+                                             progress );
+        sizes[b].m_total = counter.mark();
+        sizes[b].m_mark = bands > 1 ? band.m_mark : typename Counter::Mark();
+        sizes[b].m_cells = band.m_cell_count;
+    } );
+    return true;
+}
+
+template<typename Tessellation>
+void
+Tessellator<Tessellation>::mergeBands( std::vector<Band>&  bands,
+                                       const size_t        begin,
+                                       const size_t        end,
+                                       Seam&               seam )
+{
+    const size_t B = end - begin;
+    std::vector<const Tessellation*> shards( B );
+    std::vector<typename Tessellation::Mark> marks( B );
+    std::vector< std::vector<Index> > vertex_maps( B );
+    std::vector<Index> vertex_offset( B );
+
+    // The shards are appended in order, and the vertices of the last halo
+    // row of a band are the vertices of the last row of the preceding band,
+    // created in the same order.
+    Index offset = m_tessellation.vertices();
+    for( size_t b=0; b<B; b++ ) {
+        const Band& band = bands[begin+b];
+        shards[b] = band.m_shard.get();
+        marks[b] = band.m_mark;
+        vertex_offset[b] = offset;
+        vertex_maps[b].resize( band.m_mark.m_vertices, IllegalIndex );
+        if( begin+b > 0 ) {
+            if( band.m_seam_end - band.m_seam_begin != seam.m_last_end - seam.m_last_begin ) {
+                throw std::runtime_error( "Tessellator: mismatch of vertices on seam between bands" );
+            }
+            for( Index v=band.m_seam_begin; v<band.m_seam_end; v++ ) {
+                vertex_maps[b][v] = seam.m_last_begin + (v - band.m_seam_begin);
+            }
+        }
+        seam.m_last_begin = offset + (band.m_last_begin - band.m_mark.m_vertices);
+        seam.m_last_end   = offset + (band.m_last_end - band.m_mark.m_vertices);
+        offset += band.m_shard->vertices() - band.m_mark.m_vertices;
+    }
+    m_tessellation.merge( shards, marks, vertex_maps, m_pool );
+
+    // Each cell belongs to one band.
+    utils::ThreadPool& pool = m_pool != NULL ? *m_pool : utils::ThreadPool::instance();
+    pool.run( B, [&]( size_t b )
+    {
+        Band& band = bands[begin+b];
+        for( size_t c=0; c<band.m_cells.size(); c+=10 ) {
+            Index corner[8];
+            for( unsigned int k=0; k<8; k++ ) {
+                const Index v = band.m_cells[ c + 2 + k ];
+                corner[k] = v < band.m_mark.m_vertices
+                          ? vertex_maps[b][v]
+                          : vertex_offset[b] + (v - band.m_mark.m_vertices);
+            }
+            m_tessellation.setCell( band.m_cells[ c + 0 ],
+                                    band.m_cells[ c + 1 ],
+                                    corner[0], corner[1], corner[2], corner[3],
+                                    corner[4], corner[5], corner[6], corner[7] );
+        }
+        band.m_shard.reset();
+        std::vector<Index>().swap( band.m_cells );
+    } );
+}
+
+template<typename Tessellation>
+size_t
+Tessellator<Tessellation>::rowFirstCell( const Grid&   grid,
+                                         const Index   k,
+                                         const Index   j )
+{
+    // Same enumeration as fetchRow(), which is the identity without refinement.
+    const utils::ActiveCells& active_cells = *grid.m_active_cells;
+    const Index rx = grid.m_rx;
+    const Index ry = grid.m_ry;
+    const Index rz = grid.m_rz;
+    const size_t src_layer = (size_t)grid.m_src_nx*grid.m_src_ny;
+    const size_t layer_begin = src_layer*(k/rz);
+    const size_t layer_rank = active_cells.rank( layer_begin );
+    const size_t layer_count = active_cells.rank( layer_begin + src_layer ) - layer_rank;
+    const size_t layer_base = grid.m_cell_offset
+                            + (size_t)rx*ry*rz*layer_rank
+                            + (size_t)(k%rz)*rx*ry*layer_count;
+    if( j >= grid.m_ny ) {
+        return layer_base + (size_t)rx*ry*layer_count;
+    }
+    const size_t row_begin = layer_begin + (size_t)grid.m_src_nx*(j/ry);
+    const size_t row_rank = active_cells.rank( row_begin );
+    const size_t row_count = active_cells.rank( row_begin + grid.m_src_nx ) - row_rank;
+    return layer_base
+         + (size_t)rx*ry*(row_rank - layer_rank)
+         + (size_t)(j%ry)*rx*row_count;
+}
+
+template<typename Tessellation>
+void
+Tessellator<Tessellation>::partDone( const Grid&   grid,
+                                     const Index   j_begin,
+                                     const Index   j_end )
+{
+    if( !m_tessellation.hasPartListener() ) {
+        return;
+    }
+    // The cells of a range of rows are contiguous in each layer, and the
+    // ranges of consecutive layers are joined when the rows span the grid.
+    std::vector<Index> cell_ranges;
+    if( j_begin < j_end ) {
+        for( Index k=0; k<grid.m_nz; k++ ) {
+            const Index b = rowFirstCell( grid, k, j_begin );
+            const Index e = rowFirstCell( grid, k, j_end );
+            if( b == e ) {
+                continue;
+            }
+            if( !cell_ranges.empty() && (cell_ranges.back() == b) ) {
+                cell_ranges.back() = e;
+            }
+            else {
+                cell_ranges.push_back( b );
+                cell_ranges.push_back( e );
+            }
+        }
+    }
+    m_tessellation.partDone( cell_ranges );
+}
+
+template<typename Tessellation>
+void
+Tessellator<Tessellation>::tessellateRows( Band*           band,
+                                           const Grid&     grid,
+                                           const Index     j_begin,
+                                           const Index     j_end,
+                                           Progress&       progress )
+{
+    const Index nx = grid.m_nx;
+    const Index ny = grid.m_ny;
+    const Index nz = grid.m_nz;
+    const utils::ActiveCells& column_cells = *grid.m_column_cells;
+    const Index* const global_index = grid.m_global_index;
+
+    const Index chain_offset_stride = 4*nz+1;
+    // a band recomputes the two rows before it, see Band.
+    const Index j_first = j_begin < 2u ? 0u : j_begin - 2u;
 
     vector<Index> pi0jm1_d01_chains;
     vector<Index> pi0jm1_d01_chain_offsets( (nx+1)*chain_offset_stride, IllegalIndex );
@@ -166,17 +505,30 @@ Tessellator<Tessellation>::tessellate( boost::shared_ptr<tinia::model::ExposedMo
     vector<Index> jm1_wall_line_ix( nx*4*2*nz );
     vector<Index> jm0_wall_line_ix( nx*4*2*nz );
 
-    LOGGER_DEBUG( log, "Tessellating grid..." );
-
-    PerfTimer start;
-    for( Index j=0; j<ny+1; j++ ) {
-        int pn = (j-1*100)/ny;
-        int cn = (j*100)/ny;
-        if( pn != cn ) {
-            std::stringstream o;
-            o << "Tessellating grid... (" << cn << "%)";
-            model->updateElement<std::string>( what_key, o.str() );
-            model->updateElement<int>( progress_key, std::min( 100u, ((j*100)/ny) ) );
+    // The arrays of rows j-1 and j, the row before the first is only there
+    // to keep the pointers valid.
+    Row rows[2];
+    Row* jm1 = &rows[0];
+    Row* jm0 = &rows[1];
+    fetchRow( *jm0, grid, j_first > 0u ? j_first-1u : 0u );
+    const Index stride = jm0->m_stride;
+    const Index part_rows = std::max( Index(32u), (ny+64u)/64u );
+    Index part_begin = 0;
+
+    for( Index j=j_first; j<j_end; j++ ) {
+        std::swap( jm1, jm0 );
+        fetchRow( *jm0, grid, j );
+
+        if( band != NULL ) {
+            if( j == j_begin ) {
+                band->m_mark = m_tessellation.mark();
+            }
+            if( j+1u == j_begin ) {
+                band->m_seam_begin = m_tessellation.vertices();
+            }
+            if( j+1u == j_end ) {
+                band->m_last_begin = m_tessellation.vertices();
+            }
         }
 
         pi0jm1_d01_chains.clear();
@@ -197,12 +549,25 @@ Tessellator<Tessellation>::tessellate( boost::shared_ptr<tinia::model::ExposedMo
 
             try {
                 // Determine the active cells in the column
-                if( i < nx && j < ny ) {
-                    findActiveCellsInColumn( jm0_active_cell_list.data() + nz*(i+1),
-                                             jm0_active_cell_count[i+1],
-                                             actnum.data() + i + nx*j,
-                                             nx*ny,
-                                             nz );
+                if( i < nx && j < ny && !grid.m_columns.active( i/grid.m_rx + grid.m_src_nx*(j/grid.m_ry) ) ) {
+                    jm0_active_cell_count[ i+1 ] = 0u;
+                }
+                else if( i < nx && j < ny ) {
+                    if( jm0->m_column != NULL ) {
+                        findActiveCellsInColumn( jm0_active_cell_list.data() + nz*(i+1),
+                                                 jm0_active_cell_count[i+1],
+                                                 jm0->m_column + i,
+                                                 stride,
+                                                 nz );
+                    }
+                    else {
+                        findActiveCellsInColumn( jm0_active_cell_list.data() + nz*(i+1),
+                                                 jm0_active_cell_count[i+1],
+                                                 column_cells,
+                                                 i + nx*j,
+                                                 nx*ny,
+                                                 nz );
+                    }
                 }
                 else {
                     jm0_active_cell_count[ i+1 ] = 0u;
@@ -217,12 +582,12 @@ Tessellator<Tessellation>::tessellate( boost::shared_ptr<tinia::model::ExposedMo
                                       jm1_zcorn_ix.data() + 2*nz*( 4*(i+0) + CELL_CORNER_O01 ),   // c(i,  j-1) @ (0,1)
                                       jm0_zcorn_ix.data() + 2*nz*( 4*(i-1) + CELL_CORNER_O10 ),   // c(i-1,j  ) @ (1,0)
                                       jm0_zcorn_ix.data() + 2*nz*( 4*(i+0) + CELL_CORNER_O00 ),   // c(i,  j  ) @ (0,0)
-                                      zcorn.data() +  2*(i-1) + 1  + 2*nx*( 2*(j-1) + 1 ),
-                                      zcorn.data() +  2*(i  ) + 0  + 2*nx*( 2*(j-1) + 1 ),
-                                      zcorn.data() +  2*(i-1) + 1  + 2*nx*( 2*(j  ) + 0 ),
-                                      zcorn.data() +  2*(i  ) + 0  + 2*nx*( 2*(j  ) + 0 ),
-                                      nx*ny,
-                                      coord.data() + 6*( i + (nx+1)*j ),
+                                      jm1->m_zcorn +  2*(i-1) + 1  + 2*nx*1,
+                                      jm1->m_zcorn +  2*(i  ) + 0  + 2*nx*1,
+                                      jm0->m_zcorn +  2*(i-1) + 1  + 2*nx*0,
+                                      jm0->m_zcorn +  2*(i  ) + 0  + 2*nx*0,
+                                      stride,
+                                      jm0->m_coord + 6*i,
                                       jm1_active_cell_list.data() + nz*(i+ 0 ),
                                       jm1_active_cell_list.data() + nz*(i+ 1 ),
                                       jm0_active_cell_list.data() + nz*(i+ 0 ),
@@ -236,11 +601,11 @@ Tessellator<Tessellation>::tessellate( boost::shared_ptr<tinia::model::ExposedMo
                 // Edges along pillar
                 pillarEdges( vertex_pillar_start,
                              adjacent_cells,
-                             cell_map.data() + (i-1) + nx*(j-1),
-                             cell_map.data() + (i  ) + nx*(j-1),
-                             cell_map.data() + (i-1) + nx*(j  ),
-                             cell_map.data() + (i  ) + nx*(j  ),
-                             nx*ny );
+                             jm1->m_cell_map + (i-1),
+                             jm1->m_cell_map + (i  ),
+                             jm0->m_cell_map + (i-1),
+                             jm0->m_cell_map + (i  ),
+                             stride );
 
                 // Process pillar [p(i,j-1) and p(i,j)] along j (with c(i-1,j-1) and c(i,j-1) abutting)
                 if( 0 < j ) {
@@ -258,19 +623,19 @@ Tessellator<Tessellation>::tessellate( boost::shared_ptr<tinia::model::ExposedMo
                                       jm1_active_cell_list.data() + nz*(i+1),
                                       jm1_active_cell_count[ i+0 ],
                                       jm1_active_cell_count[ i+1 ],
-                                      cell_map.data() + (i-1) + nx*(j-1),
-                                      cell_map.data() + (i  ) + nx*(j-1),
-                                      coord.data() + 6*( i + (nx+1)*(j-1) ),
-                                      coord.data() + 6*( i + (nx+1)*j ),
-                                      nx*ny,
+                                      jm1->m_cell_map + (i-1),
+                                      jm1->m_cell_map + (i  ),
+                                      jm1->m_coord + 6*i,
+                                      jm0->m_coord + 6*i,
+                                      stride,
                                       1u );
 
                     intersectWallLines( wall_line_intersections,
                                         pi0jm1_d01_chains,
                                         pi0jm1_d01_chain_offsets.data() + chain_offset_stride*i,
                                         wall_lines,
-                                        coord.data() + 6*( i + (nx+1)*(j-1) ),
-                                        coord.data() + 6*( i + (nx+1)*j )
+                                        jm1->m_coord + 6*i,
+                                        jm0->m_coord + 6*i
                                         );
 
                     wallEdges( wall_lines,
@@ -281,8 +646,8 @@ Tessellator<Tessellation>::tessellate( boost::shared_ptr<tinia::model::ExposedMo
                     if( wall_line_intersections.empty() ) {
                         stitchPillarsNoIntersections( ORIENTATION_I,
                                                       wall_lines,
-                                                      coord.data() + 6*( (i) + (nx+1)*(j-1) ),
-                                                      coord.data() + 6*( (i) + (nx+1)*(j  ) ) );
+                                                      jm1->m_coord + 6*i,
+                                                      jm0->m_coord + 6*i );
                     }
                     else {
                         stitchPillarsHandleIntersections( ORIENTATION_I,
@@ -290,8 +655,8 @@ Tessellator<Tessellation>::tessellate( boost::shared_ptr<tinia::model::ExposedMo
                                                           wall_line_intersections,
                                                           pi0jm1_d01_chains,
                                                           pi0jm1_d01_chain_offsets.data() + chain_offset_stride*i,
-                                                          coord.data() + 6*( (i) + (nx+1)*(j-1) ),
-                                                          coord.data() + 6*( (i) + (nx+1)*(j  ) ) );
+                                                          jm1->m_coord + 6*i,
+                                                          jm0->m_coord + 6*i );
                     }
 #endif
 
@@ -341,18 +706,18 @@ Tessellator<Tessellation>::tessellate( boost::shared_ptr<tinia::model::ExposedMo
                                       jm1_active_cell_list.data() + nz*(i+0),
                                       jm0_active_cell_count[ i+0 ],
                                       jm1_active_cell_count[ i+0 ],
-                                      cell_map.data() + (i-1) + nx*(j  ),
-                                      cell_map.data() + (i-1) + nx*(j-1),
-                                      coord.data() + 6*( (i-1) + (nx+1)*j ),
-                                      coord.data() + 6*( i + (nx+1)*j ),
-                                      nx*ny,
+                                      jm0->m_cell_map + (i-1),
+                                      jm1->m_cell_map + (i-1),
+                                      jm0->m_coord + 6*(i-1),
+                                      jm0->m_coord + 6*i,
+                                      stride,
                                       nx );
                     intersectWallLines( wall_line_intersections,
                                         pi0j0_d10_chains,
                                         pi0j0_d10_chain_offsets.data() + chain_offset_stride*(i-1),
                                         wall_lines,
-                                        coord.data() + 6*( (i-1) + (nx+1)*j ),
-                                        coord.data() + 6*( i + (nx+1)*j )
+                                        jm0->m_coord + 6*(i-1),
+                                        jm0->m_coord + 6*i
                                         );
 
                     wallEdges( wall_lines,
@@ -363,8 +728,8 @@ Tessellator<Tessellation>::tessellate( boost::shared_ptr<tinia::model::ExposedMo
                     if( wall_line_intersections.empty() ) {
                         stitchPillarsNoIntersections( ORIENTATION_J,
                                                       wall_lines,
-                                                      coord.data() + 6*( (i-1) + (nx+1)*(j) ),
-                                                      coord.data() + 6*( (i  ) + (nx+1)*(j) ) );
+                                                      jm0->m_coord + 6*(i-1),
+                                                      jm0->m_coord + 6*i );
                     }
                     else {
                         stitchPillarsHandleIntersections( ORIENTATION_J,
@@ -372,8 +737,8 @@ Tessellator<Tessellation>::tessellate( boost::shared_ptr<tinia::model::ExposedMo
                                                           wall_line_intersections,
                                                           pi0j0_d10_chains,
                                                           pi0j0_d10_chain_offsets.data() + chain_offset_stride*(i-1),
-                                                          coord.data() + 6*( (i-1) + (nx+1)*(j) ),
-                                                          coord.data() + 6*( (i  ) + (nx+1)*(j) ) );
+                                                          jm0->m_coord + 6*(i-1),
+                                                          jm0->m_coord + 6*i );
                     }
 
 #ifdef CHECK_INVARIANTS
@@ -410,10 +775,10 @@ Tessellator<Tessellation>::tessellate( boost::shared_ptr<tinia::model::ExposedMo
                                      jm1_zcorn_ix.data() + 2*nz*( 4*(i-1) + CELL_CORNER_O10 ),
                                      jm1_zcorn_ix.data() + 2*nz*( 4*(i-1) + CELL_CORNER_O01 ),
                                      jm1_zcorn_ix.data() + 2*nz*( 4*(i-1) + CELL_CORNER_O11 ),
-                                     coord.data() + 6*( (i-1) + (nx+1)*(j-1) ),
-                                     coord.data() + 6*( (i  ) + (nx+1)*(j-1) ),
-                                     coord.data() + 6*( (i-1) + (nx+1)*(j  ) ),
-                                     coord.data() + 6*( (i  ) + (nx+1)*(j  ) ),
+                                     jm1->m_coord + 6*(i-1),
+                                     jm1->m_coord + 6*i,
+                                     jm0->m_coord + 6*(i-1),
+                                     jm0->m_coord + 6*i,
                                      pi0j0_d10_chains.data(),
                                      pi0j0_d10_chain_offsets.data() + chain_offset_stride*(i-1),
                                      pi0jm1_d10_chains.data(),
@@ -422,24 +787,37 @@ Tessellator<Tessellation>::tessellate( boost::shared_ptr<tinia::model::ExposedMo
                                      pi0jm1_d01_chain_offsets.data() + chain_offset_stride*(i),
                                      pi0jm1_d01_chains.data(),
                                      pi0jm1_d01_chain_offsets.data() + chain_offset_stride*(i-1),
-                                     cell_map.data() + (i-1) + nx*(j-1),
-                                     nx*ny );
+                                     jm1->m_cell_map + (i-1),
+                                     stride );
 #endif
-                    // process cell column c(i-1,j-1)
-                    for( Index m=0; m < jm1_active_cell_count[ i ]; m++ ) {
+                    // process cell column c(i-1,j-1), cells of the halo belong to the preceding band
+                    for( Index m=0; (j_begin <= j) && (m < jm1_active_cell_count[ i ]); m++ ) {
                         const Index k = jm1_active_cell_list[ (nz*i) + m];
                         const size_t gix = i-1 + nx*((j-1) + k*ny);
-                        m_tessellation.setCell( cell_map[gix],
-                                                gix,
-                                                jm1_zcorn_ix[ 2*(nz*( 4*(i-1) + CELL_CORNER_O00 ) + m ) + 0 ],
-                                                jm1_zcorn_ix[ 2*(nz*( 4*(i-1) + CELL_CORNER_O10 ) + m ) + 0 ],
-                                                jm1_zcorn_ix[ 2*(nz*( 4*(i-1) + CELL_CORNER_O01 ) + m ) + 0 ],
-                                                jm1_zcorn_ix[ 2*(nz*( 4*(i-1) + CELL_CORNER_O11 ) + m ) + 0 ],
-                                                jm1_zcorn_ix[ 2*(nz*( 4*(i-1) + CELL_CORNER_O00 ) + m ) + 1 ],
-                                                jm1_zcorn_ix[ 2*(nz*( 4*(i-1) + CELL_CORNER_O10 ) + m ) + 1 ],
-                                                jm1_zcorn_ix[ 2*(nz*( 4*(i-1) + CELL_CORNER_O01 ) + m ) + 1 ],
-                                                jm1_zcorn_ix[ 2*(nz*( 4*(i-1) + CELL_CORNER_O11 ) + m ) + 1 ] );
-
+                        const Index cell[10] = {
+                            jm1->m_cell_map[ (i-1) + stride*k ],
+                            global_index != NULL ? global_index[gix] : Index(gix),
+                            jm1_zcorn_ix[ 2*(nz*( 4*(i-1) + CELL_CORNER_O00 ) + m ) + 0 ],
+                            jm1_zcorn_ix[ 2*(nz*( 4*(i-1) + CELL_CORNER_O10 ) + m ) + 0 ],
+                            jm1_zcorn_ix[ 2*(nz*( 4*(i-1) + CELL_CORNER_O01 ) + m ) + 0 ],
+                            jm1_zcorn_ix[ 2*(nz*( 4*(i-1) + CELL_CORNER_O11 ) + m ) + 0 ],
+                            jm1_zcorn_ix[ 2*(nz*( 4*(i-1) + CELL_CORNER_O00 ) + m ) + 1 ],
+                            jm1_zcorn_ix[ 2*(nz*( 4*(i-1) + CELL_CORNER_O10 ) + m ) + 1 ],
+                            jm1_zcorn_ix[ 2*(nz*( 4*(i-1) + CELL_CORNER_O01 ) + m ) + 1 ],
+                            jm1_zcorn_ix[ 2*(nz*( 4*(i-1) + CELL_CORNER_O11 ) + m ) + 1 ]
+                        };
+                        if( band != NULL ) {
+                            // vertex indices are rebased when the band is merged
+                            if( band->m_defer_cells ) {
+                                band->m_cells.insert( band->m_cells.end(), cell, cell + 10 );
+                            }
+                            band->m_cell_count++;
+                        }
+                        else {
+                            m_tessellation.setCell( cell[0], cell[1],
+                                                    cell[2], cell[3], cell[4], cell[5],
+                                                    cell[6], cell[7], cell[8], cell[9] );
+                        }
                     }
                 }
             }
@@ -455,31 +833,281 @@ Tessellator<Tessellation>::tessellate( boost::shared_ptr<tinia::model::ExposedMo
         jm0_active_cell_list.swap( jm1_active_cell_list );
         jm0_active_cell_count.swap( jm1_active_cell_count );
         jm0_wall_line_ix.swap( jm1_wall_line_ix );
-    }
-    PerfTimer stop;
-    double t = PerfTimer::delta(start, stop);
-    LOGGER_DEBUG( log, "Tessellating grid... done (" << t << " secs)" );
 
+        if( band != NULL ) {
+            if( j+1u == j_begin ) {
+                band->m_seam_end = m_tessellation.vertices();
+            }
+            if( j+1u == j_end ) {
+                band->m_last_end = m_tessellation.vertices();
+            }
+        }
+        if( j_begin <= j ) {
+            progress.row();
+        }
+        // cells of the rows before j are set, and a single sweep delivers
+        // them in parts about as large as the bands would be.
+        if( (band == NULL) && m_tessellation.hasPartListener() &&
+            ( (j+1u == j_end) || (j - part_begin >= part_rows) ) )
+        {
+            partDone( grid, part_begin, std::min( j, ny ) );
+            part_begin = std::min( j, ny );
+        }
+    }
 }
 
 
 template<typename Tessellation>
 void
-Tessellator<Tessellation>::findActiveCellsInColumn( Index*            active_cell_list,
-                                                               Index&            active_cell_count,
-                                                               const int* const  actnum,
-                                                               const Index       stride,
-                                                               const Index       nz )
+Tessellator<Tessellation>::findActiveCellsInColumn( Index*                     active_cell_list,
+                                                               Index&                     active_cell_count,
+                                                               const utils::ActiveCells&  active_cells,
+                                                               const size_t               offset,
+                                                               const Index                stride,
+                                                               const Index                nz )
 {
     Index n = 0;
     for( Index k=0; k<nz; k++ ) {
-        if( actnum[ stride*k ] != 0 ) {
-            active_cell_list[n++] = k;
-        }
+        // Branch-free append, n only advances for active cells.
+        active_cell_list[n] = k;
+        n += active_cells.active( offset + (size_t)stride*k ) ? 1 : 0;
     }
     active_cell_count = n;
 }
 
+template<typename Tessellation>
+void
+Tessellator<Tessellation>::findActiveCellsInColumn( Index*                     active_cell_list,
+                                                    Index&                     active_cell_count,
+                                                    const unsigned char*       column,
+                                                    const Index                stride,
+                                                    const Index                nz )
+{
+    Index n = 0;
+    for( Index k=0; k<nz; k++ ) {
+        active_cell_list[n] = k;
+        n += column[ (size_t)stride*k ] != 0u ? 1 : 0;
+    }
+    active_cell_count = n;
+}
+
+template<typename Tessellation>
+bool
+Tessellator<Tessellation>::bounds( Real4&       minimum,
+                                   Real4&       maximum,
+                                   const Grid&  grid ) const
+{
+    const utils::ActiveCells& active_cells = *grid.m_column_cells;
+    if( active_cells.count() == 0 ) {
+        return false;
+    }
+    const size_t nx = grid.m_src_nx;
+    const size_t ny = grid.m_src_ny;
+
+    // z-range of the corners of the active cells
+    Real zmin = std::numeric_limits<Real>::max();
+    Real zmax = -std::numeric_limits<Real>::max();
+    for( size_t w=0; w<active_cells.size(); w+=64u ) {
+        uint64_t bits = active_cells.word( w );
+        while( bits != 0u ) {
+            const size_t c = w + __builtin_ctzll( bits );
+            bits &= bits - 1u;
+            const size_t i = c % nx;
+            const size_t j = (c / nx) % ny;
+            const size_t k = c / (nx*ny);
+            for( unsigned int kk=0; kk<2; kk++ ) {
+                for( unsigned int jj=0; jj<2; jj++ ) {
+                    const SrcReal* z = grid.m_zcorn + 4*nx*ny*(2*k+kk) + 2*nx*(2*j+jj) + 2*i;
+                    zmin = std::min( zmin, std::min( z[0], z[1] ) );
+                    zmax = std::max( zmax, std::max( z[0], z[1] ) );
+                }
+            }
+        }
+    }
+
+    // xy-range of the pillars over the z-range, as vertices are placed on
+    // pillars in uniquePillarVertices.
+    minimum = Real4( std::numeric_limits<Real>::max(), std::numeric_limits<Real>::max(), zmin );
+    maximum = Real4( -std::numeric_limits<Real>::max(), -std::numeric_limits<Real>::max(), zmax );
+    for( size_t p=0; p<(nx+1)*(ny+1); p++ ) {
+        const SrcReal* coord = grid.m_coord + 6*p;
+        for( unsigned int e=0; e<2; e++ ) {
+            const Real z = e == 0 ? zmin : zmax;
+            Real x = coord[0];
+            Real y = coord[1];
+            if( coord[5] != coord[2] ) {
+                const Real a = (z-coord[2])/(coord[5]-coord[2]);
+                const Real b = 1.f - a;
+                x = b*coord[0] + a*coord[3];
+                y = b*coord[1] + a*coord[4];
+            }
+            minimum.x() = std::min( minimum.x(), x );
+            minimum.y() = std::min( minimum.y(), y );
+            maximum.x() = std::max( maximum.x(), x );
+            maximum.y() = std::max( maximum.y(), y );
+        }
+    }
+    return true;
+}
+
+template<typename Tessellation>
+void
+Tessellator<Tessellation>::fetchRow( Row&         row,
+                                     const Grid&  grid,
+                                     const Index  j )
+{
+    const Index nx = grid.m_nx;
+    const Index ny = grid.m_ny;
+    const Index nz = grid.m_nz;
+    if( !grid.m_refined ) {
+        const utils::ActiveCells& active_cells = *grid.m_active_cells;
+        row.m_stride   = nx;
+        row.m_zcorn_storage.resize( 8*nx*nz );
+        row.m_cell_map_storage.resize( nx*nz );
+        row.m_coord    = grid.m_coord + 6*(nx+1)*(size_t)j;
+        row.m_zcorn    = row.m_zcorn_storage.data();
+        row.m_cell_map = row.m_cell_map_storage.data();
+        row.m_column   = NULL;
+        if( j >= ny ) {
+            return;
+        }
+        // Only the corners of runs of columns with cells to tessellate are
+        // copied, the corners of the other columns are never looked at.
+        const size_t row_begin = (size_t)nx*j;
+        for( Index i=0; i<nx; ) {
+            if( !grid.m_columns.active( row_begin + i ) ) {
+                i++;
+                continue;
+            }
+            Index e = i+1;
+            while( (e < nx) && grid.m_columns.active( row_begin + e ) ) {
+                e++;
+            }
+            for( Index l=0; l<4*nz; l++ ) {
+                const SrcReal* src = grid.m_zcorn + 2*nx*2*(size_t)ny*(l>>1u) + 2*nx*(2*(size_t)j+(l&1u));
+                SrcReal* dst = row.m_zcorn_storage.data() + 2*nx*(size_t)l;
+                std::copy( src + 2*i, src + 2*e, dst + 2*i );
+            }
+            i = e;
+        }
+        // the compact indices of a cell row are a rank query.
+        for( Index k=0; k<nz; k++ ) {
+            Index* cell_map = row.m_cell_map_storage.data() + nx*(size_t)k;
+            active_cells.compactIndices( cell_map, IllegalIndex, (size_t)nx*ny*k + (size_t)nx*j, nx );
+            if( grid.m_cell_offset != 0 ) {
+                for( Index i=0; i<nx; i++ ) {
+                    if( cell_map[i] != IllegalIndex ) {
+                        cell_map[i] += grid.m_cell_offset;
+                    }
+                }
+            }
+        }
+        return;
+    }
+
+    // The interpolation is the same as CornerpointGrid used when it stored
+    // the refined grid, so the output is the same.
+    const Index rx = grid.m_rx;
+    const Index ry = grid.m_ry;
+    const Index rz = grid.m_rz;
+    const Index src_nx = grid.m_src_nx;
+    const Index src_ny = grid.m_src_ny;
+    const SrcReal* const src_coord = grid.m_coord;
+    const SrcReal* const src_zcorn = grid.m_zcorn;
+    const utils::ActiveCells& active_cells = *grid.m_active_cells;
+    const utils::ActiveCells& column_cells = *grid.m_column_cells;
+
+    row.m_stride = nx;
+    row.m_coord_storage.resize( 6*(nx+1) );
+    row.m_zcorn_storage.resize( 8*nx*nz );
+    row.m_cell_map_storage.resize( nx*nz );
+    row.m_column_storage.resize( nx*nz );
+    row.m_coord    = row.m_coord_storage.data();
+    row.m_zcorn    = row.m_zcorn_storage.data();
+    row.m_cell_map = row.m_cell_map_storage.data();
+    row.m_column   = row.m_column_storage.data();
+
+    // pillars of row j
+    {
+        const Index jm = j/ry;
+        const Index jp = (j+ry-1)/ry;
+        const float jr = glm::fract( (float)j/(float)ry );
+        for( Index i=0; i<=nx; i++ ) {
+            const Index im = i/rx;
+            const Index ip = (i+rx-1)/rx;
+            const float ir = glm::fract( (float)i/(float)rx );
+            for( Index k=0; k<6; k++ ) {
+                row.m_coord_storage[ 6*i + k ] =
+                        src_coord[ 6*((src_nx+1)*jm+im)+k ]*(1.f-jr)*(1.f-ir) +
+                        src_coord[ 6*((src_nx+1)*jm+ip)+k ]*(1.f-jr)*ir +
+                        src_coord[ 6*((src_nx+1)*jp+im)+k ]*jr*(1.f-ir) +
+                        src_coord[ 6*((src_nx+1)*jp+ip)+k ]*jr*ir;
+            }
+        }
+    }
+    if( j >= ny ) {
+        return;
+    }
+
+    // cells of row j
+    const Index src_j = j/ry;
+    const size_t src_layer = (size_t)src_nx*src_ny;
+    for( Index k=0; k<nz; k++ ) {
+        const Index src_k = k/rz;
+
+        // The compact index of a refined cell counts the refined cells of
+        // the layers, rows and cells before it, see CornerpointGrid.
+        const size_t layer_begin = src_layer*src_k;
+        const size_t row_begin = layer_begin + src_nx*src_j;
+        const size_t layer_rank = active_cells.rank( layer_begin );
+        const size_t layer_count = active_cells.rank( layer_begin + src_layer ) - layer_rank;
+        const size_t row_rank = active_cells.rank( row_begin );
+        const size_t row_count = active_cells.rank( row_begin + src_nx ) - row_rank;
+        const size_t row_base = grid.m_cell_offset
+                              + (size_t)rx*ry*rz*layer_rank
+                              + (size_t)(k%rz)*rx*ry*layer_count
+                              + (size_t)rx*ry*(row_rank - layer_rank)
+                              + (size_t)(j%ry)*rx*row_count;
+
+        for( Index i=0; i<nx; i++ ) {
+            const Index src_i = i/rx;
+            const size_t src_l = row_begin + src_i;
+            const SrcReal* z = src_zcorn + 2*src_nx*2*src_ny*(2*(size_t)src_k) + 2*src_nx*(2*src_j) + 2*src_i;
+            const float z000 = z[ 0 ];
+            const float z001 = z[ 1 ];
+            const float z010 = z[ 2*src_nx + 0 ];
+            const float z011 = z[ 2*src_nx + 1 ];
+            const float z100 = z[ 2*src_nx*2*src_ny + 0 ];
+            const float z101 = z[ 2*src_nx*2*src_ny + 1 ];
+            const float z110 = z[ 2*src_nx*2*src_ny + 2*src_nx + 0 ];
+            const float z111 = z[ 2*src_nx*2*src_ny + 2*src_nx + 1 ];
+            for( Index kk=0; kk<2; kk++ ) {
+                for( Index jj=0; jj<2; jj++ ) {
+                    for( Index ii=0; ii<2; ii++ ) {
+                        const float xt = (float)((i % rx)+ii)/(float)rx;
+                        const float yt = (float)((j % ry)+jj)/(float)ry;
+                        const float zt = (float)((k % rz)+kk)/(float)rz;
+                        row.m_zcorn_storage[ 2*nx*2*(2*k+kk) + 2*nx*jj + 2*i+ii ] =
+                                  z000*(1.f-zt)*(1.f-yt)*(1.f-xt)
+                                + z001*(1.f-zt)*(1.f-yt)*xt
+                                + z010*(1.f-zt)*yt*(1.f-xt)
+                                + z011*(1.f-zt)*yt*xt
+                                + z100*zt*(1.f-yt)*(1.f-xt)
+                                + z101*zt*(1.f-yt)*xt
+                                + z110*zt*yt*(1.f-xt)
+                                + z111*zt*yt*xt;
+                    }
+                }
+            }
+            const bool active = active_cells.active( src_l );
+            row.m_cell_map_storage[ i + nx*k ] = active
+                                               ? Index( row_base + (size_t)rx*(active_cells.rank( src_l ) - row_rank) + (i%rx) )
+                                               : IllegalIndex;
+            row.m_column_storage[ i + nx*k ] = column_cells.active( src_l ) ? 1u : 0u;
+        }
+    }
+}
+
 
 template<typename Tessellation>
 void
@@ -509,7 +1137,7 @@ Tessellator<Tessellation>::pillarEdges( const Index           offset,
                     (adj_c[0] == adj_c[1]) &&
                     (adj_c[1] == adj_c[2]) &&
                     (adj_c[2] == adj_c[3]);
-            const Index fault = (!regular_p || !regular_c) ? (1u<<31u) : 0u;
+            const Index fault = (!regular_p || !regular_c) ? Tessellation::IndexFlagHi : 0u;
 
 
 
@@ -550,7 +1178,7 @@ Tessellator<Tessellation>::uniquePillarVertices( vector<Index>&      adjacent_ce
                                                             const Index         active_cell_count_10,
                                                             const Index         active_cell_count_11 )
 {
-    Logger log = getLogger( package + ".uniquePillarVertices" );
+    static const Logger log = getLogger( package + ".uniquePillarVertices" );
     const bool snap_logical_neighbours = true;
 
 
@@ -602,6 +1230,75 @@ Tessellator<Tessellation>::uniquePillarVertices( vector<Index>&      adjacent_ce
     }
 
 
+    // Fast path for a pillar inside an unfaulted region: If the four columns
+    // around the pillar have the same active cells with the same corners and
+    // the corners do not decrease, the merge below visits the corners of
+    // each column in lockstep. The vertices are then the unique corners of a
+    // single column, and the other columns share them.
+    if( ascending
+            && (active_cell_count_00 == active_cell_count_01)
+            && (active_cell_count_00 == active_cell_count_10)
+            && (active_cell_count_00 == active_cell_count_11) )
+    {
+        const Index n = active_cell_count_00;
+        bool matching = true;
+        Real prev_z = minf;
+        Index last_k = IllegalIndex-1u;
+        for( Index e=0; matching && (e<2*n); e++ ) {
+            const Index ii = e>>1;
+            const Index ij = e&1;
+            const Index k = active_cell_list_00[ ii ];
+            const size_t o = 4*stride*(2*k + ij);
+            matching = (active_cell_list_01[ii] == k)
+                    && (active_cell_list_10[ii] == k)
+                    && (active_cell_list_11[ii] == k)
+                    && (zcorn_00[o] == zcorn_01[o])
+                    && (zcorn_00[o] == zcorn_10[o])
+                    && (zcorn_00[o] == zcorn_11[o]);
+            Real z = zcorn_00[o];
+            if( snap_logical_neighbours && (ij==0) && (last_k+1 == k) ) {
+                z = zcorn_00[ 4*stride*(2*last_k + 1) ];
+            }
+            matching = matching && (prev_z <= z) && (z < maxf);
+            prev_z = z;
+            last_k = k;
+        }
+        if( matching ) {
+            Real curr_z = minf;
+            Index curr_ix = ~0;
+            Index cell_below = IllegalIndex;
+            last_k = IllegalIndex-1u;
+            for( Index e=0; e<2*n; e++ ) {
+                const Index ii = e>>1;
+                const Index ij = e&1;
+                const Index k = active_cell_list_00[ ii ];
+                Real z = zcorn_00[ 4*stride*(2*k + ij) ];
+                if( snap_logical_neighbours && (ij==0) && (last_k+1 == k) ) {
+                    z = zcorn_00[ 4*stride*(2*last_k + 1) ];
+                }
+                if( (e == 0) || (curr_z+epsf < z) ) {
+                    curr_z = z;
+                    const Real a = (z-z1)/(z2-z1);
+                    const Real b = 1.f - a;
+                    curr_ix = m_tessellation.addVertex( Real4( b*x1 + a*x2,
+                                                               b*y1 + a*y2,
+                                                               z ) );
+                    adjacent_cells.push_back( cell_below );
+                    adjacent_cells.push_back( cell_below );
+                    adjacent_cells.push_back( cell_below );
+                    adjacent_cells.push_back( cell_below );
+                }
+                cell_below = ij == 0 ? k : IllegalIndex;
+                zcorn_ix_00[ e ] = curr_ix;
+                zcorn_ix_01[ e ] = curr_ix;
+                zcorn_ix_10[ e ] = curr_ix;
+                zcorn_ix_11[ e ] = curr_ix;
+                last_k = k;
+            }
+            return;
+        }
+    }
+
     // We keep track of which cell is below the cornerpoint in all quadrants.
     Index cells_below[4] = { IllegalIndex, IllegalIndex, IllegalIndex, IllegalIndex };
 
@@ -760,7 +1457,7 @@ Tessellator<Tessellation>::stitchTopBottom( const Index* const   ci0j0_active_ce
                                                        const Index          stride )
 {
 
-    Logger log = getLogger( package + ".stitchTopBottom" );
+    static const Logger log = getLogger( package + ".stitchTopBottom" );
 
 
 
@@ -937,7 +1634,7 @@ Tessellator<Tessellation>::wallEdges( const vector<WallLine>&      boundaries,
         cell_under[1] = wl.m_cell_under[1];
         Index other_side = wl.m_side==1 ? 0 : 1;
         Index end0 = wl.m_ends[0];
-        Index fault = wl.m_fault ? (1u<<31u) : 0u;
+        Index fault = wl.m_fault ? Tessellation::IndexFlagHi : 0u;
         for( size_t c=chain_offsets[b]; c!=chain_offsets[b+1]; c++ ) {
             // Run through intersections, adjust cell over and under
             const Intersection& i = intersections[ chains[c] ];
@@ -973,7 +1670,7 @@ Tessellator<Tessellation>::stitchPillarsHandleIntersections( const Orientation
                                                                         const SrcReal* const         o0_coord,
                                                                         const SrcReal* const         o1_coord )
 {
-    Logger log = getLogger( package + ".stitchPillarsHandleIntersections" );
+    static const Logger log = getLogger( package + ".stitchPillarsHandleIntersections" );
 
 
     //const Real c_x[4] = { o0_coord[0], o1_coord[0], o0_coord[3], o1_coord[3] };
@@ -1299,7 +1996,7 @@ Tessellator<Tessellation>::stitchPillarsNoIntersections( const Orientation
                                                                     const SrcReal* const     o0_coord,
                                                                     const SrcReal* const     o1_coord  )
 {
-    Logger log = getLogger( package + ".stitchPillarsNoIntersections" );
+    static const Logger log = getLogger( package + ".stitchPillarsNoIntersections" );
 
 
     if( boundaries.empty() ) {
@@ -1421,7 +2118,7 @@ Tessellator<Tessellation>::extractWallLines( vector<WallLine>&     wall_lines,
                                                         const Index           adjacent_stride )
 {
 
-    Logger log = getLogger( package + ".extractWallLines" );
+    static const Logger log = getLogger( package + ".extractWallLines" );
 
     // Convert to arrays so we can use loops.
     const Index* zcorn_ix[4] = {
@@ -1448,6 +2145,87 @@ Tessellator<Tessellation>::extractWallLines( vector<WallLine>&     wall_lines,
     };
 
 
+    // Fast path for a wall inside an unfaulted region: If both sides have
+    // the same active cells with the same corners, the lines of the two
+    // sides are identical and the merge below pairs them up in order,
+    // provided that the lines are lexicographically increasing. The merged
+    // lines are then built directly from one side.
+    bool matching = active_cell_count_a == active_cell_count_b;
+    for( Index m=0; matching && (m<active_cell_count_a); m++ ) {
+        matching = (active_cell_list_a[m] == active_cell_list_b[m])
+                && (zcorn_ix_a_0[2*m+0] == zcorn_ix_b_0[2*m+0])
+                && (zcorn_ix_a_0[2*m+1] == zcorn_ix_b_0[2*m+1])
+                && (zcorn_ix_a_1[2*m+0] == zcorn_ix_b_1[2*m+0])
+                && (zcorn_ix_a_1[2*m+1] == zcorn_ix_b_1[2*m+1]);
+    }
+    if( matching ) {
+        wall_lines.clear();
+        wall_lines.reserve( 2*active_cell_count_a );
+        for( Index m=0; m<active_cell_count_a; m++ ) {
+            const Index b0 = zcorn_ix_a_0[ 2*m + 0 ];
+            const Index b1 = zcorn_ix_a_1[ 2*m + 0 ];
+            const Index t0 = zcorn_ix_a_0[ 2*m + 1 ];
+            const Index t1 = zcorn_ix_a_1[ 2*m + 1 ];
+            const Index k = active_cell_list_a[ m ];
+            const Index cell_a = cell_map_a[ stride*k ];
+            const Index cell_b = cell_map_b[ stride*k ];
+            const bool new_bottom = wall_lines.empty() ||
+                                    (wall_lines.back().m_ends[0] != b0) ||
+                                    (wall_lines.back().m_ends[1] != b1);
+            if( new_bottom ) {
+                wall_lines.resize( wall_lines.size() + 1 );
+                WallLine& l = wall_lines.back();
+                l.m_ends[0] = b0;
+                l.m_ends[1] = b1;
+                // A new line at a degenerate face has no cells, and its
+                // twin is zero (as the sided lines are value-initialized).
+                l.m_cell_over[0] = IllegalIndex;
+                l.m_cell_over[1] = IllegalIndex;
+                l.m_match_over = false;
+            }
+            if( (b0 != t0) || (b1 != t1) ) {
+                WallLine& bottom_line = wall_lines.back();
+                bottom_line.m_cell_over[0] = cell_a;
+                bottom_line.m_cell_over[1] = cell_b;
+                bottom_line.m_match_over = true;
+                boundary_line_index_a[2*m+0] = wall_lines.size()-1u;
+
+                wall_lines.resize( wall_lines.size() + 1 );
+                WallLine& top_line = wall_lines.back();
+                top_line.m_ends[0] = t0;
+                top_line.m_ends[1] = t1;
+                top_line.m_cell_over[0] = IllegalIndex;
+                top_line.m_cell_over[1] = IllegalIndex;
+                top_line.m_match_over = true;
+            }
+            else {
+                boundary_line_index_a[2*m+0] = wall_lines.size()-1u;
+            }
+            boundary_line_index_a[2*m+1] = wall_lines.size()-1u;
+            boundary_line_index_b[2*m+0] = boundary_line_index_a[2*m+0];
+            boundary_line_index_b[2*m+1] = boundary_line_index_a[2*m+1];
+        }
+        for( size_t i=1; matching && (i<wall_lines.size()); i++ ) {
+            const Index* p = wall_lines[i-1].m_ends;
+            const Index* c = wall_lines[i].m_ends;
+            matching = (p[0] < c[0]) || ((p[0] == c[0]) && (p[1] < c[1]));
+        }
+    }
+    if( matching ) {
+        PillarWallSampler<Tessellation> wall( o0_coord, o1_coord );
+        for( size_t i=0; i<wall_lines.size(); i++ ) {
+            WallLine& l = wall_lines[i];
+            l.m_normals[0] = m_tessellation.addNormal( wall.normal( 0.f, m_tessellation.vertex( l.m_ends[0] ).z() ) );
+            l.m_normals[1] = m_tessellation.addNormal( wall.normal( 1.f, m_tessellation.vertex( l.m_ends[1] ).z() ) );
+            l.m_side = 3;
+            l.m_cutoff = l.m_ends[1];
+            l.m_cell_under[0] = i > 0 ? wall_lines[i-1].m_cell_over[0] : IllegalIndex;
+            l.m_cell_under[1] = i > 0 ? wall_lines[i-1].m_cell_over[1] : IllegalIndex;
+            l.m_fault = !wall_lines[ i>0 ? i-1 : i ].m_match_over || !l.m_match_over;
+        }
+        return;
+    }
+
     // Step 1: Extract all wall lines on each side of the wall.
     vector<SidedWallLine<Tessellation> > sided_wall_lines[2];
     for( Index side=0; side<2; side++) {
@@ -1670,11 +2448,24 @@ Tessellator<Tessellation>::intersectWallLines( vector<Intersection>&    wall_lin
                                                           const float*                  pillar_a,
                                                           const float*                  pillar_b )
 {
-    Logger log = getLogger( package + ".intersectWallLines" );
+    static const Logger log = getLogger( package + ".intersectWallLines" );
     if( wall_lines.empty() ) {
         return;
     }
 
+    // Lines are ordered at pillar 0, and if they are ordered at pillar 1 as
+    // well no lines cross, which is the case for unfaulted walls.
+    bool ordered = true;
+    for( size_t l=1; ordered && (l<wall_lines.size()); l++ ) {
+        ordered = wall_lines[l-1].m_ends[1] <= wall_lines[l].m_ends[1];
+    }
+    if( ordered ) {
+        for( size_t l=0; l<=wall_lines.size(); l++ ) {
+            chain_offsets[l] = chains.size();
+        }
+        return;
+    }
+
     PillarWallSampler<Tessellation> wall( pillar_a, pillar_b );
 
     // Step 1: Detect intersections, and insert the index of the intersection
@@ -1683,57 +2474,51 @@ Tessellator<Tessellation>::intersectWallLines( vector<Intersection>&    wall_lin
     // We use two lines; 'lowest_at_p0' and 'larger_at_p0'. For these two lines
     // to intersect, 'larger_at_p0' must be smaller at p1 than lowest_at_p0.
     //
-    // Since we scan from smaller indices to larger, we find intersections in an
-    // particular order: All found intersections are in front (from p0 to p1)
-    // for 'lowest_at_p0', while the converse is true for 'larger_at_p0', all
+    // The crossings are found in order from smaller indices to larger (see
+    // WallLineCrossings), so we find intersections in an particular order:
+    // All found intersections are in front (from p0 to p1) for
+    // 'lowest_at_p0', while the converse is true for 'larger_at_p0', all
     // found intersections come after.
 #ifdef CHECK_INVARIANTS
     const Index isec_base_offset = wall_line_intersections.size();
 #endif
 
+    vector<Index> p1( wall_lines.size() );
+    vector<Index> cutoff( wall_lines.size() );
+    for( size_t l=0; l<wall_lines.size(); l++ ) {
+        p1[l] = wall_lines[l].m_ends[1];
+        cutoff[l] = wall_lines[l].m_cutoff;
+    }
+    vector<Index> crossings;
+    m_crossings.find( crossings, p1.data(), cutoff.data(), wall_lines.size() );
+
     vector< std::list<Index> > chains_tmp( wall_lines.size() );
-    for( size_t lower = 0; lower < wall_lines.size(); lower++ ) {
+    for( size_t c=0; c<crossings.size(); c+=2 ) {
+        const Index lower = crossings[c+0];
+        const Index upper = crossings[c+1];
         const WallLine& lowest_at_p0 = wall_lines[lower];
-
-        // scan over edges that are above at pillar 0
-        for( size_t upper = lower+1; upper < wall_lines.size(); upper++ ) {
-            const WallLine& larger_at_p0 = wall_lines[upper];
-
-            // Early exit: No edges above have an index at p1 that is smaller
-            // than lowest_at_p0.
-            if( larger_at_p0.m_cutoff >= lowest_at_p0.m_ends[1] ) {
-                break;
-            }
-
-            // detect upper edges that are lower at pillar 1 -> intersection
-            if( larger_at_p0.m_ends[1] < lowest_at_p0.m_ends[1] ) {
-                // Just make sure that the early exit condition holds
-                // (only relevant when we disable early exit)
-                // LOGGER_INVARIANT( log, larger_at_p0.m_cutoff < lowest_at_p0.m_ends[1]);
-
-
-                // We have an intersection. Since boundaries have been compacted
-                // on each side of the cell column wall, the boundaries should
-                // be from different sides.
-
-                LOGGER_INVARIANT( log, (wall_lines[ upper ].m_side ^ wall_lines[ lower ].m_side) == 3 );
-                const Index is_ix = wall_line_intersections.size();
-                chains_tmp[lower].push_back( is_ix );
-                chains_tmp[upper].push_front( is_ix );
-                wall_line_intersections.resize( wall_line_intersections.size()+1 );
-
-                Real4 ip = wall.intersect( m_tessellation.vertex( lowest_at_p0.m_ends[0] ).z(),
-                                           m_tessellation.vertex( lowest_at_p0.m_ends[1] ).z(),
-                                           m_tessellation.vertex( larger_at_p0.m_ends[0] ).z(),
-                                           m_tessellation.vertex( larger_at_p0.m_ends[1] ).z() );
-
-                Intersection& i = wall_line_intersections.back();
-                i.m_vtx_ix = m_tessellation.addVertex( ip );
-                i.m_upwrd_bndry_ix = lower;
-                i.m_dnwrd_bndry_ix = upper;
-                i.m_n = m_tessellation.addNormal( wall.normal( ip.w(), ip.z() ) );
-            }
-        }
+        const WallLine& larger_at_p0 = wall_lines[upper];
+
+        // We have an intersection. Since boundaries have been compacted
+        // on each side of the cell column wall, the boundaries should
+        // be from different sides.
+
+        LOGGER_INVARIANT( log, (wall_lines[ upper ].m_side ^ wall_lines[ lower ].m_side) == 3 );
+        const Index is_ix = wall_line_intersections.size();
+        chains_tmp[lower].push_back( is_ix );
+        chains_tmp[upper].push_front( is_ix );
+        wall_line_intersections.resize( wall_line_intersections.size()+1 );
+
+        Real4 ip = wall.intersect( m_tessellation.vertex( lowest_at_p0.m_ends[0] ).z(),
+                                   m_tessellation.vertex( lowest_at_p0.m_ends[1] ).z(),
+                                   m_tessellation.vertex( larger_at_p0.m_ends[0] ).z(),
+                                   m_tessellation.vertex( larger_at_p0.m_ends[1] ).z() );
+
+        Intersection& i = wall_line_intersections.back();
+        i.m_vtx_ix = m_tessellation.addVertex( ip );
+        i.m_upwrd_bndry_ix = lower;
+        i.m_dnwrd_bndry_ix = upper;
+        i.m_n = m_tessellation.addNormal( wall.normal( ip.w(), ip.z() ) );
     }
 #ifdef DEBUG
     for(auto isec=wall_line_intersections.begin(); isec!=wall_line_intersections.end(); ++isec ) {
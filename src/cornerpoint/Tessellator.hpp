@@ -19,14 +19,52 @@
 
 #include <memory>
 #include <vector>
+#include <mutex>
+#include <boost/shared_ptr.hpp>
 #include <tinia/model/ExposedModel.hpp>
 #include "eclipse/EclipseReader.hpp"
+#include "utils/ActiveCells.hpp"
+#include "cornerpoint/WallLineCrossings.hpp"
+
+namespace utils {
+    class ThreadPool;
+}
 
 namespace cornerpoint {
 
+/** The grid being tessellated, shared by the bands.
+  *
+  * The dimensions are those of the refined grid, the arrays are those of
+  * the source grid, see Tessellator::fetchRow(). Does not depend on the
+  * tessellation type, so the counting pass of Tessellator can sweep the same
+  * grid with a different tessellation.
+  */
+template<typename Index>
+struct TessellatorGrid
+{
+    Index                       m_nx;
+    Index                       m_ny;
+    Index                       m_nz;
+    Index                       m_src_nx;
+    Index                       m_src_ny;
+    Index                       m_src_nz;
+    Index                       m_rx;
+    Index                       m_ry;
+    Index                       m_rz;
+    bool                        m_refined;
+    const float*                m_coord;
+    const float*                m_zcorn;
+    const utils::ActiveCells*   m_active_cells;     ///< Active cells, defines the compact index.
+    const utils::ActiveCells*   m_column_cells;     ///< Active cells that get geometry.
+    utils::ActiveCells          m_columns;          ///< Source columns with cells that get geometry.
+    Index                       m_cell_offset;      ///< Added to the compact index.
+    const Index*                m_global_index;     ///< Global index of each cell, or NULL for identity.
+};
+
 template<typename Tessellation>
 class Tessellator
 {
+    template<typename> friend class Tessellator;
 public:
     /** \name Forwarding
       * Forwarding of tessellation types and constants. */
@@ -44,9 +82,66 @@ public:
     static const Index IllegalIndex;
     /** @} */
 
-    /** Constructor, attaches itself to an empty tessellation. */
-    Tessellator( Tessellation& tessellation );
+    /** Constructor, attaches itself to an empty tessellation.
+      *
+      * \param[in] pool  Threads to tessellate bands with, NULL selects
+      *                  utils::ThreadPool::instance().
+      */
+    Tessellator( Tessellation& tessellation, utils::ThreadPool* pool = NULL );
+
+    /** Set the number of pillar rows per band, 0 selects it from the grid size.
+      *
+      * The rows of the grid are split into bands that are tessellated
+      * concurrently, each into a tessellation of its own, and merged in
+      * order. The output is identical to that of a single band, and thus
+      * does not depend on the number of threads.
+      */
+    void
+    setBandRows( const Index rows ) { m_band_rows = rows; }
+
+    /** Set the refinement of the grid, 1,1,1 (the default) for no refinement.
+      *
+      * Each cell of the grid passed to tessellate() is split into rx*ry*rz
+      * cells, with pillars and corners trilinearly interpolated from the
+      * cell. The refined corners and compact indices are evaluated row by row
+      * during the sweep, so the refined grid is never stored. Cells are
+      * enumerated as in the refined grid, i.e., as if the refined COORD,
+      * ZCORN and ACTNUM were passed to tessellate().
+      */
+    void
+    setRefinement( const Index rx, const Index ry, const Index rz )
+    { m_rx = rx; m_ry = ry; m_rz = rz; }
 
+    /** Tessellate a cornerpoint grid.
+      *
+      * May be invoked several times on the same tessellation, e.g., to add
+      * the local grid refinements after the global grid.
+      *
+      * If the tessellation type names a different Tessellation::Counter
+      * type, the grid is first tessellated into counters to find the exact
+      * size of the output, and the tessellation is sized accordingly before
+      * the output is added, see Tessellation::reserve(). Otherwise, the size
+      * is estimated from the number of cells.
+      *
+      * \param[in] nx, ny, nz, coord, zcorn, active_cells  The grid before
+      *                               refinement, see setRefinement().
+      * \param[in] active_cells       The active cells, defines the compact
+      *                               cell indices.
+      * \param[in] tessellated_cells  If non-NULL, the subset of the active
+      *                               cells to tessellate. The other active
+      *                               cells keep their compact index but get
+      *                               no geometry, e.g., host cells of LGRs.
+      * \param[in] cell_offset        Added to the compact cell indices.
+      * \param[in] global_index       If non-NULL, the global index stored
+      *                               for each of the cells of the refined
+      *                               grid, e.g., the host cell of a cell of
+      *                               a local grid.
+      *
+      * If the tessellation has a part listener, it is notified as the rows
+      * are completed, i.e., regularly during a single sweep, and after each
+      * band when tessellating in bands, as bands are merged in order as soon
+      * as the bands before them are done.
+      */
     void
     tessellate( boost::shared_ptr<tinia::model::ExposedModel> model,
                 const std::string& what_key,
@@ -57,24 +152,27 @@ public:
                 const Index                  nr,
                 const std::vector<SrcReal>&  coord,
                 const std::vector<SrcReal>&  zcorn,
-                const std::vector<int>&      actnum );
+                const utils::ActiveCells&    active_cells,
+                const utils::ActiveCells*    tessellated_cells = NULL,
+                const Index                  cell_offset = 0,
+                const Index*                 global_index = NULL );
 
 private:
 
     /** Helper struct used for ordering intersection paths along inbetween pillar walls.
       *
-      * Everything is currently encoded as an uint32, where the single upper bit
-      * is used to signal if the index is a vertex index or a intersection
-      * index. Maximum index is thus restricted to 2^31-1.
+      * Everything is encoded as an Index, where the single upper bit is used
+      * to signal if the index is a vertex index or a intersection index.
+      * Maximum index is thus restricted to Tessellation::IndexFlagHi-1.
       */
     struct NextIntersection
     {
         static inline NextIntersection intersection( Index ix ) { NextIntersection ni; ni.m_value = ix; return ni; }
-        static inline NextIntersection vertex( Index ix ) { NextIntersection ni; ni.m_value = ix | (1u<<31u); return ni; }
+        static inline NextIntersection vertex( Index ix ) { NextIntersection ni; ni.m_value = ix | Tessellation::IndexFlagHi; return ni; }
         inline NextIntersection() : m_value( IllegalIndex ) {}
-        inline bool isVertex() const { return (m_value & (1u<<31u)) != 0u; }
-        inline bool isIntersection() const { return (m_value & (1u<<31u)) == 0u; }
-        inline Index vertex() const { return m_value & (~(1u<<31u)); }
+        inline bool isVertex() const { return (m_value & Tessellation::IndexFlagHi) != 0u; }
+        inline bool isIntersection() const { return (m_value & Tessellation::IndexFlagHi) == 0u; }
+        inline Index vertex() const { return m_value & (~Tessellation::IndexFlagHi); }
         inline Index intersection() const { return m_value; }
         Index        m_value;
     };
@@ -126,14 +224,221 @@ private:
         CELL_WALL_O01_D10 = 3   ///< Edge [(0,1),(1,1)] of cell c(i,j).
     };
 
+    /** The grid being tessellated, shared by the bands and the counting pass. */
+    typedef TessellatorGrid<Index> Grid;
+
+    /** The arrays of pillar row j and cell row j of the refined grid.
+      *
+      * Corner (ii,jj,kk) of cell c(i,j,k) is at
+      * m_zcorn[ 2*i+ii + 2*nx*jj + 4*m_stride*(2*k+kk) ] and its compact index
+      * at m_cell_map[ i + m_stride*k ], where the stride is nx. The
+      * pillars point into the grid without refinement, the rest is always
+      * held in the storage of the row, so no full-size compact index map of
+      * the grid is needed.
+      */
+    struct Row
+    {
+        Index                       m_stride;
+        const SrcReal*              m_coord;            ///< Pillars p(0,j) to p(nx,j), six values each.
+        const SrcReal*              m_zcorn;            ///< Corners of cells c(0,j) to c(nx-1,j).
+        const Index*                m_cell_map;         ///< Compact index of cells c(0,j) to c(nx-1,j).
+        const unsigned char*        m_column;           ///< Nonzero if cell gets geometry, NULL if not refined.
+        std::vector<SrcReal>        m_coord_storage;
+        std::vector<SrcReal>        m_zcorn_storage;
+        std::vector<Index>          m_cell_map_storage;
+        std::vector<unsigned char>  m_column_storage;
+    };
+
+    /** A range of pillar rows tessellated into a tessellation of its own.
+      *
+      * The sweep carries state from one row to the next, so a band that does
+      * not start at the first row first recomputes the two rows before it,
+      * the halo. The output of the halo is skipped when the band is merged,
+      * and the vertices of its last row are identified with the vertices of
+      * the last row of the preceding band, which are created in the same
+      * order.
+      */
+    struct Band
+    {
+        Band() : m_cell_count( 0u ), m_defer_cells( true ) {}
+
+        boost::shared_ptr<Tessellation>     m_shard;
+        typename Tessellation::Mark         m_mark;         ///< Output of the shard when the halo is done.
+        Index                               m_seam_begin;   ///< First vertex of the last halo row.
+        Index                               m_seam_end;     ///< Past the last vertex of the last halo row.
+        Index                               m_last_begin;   ///< First vertex of the last row.
+        Index                               m_last_end;     ///< Past the last vertex of the last row.
+        std::vector<Index>                  m_cells;        ///< Deferred setCell arguments, 10 per cell.
+        Index                               m_cell_count;   ///< Number of cells of the band.
+        bool                                m_defer_cells;  ///< False if cells are only counted.
+    };
+
+    /** The exact output of a band, as found by the counting pass. */
+    struct BandSize
+    {
+        typename Tessellation::Mark         m_total;        ///< Output of the shard, including the halo.
+        typename Tessellation::Mark         m_mark;         ///< Output of the halo.
+        Index                               m_cells;        ///< Number of cells of the band.
+    };
+
+    /** Progress reporting shared by the bands. */
+    class Progress
+    {
+    public:
+        Progress( boost::shared_ptr<tinia::model::ExposedModel> model,
+                  const std::string& what_key,
+                  const std::string& progress_key,
+                  const std::string& what,
+                  const Index rows );
+
+        /** Notify that a row is done. */
+        void
+        row();
+
+    private:
+        boost::shared_ptr<tinia::model::ExposedModel>   m_model;
+        const std::string                               m_what_key;
+        const std::string                               m_progress_key;
+        const std::string                               m_what;
+        const Index                                     m_rows;
+        Index                                           m_done;
+        int                                             m_percent;
+        std::mutex                                      m_lock;
+    };
+
     Tessellation&                   m_tessellation;
+    utils::ThreadPool*              m_pool;
+    Index                           m_band_rows;
+    Index                           m_rx;
+    Index                           m_ry;
+    Index                           m_rz;
+    WallLineCrossings<Tessellation> m_crossings;
+
+    /** Box that the tessellation of the grid lies within.
+      *
+      * Vertices lie on the pillars, or on the walls between them, between the
+      * top and the bottom of the cells that get geometry.
+      *
+      * \returns False if no cells get geometry.
+      */
+    bool
+    bounds( Real4&       minimum,
+            Real4&       maximum,
+            const Grid&  grid ) const;
+
+    /** Point row at pillar row j and cell row j of grid, refining them if needed. */
+    void
+    fetchRow( Row&          row,
+              const Grid&   grid,
+              const Index   j );
+
+    /** Sweep the pillar rows [j_begin,j_end) of the grid.
+      *
+      * \param[in,out] band  If NULL, the whole grid is tessellated directly.
+      *                      Otherwise, the halo is processed first and the
+      *                      cells are deferred to the band.
+      */
+    void
+    tessellateRows( Band*           band,
+                    const Grid&     grid,
+                    const Index     j_begin,
+                    const Index     j_end,
+                    Progress&       progress );
+
+    /** Find the exact output of each band by tessellating into counters.
+      *
+      * The band rows are those of the real pass, so the sizes apply to the
+      * shards as well as to the whole tessellation.
+      *
+      * \returns False if the tessellation type has no counter, see
+      *          tessellate().
+      */
+    bool
+    count( std::vector<BandSize>&                          sizes,
+           const Grid&                                     grid,
+           const Index                                     rows,
+           const Index                                     band_rows,
+           boost::shared_ptr<tinia::model::ExposedModel>   model,
+           const std::string&                              what_key,
+           const std::string&                              progress_key )
+    { return count( sizes, grid, rows, band_rows, model, what_key, progress_key,
+                    (typename Tessellation::Counter*)NULL ); }
+
+    template<typename Counter>
+    bool
+    count( std::vector<BandSize>&                          sizes,
+           const Grid&                                     grid,
+           const Index                                     rows,
+           const Index                                     band_rows,
+           boost::shared_ptr<tinia::model::ExposedModel>   model,
+           const std::string&                              what_key,
+           const std::string&                              progress_key,
+           Counter*                                        );
+
+    /** A tessellation that is its own counter is not counted. */
+    bool
+    count( std::vector<BandSize>&                          sizes,
+           const Grid&                                     grid,
+           const Index                                     rows,
+           const Index                                     band_rows,
+           boost::shared_ptr<tinia::model::ExposedModel>   model,
+           const std::string&                              what_key,
+           const std::string&                              progress_key,
+           Tessellation*                                   )
+    { return false; }
+
+    /** The last row of the bands merged so far, in the tessellation. */
+    struct Seam
+    {
+        Seam() : m_last_begin( 0u ), m_last_end( 0u ) {}
+
+        Index   m_last_begin;   ///< First vertex of the last row.
+        Index   m_last_end;     ///< Past the last vertex of the last row.
+    };
+
+    /** Merge the shards of bands [begin,end) into the tessellation.
+      *
+      * Bands are merged in order, i.e., the bands before begin must have been
+      * merged, with seam as left by the merge of the preceding bands.
+      */
+    void
+    mergeBands( std::vector<Band>&  bands,
+                const size_t        begin,
+                const size_t        end,
+                Seam&               seam );
+
+    /** Compact index of the first cell of row j of layer k of the refined grid.
+      *
+      * Row ny is the end of the layer.
+      */
+    static
+    size_t
+    rowFirstCell( const Grid&   grid,
+                  const Index   k,
+                  const Index   j );
+
+    /** Notify the part listener of the tessellation that the cells of rows
+      * [j_begin,j_end) are done, see Tessellation::setPartListener().
+      */
+    void
+    partDone( const Grid&   grid,
+              const Index   j_begin,
+              const Index   j_end );
+
+    void
+    findActiveCellsInColumn( Index*                     active_cell_list,
+                             Index&                     active_cell_count,
+                             const utils::ActiveCells&  active_cells,
+                             const size_t               offset,
+                             const Index                stride,
+                             const Index                nz );
 
     void
-    findActiveCellsInColumn( Index*            active_cell_list,
-                             Index&            active_cell_count,
-                             const int* const  actnum,
-                             const Index       stride,
-                             const Index       nz );
+    findActiveCellsInColumn( Index*                     active_cell_list,
+                             Index&                     active_cell_count,
+                             const unsigned char*       column,
+                             const Index                stride,
+                             const Index                nz );
 
     void
     uniquePillarVertices( std::vector<Index>&   adjacent_cells,
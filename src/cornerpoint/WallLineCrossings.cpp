@@ -0,0 +1,139 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ * 
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *  
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include "WallLineCrossings.hpp"
+#include "bridge/PolyhedralMeshBridge.hpp"
+#include "bridge/PolyhedralMeshCounter.hpp"
+
+namespace cornerpoint {
+
+template<typename Tessellation>
+void
+WallLineCrossings<Tessellation>::find( std::vector<Index>&  pairs,
+                                       const Index*         p1,
+                                       const Index*         cutoff,
+                                       const size_t         n )
+{
+    pairs.clear();
+    bool built = false;
+    for( size_t lower=0; lower<n; lower++ ) {
+        const Index value = p1[lower];
+
+        // Scan directly, as the quadratic scan would.
+        size_t upper = lower+1;
+        bool done = false;
+        for( ; (upper < n) && (upper < lower+1+scan_lines); upper++ ) {
+            if( cutoff[upper] >= value ) {
+                done = true;
+                break;
+            }
+            if( p1[upper] < value ) {
+                pairs.push_back( lower );
+                pairs.push_back( upper );
+            }
+        }
+        if( done || (upper >= n) ) {
+            continue;
+        }
+
+        // Long scan, find where it stops and the crossings before that.
+        if( !built ) {
+            build( p1, cutoff, n );
+            built = true;
+        }
+        size_t stop = firstCutoff( 1, 0, m_leaves, upper, value );
+        if( stop > n ) {
+            stop = n;
+        }
+        reportBelow( pairs, lower, 1, 0, m_leaves, upper, stop, value );
+    }
+}
+
+template<typename Tessellation>
+void
+WallLineCrossings<Tessellation>::build( const Index*  p1,
+                                        const Index*  cutoff,
+                                        const size_t  n )
+{
+    m_leaves = 1;
+    while( m_leaves < n ) {
+        m_leaves *= 2;
+    }
+    // Padding never crosses and never stops the scan before n.
+    m_min_p1.assign( 2*m_leaves, ~Index(0) );
+    m_max_cutoff.assign( 2*m_leaves, Index(0) );
+    for( size_t i=0; i<n; i++ ) {
+        m_min_p1[ m_leaves + i ] = p1[i];
+        m_max_cutoff[ m_leaves + i ] = cutoff[i];
+    }
+    for( size_t i=m_leaves-1; i>0; i-- ) {
+        m_min_p1[i] = std::min( m_min_p1[2*i], m_min_p1[2*i+1] );
+        m_max_cutoff[i] = std::max( m_max_cutoff[2*i], m_max_cutoff[2*i+1] );
+    }
+}
+
+template<typename Tessellation>
+size_t
+WallLineCrossings<Tessellation>::firstCutoff( const size_t  node,
+                                              const size_t  begin,
+                                              const size_t  end,
+                                              const size_t  from,
+                                              const Index   value ) const
+{
+    if( (end <= from) || (m_max_cutoff[node] < value) ) {
+        return ~size_t(0);
+    }
+    if( end - begin == 1 ) {
+        return begin;
+    }
+    const size_t middle = (begin + end)/2;
+    const size_t left = firstCutoff( 2*node, begin, middle, from, value );
+    if( left != ~size_t(0) ) {
+        return left;
+    }
+    return firstCutoff( 2*node+1, middle, end, from, value );
+}
+
+template<typename Tessellation>
+void
+WallLineCrossings<Tessellation>::reportBelow( std::vector<Index>&  pairs,
+                                              const Index          lower,
+                                              const size_t         node,
+                                              const size_t         begin,
+                                              const size_t         end,
+                                              const size_t         from,
+                                              const size_t         to,
+                                              const Index          value ) const
+{
+    if( (end <= from) || (to <= begin) || (m_min_p1[node] >= value) ) {
+        return;
+    }
+    if( end - begin == 1 ) {
+        pairs.push_back( lower );
+        pairs.push_back( begin );
+        return;
+    }
+    const size_t middle = (begin + end)/2;
+    reportBelow( pairs, lower, 2*node, begin, middle, from, to, value );
+    reportBelow( pairs, lower, 2*node+1, middle, end, from, to, value );
+}
+
+template class WallLineCrossings< bridge::PolyhedralMeshBridge >;
+template class WallLineCrossings< bridge::PolyhedralMeshCounter >;
+
+} // of namespace cornerpoint
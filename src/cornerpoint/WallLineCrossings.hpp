@@ -0,0 +1,94 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ * 
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *  
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <vector>
+#include <cstddef>
+
+namespace cornerpoint {
+
+/** Finds the crossing pairs among the boundary lines on a pillar wall.
+  *
+  * Line l goes from vertex p0[l] on pillar 0 to vertex p1[l] on pillar 1,
+  * and the lines are sorted by p0. Two lines lower < upper cross if
+  * p1[upper] < p1[lower]. The scan for the lines crossing lower stops at the
+  * first upper with cutoff[upper] >= p1[lower], where cutoff[upper] is the
+  * smallest p1 of upper and the lines after it (see
+  * Tessellator::WallLine::m_cutoff).
+  *
+  * The pairs are found in the order of the obvious quadratic scan, i.e.,
+  * ordered by lower and then by upper. Each lower first scans a few lines
+  * directly, which is all an unfaulted wall needs. If that is not enough,
+  * two segment trees over p1 and cutoff find where the scan stops and the
+  * crossing lines before that point. This keeps the search
+  * O((n+k) log n) for n lines and k crossings even on walls where
+  * hundreds of layers are offset against each other.
+  */
+template<typename Tessellation>
+class WallLineCrossings
+{
+public:
+    typedef typename Tessellation::Index  Index;
+
+    /** Lines scanned directly before resorting to the segment trees. */
+    static const size_t scan_lines = 16u;
+
+    /** Find the crossing pairs.
+      *
+      * \param[out] pairs   Cleared and populated with lower,upper pairs.
+      * \param[in]  p1      Vertex index at pillar 1 of each line.
+      * \param[in]  cutoff  Scan cutoff of each line.
+      * \param[in]  n       Number of lines.
+      */
+    void
+    find( std::vector<Index>&  pairs,
+          const Index*         p1,
+          const Index*         cutoff,
+          const size_t         n );
+
+protected:
+    size_t              m_leaves;
+    std::vector<Index>  m_min_p1;       ///< Minimum p1 of each node.
+    std::vector<Index>  m_max_cutoff;   ///< Maximum cutoff of each node.
+
+    /** Build the segment trees over the n lines. */
+    void
+    build( const Index*  p1,
+           const Index*  cutoff,
+           const size_t  n );
+
+    /** First line at or after from in node with cutoff at least value, or ~0 if none. */
+    size_t
+    firstCutoff( const size_t  node,
+                 const size_t  begin,
+                 const size_t  end,
+                 const size_t  from,
+                 const Index   value ) const;
+
+    /** Append lower and each line in [from,to) in node with p1 below value. */
+    void
+    reportBelow( std::vector<Index>&  pairs,
+                 const Index          lower,
+                 const size_t         node,
+                 const size_t         begin,
+                 const size_t         end,
+                 const size_t         from,
+                 const size_t         to,
+                 const Index          value ) const;
+};
+
+} // of namespace cornerpoint
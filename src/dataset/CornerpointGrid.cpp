@@ -17,6 +17,7 @@
 
 #include <algorithm>
 #include <stdexcept>
+#include <map>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <fcntl.h>
@@ -24,11 +25,14 @@
 #include <cstring>
 #include "utils/Logger.hpp"
 #include "utils/Path.hpp"
+#include "utils/PerfTimer.hpp"
+#include "utils/ThreadPool.hpp"
 #include "dataset/CornerpointGrid.hpp"
 #include "eclipse/EclipseParser.hpp"
 #include "cornerpoint/Tessellator.hpp"
 #include "dataset/FooBarParser.hpp"
 #include "bridge/PolyhedralMeshBridge.hpp"
+#include "bridge/PolyhedralMeshCache.hpp"
 #include "bridge/FieldBridge.hpp"
 
 using std::vector;
@@ -42,11 +46,16 @@ static const std::string package = "dataset.Project";
 CornerpointGrid::CornerpointGrid(const std::string filename,
                        int refine_i,
                        int refine_j,
-                       int refine_k )
+                       int refine_k,
+                       bool lazy_restart )
 {
     Logger log = getLogger( "package.constructor" );
 
     m_geometry_type = GEOMETRY_NONE;
+    m_lazy_restart = lazy_restart;
+    m_follow.m_offset = 0;
+    m_follow.m_end = 0;
+    m_follow.m_pending = false;
     m_cornerpoint_geometry.m_rx = 1;
     m_cornerpoint_geometry.m_ry = 1;
     m_cornerpoint_geometry.m_rz = 1;
@@ -99,15 +108,19 @@ CornerpointGrid::CornerpointGrid(const std::string filename,
         m_unprocessed_files.push_front( file );
         LOGGER_DEBUG( log, "Found GEOMETRY file" );
     }
-    else if( suffix == ".EGRID" ) {
+    else if( (suffix == ".EGRID") || (suffix == ".FEGRID") ) {
+        // Formatted files have an F prefixed to the suffix, and the reader
+        // detects the format from the file contents.
+        const bool formatted = suffix == ".FEGRID";
+
         File file;
         file.m_filetype = ECLIPSE_EGRID_FILE;
         file.m_timestep = -1;
         file.m_path     = filename;
         m_unprocessed_files.push_front( file );
-        LOGGER_DEBUG( log, "Found EGRID file" );
+        LOGGER_DEBUG( log, "Found " << (formatted ? "FEGRID" : "EGRID" ) << " file" );
 
-        string unrst = path + stem + ".UNRST";
+        string unrst = path + stem + (formatted ? ".FUNRST" : ".UNRST");
         int fd = open( unrst.c_str(), O_RDONLY );
         if( fd >= 0 ) {
             close( fd );
@@ -122,7 +135,7 @@ CornerpointGrid::CornerpointGrid(const std::string filename,
             // Search for restart steps in separate files
             for(int step=0; true; step++) {
                 std::stringstream o;
-                o << path << stem << ".X";
+                o << path << stem << (formatted ? ".F" : ".X");
                 o.width( 4 );
                 o.fill( '0' );
                 o << step;
@@ -158,12 +171,89 @@ CornerpointGrid::geometry( Tessellation&                                  geomet
                    const std::string&                             progress_description_key,
                    const std::string&                             progress_counter_key )
 {
-    cornerpoint::Tessellator< bridge::PolyhedralMeshBridge > tessellator( geometry_bridge );
+    typedef cornerpoint::Tessellator< bridge::PolyhedralMeshBridge > Tessellator;
+    Tessellator tessellator( geometry_bridge );
+
+    const std::vector< eclipse::LocalGrid<REAL> >& local_grids = m_cornerpoint_geometry.m_local_grids;
+    if( local_grids.empty() ) {
+        tessellator.setRefinement( m_cornerpoint_geometry.m_rx,
+                                   m_cornerpoint_geometry.m_ry,
+                                   m_cornerpoint_geometry.m_rz );
+        tessellator.tessellate( model, progress_description_key, progress_counter_key,
+                                m_cornerpoint_geometry.m_nx,
+                                m_cornerpoint_geometry.m_ny,
+                                m_cornerpoint_geometry.m_nz,
+                                nr(),
+                                cornerPointCoord(),
+                                cornerPointZCorn(),
+                                cornerPointActiveCells() );
+        return;
+    }
+
+    // The global grid leaves holes where the host cells are, which are filled
+    // by the local grids. Cells are enumerated as in localGridField().
     tessellator.tessellate( model, progress_description_key, progress_counter_key,
                             nx(), ny(), nz(), nr(),
                             cornerPointCoord(),
                             cornerPointZCorn(),
-                            cornerPointActNum() );
+                            cornerPointActiveCells(),
+                            &m_cornerpoint_geometry.m_tessellated_cells );
+
+    Tessellator::Index offset = cornerPointActiveCells().count();
+    for( size_t l=0; l<local_grids.size(); l++ ) {
+        const eclipse::LocalGrid<REAL>& lgr = local_grids[l];
+
+        std::vector<Tessellator::Index> host( lgr.m_hostnum.size() );
+        for( size_t i=0; i<host.size(); i++ ) {
+            host[i] = lgr.m_hostnum[i] - 1;
+        }
+        tessellator.tessellate( model, progress_description_key, progress_counter_key,
+                                lgr.m_nx, lgr.m_ny, lgr.m_nz, lgr.m_nr,
+                                lgr.m_coord,
+                                lgr.m_zcorn,
+                                lgr.m_active_cells,
+                                NULL,
+                                offset,
+                                host.data() );
+        offset += lgr.m_active_cells.count();
+    }
+}
+
+bool
+CornerpointGrid::geometryKey( uint64_t& key ) const
+{
+    typedef bridge::PolyhedralMeshCache Cache;
+
+    // Refinement is virtual, so the coordinates are those of the unrefined
+    // grid and only the refinement factors tell refinements apart. The
+    // dimensions are included so that differently shaped grids never collide.
+    const uint64_t dims[7] = { nx(), ny(), nz(), nr(),
+                               m_cornerpoint_geometry.m_rx,
+                               m_cornerpoint_geometry.m_ry,
+                               m_cornerpoint_geometry.m_rz };
+    uint64_t h = Cache::hash( dims, sizeof(dims) );
+    h = Cache::hash( m_cornerpoint_geometry.m_coord.data(),
+                     sizeof(REAL)*m_cornerpoint_geometry.m_coord.size(), h );
+    h = Cache::hash( m_cornerpoint_geometry.m_zcorn.data(),
+                     sizeof(REAL)*m_cornerpoint_geometry.m_zcorn.size(), h );
+    h = Cache::hash( m_cornerpoint_geometry.m_active_cells.bits().data(),
+                     sizeof(uint64_t)*m_cornerpoint_geometry.m_active_cells.bits().size(), h );
+    h = Cache::hash( m_cornerpoint_geometry.m_tessellated_cells.bits().data(),
+                     sizeof(uint64_t)*m_cornerpoint_geometry.m_tessellated_cells.bits().size(), h );
+
+    const std::vector< eclipse::LocalGrid<REAL> >& local_grids = m_cornerpoint_geometry.m_local_grids;
+    for( size_t l=0; l<local_grids.size(); l++ ) {
+        const eclipse::LocalGrid<REAL>& lgr = local_grids[l];
+        const uint64_t lgr_dims[4] = { lgr.m_nx, lgr.m_ny, lgr.m_nz, lgr.m_nr };
+        h = Cache::hash( lgr_dims, sizeof(lgr_dims), h );
+        h = Cache::hash( lgr.m_coord.data(), sizeof(REAL)*lgr.m_coord.size(), h );
+        h = Cache::hash( lgr.m_zcorn.data(), sizeof(REAL)*lgr.m_zcorn.size(), h );
+        h = Cache::hash( lgr.m_active_cells.bits().data(),
+                         sizeof(uint64_t)*lgr.m_active_cells.bits().size(), h );
+        h = Cache::hash( lgr.m_hostnum.data(), sizeof(lgr.m_hostnum[0])*lgr.m_hostnum.size(), h );
+    }
+    key = h;
+    return true;
 }
 
 
@@ -182,7 +272,7 @@ CornerpointGrid::addFile( const string& filename )
       *it = toupper( *it );
     }
 
-    if( suffix == "EGRID" ) {
+    if( (suffix == "EGRID") || (suffix == "FEGRID") ) {
         File file;
         file.m_filetype = ECLIPSE_EGRID_FILE;
         file.m_timestep = -1;
@@ -203,7 +293,7 @@ CornerpointGrid::addFile( const string& filename )
         file.m_path     = filename;
         m_unprocessed_files.push_front( file );
     }
-    else if( suffix.size() > 2 && suffix[0] == 'X' && isdigit( suffix[1] ) ) {
+    else if( suffix.size() > 2 && ((suffix[0] == 'X') || (suffix[0] == 'F')) && isdigit( suffix[1] ) ) {
         int index = 0;
         for( auto it = ++suffix.begin(); it != suffix.end(); ++it ) {
             if( !isdigit( *it ) ) {
@@ -218,7 +308,7 @@ CornerpointGrid::addFile( const string& filename )
         file.m_path     = filename;
         m_unprocessed_files.push_back( file );
     }
-    else if( suffix == "UNRST" ) {
+    else if( (suffix == "UNRST") || (suffix == "FUNRST") ) {
         File file;
         file.m_filetype = ECLIPSE_UNIFIED_RESTART_FILE;
         file.m_timestep = -1;
@@ -261,14 +351,13 @@ CornerpointGrid::bakeCornerpointGeometry()
         }
     }
 
-    REAL minz, maxz;
-    for(uint i=0; i<nx*ny*nz; i++) {
-        if( m_cornerpoint_geometry.m_actnum[i] != 0 ) {
-            minz = maxz = m_cornerpoint_geometry.m_zcorn[8*i];
-        }
+    const utils::ActiveCells& active_cells = m_cornerpoint_geometry.m_active_cells;
+    REAL minz = 0.f, maxz = 0.f;
+    if( active_cells.count() > 0 ) {
+        minz = maxz = m_cornerpoint_geometry.m_zcorn[ 8*active_cells.select( 0 ) ];
     }
     for(uint i=0; i<nx*ny*nz; i++) {
-        if( m_cornerpoint_geometry.m_actnum[i] != 0 ) {
+        if( active_cells.active( i ) ) {
             for(uint k=0; k<8; k++) {
                 minz = std::min( minz, m_cornerpoint_geometry.m_zcorn[8*i+k] );
                 maxz = std::max( maxz, m_cornerpoint_geometry.m_zcorn[8*i+k] );
@@ -307,9 +396,53 @@ CornerpointGrid::bakeCornerpointGeometry()
     for(uint i=0; i<8*nx*ny*nz; i++) {
         m_cornerpoint_geometry.m_zcorn[i] = scale[2]*(m_cornerpoint_geometry.m_zcorn[i] - shift[2]);
    }
+    // local grids share the coordinate system of the global grid
+    for(size_t l=0; l<m_cornerpoint_geometry.m_local_grids.size(); l++ ) {
+        eclipse::LocalGrid<REAL>& lgr = m_cornerpoint_geometry.m_local_grids[l];
+        for(size_t i=0; i<lgr.m_coord.size(); i++ ) {
+            lgr.m_coord[i] = scale[i%3]*(lgr.m_coord[i] - shift[i%3]);
+        }
+        for(size_t i=0; i<lgr.m_zcorn.size(); i++ ) {
+            lgr.m_zcorn[i] = scale[2]*(lgr.m_zcorn[i] - shift[2]);
+        }
+    }
 #endif
 }
 
+void
+CornerpointGrid::setupLocalGrids()
+{
+    Logger log = getLogger( package + ".setupLocalGrids" );
+
+    std::vector< eclipse::LocalGrid<REAL> >& local_grids = m_cornerpoint_geometry.m_local_grids;
+    if( local_grids.empty() ) {
+        return;
+    }
+    if( (m_cornerpoint_geometry.m_rx != 1) || (m_cornerpoint_geometry.m_ry != 1) || (m_cornerpoint_geometry.m_rz != 1) ) {
+        LOGGER_WARN( log, "Local grid refinements are ignored when the grid is refined." );
+        local_grids.clear();
+        return;
+    }
+
+    // Only the active cells of a local grid replace their host cells.
+    std::vector<uint64_t> bits = m_cornerpoint_geometry.m_active_cells.bits();
+    size_t cells = 0;
+    for( size_t l=0; l<local_grids.size(); l++ ) {
+        const eclipse::LocalGrid<REAL>& lgr = local_grids[l];
+        for( size_t i=0; i<lgr.m_hostnum.size(); i++ ) {
+            if( lgr.m_active_cells.active( i ) ) {
+                const size_t host = lgr.m_hostnum[i] - 1;
+                bits[ host>>6u ] &= ~(uint64_t(1u) << (host&63u));
+            }
+        }
+        cells += lgr.m_active_cells.count();
+    }
+    m_cornerpoint_geometry.m_tessellated_cells.assign( bits, m_cornerpoint_geometry.m_active_cells.size() );
+    LOGGER_DEBUG( log, local_grids.size() << " local grids with " << cells << " active cells replace "
+                  << (m_cornerpoint_geometry.m_active_cells.count() - m_cornerpoint_geometry.m_tessellated_cells.count())
+                  << " host cells." );
+}
+
 
 float CornerpointGrid::cornerPointXYScale() const {
     if( m_geometry_type == GEOMETRY_CORNERPOINT_GRID ) {
@@ -339,120 +472,55 @@ CornerpointGrid::refineCornerpointGeometry( unsigned int rx,
         return;
     }
 
-    uint old_nx = m_cornerpoint_geometry.m_nx;
-    uint old_ny = m_cornerpoint_geometry.m_ny;
-    uint old_nz = m_cornerpoint_geometry.m_nz;
-    uint new_nx = rx*old_nx;
-    uint new_ny = ry*old_ny;
-    uint new_nz = rz*old_nz;
-    const std::vector<REAL>& old_coord = m_cornerpoint_geometry.m_coord;
-    const std::vector<REAL>& old_zcorn = m_cornerpoint_geometry.m_zcorn;
-    const std::vector<int>& old_actnum = m_cornerpoint_geometry.m_actnum;
-    std::vector<REAL> new_coord( 6*(new_nx+1)*(new_ny+1) );
-    std::vector<REAL> new_zcorn( 8*new_nx * new_ny * new_nz );
-    std::vector<int>  new_actnum( new_nx * new_ny * new_nz );
-
-    for(uint j=0; j<=new_ny; j++ ) {
-        uint jm = j/ry;
-        uint jp = (j+ry-1)/ry;
-        float jr = glm::fract( (float)j/(float)ry );
-        for(uint i=0; i<=new_nx; i++ ) {
-            uint im = i/rx;
-            uint ip = (i+rx-1)/rx;
-            float ir = glm::fract( (float)i/(float)rx );
-
-            for(int k=0; k<6; k++) {
-                new_coord[ 6*((new_nx+1)*j+i)+k] =
-                        old_coord[ 6*((old_nx+1)*jm+im)+k ]*(1.f-jr)*(1.f-ir) +
-                        old_coord[ 6*((old_nx+1)*jm+ip)+k ]*(1.f-jr)*ir +
-                        old_coord[ 6*((old_nx+1)*jp+im)+k ]*jr*(1.f-ir) +
-                        old_coord[ 6*((old_nx+1)*jp+ip)+k ]*jr*ir;
-
-            }
-        }
-    }
-
-    int active = 0;
-    std::vector<uint> remap( old_nx*old_ny*old_nz);
-    for( uint old_k=0; old_k<old_nz; old_k++ ) {
-        for( uint old_j=0; old_j<old_ny; old_j++ ) {
-            for( uint old_i=0; old_i<old_nx; old_i++ ) {
-                uint l = old_nx*old_ny*old_k + old_nx*old_j + old_i;
-                if( old_actnum[l] != 0 ) {
-                    remap[ l ] = active++;
-                }
-                else {
-                    remap[l ] = ~0u;
+    Logger log = getLogger( package + ".refineCornerpointGeometry" );
+
+    const unsigned int nx = m_cornerpoint_geometry.m_nx;
+    const unsigned int ny = m_cornerpoint_geometry.m_ny;
+    const unsigned int nz = m_cornerpoint_geometry.m_nz;
+    const utils::ActiveCells& active = m_cornerpoint_geometry.m_active_cells;
+    const size_t layer = (size_t)nx*ny;
+
+    // The compact index of a refined cell is its rank among the refined
+    // active cells, i.e., each active cell of an unrefined layer contributes
+    // rx*ry cells to each of its rz refined layers. This gives the start of
+    // each refined layer, and the layers are filled concurrently.
+    std::vector<size_t> layer_begin( rz*nz + 1 );
+    layer_begin[0] = 0;
+    for( unsigned int k=0; k<rz*nz; k++ ) {
+        const size_t begin = active.rank( layer*(k/rz) );
+        const size_t end = active.rank( layer*(k/rz+1) );
+        layer_begin[k+1] = layer_begin[k] + (size_t)rx*ry*(end-begin);
+    }
+    std::vector<int>& map = m_cornerpoint_geometry.m_refine_map_compact;
+    map.resize( layer_begin.back() );
+
+    PerfTimer start;
+    utils::ThreadPool::instance().run( rz*nz, [&]( size_t new_k )
+    {
+        const size_t old_k = new_k/rz;
+        size_t o = layer_begin[ new_k ];
+        for( unsigned int new_j=0; new_j<ry*ny; new_j++ ) {
+            const size_t old_j = new_j/ry;
+            // The active cells of a row are consecutive in the compact
+            // enumeration, so the row is found from rank alone and inactive
+            // cells are never visited.
+            const size_t row = layer*old_k + nx*old_j;
+            const size_t begin = active.rank( row );
+            const size_t end = active.rank( row + nx );
+            for( size_t r=begin; r<end; r++ ) {
+                for( unsigned int ii=0; ii<rx; ii++ ) {
+                    map[o++] = r;
                 }
             }
         }
-    }
-
-    m_cornerpoint_geometry.m_refine_map_compact.clear();
-    for( uint new_k=0; new_k<new_nz; new_k++ ) {
-        uint old_k = new_k/rz;
-        // float krm = glm::fract( (float)new_k/(float)rz );
-        // float krp = glm::fract( (float)(new_k+1.f)/(float)rz);
-
-
-        for( uint new_j=0; new_j<new_ny; new_j++ ) {
-            uint old_j = new_j/ry;
-            for( uint new_i=0; new_i<new_nx; new_i++ ) {
-                uint old_i = new_i/rx;
-
-                float z000 = old_zcorn[ 2*old_nx*2*old_ny*(2*old_k+0)  + 2*old_nx*(2*old_j+0) + 2*old_i+0 ];
-                float z001 = old_zcorn[ 2*old_nx*2*old_ny*(2*old_k+0)  + 2*old_nx*(2*old_j+0) + 2*old_i+1 ];
-                float z010 = old_zcorn[ 2*old_nx*2*old_ny*(2*old_k+0)  + 2*old_nx*(2*old_j+1) + 2*old_i+0 ];
-                float z011 = old_zcorn[ 2*old_nx*2*old_ny*(2*old_k+0)  + 2*old_nx*(2*old_j+1) + 2*old_i+1 ];
-                float z100 = old_zcorn[ 2*old_nx*2*old_ny*(2*old_k+1)  + 2*old_nx*(2*old_j+0) + 2*old_i+0 ];
-                float z101 = old_zcorn[ 2*old_nx*2*old_ny*(2*old_k+1)  + 2*old_nx*(2*old_j+0) + 2*old_i+1 ];
-                float z110 = old_zcorn[ 2*old_nx*2*old_ny*(2*old_k+1)  + 2*old_nx*(2*old_j+1) + 2*old_i+0 ];
-                float z111 = old_zcorn[ 2*old_nx*2*old_ny*(2*old_k+1)  + 2*old_nx*(2*old_j+1) + 2*old_i+1 ];
-
-                for(int kk=0; kk<2; kk++) {
-                    for(int jj=0; jj<2; jj++) {
-                        for(int ii=0; ii<2; ii++) {
-                            float xt = (float)((new_i % rx)+ii)/(float)rx;
-                            float yt = (float)((new_j % ry)+jj)/(float)ry;
-                            float zt = (float)((new_k % rz)+kk)/(float)rz;
-
-                            float z = z000*(1.f-zt)*(1.f-yt)*(1.f-xt)
-                                    + z001*(1.f-zt)*(1.f-yt)*xt
-                                    + z010*(1.f-zt)*yt*(1.f-xt)
-                                    + z011*(1.f-zt)*yt*xt
-                                    + z100*zt*(1.f-yt)*(1.f-xt)
-                                    + z101*zt*(1.f-yt)*xt
-                                    + z110*zt*yt*(1.f-xt)
-                                    + z111*zt*yt*xt;
-
-                            new_zcorn[ 2*new_nx*2*new_ny*(2*new_k+kk) + 2*new_nx*(2*new_j+jj) + 2*new_i+ii ] = z;
-                        }
-                    }
-                }
-                if( old_actnum[ old_nx*old_ny*old_k + old_nx*old_j + old_i ] != 0 ) {
-                    m_cornerpoint_geometry.m_refine_map_compact.push_back( remap[old_nx*old_ny*old_k + old_nx*old_j + old_i] );
-                }
-
-                new_actnum[ new_nx*new_ny*new_k  + new_nx*new_j + new_i ] =
-                        old_actnum[ old_nx*old_ny*old_k + old_nx*old_j + old_i ];
+    } );
+    PerfTimer stop;
 
-            }
-        }
-    }
     m_cornerpoint_geometry.m_rx = rx;
     m_cornerpoint_geometry.m_ry = ry;
     m_cornerpoint_geometry.m_rz = rz;
-
-/*    m_cornerpoint_geometry.m_nx = rx*old_nx;
-    m_cornerpoint_geometry.m_ny = ry*old_ny;
-    m_cornerpoint_geometry.m_nz = rz*old_nz;
-    m_cornerpoint_geometry.m_rx = 1;
-    m_cornerpoint_geometry.m_ry = 1;
-    m_cornerpoint_geometry.m_rz = 1;
-*/
-    m_cornerpoint_geometry.m_coord.swap( new_coord );
-    m_cornerpoint_geometry.m_zcorn.swap( new_zcorn );
-    m_cornerpoint_geometry.m_actnum.swap( new_actnum );
+    LOGGER_DEBUG( log, "Refined " << active.count() << " active cells into " << map.size()
+                  << " (" << (1000.0*PerfTimer::delta( start, stop )) << "ms)" );
 }
 
 void
@@ -468,10 +536,12 @@ CornerpointGrid::refresh( int rx, int ry, int rz )
                     unsigned int nx, ny, nz, nr;
                     std::vector<REAL>  coord;
                     std::vector<REAL>  zcorn;
-                    std::vector<int>   actnum;
+                    utils::ActiveCells active_cells;
                     eclipse::Properties properties;
+                    std::vector< eclipse::LocalGrid<REAL> > local_grids;
 
-                    eclipse::parseEGrid( nx, ny, nz, nr, coord, zcorn, actnum, properties, it->m_path );
+                    eclipse::parseEGrid( nx, ny, nz, nr, coord, zcorn, active_cells, properties, it->m_path,
+                                         &local_grids );
 
                     m_geometry_type = GEOMETRY_CORNERPOINT_GRID;
                     m_cornerpoint_geometry.m_nx = nx;
@@ -480,9 +550,11 @@ CornerpointGrid::refresh( int rx, int ry, int rz )
                     m_cornerpoint_geometry.m_nr = nr;
                     m_cornerpoint_geometry.m_coord.swap( coord );
                     m_cornerpoint_geometry.m_zcorn.swap( zcorn );
-                    m_cornerpoint_geometry.m_actnum.swap( actnum );
+                    m_cornerpoint_geometry.m_active_cells = active_cells;
+                    m_cornerpoint_geometry.m_local_grids.swap( local_grids );
                     bakeCornerpointGeometry();
                     refineCornerpointGeometry( rx, ry, rz );
+                    setupLocalGrids();
                 }
                 catch( const std::runtime_error& e ) {
                     LOGGER_ERROR( log, it->m_path << ": Parse error: " << e.what() );
@@ -517,7 +589,7 @@ CornerpointGrid::refresh( int rx, int ry, int rz )
                     m_cornerpoint_geometry.m_nr = 1;
                     m_cornerpoint_geometry.m_coord.swap( coord );
                     m_cornerpoint_geometry.m_zcorn.swap( zcorn );
-                    m_cornerpoint_geometry.m_actnum.swap( actnum );
+                    m_cornerpoint_geometry.m_active_cells.build( actnum.data(), actnum.size() );
                     bakeCornerpointGeometry();
                     refineCornerpointGeometry( rx, ry, rz );
                 }
@@ -551,7 +623,7 @@ CornerpointGrid::refresh( int rx, int ry, int rz )
                     m_cornerpoint_geometry.m_nr = 1;
                     m_cornerpoint_geometry.m_coord.swap( coord );
                     m_cornerpoint_geometry.m_zcorn.swap( zcorn );
-                    m_cornerpoint_geometry.m_actnum.swap( actnum );
+                    m_cornerpoint_geometry.m_active_cells.build( actnum.data(), actnum.size() );
                     bakeCornerpointGeometry();
                     refineCornerpointGeometry( rx, ry, rz );
                 }
@@ -599,30 +671,79 @@ CornerpointGrid::refresh( int rx, int ry, int rz )
         LOGGER_ERROR( log, "Cannot process restart files without geometry" );
     }
 
+    // Per-step restart files are independent, parse them concurrently.
+    std::vector<const File*> restart_files;
+    for( auto it = m_unprocessed_files.begin(); it!=m_unprocessed_files.end(); ++it ) {
+        if( it->m_filetype == ECLIPSE_RESTART_FILE ) {
+            restart_files.push_back( &(*it) );
+        }
+    }
+    std::vector< std::list<eclipse::ReportStep> > restart_steps( restart_files.size() );
+    std::vector< std::string > restart_errors( restart_files.size() );
+    if( !restart_files.empty() ) {
+        PerfTimer start;
+        utils::ThreadPool::instance().run( restart_files.size(),
+                                           [&]( size_t i )
+        {
+            try {
+                eclipse::parseRestartFile( restart_steps[i],
+                                           m_cornerpoint_geometry.m_active_cells,
+                                           restart_files[i]->m_path );
+            }
+            catch( const std::runtime_error& e ) {
+                restart_steps[i].clear();
+                restart_errors[i] = e.what();
+            }
+        } );
+        PerfTimer stop;
+        LOGGER_DEBUG( log, "Parsed " << restart_files.size() << " restart files ("
+                      << (1000.0*PerfTimer::delta( start, stop )) << "ms)" );
+    }
+
     for( auto it = m_unprocessed_files.begin(); it!=m_unprocessed_files.end(); ++it ) {
 
 
-        if( it->m_filetype == ECLIPSE_UNIFIED_RESTART_FILE ) {
+        if( (it->m_filetype == ECLIPSE_UNIFIED_RESTART_FILE) && m_lazy_restart ) {
             try {
+                PerfTimer start;
                 std::list<eclipse::ReportStep> report_steps;
-                eclipse::parseUnifiedRestartFile( report_steps,
-                                                  m_cornerpoint_geometry.m_actnum,
+                std::list<eclipse::ReportStepBlocks> step_blocks;
+                eclipse::indexUnifiedRestartFile( report_steps,
+                                                  step_blocks,
                                                   it->m_path );
-                for( auto jt=report_steps.begin(); jt!=report_steps.end(); ++jt ) {
-                    import( *jt, it->m_path );
+                // Wells are numbered here, in file order, as deferred parsing
+                // may visit the steps in any order and on any thread.
+                auto kt = step_blocks.begin();
+                for( auto jt=report_steps.begin(); jt!=report_steps.end(); ++jt, ++kt ) {
+                    for( auto lt=kt->m_well_names.begin(); lt!=kt->m_well_names.end(); ++lt ) {
+                        wellIndex( *lt );
+                    }
+                    importSolutions( *jt, it->m_path );
+                    ReportStep& step = reportStepBySeqNum( jt->m_sequence_number );
+                    step.m_parsed = false;
+                    step.m_pending_path = it->m_path;
+                    step.m_pending_blocks.m_sequence_number = kt->m_sequence_number;
+                    step.m_pending_blocks.m_blocks.swap( kt->m_blocks );
                 }
+                // The first step is shown initially, no point in deferring it.
+                if( !m_report_steps.empty() ) {
+                    parseReportStep( 0 );
+                }
+                PerfTimer stop;
+                LOGGER_DEBUG( log, "Indexed " << report_steps.size() << " report steps of "
+                              << it->m_path << " (" << (1000.0*PerfTimer::delta( start, stop )) << "ms)" );
             }
             catch( const std::runtime_error& e ) {
                 LOGGER_ERROR( log, it->m_path << ": Parse error: " << e.what() );
                 break;
             }
-       }
-        else if( it->m_filetype == ECLIPSE_RESTART_FILE ) {
+        }
+        else if( it->m_filetype == ECLIPSE_UNIFIED_RESTART_FILE ) {
             try {
                 std::list<eclipse::ReportStep> report_steps;
-                eclipse::parseRestartFile( report_steps,
-                                           m_cornerpoint_geometry.m_actnum,
-                                           it->m_path );
+                eclipse::parseUnifiedRestartFile( report_steps,
+                                                  m_cornerpoint_geometry.m_active_cells,
+                                                  it->m_path );
                 for( auto jt=report_steps.begin(); jt!=report_steps.end(); ++jt ) {
                     import( *jt, it->m_path );
                 }
@@ -631,6 +752,51 @@ CornerpointGrid::refresh( int rx, int ry, int rz )
                 LOGGER_ERROR( log, it->m_path << ": Parse error: " << e.what() );
                 break;
             }
+       }
+    }
+
+    // Import in SEQNUM order regardless of file listing and completion order,
+    // so well and field indices do not depend on scheduling.
+    std::vector< std::pair<const eclipse::ReportStep*, const std::string*> > restart_order;
+    for( size_t i=0; i<restart_files.size(); i++ ) {
+        if( !restart_errors[i].empty() ) {
+            LOGGER_ERROR( log, restart_files[i]->m_path << ": Parse error: " << restart_errors[i] );
+            continue;
+        }
+        for( auto jt=restart_steps[i].begin(); jt!=restart_steps[i].end(); ++jt ) {
+            restart_order.push_back( std::make_pair( &(*jt), &restart_files[i]->m_path ) );
+        }
+    }
+    std::stable_sort( restart_order.begin(),
+                      restart_order.end(),
+                      []( const std::pair<const eclipse::ReportStep*, const std::string*>& a,
+                          const std::pair<const eclipse::ReportStep*, const std::string*>& b )
+    {
+        return a.first->m_sequence_number < b.first->m_sequence_number;
+    } );
+    for( auto it=restart_order.begin(); it!=restart_order.end(); ++it ) {
+        import( *it->first, *it->second );
+    }
+
+    // Follow the unified restart file from the start of its last step, which
+    // may still grow, formatted files are not followed.
+    for( auto it = m_unprocessed_files.begin(); it!=m_unprocessed_files.end(); ++it ) {
+        if( it->m_filetype != ECLIPSE_UNIFIED_RESTART_FILE ) {
+            continue;
+        }
+        boost::shared_ptr<eclipse::Reader> reader = m_reader_cache.reader( it->m_path );
+        if( !reader->formatted() ) {
+            const std::list<eclipse::Block> blocks = reader->blocks();
+            m_follow.m_path = it->m_path;
+            m_follow.m_offset = 0;
+            m_follow.m_end = 0;
+            for( auto jt=blocks.begin(); jt!=blocks.end(); ++jt ) {
+                if( jt->m_keyword == eclipse::KEYWORD_SEQNUM ) {
+                    // The header record precedes the data by 4+16+4 bytes.
+                    m_follow.m_offset = jt->m_offset - 24;
+                }
+                m_follow.m_end = jt->m_offset + jt->m_size;
+            }
         }
     }
     m_unprocessed_files.clear();
@@ -652,6 +818,7 @@ CornerpointGrid::wellDefined(  const unsigned int report_step_ix,
     if( m_report_steps.size() <= report_step_ix ) {
         return false;
     }
+    ensureReportStep( report_step_ix );
     if( m_report_steps[ report_step_ix ].m_wells.size() <= well_ix ) {
         return false;
     }
@@ -659,6 +826,19 @@ CornerpointGrid::wellDefined(  const unsigned int report_step_ix,
 }
 
 
+unsigned int
+CornerpointGrid::wellIndex( const std::string& name )
+{
+    auto it = m_well_name_lut.find( name );
+    if( it != m_well_name_lut.end() ) {
+        return it->second;
+    }
+    unsigned int well_index = m_well_names.size();
+    m_well_names.push_back( name );
+    m_well_name_lut[ name ] = well_index;
+    return well_index;
+}
+
 void
 CornerpointGrid::addWell( const eclipse::Well& ewell,
                        const unsigned int sequence_number )
@@ -680,16 +860,7 @@ CornerpointGrid::addWell( const eclipse::Well& ewell,
                       "]  (" << report_step.m_date << ")" );
     }
 
-    unsigned int well_index = 0u;
-    auto it = m_well_name_lut.find( ewell.m_name );
-    if( it == m_well_name_lut.end() ) {
-        well_index = m_well_names.size();
-        m_well_names.push_back( ewell.m_name );
-        m_well_name_lut[ ewell.m_name ] = well_index;
-    }
-    else {
-        well_index = it->second;
-    }
+    unsigned int well_index = wellIndex( ewell.m_name );
 
     if( well_index <= report_step.m_wells.size() ) {
         unsigned int a = report_step.m_wells.size();
@@ -738,6 +909,13 @@ CornerpointGrid::addWell( const eclipse::Well& ewell,
 void
 CornerpointGrid::import( const eclipse::ReportStep& e_step,
                        const std::string path )
+{
+    importDateAndWells( e_step );
+    importSolutions( e_step, path );
+}
+
+void
+CornerpointGrid::importDateAndWells( const eclipse::ReportStep& e_step )
 {
     Logger log = getLogger( "Project.Eclipse.Reportstep.import" );
 
@@ -803,9 +981,19 @@ CornerpointGrid::import( const eclipse::ReportStep& e_step,
         }
         */
     }
+}
+
+void
+CornerpointGrid::importSolutions( const eclipse::ReportStep& e_step,
+                                  const std::string path )
+{
+    const std::vector< eclipse::LocalGrid<REAL> >& local_grids = m_cornerpoint_geometry.m_local_grids;
 
     for( auto kt=e_step.m_solutions.begin(); kt!=e_step.m_solutions.end(); ++kt ) {
         const eclipse::Solution& e_solution = *kt;
+        if( !e_solution.m_local_grid.empty() ) {
+            continue;
+        }
 
         Solution solution;
         solution.m_reader = READER_UNFORMATTED_ECLIPSE;
@@ -816,6 +1004,29 @@ CornerpointGrid::import( const eclipse::ReportStep& e_step,
                      e_step.m_sequence_number );
 
     }
+
+    // Attach the solutions of the local grids to the global solution of the
+    // same name, a local grid without one falls back to its host cells.
+    for( auto kt=e_step.m_solutions.begin(); kt!=e_step.m_solutions.end(); ++kt ) {
+        const eclipse::Solution& e_solution = *kt;
+        if( e_solution.m_local_grid.empty() ) {
+            continue;
+        }
+        auto nt = m_solution_name_lut.find( e_solution.m_name );
+        if( nt == m_solution_name_lut.end() ) {
+            continue;
+        }
+        for( size_t l=0; l<local_grids.size(); l++ ) {
+            if( local_grids[l].m_name == e_solution.m_local_grid ) {
+                Solution& solution = reportStepBySeqNum( e_step.m_sequence_number ).m_solutions[ nt->second ];
+                if( solution.m_reader == READER_UNFORMATTED_ECLIPSE && solution.m_path == path ) {
+                    solution.m_local_grids.resize( local_grids.size() );
+                    solution.m_local_grids[l] = e_solution.m_location;
+                }
+                break;
+            }
+        }
+    }
 }
 
 
@@ -830,7 +1041,7 @@ CornerpointGrid::cornerPointCellCentroid( REAL*               p,
     const unsigned int nj = m_cornerpoint_geometry.m_ny;
 
     size_t global_ix = i + ni*(j + k*nj);
-    if( m_cornerpoint_geometry.m_actnum[ global_ix ] == 0 ) {
+    if( !m_cornerpoint_geometry.m_active_cells.active( global_ix ) ) {
         Logger log = getLogger( "Project.cornerPointCellCentroid" );
         LOGGER_ERROR( log, "cell is inactive" );
         p[0] = p[1] = p[2] = 0.f;
@@ -904,6 +1115,7 @@ CornerpointGrid::reportStepBySeqNum( unsigned int seqnum )
     m_report_steps.push_back( ReportStep() );
     ReportStep& step = m_report_steps.back();
     step.m_seqnum = seqnum;
+    step.m_parsed = true;
     step.m_solutions.resize( m_solution_names.size() );
     for(std::vector<Solution>::iterator it=step.m_solutions.begin(); it!=step.m_solutions.end(); ++it ) {
         it->m_reader = READER_NONE;
@@ -1005,12 +1217,53 @@ CornerpointGrid::nz() const
 
 
 
+const unsigned int
+CornerpointGrid::wellCount() const
+{
+    std::lock_guard<std::mutex> guard( m_report_step_lock );
+    return m_well_names.size();
+}
+
+const std::string&
+CornerpointGrid::wellName( unsigned int well_ix ) const
+{
+    std::lock_guard<std::mutex> guard( m_report_step_lock );
+    return m_well_names[ well_ix ];
+}
+
+// A report step is not changed once parsed, so references into it stay valid.
+const float*
+CornerpointGrid::wellHeadPosition( const unsigned int report_step_ix,
+                                   const unsigned int well_ix ) const
+{
+    ensureReportStep( report_step_ix );
+    return m_report_steps[ report_step_ix ].m_wells[ well_ix ].m_head;
+}
+
+const unsigned int
+CornerpointGrid::wellBranchCount( const unsigned int report_step_ix,
+                                  const unsigned int well_ix ) const
+{
+    ensureReportStep( report_step_ix );
+    return m_report_steps[ report_step_ix ].m_wells[ well_ix ].m_branches.size();
+}
+
+const std::vector<float>&
+CornerpointGrid::wellBranchPositions( const unsigned int report_step_ix,
+                                      const unsigned int well_ix,
+                                      const unsigned int branch_ix )
+{
+    ensureReportStep( report_step_ix );
+    return m_report_steps[ report_step_ix ].m_wells[ well_ix ].m_branches[ branch_ix ];
+}
+
 const std::vector<CornerpointGrid::Well>&
 CornerpointGrid::wells( const unsigned int step )
 {
     if( step >= m_report_steps.size() ) {
         throw std::runtime_error( "Illegal report step" );
     }
+    ensureReportStep( step );
     return m_report_steps[ step ].m_wells;
 }
 
@@ -1021,26 +1274,45 @@ CornerpointGrid::field( boost::shared_ptr<Field>  bridge,
        const size_t              field_index,
        const size_t              timestep_index ) const
 {
-    if( field_index >= m_solution_names.size()) {
-        throw std::runtime_error( "Illegal solution index" );
-    }
-    if( timestep_index >= m_report_steps.size() ) {
-        throw std::runtime_error( "Illegal report step" );
+    ensureReportStep( timestep_index );
+
+    // Report steps may be appended concurrently, see appendRestartSteps().
+    Solution sol;
+    {
+        std::lock_guard<std::mutex> guard( m_report_step_lock );
+        if( field_index >= m_solution_names.size()) {
+            throw std::runtime_error( "Illegal solution index" );
+        }
+        if( timestep_index >= m_report_steps.size() ) {
+            throw std::runtime_error( "Illegal report step" );
+        }
+        sol = m_report_steps[ timestep_index ].m_solutions[ field_index ];
     }
-
-    const Solution& sol = m_report_steps[ timestep_index ].m_solutions[ field_index ];
     if( sol.m_reader == READER_UNFORMATTED_ECLIPSE ) {
 
+        // The timeline is typically scrubbed, so let the kernel read the same
+        // field of the adjacent report steps while we decode this one.
+        if( timestep_index > 0 ) {
+            prefetchField( field_index, timestep_index - 1 );
+        }
+        prefetchField( field_index, timestep_index + 1 );
+
+        if( !m_cornerpoint_geometry.m_local_grids.empty() ) {
+            localGridField( bridge, sol );
+            return;
+        }
+
+        boost::shared_ptr<eclipse::Reader> reader = m_reader_cache.reader( sol.m_path );
+
         if( m_cornerpoint_geometry.m_refine_map_compact.empty() ) {
             // Data can be read directly
-            bridge->init( sol.m_location.m_unformatted_eclipse.m_size );
+            bridge->init( sol.m_location.m_unformatted_eclipse.m_count );
             
             REAL minimum, maximum;
-            eclipse::Reader reader( sol.m_path );
-            reader.blockContent( bridge->values(),
-                                 minimum,
-                                 maximum,
-                                 sol.m_location.m_unformatted_eclipse );
+            reader->blockContent( bridge->values(),
+                                  minimum,
+                                  maximum,
+                                  sol.m_location.m_unformatted_eclipse );
             bridge->setMinimum( minimum );
             bridge->setMaximum( maximum );
             std::cerr << "timestep=" << timestep_index << ", field=" << field_index << "\n";
@@ -1048,14 +1320,13 @@ CornerpointGrid::field( boost::shared_ptr<Field>  bridge,
         else {
             // Grid has been refined, we must duplicate entries
             
-            std::vector<float> tmp( sol.m_location.m_unformatted_eclipse.m_size );
+            std::vector<float> tmp( sol.m_location.m_unformatted_eclipse.m_count );
 
             REAL minimum, maximum;
-            eclipse::Reader reader( sol.m_path );
-            reader.blockContent( tmp.data(),
-                                 minimum,
-                                 maximum,
-                                 sol.m_location.m_unformatted_eclipse );
+            reader->blockContent( tmp.data(),
+                                  minimum,
+                                  maximum,
+                                  sol.m_location.m_unformatted_eclipse );
 
             // duplicate entries as refinement dictates
             bridge->init( m_cornerpoint_geometry.m_refine_map_compact.size() );
@@ -1074,6 +1345,171 @@ CornerpointGrid::field( boost::shared_ptr<Field>  bridge,
     }
 }
 
+void
+CornerpointGrid::fieldsAtTimestep( const std::vector< boost::shared_ptr<Field> >&  bridges,
+                                   const std::vector<size_t>&                      field_indices,
+                                   const size_t                                    timestep_index ) const
+{
+    if( bridges.size() != field_indices.size() ) {
+        throw std::runtime_error( "Number of bridges and fields differ" );
+    }
+    if( !m_cornerpoint_geometry.m_local_grids.empty() ) {
+        for( size_t i=0; i<field_indices.size(); i++ ) {
+            field( bridges[i], field_indices[i], timestep_index );
+        }
+        return;
+    }
+    ensureReportStep( timestep_index );
+
+    // Report steps may be appended concurrently, see appendRestartSteps().
+    std::vector<Solution> sols( field_indices.size() );
+    {
+        std::lock_guard<std::mutex> guard( m_report_step_lock );
+        if( timestep_index >= m_report_steps.size() ) {
+            throw std::runtime_error( "Illegal report step" );
+        }
+        for( size_t i=0; i<field_indices.size(); i++ ) {
+            if( field_indices[i] >= m_solution_names.size()) {
+                throw std::runtime_error( "Illegal solution index" );
+            }
+            sols[i] = m_report_steps[ timestep_index ].m_solutions[ field_indices[i] ];
+            if( sols[i].m_reader != READER_UNFORMATTED_ECLIPSE ) {
+                throw std::runtime_error( "No data" );
+            }
+        }
+    }
+
+    // Group the reads by file, decoding directly into the bridges unless the
+    // grid has been refined and entries must be duplicated.
+    const std::vector<int>& refine_map = m_cornerpoint_geometry.m_refine_map_compact;
+    std::vector< std::vector<float> > tmp( sols.size() );
+    std::map< std::string, std::vector<size_t> > files;
+    std::map< std::string, std::vector<eclipse::Reader::BlockRead> > reads;
+    for( size_t i=0; i<sols.size(); i++ ) {
+        const eclipse::Block& block = sols[i].m_location.m_unformatted_eclipse;
+        eclipse::Reader::BlockRead read;
+        read.m_block = block;
+        if( refine_map.empty() ) {
+            bridges[i]->init( block.m_count );
+            read.m_content = bridges[i]->values();
+        }
+        else {
+            tmp[i].resize( block.m_count );
+            read.m_content = tmp[i].data();
+        }
+        files[ sols[i].m_path ].push_back( i );
+        reads[ sols[i].m_path ].push_back( read );
+    }
+
+    for( auto it=reads.begin(); it!=reads.end(); ++it ) {
+        boost::shared_ptr<eclipse::Reader> reader = m_reader_cache.reader( it->first );
+        reader->blockContents( it->second );
+
+        const std::vector<size_t>& indices = files[ it->first ];
+        for( size_t k=0; k<indices.size(); k++ ) {
+            const size_t i = indices[k];
+            if( !refine_map.empty() ) {
+                bridges[i]->init( refine_map.size() );
+                REAL* ptr = bridges[i]->values();
+                for( size_t j=0; j<refine_map.size(); j++ ) {
+                    ptr[j] = tmp[i][ refine_map[j] ];
+                }
+            }
+            bridges[i]->setMinimum( it->second[k].m_minimum );
+            bridges[i]->setMaximum( it->second[k].m_maximum );
+        }
+    }
+}
+
+void
+CornerpointGrid::localGridField( boost::shared_ptr<Field>  bridge,
+                                 const Solution&           sol ) const
+{
+    const std::vector< eclipse::LocalGrid<REAL> >& local_grids = m_cornerpoint_geometry.m_local_grids;
+    const utils::ActiveCells& active_cells = m_cornerpoint_geometry.m_active_cells;
+    const eclipse::Block& block = sol.m_location.m_unformatted_eclipse;
+    if( block.m_count != active_cells.count() ) {
+        throw std::runtime_error( "Solution size does not match the number of active cells" );
+    }
+
+    size_t total = active_cells.count();
+    for( size_t l=0; l<local_grids.size(); l++ ) {
+        total += local_grids[l].m_active_cells.count();
+    }
+    bridge->init( total );
+    REAL* ptr = bridge->values();
+
+    boost::shared_ptr<eclipse::Reader> reader = m_reader_cache.reader( sol.m_path );
+    REAL minimum, maximum;
+    reader->blockContent( ptr, minimum, maximum, block );
+
+    std::vector<float> tmp;
+    size_t offset = active_cells.count();
+    for( size_t l=0; l<local_grids.size(); l++ ) {
+        const eclipse::LocalGrid<REAL>& lgr = local_grids[l];
+        const size_t count = lgr.m_active_cells.count();
+        const size_t cells = lgr.m_active_cells.size();
+
+        const eclipse::Block* lgr_block = NULL;
+        if( l < sol.m_local_grids.size() ) {
+            const size_t n = sol.m_local_grids[l].m_count;
+            if( (n != 0) && ((n == count) || (n == cells)) ) {
+                lgr_block = &sol.m_local_grids[l];
+            }
+        }
+
+        if( lgr_block != NULL ) {
+            REAL lgr_minimum, lgr_maximum;
+            if( lgr_block->m_count == count ) {
+                reader->blockContent( ptr + offset, lgr_minimum, lgr_maximum, *lgr_block );
+            }
+            else {
+                // per-cell solution, keep the active cells only
+                tmp.resize( cells );
+                reader->blockContent( tmp.data(), lgr_minimum, lgr_maximum, *lgr_block );
+                for( size_t i=0; i<cells; i++ ) {
+                    if( lgr.m_active_cells.active( i ) ) {
+                        ptr[ offset + lgr.m_active_cells.rank( i ) ] = tmp[i];
+                    }
+                }
+            }
+            minimum = std::min( minimum, lgr_minimum );
+            maximum = std::max( maximum, lgr_maximum );
+        }
+        else {
+            // no solution for the local grid, use the value of the host cell
+            for( size_t i=0; i<cells; i++ ) {
+                if( lgr.m_active_cells.active( i ) ) {
+                    const size_t host = lgr.m_hostnum[i] - 1;
+                    ptr[ offset + lgr.m_active_cells.rank( i ) ] = active_cells.active( host )
+                                                                 ? ptr[ active_cells.rank( host ) ]
+                                                                 : 0.f;
+                }
+            }
+        }
+        offset += count;
+    }
+    bridge->setMinimum( minimum );
+    bridge->setMaximum( maximum );
+}
+
+void
+CornerpointGrid::prefetchField( const size_t field_index, const size_t timestep_index ) const
+{
+    std::lock_guard<std::mutex> guard( m_report_step_lock );
+    if( timestep_index >= m_report_steps.size() ) {
+        return;
+    }
+    const ReportStep& step = m_report_steps[ timestep_index ];
+    if( field_index >= step.m_solutions.size() ) {
+        return;
+    }
+    const Solution& sol = step.m_solutions[ field_index ];
+    if( sol.m_reader == READER_UNFORMATTED_ECLIPSE ) {
+        m_reader_cache.prefetch( sol.m_path, sol.m_location.m_unformatted_eclipse );
+    }
+}
+
 bool
 CornerpointGrid::validFieldAtTimestep( size_t field_index, size_t timestep_index ) const
 {
@@ -1084,6 +1520,7 @@ CornerpointGrid::validFieldAtTimestep( size_t field_index, size_t timestep_index
         if( timestep_index >= m_report_steps.size() ) {
             return false;
         }
+        ensureReportStep( timestep_index );
         return true;
     }
     return false;  
@@ -1123,8 +1560,109 @@ const std::string CornerpointGrid::timestepDescription(size_t timestep_index ) c
         return illegal;
     }
     else {
+        ensureReportStep( timestep_index );
         return m_report_steps[ timestep_index ].m_date;
     }
 }
 
+bool
+CornerpointGrid::pollRestart()
+{
+    Logger log = getLogger( package + ".pollRestart" );
+    if( m_follow.m_path.empty() ) {
+        return false;
+    }
+    if( !m_follow.m_watcher ) {
+        m_follow.m_watcher.reset( new utils::FileWatcher( m_follow.m_path ) );
+        // The file may have grown since it was indexed.
+        m_follow.m_pending = true;
+    }
+    bool changed = m_follow.m_watcher->changed();
+    if( !changed && !m_follow.m_pending ) {
+        return false;
+    }
+
+    std::list<eclipse::ReportStep> report_steps;
+    try {
+        // The last step is only known to be complete when the next starts,
+        // or when the simulator has stopped writing to the file.
+        m_follow.m_pending = eclipse::parseAppendedRestartSteps( report_steps,
+                                                                 m_follow.m_offset,
+                                                                 m_follow.m_end,
+                                                                 m_cornerpoint_geometry.m_active_cells,
+                                                                 m_follow.m_path,
+                                                                 !changed );
+    }
+    catch( const std::runtime_error& e ) {
+        LOGGER_ERROR( log, m_follow.m_path << ": Parse error: " << e.what() );
+        return false;
+    }
+    if( report_steps.empty() ) {
+        return false;
+    }
+    LOGGER_DEBUG( log, "Staged " << report_steps.size() << " report steps." );
+    std::lock_guard<std::mutex> guard( m_report_step_lock );
+    m_follow.m_staged.splice( m_follow.m_staged.end(), report_steps );
+    return true;
+}
+
+size_t
+CornerpointGrid::appendRestartSteps()
+{
+    std::lock_guard<std::mutex> guard( m_report_step_lock );
+    if( m_follow.m_staged.empty() ) {
+        return 0;
+    }
+    // A step with a known sequence number is merged into the existing one.
+    const size_t imported = m_follow.m_staged.size();
+    for( auto it=m_follow.m_staged.begin(); it!=m_follow.m_staged.end(); ++it ) {
+        import( *it, m_follow.m_path );
+    }
+    m_follow.m_staged.clear();
+
+    // A cached reader only knows the file as it was when it was opened.
+    m_reader_cache.invalidate( m_follow.m_path );
+    return imported;
+}
+
+void
+CornerpointGrid::ensureReportStep( const size_t timestep_index ) const
+{
+    std::lock_guard<std::mutex> guard( m_report_step_lock );
+    if( (timestep_index < m_report_steps.size()) && !m_report_steps[ timestep_index ].m_parsed ) {
+        // Parsing only fills in what was deferred when the step was indexed,
+        // so the step is logically unchanged.
+        const_cast<CornerpointGrid*>( this )->parseReportStep( timestep_index );
+    }
+}
+
+void
+CornerpointGrid::parseReportStep( const size_t timestep_index )
+{
+    Logger log = getLogger( package + ".parseReportStep" );
+
+    ReportStep& step = m_report_steps[ timestep_index ];
+    if( step.m_parsed ) {
+        return;
+    }
+    // Do not retry a step that fails to parse.
+    step.m_parsed = true;
+    try {
+        std::list<eclipse::ReportStep> report_steps;
+        eclipse::parseRestartStep( report_steps,
+                                   step.m_pending_blocks,
+                                   m_cornerpoint_geometry.m_active_cells,
+                                   step.m_pending_path );
+        for( auto it=report_steps.begin(); it!=report_steps.end(); ++it ) {
+            importDateAndWells( *it );
+        }
+    }
+    catch( const std::runtime_error& e ) {
+        LOGGER_ERROR( log, step.m_pending_path << ": Parse error in report step "
+                      << step.m_seqnum << ": " << e.what() );
+    }
+    step.m_pending_path.clear();
+    step.m_pending_blocks.m_blocks.clear();
+}
+
 } // of namespace dataset
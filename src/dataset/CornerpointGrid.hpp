@@ -17,9 +17,11 @@
 
 #pragma once
 #include <string>
+#include <deque>
 #include <list>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include "dataset/AbstractDataSource.hpp"
 #include "dataset/PolyhedralDataInterface.hpp"
@@ -28,6 +30,10 @@
 #include "dataset/FieldDataInterface.hpp"
 #include "dataset/ZScaleInterface.hpp"
 #include "eclipse/Eclipse.hpp"
+#include "eclipse/EclipseParser.hpp"
+#include "eclipse/EclipseReaderCache.hpp"
+#include "utils/ActiveCells.hpp"
+#include "utils/FileWatcher.hpp"
 
 namespace dataset {
     
@@ -48,10 +54,18 @@ public:
         GEOMETRY_POLYHEDRAL_MESH
     };
 
+    /** Open a grid and its restart files.
+      *
+      * \param[in] lazy_restart  If true, the report steps of a unified
+      *                          restart file are only indexed, and the date
+      *                          and wells of a step are parsed the first
+      *                          time the step is requested.
+      */
     CornerpointGrid(const std::string filename,
              int refine_i = 1,
              int refine_j = 1,
-             int refine_k = 1 );
+             int refine_k = 1,
+             bool lazy_restart = true );
     
     virtual
     ~CornerpointGrid();
@@ -115,6 +129,9 @@ public:
               const std::string&                             progress_description_key,
               const std::string&                             progress_counter_key );
 
+    /** Hash of the baked corner-point geometry, including local grids. */
+    bool
+    geometryKey( uint64_t& key ) const;
 
     size_t
     timesteps() const
@@ -128,9 +145,53 @@ public:
            const size_t              field_index,
            const size_t              timestep_index ) const;
 
+    /** Extract several fields of a report step in one pass over the files.
+      *
+      * Equivalent to invoking field() for each field index, but the blocks
+      * that reside in the same restart file are read together, see
+      * eclipse::Reader::blockContents(). Intended for multi-field selections
+      * and derived quantities.
+      *
+      * \param[in] bridges        Destinations, one per field index.
+      * \param[in] field_indices  The fields to extract.
+      * \param[in] timestep_index The report step to extract them from.
+      */
+    void
+    fieldsAtTimestep( const std::vector< boost::shared_ptr<Field> >&  bridges,
+                      const std::vector<size_t>&                      field_indices,
+                      const size_t                                    timestep_index ) const;
+
     bool
     validFieldAtTimestep( size_t field_index, size_t timestep_index ) const;
 
+    /** Check the unified restart file for report steps written since the last check.
+      *
+      * Used to follow a running simulation. Only the last known report step
+      * and the bytes appended after it are scanned. New report steps, and the
+      * last known step if solutions were appended to it, are staged until
+      * appendRestartSteps() is invoked. The geometry is never touched.
+      * Intended to be invoked periodically from a worker thread.
+      *
+      * \returns True if report steps were staged.
+      */
+    bool
+    pollRestart();
+
+    /** Append the report steps staged by pollRestart() to timesteps().
+      *
+      * A staged step with the sequence number of a known step is merged into
+      * it. Must be invoked from the thread that queries report steps and wells.
+      *
+      * \returns The number of report steps added or updated.
+      */
+    size_t
+    appendRestartSteps();
+
+    /** Set the address space budget of mapped restart files, 0 selects the default. */
+    void
+    setMappingBudget( size_t bytes )
+    { m_reader_cache.setBudget( bytes ); }
+
     size_t
     fields() const;
 
@@ -146,11 +207,10 @@ public:
     /** @{ */
     
     const unsigned int
-    wellCount() const { return m_well_names.size(); }
-
+    wellCount() const;
 
     const std::string&
-    wellName( unsigned int well_ix ) const { return m_well_names[ well_ix ]; }
+    wellName( unsigned int well_ix ) const;
 
     const bool
     wellDefined( const unsigned int report_step_ix,
@@ -158,25 +218,16 @@ public:
 
     const float*
     wellHeadPosition( const unsigned int report_step_ix,
-                      const unsigned int well_ix ) const
-    {
-        return m_report_steps[ report_step_ix ].m_wells[ well_ix ].m_head;
-    }
+                      const unsigned int well_ix ) const;
 
     const unsigned int
     wellBranchCount( const unsigned int report_step_ix,
-                     const unsigned int well_ix ) const
-    {
-        return m_report_steps[ report_step_ix ].m_wells[ well_ix ].m_branches.size();
-    }
+                     const unsigned int well_ix ) const;
 
     const std::vector<float>&
     wellBranchPositions( const unsigned int report_step_ix,
                          const unsigned int well_ix,
-                         const unsigned int branch_ix )
-    {
-        return m_report_steps[ report_step_ix ].m_wells[ well_ix ].m_branches[ branch_ix ];
-    }
+                         const unsigned int branch_ix );
 
     const std::vector<Well>&
     wells( const unsigned int step );
@@ -192,7 +243,7 @@ private:
     std::string                                     m_name;
     enum SolutionReader {
         READER_NONE,
-        READER_UNFORMATTED_ECLIPSE,
+        READER_UNFORMATTED_ECLIPSE,     // Formatted files too, see eclipse::Reader
         READER_FROM_SOURCE // Let source class handle reading
     };
     struct Solution {
@@ -203,6 +254,8 @@ private:
         }                                           m_location;
         size_t                                      m_field_index;
         size_t                                      m_timestep_index;
+        /** Location of the solution of each LGR, m_count is zero if absent. */
+        std::vector<eclipse::Block>                 m_local_grids;
     };
     const std::vector<int>&
     fieldRemap() const { return m_cornerpoint_geometry.m_refine_map_compact; }
@@ -212,6 +265,10 @@ private:
               const uint solution_ix,
               const uint report_step );
 
+    /** Issue readahead of a field at a report step, if it exists. */
+    void
+    prefetchField( const size_t field_index, const size_t timestep_index ) const;
+
     enum FileType {
         ECLIPSE_EGRID_FILE,
         FOOBAR_GRID_FILE,
@@ -238,8 +295,12 @@ private:
         REAL                                            m_zscale;
         std::vector<REAL>                               m_coord;
         std::vector<REAL>                               m_zcorn;
-        std::vector<int>                                m_actnum;
+        utils::ActiveCells                              m_active_cells;
         std::vector<int>                                m_refine_map_compact;
+        /** Local grid refinements, each replaces its host cells. */
+        std::vector< eclipse::LocalGrid<REAL> >         m_local_grids;
+        /** Active cells that are not hosts of a local grid, empty without LGRs. */
+        utils::ActiveCells                              m_tessellated_cells;
     }                                               m_cornerpoint_geometry;
 
     struct {
@@ -253,17 +314,35 @@ private:
         std::string                                 m_date;
         std::vector<Solution>                       m_solutions;
         std::vector<Well>                           m_wells;
+        bool                                        m_parsed;           ///< False until date and wells are imported.
+        std::string                                 m_pending_path;     ///< File of a step not yet parsed.
+        eclipse::ReportStepBlocks                   m_pending_blocks;   ///< Blocks of a step not yet parsed.
     };
 
     GeometryType                                    m_geometry_type;
 
     std::vector<std::string>                        m_solution_names;
     std::unordered_map<std::string,unsigned int>    m_solution_name_lut;
-    std::vector<std::string>                        m_well_names;
+    /** Guarded by m_report_step_lock, a deque so that names returned by wellName() stay put. */
+    std::deque<std::string>                         m_well_names;
     std::unordered_map<std::string,unsigned int>    m_well_name_lut;
 
     std::vector<ReportStep>                         m_report_steps;
+    bool                                            m_lazy_restart;
+    /** Serializes deferred parsing of report steps and access to the well names. */
+    mutable std::mutex                              m_report_step_lock;
     std::list<File>                                 m_unprocessed_files;
+    /** State of following a unified restart file that grows, see pollRestart(). */
+    struct {
+        std::string                                 m_path;
+        size_t                                      m_offset;   ///< Start of the header of the last SEQNUM.
+        size_t                                      m_end;      ///< End of the blocks processed.
+        bool                                        m_pending;  ///< Bytes past m_end not yet consumed.
+        boost::shared_ptr<utils::FileWatcher>       m_watcher;
+        std::list<eclipse::ReportStep>              m_staged;   ///< Guarded by m_report_step_lock.
+    }                                               m_follow;
+    /** Readers of the restart files, kept open between field reads. */
+    mutable eclipse::ReaderCache                    m_reader_cache;
 
     
     const std::vector<REAL>
@@ -272,9 +351,15 @@ private:
     const std::vector<REAL>
     cornerPointZCorn() const { return m_cornerpoint_geometry.m_zcorn; }
 
-    const std::vector<int>
-    cornerPointActNum() const { return m_cornerpoint_geometry.m_actnum; }
+    const utils::ActiveCells&
+    cornerPointActiveCells() const { return m_cornerpoint_geometry.m_active_cells; }
     
+    /** Refine each cell into rx*ry*rz cells.
+      *
+      * The geometry is not refined here, the tessellator refines it on the
+      * fly (see cornerpoint::Tessellator::setRefinement), only the map from
+      * refined to unrefined compact cell indices used for fields is built.
+      */
     void
     refineCornerpointGeometry( unsigned int rx,
                                unsigned int ry,
@@ -283,6 +368,15 @@ private:
     void
     bakeCornerpointGeometry();
 
+    /** Find the host cells of the local grids, see m_tessellated_cells. */
+    void
+    setupLocalGrids();
+
+    /** Extract a field, the global cells followed by the cells of each LGR. */
+    void
+    localGridField( boost::shared_ptr<Field>  bridge,
+                    const Solution&           sol ) const;
+
     ReportStep&
     reportStepBySeqNum( unsigned int seqnum );
 
@@ -308,6 +402,31 @@ private:
     import( const eclipse::ReportStep& e_step,
             const std::string path );
 
+    /** Import the solution table of a report step. */
+    void
+    importSolutions( const eclipse::ReportStep& e_step,
+                     const std::string path );
+
+    /** Import the date and the wells of a report step. */
+    void
+    importDateAndWells( const eclipse::ReportStep& e_step );
+
+    /** Parse a report step deferred by lazy restart indexing, if needed. */
+    void
+    ensureReportStep( const size_t timestep_index ) const;
+
+    /** Parse a deferred report step, the caller must hold m_report_step_lock. */
+    void
+    parseReportStep( const size_t timestep_index );
+
+    /** Index of a well, a new well is numbered after the known wells.
+      *
+      * Lazy restart indexing numbers all wells up front, so deferred parsing
+      * never adds wells, see ensureReportStep().
+      */
+    unsigned int
+    wellIndex( const std::string& name );
+
     void
     addWell( const eclipse::Well& ewell,
             const unsigned int sequence_number );
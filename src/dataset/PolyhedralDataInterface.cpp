@@ -24,4 +24,10 @@ PolyhedralDataInterface::~PolyhedralDataInterface()
 {
 }
 
+bool
+PolyhedralDataInterface::geometryKey( uint64_t& key ) const
+{
+    return false;
+}
+
 } // of namespace dataset
@@ -16,6 +16,7 @@
  * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdint.h>
 #include <boost/shared_ptr.hpp>
 #include <tinia/model/ExposedModel.hpp>
 #include "bridge/PolyhedralMeshBridge.hpp"
@@ -40,6 +41,18 @@ public:
               boost::shared_ptr<tinia::model::ExposedModel>  model,
               const std::string&                             progress_description_key,
               const std::string&                             progress_counter_key ) = 0;
+
+    /** Key that identifies the geometry for caching its tessellation.
+      *
+      * The key must change whenever the output of geometry() would change,
+      * see bridge::PolyhedralMeshCache.
+      *
+      * \param[out] key  Hash of the geometry.
+      * \returns False if the source does not support caching (default).
+      */
+    virtual
+    bool
+    geometryKey( uint64_t& key ) const;
     
 };
 
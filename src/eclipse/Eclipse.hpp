@@ -185,6 +185,7 @@ struct Well {
 struct Solution {
     std::string         m_name;
     Block               m_location;
+    std::string         m_local_grid;   ///< Name of the LGR the solution belongs to, empty for the global grid.
 };
 
 struct ReportStep {
@@ -199,6 +200,13 @@ struct ReportStep {
     std::vector<Well>   m_wells;
 };
 
+/** The blocks of a report step in a unified restart file, excluding SEQNUM. */
+struct ReportStepBlocks {
+    unsigned int                m_sequence_number;
+    std::list<Block>            m_blocks;
+    std::vector<std::string>    m_well_names;   ///< Names of the wells, in the order of ZWEL.
+};
+
 
 /** Given 8 chars of ASCII, return keyword enum. */
 Keyword
@@ -0,0 +1,259 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ *
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "utils/Logger.hpp"
+#include "utils/PerfTimer.hpp"
+#include "EclipseBlockIndex.hpp"
+
+namespace eclipse {
+
+using std::string;
+using std::vector;
+using std::list;
+
+namespace {
+
+const char index_magic[8] = { 'F', 'R', 'V', 'B', 'I', 'D', 'X', '\0' };
+
+/** Sidecar file header, followed by the block records and the seqnum array. */
+struct IndexHeader {
+    char        m_magic[8];
+    uint32_t    m_version;
+    uint32_t    m_record_size;
+    uint64_t    m_filesize;
+    int64_t     m_mtime_sec;
+    int64_t     m_mtime_nsec;
+    uint64_t    m_header_hash;
+    uint64_t    m_blocks;
+    uint64_t    m_seqnums;
+};
+
+/** On-disk block record, explicitly sized so the layout is independent of Block. */
+struct IndexRecord {
+    char        m_keyword_string[8];
+    uint32_t    m_datatype;
+    uint32_t    m_typesize;
+    uint32_t    m_count;
+    uint32_t    m_record_size;
+    uint32_t    m_records;
+    uint32_t    m_padding;
+    uint64_t    m_offset;
+    uint64_t    m_size;
+};
+
+static_assert( sizeof(IndexHeader) == 64, "IndexHeader is not 64 bytes" );
+static_assert( sizeof(IndexRecord) == 48, "IndexRecord is not 48 bytes" );
+
+bool
+writeAll( int fd, const void* data, size_t bytes )
+{
+    const char* p = reinterpret_cast<const char*>( data );
+    while( bytes > 0 ) {
+        ssize_t n = write( fd, p, bytes );
+        if( n < 0 ) {
+            if( errno == EINTR ) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+} // of anonymous namespace
+
+
+string
+BlockIndex::path( const string& file )
+{
+    return file + ".frvidx";
+}
+
+uint64_t
+BlockIndex::hash( const unsigned char* bytes, size_t n )
+{
+    uint64_t h = 14695981039346656037ull;
+    for( size_t i=0; i<n; i++ ) {
+        h = (h ^ bytes[i]) * 1099511628211ull;
+    }
+    return h;
+}
+
+bool
+BlockIndex::load( list<Block>&          blocks,
+                  vector<size_t>&       seqnum_blocks,
+                  const string&         file,
+                  const BlockIndexKey&  key )
+{
+    Logger log = getLogger( "Eclipse.BlockIndex.load" );
+
+    const string index_path = path( file );
+    int fd = open( index_path.c_str(), O_RDONLY );
+    if( fd < 0 ) {
+        return false;
+    }
+    struct stat finfo;
+    if( (fstat( fd, &finfo ) != 0) || ((size_t)finfo.st_size < sizeof(IndexHeader)) ) {
+        close( fd );
+        return false;
+    }
+    size_t bytes = finfo.st_size;
+
+    void* map = mmap( NULL, bytes, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if( map == MAP_FAILED ) {
+        LOGGER_WARN( log, "mmap() of " << index_path << " failed: " << strerror(errno) );
+        return false;
+    }
+
+    PerfTimer start;
+    bool valid = false;
+    const IndexHeader* header = reinterpret_cast<const IndexHeader*>( map );
+    if( (memcmp( header->m_magic, index_magic, 8 ) == 0 )
+            && (header->m_version == version )
+            && (header->m_record_size == sizeof(IndexRecord) )
+            && (header->m_filesize == key.m_filesize )
+            && (header->m_mtime_sec == key.m_mtime_sec )
+            && (header->m_mtime_nsec == key.m_mtime_nsec )
+            && (header->m_header_hash == key.m_header_hash )
+            && (bytes == sizeof(IndexHeader)
+                       + header->m_blocks*sizeof(IndexRecord)
+                       + header->m_seqnums*sizeof(uint64_t) ) )
+    {
+        valid = true;
+
+        const IndexRecord* records = reinterpret_cast<const IndexRecord*>( header + 1 );
+        list<Block> tmp_blocks;
+        for( uint64_t i=0; i<header->m_blocks; i++ ) {
+            const IndexRecord& r = records[i];
+            if( (r.m_datatype > TYPE_MESSAGE) || (r.m_offset + r.m_size > key.m_filesize) ) {
+                valid = false;
+                break;
+            }
+            Block block;
+            memcpy( block.m_keyword_string, r.m_keyword_string, 8 );
+            block.m_keyword     = keyword( r.m_keyword_string );
+            block.m_datatype    = static_cast<DataType>( r.m_datatype );
+            block.m_typesize    = r.m_typesize;
+            block.m_count       = r.m_count;
+            block.m_record_size = r.m_record_size;
+            block.m_records     = r.m_records;
+            block.m_offset      = r.m_offset;
+            block.m_size        = r.m_size;
+            tmp_blocks.push_back( block );
+        }
+
+        const uint64_t* seqnums = reinterpret_cast<const uint64_t*>( records + header->m_blocks );
+        vector<size_t> tmp_seqnums( header->m_seqnums );
+        for( uint64_t i=0; valid && i<header->m_seqnums; i++ ) {
+            if( seqnums[i] >= header->m_blocks ) {
+                valid = false;
+            }
+            tmp_seqnums[i] = seqnums[i];
+        }
+        if( valid ) {
+            blocks.swap( tmp_blocks );
+            seqnum_blocks.swap( tmp_seqnums );
+        }
+    }
+    munmap( map, bytes );
+    PerfTimer stop;
+
+    if( valid ) {
+        LOGGER_DEBUG( log, "Loaded index of " << blocks.size() << " blocks from " << index_path
+                      << " (" << (1000.0*PerfTimer::delta( start, stop )) << "ms)" );
+    }
+    else {
+        LOGGER_DEBUG( log, "Index " << index_path << " is stale, ignoring." );
+    }
+    return valid;
+}
+
+bool
+BlockIndex::store( const string&            file,
+                   const BlockIndexKey&     key,
+                   const list<Block>&       blocks,
+                   const vector<size_t>&    seqnum_blocks )
+{
+    Logger log = getLogger( "Eclipse.BlockIndex.store" );
+
+    const string index_path = path( file );
+    const string tmp_path = index_path + ".tmp" + std::to_string( (long long)getpid() );
+
+    IndexHeader header;
+    memset( &header, 0, sizeof(header) );
+    memcpy( header.m_magic, index_magic, 8 );
+    header.m_version     = version;
+    header.m_record_size = sizeof(IndexRecord);
+    header.m_filesize    = key.m_filesize;
+    header.m_mtime_sec   = key.m_mtime_sec;
+    header.m_mtime_nsec  = key.m_mtime_nsec;
+    header.m_header_hash = key.m_header_hash;
+    header.m_blocks      = blocks.size();
+    header.m_seqnums     = seqnum_blocks.size();
+
+    vector<IndexRecord> records( blocks.size() );
+    size_t i = 0;
+    for( auto it=blocks.begin(); it!=blocks.end(); ++it ) {
+        IndexRecord& r = records[i++];
+        memset( &r, 0, sizeof(r) );
+        memcpy( r.m_keyword_string, it->m_keyword_string, 8 );
+        r.m_datatype    = it->m_datatype;
+        r.m_typesize    = it->m_typesize;
+        r.m_count       = it->m_count;
+        r.m_record_size = it->m_record_size;
+        r.m_records     = it->m_records;
+        r.m_offset      = it->m_offset;
+        r.m_size        = it->m_size;
+    }
+    vector<uint64_t> seqnums( seqnum_blocks.begin(), seqnum_blocks.end() );
+
+    int fd = open( tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    if( fd < 0 ) {
+        LOGGER_DEBUG( log, "Unable to create " << tmp_path << ": " << strerror(errno) );
+        return false;
+    }
+    bool success = writeAll( fd, &header, sizeof(header) )
+                && writeAll( fd, records.data(), records.size()*sizeof(IndexRecord) )
+                && writeAll( fd, seqnums.data(), seqnums.size()*sizeof(uint64_t) );
+    if( close( fd ) != 0 ) {
+        success = false;
+    }
+    if( success && (rename( tmp_path.c_str(), index_path.c_str() ) != 0) ) {
+        success = false;
+    }
+    if( !success ) {
+        LOGGER_WARN( log, "Failed to write " << index_path << ": " << strerror(errno) );
+        unlink( tmp_path.c_str() );
+        return false;
+    }
+    LOGGER_DEBUG( log, "Wrote index of " << blocks.size() << " blocks to " << index_path );
+    return true;
+}
+
+
+} // of namespace eclipse
@@ -0,0 +1,104 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ *
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <list>
+#include <stdint.h>
+
+#include "Eclipse.hpp"
+
+namespace eclipse {
+
+/** Identifies a particular version of an Eclipse file.
+  *
+  * An index is only valid for the file it was created from, and a stale index
+  * is detected by comparing file size, modification time and a hash of the
+  * first bytes of the file.
+  */
+struct BlockIndexKey {
+    uint64_t    m_filesize;
+    int64_t     m_mtime_sec;
+    int64_t     m_mtime_nsec;
+    uint64_t    m_header_hash;
+};
+
+/** Persistent sidecar index of the blocks of an Eclipse file.
+  *
+  * The index is stored next to the file it describes (see path()), and holds
+  * the keyword, type, count and offset of every block, as well as the indices
+  * of the SEQNUM blocks that start each report step. Loading the index maps
+  * the sidecar and avoids the header-by-header scan of the data file.
+  */
+class BlockIndex
+{
+public:
+    /** Current on-disk format version, bump when the layout changes. */
+    static const uint32_t   version = 1u;
+
+    /** Files with fewer blocks than this are not worth indexing. */
+    static const size_t     minimum_blocks = 128u;
+
+    /** Returns the path of the sidecar index for the file at path. */
+    static
+    std::string
+    path( const std::string& file );
+
+    /** Hash a buffer of bytes (64-bit FNV-1a). */
+    static
+    uint64_t
+    hash( const unsigned char* bytes, size_t n );
+
+    /** Try to load the index of a file.
+      *
+      * \param[out] blocks          The blocks of the file, in file order.
+      * \param[out] seqnum_blocks   Index into blocks of each SEQNUM block.
+      * \param[in]  file            Path of the indexed file (not the sidecar).
+      * \param[in]  key             Identification of the current file version.
+      * \returns True if a valid index matching key was found, false otherwise.
+      * \note Never throws, a missing or stale index just returns false.
+      */
+    static
+    bool
+    load( std::list<Block>&             blocks,
+          std::vector<size_t>&          seqnum_blocks,
+          const std::string&            file,
+          const BlockIndexKey&          key );
+
+    /** Store the index of a file.
+      *
+      * The sidecar is written to a temporary file and atomically renamed into
+      * place, so concurrent readers never see a partial index.
+      *
+      * \param[in]  file            Path of the indexed file (not the sidecar).
+      * \param[in]  key             Identification of the current file version.
+      * \param[in]  blocks          The blocks of the file, in file order.
+      * \param[in]  seqnum_blocks   Index into blocks of each SEQNUM block.
+      * \returns True if the index was written.
+      * \note Never throws, failure (e.g. read-only directory) is only logged.
+      */
+    static
+    bool
+    store( const std::string&           file,
+           const BlockIndexKey&         key,
+           const std::list<Block>&      blocks,
+           const std::vector<size_t>&   seqnum_blocks );
+
+};
+
+} // of namespace eclipse
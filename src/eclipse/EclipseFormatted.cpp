@@ -0,0 +1,553 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ *
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include "utils/ThreadPool.hpp"
+#include "EclipseFormatted.hpp"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Formatted files are written by Fortran list-directed or fixed-format I/O,
+// e.g. "  0.12345678E+01" for REAL, "  0.12345678901234D+01" for DOUB and
+// "-0.1234567890123-100" for doubles with three-digit exponents. The parser is
+// agnostic to column widths and to the number of elements per line; only the
+// whitespace separation of tokens is assumed.
+
+namespace eclipse {
+namespace formatted {
+
+namespace {
+
+/** Blocks with fewer elements than this are parsed serially. */
+const size_t parallel_parse_threshold = 64u*1024u;
+
+/** Files smaller than this are scanned serially for headers. */
+const size_t parallel_scan_threshold = 16u*1024u*1024u;
+
+inline bool
+isSpace( const char c )
+{
+    return (c == ' ') || (c == '\n') || (c == '\r') || (c == '\t');
+}
+
+inline bool
+isDigit( const char c )
+{
+    return static_cast<unsigned char>( c - '0' ) < 10u;
+}
+
+/** Advance p to the first non-whitespace byte before end. */
+inline const char*
+skipSpace( const char* p, const char* end )
+{
+#ifdef __SSE2__
+    // Bytes larger than ' ' are token bytes.
+    const __m128i space = _mm_set1_epi8( ' ' );
+    while( p + 16 <= end ) {
+        __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( p ) );
+        unsigned int mask = _mm_movemask_epi8( _mm_cmpgt_epi8( v, space ) );
+        if( mask != 0u ) {
+            return p + __builtin_ctz( mask );
+        }
+        p += 16;
+    }
+#endif
+    while( (p < end) && isSpace( *p ) ) {
+        p++;
+    }
+    return p;
+}
+
+/** Advance p to the first whitespace byte before end. */
+inline const char*
+skipToken( const char* p, const char* end )
+{
+    while( (p < end) && !isSpace( *p ) ) {
+        p++;
+    }
+    return p;
+}
+
+/** Count whitespace-separated tokens in [begin,end). */
+size_t
+countTokens( const char* begin, const char* end )
+{
+    size_t tokens = 0;
+    const char* p = begin;
+    bool in_token = false;
+#ifdef __SSE2__
+    const __m128i space = _mm_set1_epi8( ' ' );
+    unsigned int carry = 0u;
+    while( p + 16 <= end ) {
+        __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( p ) );
+        unsigned int mask = _mm_movemask_epi8( _mm_cmpgt_epi8( v, space ) );
+        unsigned int starts = mask & ~( (mask << 1u) | carry );
+        tokens += __builtin_popcount( starts & 0xffffu );
+        carry = (mask >> 15u) & 1u;
+        p += 16;
+    }
+    in_token = carry != 0u;
+#endif
+    for( ; p < end; p++ ) {
+        bool t = !isSpace( *p );
+        if( t && !in_token ) {
+            tokens++;
+        }
+        in_token = t;
+    }
+    return tokens;
+}
+
+/** True if the eight bytes of v are all ASCII digits. */
+inline bool
+isEightDigits( const uint64_t v )
+{
+    return ( ( (v & 0xF0F0F0F0F0F0F0F0ull) |
+               ( ( (v + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull ) >> 4u ) )
+             == 0x3333333333333333ull );
+}
+
+/** Convert eight ASCII digits in memory order to their value (SWAR). */
+inline uint32_t
+parseEightDigits( uint64_t v )
+{
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+    v = __builtin_bswap64( v );
+#endif
+    v -= 0x3030303030303030ull;
+    v = (v * 10u) + (v >> 8u);
+    v = ( ( (v & 0x000000FF000000FFull) * (100u + (1000000ull << 32u)) ) +
+          ( ( (v >> 16u) & 0x000000FF000000FFull ) * (1u + (10000ull << 32u)) ) ) >> 32u;
+    return static_cast<uint32_t>( v );
+}
+
+/** Accumulate the digits starting at p into value.
+  *
+  * \returns Pointer past the last digit, digits holds the number of digits.
+  */
+inline const char*
+parseDigits( uint64_t& value, unsigned int& digits, const char* p, const char* end )
+{
+    digits = 0u;
+    while( p + 8 <= end ) {
+        uint64_t v;
+        memcpy( &v, p, sizeof(v) );
+        if( !isEightDigits( v ) ) {
+            break;
+        }
+        value = 100000000u*value + parseEightDigits( v );
+        digits += 8u;
+        p += 8;
+    }
+    while( (p < end) && isDigit( *p ) ) {
+        value = 10u*value + (*p - '0');
+        digits++;
+        p++;
+    }
+    return p;
+}
+
+const char*
+parseInteger( int& value, const char* p, const char* end )
+{
+    const char* start = p;
+    bool negative = false;
+    if( (p < end) && ((*p == '-') || (*p == '+')) ) {
+        negative = *p == '-';
+        p++;
+    }
+    uint64_t v = 0u;
+    unsigned int digits = 0u;
+    p = parseDigits( v, digits, p, end );
+    if( (digits == 0u) || (digits > 10u) || (v > (negative ? 0x80000000ull : 0x7fffffffull)) ||
+        ( (p < end) && !isSpace( *p ) ) )
+    {
+        throw std::runtime_error( "Malformed integer '" + std::string( start, skipToken( start, end ) ) + "'" );
+    }
+    value = negative ? static_cast<int>( -static_cast<int64_t>( v ) ) : static_cast<int>( v );
+    return p;
+}
+
+/** Parse a number the fast path can't handle using strtod. */
+const char*
+parseNumberSlow( double& value, const char* p, const char* end )
+{
+    // Fortran writes D as exponent letter for doubles, and omits the letter
+    // altogether when the exponent has three digits, e.g. 0.1234-100.
+    const char* token_end = skipToken( p, end );
+    std::string token( p, token_end );
+    for( size_t i=1; i<token.size(); i++ ) {
+        char c = token[i];
+        if( (c == 'D') || (c == 'd') ) {
+            token[i] = 'E';
+        }
+        else if( ((c == '-') || (c == '+')) && isDigit( token[i-1] ) ) {
+            token.insert( i, 1, 'E' );
+            break;
+        }
+    }
+    char* stop = NULL;
+    value = strtod( token.c_str(), &stop );
+    if( (stop == token.c_str()) || (*stop != '\0') ) {
+        throw std::runtime_error( "Malformed number '" + std::string( p, token_end ) + "'" );
+    }
+    return token_end;
+}
+
+const double powers_of_ten[23] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/** Parse a REAL or DOUB number.
+  *
+  * Mantissas below 2^53 and powers of ten up to 10^22 are exactly
+  * representable, so a single multiplication or division yields the correctly
+  * rounded result. Anything else goes through strtod.
+  */
+const char*
+parseNumber( double& value, const char* p, const char* end )
+{
+    const char* start = p;
+    bool negative = false;
+    if( (p < end) && ((*p == '-') || (*p == '+')) ) {
+        negative = *p == '-';
+        p++;
+    }
+    uint64_t mantissa = 0u;
+    unsigned int int_digits = 0u;
+    unsigned int frac_digits = 0u;
+    p = parseDigits( mantissa, int_digits, p, end );
+    if( (p < end) && (*p == '.') ) {
+        p++;
+        p = parseDigits( mantissa, frac_digits, p, end );
+    }
+    if( int_digits + frac_digits == 0u ) {
+        return parseNumberSlow( value, start, end );
+    }
+    int exponent = 0;
+    if( p < end ) {
+        char c = *p;
+        bool letter = (c == 'E') || (c == 'e') || (c == 'D') || (c == 'd');
+        if( letter || (c == '-') || (c == '+') ) {
+            if( letter ) {
+                p++;
+            }
+            bool exp_negative = false;
+            if( (p < end) && ((*p == '-') || (*p == '+')) ) {
+                exp_negative = *p == '-';
+                p++;
+            }
+            if( (p >= end) || !isDigit( *p ) ) {
+                throw std::runtime_error( "Malformed number '" + std::string( start, skipToken( start, end ) ) + "'" );
+            }
+            while( (p < end) && isDigit( *p ) && (exponent < 10000) ) {
+                exponent = 10*exponent + (*p - '0');
+                p++;
+            }
+            exponent = exp_negative ? -exponent : exponent;
+        }
+    }
+    if( (p < end) && !isSpace( *p ) ) {
+        throw std::runtime_error( "Malformed number '" + std::string( start, skipToken( start, end ) ) + "'" );
+    }
+    exponent -= static_cast<int>( frac_digits );
+    if( (int_digits + frac_digits > 19u) || (mantissa >= (1ull<<53u)) ||
+        (exponent < -22) || (exponent > 22) )
+    {
+        return parseNumberSlow( value, start, end );
+    }
+    double v = static_cast<double>( mantissa );
+    v = exponent < 0 ? v / powers_of_ten[ -exponent ] : v * powers_of_ten[ exponent ];
+    value = negative ? -v : v;
+    return p;
+}
+
+/** Split [begin,end) into parts at whitespace and count tokens in each part. */
+void
+splitTokens( std::vector<const char*>&  splits,
+             std::vector<size_t>&       firsts,
+             const char*                begin,
+             const char*                end )
+{
+    utils::ThreadPool& pool = utils::ThreadPool::instance();
+    const size_t parts = 4*pool.concurrency();
+    const size_t part_size = (end - begin + parts - 1)/parts;
+
+    splits.resize( parts + 1 );
+    splits[0] = begin;
+    splits[parts] = end;
+    for( size_t i=1; i<parts; i++ ) {
+        const char* p = std::min( end, begin + i*part_size );
+        p = std::max( p, splits[i-1] );
+        splits[i] = skipToken( p, end );
+    }
+    firsts.resize( parts + 1 );
+    firsts[0] = 0;
+    pool.run( parts, [&]( size_t i ) {
+        firsts[i+1] = countTokens( splits[i], splits[i+1] );
+    } );
+    for( size_t i=0; i<parts; i++ ) {
+        firsts[i+1] += firsts[i];
+    }
+}
+
+void
+checkCount( size_t found, size_t count )
+{
+    if( found < count ) {
+        throw std::runtime_error( "Premature end of block" );
+    }
+}
+
+/** Parse count tokens in [begin,end) using parse, in parallel for large blocks.
+  *
+  * \param[in] parse  Invoked as parse( dst, begin, end, n ) and parses n
+  *                   tokens from [begin,end) into dst[0..n-1].
+  */
+template<typename T, typename Parse>
+void
+parseTokens( T* dst, const char* begin, const char* end, const size_t count, Parse parse )
+{
+    if( (count < parallel_parse_threshold) || (utils::ThreadPool::instance().concurrency() < 2) ) {
+        parse( dst, begin, end, count );
+        return;
+    }
+    std::vector<const char*> splits;
+    std::vector<size_t> firsts;
+    splitTokens( splits, firsts, begin, end );
+    checkCount( firsts.back(), count );
+
+    utils::ThreadPool::instance().run( splits.size()-1, [&]( size_t i ) {
+        size_t a = std::min( count, firsts[i] );
+        size_t b = std::min( count, firsts[i+1] );
+        if( a < b ) {
+            parse( dst + a, splits[i], splits[i+1], b - a );
+        }
+    } );
+}
+
+void
+parseIntegersSerial( int* dst, const char* p, const char* end, const size_t count )
+{
+    for( size_t i=0; i<count; i++ ) {
+        p = skipSpace( p, end );
+        checkCount( p < end ? count : i, count );
+        p = parseInteger( dst[i], p, end );
+    }
+}
+
+template<typename T>
+void
+parseNumbersSerial( T* dst, const char* p, const char* end, const size_t count )
+{
+    for( size_t i=0; i<count; i++ ) {
+        p = skipSpace( p, end );
+        checkCount( p < end ? count : i, count );
+        double v;
+        p = parseNumber( v, p, end );
+        dst[i] = static_cast<T>( v );
+    }
+}
+
+/** True if the line at p is a header line, populating header if so. */
+bool
+parseHeader( Header& header, const char* line, const char* bytes, const char* end )
+{
+    // Header: (1X, 1X, A8, 1X, 1X, I11, 1X, 1X, A4), quoted strings.
+    const char* p = skipSpace( line, end );
+    if( (p + 1 + 8 + 1 >= end) || (p[0] != '\'') || (p[9] != '\'') ) {
+        return false;
+    }
+    const char* keyword = p + 1;
+    p = skipSpace( p + 10, end );
+    uint64_t count = 0u;
+    unsigned int digits = 0u;
+    const char* q = parseDigits( count, digits, p, end );
+    if( (digits == 0u) || (digits > 10u) || (count > 0xffffffffull) ||
+        (q >= end) || !isSpace( *q ) )
+    {
+        return false;
+    }
+    p = skipSpace( q, end );
+    if( (p + 1 + 4 + 1 > end) || (p[0] != '\'') || (p[5] != '\'') ) {
+        return false;
+    }
+    const char* type = p + 1;
+    p += 6;
+    while( (p < end) && (*p != '\n') ) {
+        if( !isSpace( *p ) ) {
+            return false;
+        }
+        p++;
+    }
+    header.m_offset = line - bytes;
+    header.m_data   = (p < end ? p + 1 : end) - bytes;
+    memcpy( header.m_keyword, keyword, 8 );
+    memcpy( header.m_type, type, 4 );
+    header.m_count = static_cast<unsigned int>( count );
+    return true;
+}
+
+/** Find the headers among the lines that start in [begin,end). */
+void
+scanLines( std::vector<Header>& headers, const char* bytes, const char* begin, const char* end, const char* file_end )
+{
+    const char* line = begin;
+    while( line < end ) {
+        // Only header lines and CHAR data lines start with a quote.
+        const char* p = line;
+        while( (p < file_end) && (*p == ' ') ) {
+            p++;
+        }
+        if( (p < file_end) && (*p == '\'') ) {
+            Header header;
+            if( parseHeader( header, line, bytes, file_end ) ) {
+                headers.push_back( header );
+            }
+        }
+        const void* nl = memchr( p, '\n', file_end - p );
+        if( nl == NULL ) {
+            break;
+        }
+        line = static_cast<const char*>( nl ) + 1;
+    }
+}
+
+} // of anonymous namespace
+
+bool
+isFormatted( const unsigned char* bytes, const size_t n )
+{
+    const char* p = skipSpace( reinterpret_cast<const char*>( bytes ),
+                               reinterpret_cast<const char*>( bytes ) + n );
+    return (p < reinterpret_cast<const char*>( bytes ) + n) && (*p == '\'');
+}
+
+void
+scanHeaders( std::vector<Header>& headers, const char* bytes, const size_t size )
+{
+    headers.clear();
+    const char* end = bytes + size;
+
+    utils::ThreadPool& pool = utils::ThreadPool::instance();
+    if( (size < parallel_scan_threshold) || (pool.concurrency() < 2) ) {
+        scanLines( headers, bytes, bytes, end, end );
+        return;
+    }
+
+    // Each part handles the lines that start within it.
+    const size_t parts = 4*pool.concurrency();
+    const size_t part_size = (size + parts - 1)/parts;
+    std::vector< std::vector<Header> > part_headers( parts );
+    pool.run( parts, [&]( size_t i ) {
+        const char* b = bytes + std::min( size, i*part_size );
+        const char* e = bytes + std::min( size, (i+1)*part_size );
+        if( (b > bytes) && (b < e) ) {
+            const void* nl = memchr( b-1, '\n', e - (b-1) );
+            b = nl == NULL ? e : static_cast<const char*>( nl ) + 1;
+        }
+        scanLines( part_headers[i], bytes, b, e, end );
+    } );
+    for( size_t i=0; i<parts; i++ ) {
+        headers.insert( headers.end(), part_headers[i].begin(), part_headers[i].end() );
+    }
+}
+
+void
+parseIntegers( int* dst, const char* begin, const char* end, const size_t count )
+{
+    parseTokens( dst, begin, end, count, parseIntegersSerial );
+}
+
+void
+parseFloats( float*         dst,
+             const char*    begin,
+             const char*    end,
+             const size_t   count,
+             float&         minimum,
+             float&         maximum )
+{
+    parseTokens( dst, begin, end, count, parseNumbersSerial<float> );
+
+    float mn = std::numeric_limits<float>::max();
+    float mx = -std::numeric_limits<float>::max();
+    for( size_t i=0; i<count; i++ ) {
+        mn = std::min( mn, dst[i] );
+        mx = std::max( mx, dst[i] );
+    }
+    minimum = mn;
+    maximum = mx;
+}
+
+void
+parseDoubles( double* dst, const char* begin, const char* end, const size_t count )
+{
+    parseTokens( dst, begin, end, count, parseNumbersSerial<double> );
+}
+
+void
+parseLogicals( std::vector<bool>& dst, const char* begin, const char* end, const size_t count )
+{
+    dst.resize( count );
+    const char* p = begin;
+    for( size_t i=0; i<count; i++ ) {
+        p = skipSpace( p, end );
+        checkCount( p < end ? count : i, count );
+        const char* q = skipToken( p, end );
+        if( (q - p == 1) && ((*p == 'T') || (*p == 't')) ) {
+            dst[i] = true;
+        }
+        else if( (q - p == 1) && ((*p == 'F') || (*p == 'f')) ) {
+            dst[i] = false;
+        }
+        else {
+            throw std::runtime_error( "Malformed logical '" + std::string( p, q ) + "'" );
+        }
+        p = q;
+    }
+}
+
+void
+parseStrings( std::vector<std::string>& dst,
+              const char*               begin,
+              const char*               end,
+              const size_t              count,
+              const size_t              typesize )
+{
+    dst.resize( count );
+    const char* p = begin;
+    for( size_t i=0; i<count; i++ ) {
+        p = skipSpace( p, end );
+        checkCount( p < end ? count : i, count );
+        // Strings may contain spaces, so they are delimited by quotes.
+        if( (p + typesize + 2 > end) || (p[0] != '\'') || (p[typesize+1] != '\'') ) {
+            throw std::runtime_error( "Malformed string '" + std::string( p, skipToken( p, end ) ) + "'" );
+        }
+        dst[i] = std::string( p + 1, p + 1 + typesize );
+        p += typesize + 2;
+    }
+}
+
+} // of namespace formatted
+} // of namespace eclipse
@@ -0,0 +1,105 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ *
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace eclipse {
+namespace formatted {
+
+/** A keyword header line of a formatted file.
+  *
+  * Formatted files are the ASCII counterpart of the unformatted files, where
+  * each block starts with a header line like " 'INTEHEAD'         411 'INTE'"
+  * followed by the elements as whitespace separated numbers, T/F logicals or
+  * quoted strings.
+  */
+struct Header {
+    size_t      m_offset;       ///< File offset of the header line.
+    size_t      m_data;         ///< File offset of the first byte after the header line.
+    char        m_keyword[8];
+    char        m_type[4];
+    unsigned int m_count;
+};
+
+/** True if the first bytes of a file look like a formatted file. */
+bool
+isFormatted( const unsigned char* bytes, const size_t n );
+
+/** Find the keyword headers of a formatted file.
+  *
+  * Large files are split into chunks that are scanned in parallel.
+  *
+  * \param[out] headers  Headers in file order.
+  * \param[in]  bytes    Contents of the file.
+  * \param[in]  size     Size of the file.
+  */
+void
+scanHeaders( std::vector<Header>& headers, const char* bytes, const size_t size );
+
+/** Parse whitespace separated integers.
+  *
+  * \param[out] dst    Destination of count integers.
+  * \param[in]  begin  First byte of the block data.
+  * \param[in]  end    End of the block data.
+  * \param[in]  count  Number of elements in the block.
+  * \throws std::runtime_error If the block does not hold count integers.
+  */
+void
+parseIntegers( int* dst, const char* begin, const char* end, const size_t count );
+
+/** Parse whitespace separated REAL or DOUB numbers into floats, finding min and max.
+  *
+  * \throws std::runtime_error If the block does not hold count numbers.
+  */
+void
+parseFloats( float*         dst,
+             const char*    begin,
+             const char*    end,
+             const size_t   count,
+             float&         minimum,
+             float&         maximum );
+
+/** Parse whitespace separated REAL or DOUB numbers into doubles.
+  *
+  * \throws std::runtime_error If the block does not hold count numbers.
+  */
+void
+parseDoubles( double* dst, const char* begin, const char* end, const size_t count );
+
+/** Parse whitespace separated T/F logicals.
+  *
+  * \throws std::runtime_error If the block does not hold count logicals.
+  */
+void
+parseLogicals( std::vector<bool>& dst, const char* begin, const char* end, const size_t count );
+
+/** Parse quoted strings of typesize characters.
+  *
+  * \throws std::runtime_error If the block does not hold count strings.
+  */
+void
+parseStrings( std::vector<std::string>& dst,
+              const char*               begin,
+              const char*               end,
+              const size_t              count,
+              const size_t              typesize );
+
+} // of namespace formatted
+} // of namespace eclipse
@@ -0,0 +1,911 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ *
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include "EclipseKernels.hpp"
+#if defined(__x86_64__) || defined(__i386__)
+#define ECLIPSE_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+// The vector kernels are compiled for their instruction set using function
+// attributes, so that a single binary can pick the best variant at run time,
+// regardless of the -m flags used for the rest of the code.
+
+namespace eclipse {
+namespace kernels {
+
+namespace {
+
+// --- Scalar ------------------------------------------------------------------
+
+inline uint32_t
+load32be( const unsigned char* src )
+{
+    uint32_t v;
+    memcpy( &v, src, sizeof(v) );
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    v = __builtin_bswap32( v );
+#endif
+    return v;
+}
+
+void
+swap32Scalar( void* dst, const unsigned char* src, const size_t n )
+{
+    uint32_t* out = reinterpret_cast<uint32_t*>( dst );
+    for( size_t i=0; i<n; i++ ) {
+        out[i] = load32be( src + 4*i );
+    }
+}
+
+void
+float32MinMaxScalar( float*                 dst,
+                     const unsigned char*   src,
+                     const size_t           n,
+                     float&                 minimum,
+                     float&                 maximum )
+{
+    float min = minimum;
+    float max = maximum;
+    for( size_t i=0; i<n; i++ ) {
+        union {
+            uint32_t    ui;
+            float       f;
+        } v;
+        v.ui = load32be( src + 4*i );
+        dst[i] = v.f;
+        min = v.f < min ? v.f : min;
+        max = max < v.f ? v.f : max;
+    }
+    minimum = min;
+    maximum = max;
+}
+
+inline uint64_t
+load64be( const unsigned char* src )
+{
+    uint64_t v;
+    memcpy( &v, src, sizeof(v) );
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    v = __builtin_bswap64( v );
+#endif
+    return v;
+}
+
+void
+swap64Scalar( void* dst, const unsigned char* src, const size_t n )
+{
+    uint64_t* out = reinterpret_cast<uint64_t*>( dst );
+    for( size_t i=0; i<n; i++ ) {
+        out[i] = load64be( src + 8*i );
+    }
+}
+
+void
+float64MinMaxScalar( float*                 dst,
+                     const unsigned char*   src,
+                     const size_t           n,
+                     float&                 minimum,
+                     float&                 maximum )
+{
+    float min = minimum;
+    float max = maximum;
+    for( size_t i=0; i<n; i++ ) {
+        union {
+            uint64_t    ui;
+            double      d;
+        } v;
+        v.ui = load64be( src + 8*i );
+        float f = v.d;
+        dst[i] = f;
+        min = f < min ? f : min;
+        max = max < f ? f : max;
+    }
+    minimum = min;
+    maximum = max;
+}
+
+/** OR word into the bit array at bit position pos, spilling into the next word if needed. */
+inline void
+orBits( uint64_t* bits, const size_t pos, const uint64_t word )
+{
+    const size_t shift = pos & 63u;
+    bits[ pos>>6u ] |= word << shift;
+    if( shift != 0u ) {
+        // Only touch the next word if bits actually spill, so the last word is never overrun.
+        const uint64_t carry = word >> (64u-shift);
+        if( carry != 0u ) {
+            bits[ (pos>>6u) + 1u ] |= carry;
+        }
+    }
+}
+
+size_t
+int32ActiveScalar( int*                  dst,
+                   const unsigned char*  src,
+                   const size_t          n,
+                   uint64_t*             bits,
+                   const size_t          bit )
+{
+    size_t count = 0;
+    for( size_t i=0; i<n; i+=64 ) {
+        const size_t m = std::min( n-i, (size_t)64u );
+        uint64_t word = 0u;
+        for( size_t k=0; k<m; k++ ) {
+            uint32_t v = load32be( src + 4*(i+k) );
+            dst[i+k] = v;
+            word |= (uint64_t)(v != 0u) << k;
+        }
+        orBits( bits, bit + i, word );
+        count += __builtin_popcountll( word );
+    }
+    return count;
+}
+
+/** Number of scalar elements before dst is aligned to alignment bytes. */
+inline size_t
+headCount( const void* dst, const size_t alignment, const size_t n )
+{
+    size_t misalignment = reinterpret_cast<uintptr_t>( dst ) & (alignment-1);
+    if( misalignment == 0 ) {
+        return 0;
+    }
+    if( (misalignment & 3) != 0 ) {
+        return n;   // dst is not float-aligned and can never be vector-aligned.
+    }
+    size_t head = (alignment - misalignment)/4;
+    return head < n ? head : n;
+}
+
+#ifdef ECLIPSE_KERNELS_X86
+
+// --- SSE2 --------------------------------------------------------------------
+
+/** Horizontal min and max of four-wide accumulators, merged into minimum and maximum. */
+__attribute__((target("sse2"),always_inline))
+inline void
+reduceMinMaxSSE2( __m128 min, __m128 max, float& minimum, float& maximum )
+{
+    min = _mm_min_ps( _mm_shuffle_ps( min, min, _MM_SHUFFLE( 2, 3, 0, 1) ), min );
+    min = _mm_min_ss( _mm_shuffle_ps( min, min, _MM_SHUFFLE( 2, 2, 2, 2) ), min );
+    _mm_store_ss( &minimum, min );
+    max = _mm_max_ps( _mm_shuffle_ps( max, max, _MM_SHUFFLE( 2, 3, 0, 1) ), max );
+    max = _mm_max_ss( _mm_shuffle_ps( max, max, _MM_SHUFFLE( 2, 2, 2, 2) ), max );
+    _mm_store_ss( &maximum, max );
+}
+
+__attribute__((target("sse2"),always_inline))
+inline __m128i
+endianSwap32SSE2( const __m128i value )
+{
+    // Swap bytes in each word using shifts, then swap the words.
+    __m128i r = _mm_or_si128( _mm_slli_epi16( value, 8 ), _mm_srli_epi16( value, 8 ) );
+    r = _mm_shufflehi_epi16( r, _MM_SHUFFLE(2, 3, 0, 1) );
+    r = _mm_shufflelo_epi16( r, _MM_SHUFFLE(2, 3, 0, 1) );
+    return r;
+}
+
+__attribute__((target("sse2")))
+void
+swap32SSE2( void* dst, const unsigned char* src, const size_t n )
+{
+    unsigned char* out = reinterpret_cast<unsigned char*>( dst );
+    size_t i = 0;
+    for( ; i+8<=n; i+=8 ) {
+        __m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 4*i ) );
+        __m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 4*i + 16 ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + 4*i ), endianSwap32SSE2( a ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + 4*i + 16 ), endianSwap32SSE2( b ) );
+    }
+    swap32Scalar( out + 4*i, src + 4*i, n - i );
+}
+
+__attribute__((target("sse2")))
+void
+float32MinMaxSSE2( float*                   dst,
+                   const unsigned char*     src,
+                   const size_t             n,
+                   float&                   minimum,
+                   float&                   maximum )
+{
+    size_t i = headCount( dst, 16, n );
+    float32MinMaxScalar( dst, src, i, minimum, maximum );
+
+    __m128 min0 = _mm_set1_ps( minimum );
+    __m128 max0 = _mm_set1_ps( maximum );
+    __m128 min1 = min0;
+    __m128 max1 = max0;
+    for( ; i+8<=n; i+=8 ) {
+        __m128 a = _mm_castsi128_ps( endianSwap32SSE2( _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 4*i ) ) ) );
+        __m128 b = _mm_castsi128_ps( endianSwap32SSE2( _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 4*i + 16 ) ) ) );
+        min0 = _mm_min_ps( min0, a );
+        max0 = _mm_max_ps( max0, a );
+        min1 = _mm_min_ps( min1, b );
+        max1 = _mm_max_ps( max1, b );
+        _mm_stream_ps( dst + i, a );
+        _mm_stream_ps( dst + i + 4, b );
+    }
+    _mm_sfence();
+    reduceMinMaxSSE2( _mm_min_ps( min0, min1 ), _mm_max_ps( max0, max1 ), minimum, maximum );
+
+    float32MinMaxScalar( dst + i, src + 4*i, n - i, minimum, maximum );
+}
+
+__attribute__((target("sse2")))
+size_t
+int32ActiveSSE2( int*                   dst,
+                 const unsigned char*   src,
+                 const size_t           n,
+                 uint64_t*              bits,
+                 const size_t           bit )
+{
+    // Nonzero test is independent of byte order, so it is done on the raw words.
+    const __m128i zero = _mm_setzero_si128();
+    size_t count = 0;
+    size_t i = 0;
+    for( ; i+64<=n; i+=64 ) {
+        uint64_t word = 0u;
+        for( size_t k=0; k<64; k+=4 ) {
+            __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 4*(i+k) ) );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( dst + i + k ), endianSwap32SSE2( v ) );
+            uint64_t z = _mm_movemask_ps( _mm_castsi128_ps( _mm_cmpeq_epi32( v, zero ) ) );
+            word |= (z ^ 0xfu) << k;
+        }
+        orBits( bits, bit + i, word );
+        count += __builtin_popcountll( word );
+    }
+    return count + int32ActiveScalar( dst + i, src + 4*i, n - i, bits, bit + i );
+}
+
+__attribute__((target("sse2"),always_inline))
+inline __m128i
+endianSwap64SSE2( const __m128i value )
+{
+    // Swap bytes in each word using shifts, then reverse the words.
+    __m128i r = _mm_or_si128( _mm_slli_epi16( value, 8 ), _mm_srli_epi16( value, 8 ) );
+    r = _mm_shufflehi_epi16( r, _MM_SHUFFLE(0, 1, 2, 3) );
+    r = _mm_shufflelo_epi16( r, _MM_SHUFFLE(0, 1, 2, 3) );
+    return r;
+}
+
+__attribute__((target("sse2")))
+void
+swap64SSE2( void* dst, const unsigned char* src, const size_t n )
+{
+    unsigned char* out = reinterpret_cast<unsigned char*>( dst );
+    size_t i = 0;
+    for( ; i+4<=n; i+=4 ) {
+        __m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 8*i ) );
+        __m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 8*i + 16 ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + 8*i ), endianSwap64SSE2( a ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + 8*i + 16 ), endianSwap64SSE2( b ) );
+    }
+    swap64Scalar( out + 8*i, src + 8*i, n - i );
+}
+
+__attribute__((target("sse2")))
+void
+float64MinMaxSSE2( float*                   dst,
+                   const unsigned char*     src,
+                   const size_t             n,
+                   float&                   minimum,
+                   float&                   maximum )
+{
+    size_t i = headCount( dst, 16, n );
+    float64MinMaxScalar( dst, src, i, minimum, maximum );
+
+    __m128 min = _mm_set1_ps( minimum );
+    __m128 max = _mm_set1_ps( maximum );
+    for( ; i+4<=n; i+=4 ) {
+        __m128d a = _mm_castsi128_pd( endianSwap64SSE2( _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 8*i ) ) ) );
+        __m128d b = _mm_castsi128_pd( endianSwap64SSE2( _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 8*i + 16 ) ) ) );
+        __m128 f = _mm_movelh_ps( _mm_cvtpd_ps( a ), _mm_cvtpd_ps( b ) );
+        min = _mm_min_ps( min, f );
+        max = _mm_max_ps( max, f );
+        _mm_stream_ps( dst + i, f );
+    }
+    _mm_sfence();
+    reduceMinMaxSSE2( min, max, minimum, maximum );
+
+    float64MinMaxScalar( dst + i, src + 8*i, n - i, minimum, maximum );
+}
+
+// --- SSSE3 -------------------------------------------------------------------
+
+__attribute__((target("ssse3")))
+void
+swap32SSSE3( void* dst, const unsigned char* src, const size_t n )
+{
+    // SSSE3 has a byte-shuffle instruction which does everything.
+    const __m128i mask = _mm_set_epi8( 12, 13, 14, 15, 8, 9, 10, 11,
+                                       4, 5, 6, 7, 0, 1, 2, 3 );
+    unsigned char* out = reinterpret_cast<unsigned char*>( dst );
+    size_t i = 0;
+    for( ; i+8<=n; i+=8 ) {
+        __m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 4*i ) );
+        __m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 4*i + 16 ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + 4*i ), _mm_shuffle_epi8( a, mask ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + 4*i + 16 ), _mm_shuffle_epi8( b, mask ) );
+    }
+    swap32Scalar( out + 4*i, src + 4*i, n - i );
+}
+
+__attribute__((target("ssse3")))
+void
+float32MinMaxSSSE3( float*                  dst,
+                    const unsigned char*    src,
+                    const size_t            n,
+                    float&                  minimum,
+                    float&                  maximum )
+{
+    const __m128i mask = _mm_set_epi8( 12, 13, 14, 15, 8, 9, 10, 11,
+                                       4, 5, 6, 7, 0, 1, 2, 3 );
+    size_t i = headCount( dst, 16, n );
+    float32MinMaxScalar( dst, src, i, minimum, maximum );
+
+    __m128 min0 = _mm_set1_ps( minimum );
+    __m128 max0 = _mm_set1_ps( maximum );
+    __m128 min1 = min0;
+    __m128 max1 = max0;
+    for( ; i+8<=n; i+=8 ) {
+        __m128 a = _mm_castsi128_ps( _mm_shuffle_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 4*i ) ), mask ) );
+        __m128 b = _mm_castsi128_ps( _mm_shuffle_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 4*i + 16 ) ), mask ) );
+        min0 = _mm_min_ps( min0, a );
+        max0 = _mm_max_ps( max0, a );
+        min1 = _mm_min_ps( min1, b );
+        max1 = _mm_max_ps( max1, b );
+        _mm_stream_ps( dst + i, a );
+        _mm_stream_ps( dst + i + 4, b );
+    }
+    _mm_sfence();
+    reduceMinMaxSSE2( _mm_min_ps( min0, min1 ), _mm_max_ps( max0, max1 ), minimum, maximum );
+
+    float32MinMaxScalar( dst + i, src + 4*i, n - i, minimum, maximum );
+}
+
+__attribute__((target("ssse3")))
+size_t
+int32ActiveSSSE3( int*                  dst,
+                  const unsigned char*  src,
+                  const size_t          n,
+                  uint64_t*             bits,
+                  const size_t          bit )
+{
+    const __m128i mask = _mm_set_epi8( 12, 13, 14, 15, 8, 9, 10, 11,
+                                       4, 5, 6, 7, 0, 1, 2, 3 );
+    const __m128i zero = _mm_setzero_si128();
+    size_t count = 0;
+    size_t i = 0;
+    for( ; i+64<=n; i+=64 ) {
+        uint64_t word = 0u;
+        for( size_t k=0; k<64; k+=4 ) {
+            __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 4*(i+k) ) );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( dst + i + k ), _mm_shuffle_epi8( v, mask ) );
+            uint64_t z = _mm_movemask_ps( _mm_castsi128_ps( _mm_cmpeq_epi32( v, zero ) ) );
+            word |= (z ^ 0xfu) << k;
+        }
+        orBits( bits, bit + i, word );
+        count += __builtin_popcountll( word );
+    }
+    return count + int32ActiveScalar( dst + i, src + 4*i, n - i, bits, bit + i );
+}
+
+__attribute__((target("ssse3")))
+void
+swap64SSSE3( void* dst, const unsigned char* src, const size_t n )
+{
+    const __m128i mask = _mm_set_epi8( 8, 9, 10, 11, 12, 13, 14, 15,
+                                       0, 1, 2, 3, 4, 5, 6, 7 );
+    unsigned char* out = reinterpret_cast<unsigned char*>( dst );
+    size_t i = 0;
+    for( ; i+4<=n; i+=4 ) {
+        __m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 8*i ) );
+        __m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 8*i + 16 ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + 8*i ), _mm_shuffle_epi8( a, mask ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + 8*i + 16 ), _mm_shuffle_epi8( b, mask ) );
+    }
+    swap64Scalar( out + 8*i, src + 8*i, n - i );
+}
+
+__attribute__((target("ssse3")))
+void
+float64MinMaxSSSE3( float*                  dst,
+                    const unsigned char*    src,
+                    const size_t            n,
+                    float&                  minimum,
+                    float&                  maximum )
+{
+    const __m128i mask = _mm_set_epi8( 8, 9, 10, 11, 12, 13, 14, 15,
+                                       0, 1, 2, 3, 4, 5, 6, 7 );
+    size_t i = headCount( dst, 16, n );
+    float64MinMaxScalar( dst, src, i, minimum, maximum );
+
+    __m128 min = _mm_set1_ps( minimum );
+    __m128 max = _mm_set1_ps( maximum );
+    for( ; i+4<=n; i+=4 ) {
+        __m128d a = _mm_castsi128_pd( _mm_shuffle_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 8*i ) ), mask ) );
+        __m128d b = _mm_castsi128_pd( _mm_shuffle_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + 8*i + 16 ) ), mask ) );
+        __m128 f = _mm_movelh_ps( _mm_cvtpd_ps( a ), _mm_cvtpd_ps( b ) );
+        min = _mm_min_ps( min, f );
+        max = _mm_max_ps( max, f );
+        _mm_stream_ps( dst + i, f );
+    }
+    _mm_sfence();
+    reduceMinMaxSSE2( min, max, minimum, maximum );
+
+    float64MinMaxScalar( dst + i, src + 8*i, n - i, minimum, maximum );
+}
+
+// --- AVX2 --------------------------------------------------------------------
+
+__attribute__((target("avx2")))
+void
+swap32AVX2( void* dst, const unsigned char* src, const size_t n )
+{
+    const __m256i mask = _mm256_set_epi8( 12, 13, 14, 15, 8, 9, 10, 11,
+                                          4, 5, 6, 7, 0, 1, 2, 3,
+                                          12, 13, 14, 15, 8, 9, 10, 11,
+                                          4, 5, 6, 7, 0, 1, 2, 3 );
+    unsigned char* out = reinterpret_cast<unsigned char*>( dst );
+    size_t i = 0;
+    for( ; i+16<=n; i+=16 ) {
+        __m256i a = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( src + 4*i ) );
+        __m256i b = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( src + 4*i + 32 ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + 4*i ), _mm256_shuffle_epi8( a, mask ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + 4*i + 32 ), _mm256_shuffle_epi8( b, mask ) );
+    }
+    swap32Scalar( out + 4*i, src + 4*i, n - i );
+}
+
+__attribute__((target("avx2")))
+void
+float32MinMaxAVX2( float*                   dst,
+                   const unsigned char*     src,
+                   const size_t             n,
+                   float&                   minimum,
+                   float&                   maximum )
+{
+    const __m256i mask = _mm256_set_epi8( 12, 13, 14, 15, 8, 9, 10, 11,
+                                          4, 5, 6, 7, 0, 1, 2, 3,
+                                          12, 13, 14, 15, 8, 9, 10, 11,
+                                          4, 5, 6, 7, 0, 1, 2, 3 );
+    size_t i = headCount( dst, 32, n );
+    float32MinMaxScalar( dst, src, i, minimum, maximum );
+
+    __m256 min0 = _mm256_set1_ps( minimum );
+    __m256 max0 = _mm256_set1_ps( maximum );
+    __m256 min1 = min0;
+    __m256 max1 = max0;
+    for( ; i+16<=n; i+=16 ) {
+        __m256 a = _mm256_castsi256_ps( _mm256_shuffle_epi8( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( src + 4*i ) ), mask ) );
+        __m256 b = _mm256_castsi256_ps( _mm256_shuffle_epi8( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( src + 4*i + 32 ) ), mask ) );
+        min0 = _mm256_min_ps( min0, a );
+        max0 = _mm256_max_ps( max0, a );
+        min1 = _mm256_min_ps( min1, b );
+        max1 = _mm256_max_ps( max1, b );
+        _mm256_stream_ps( dst + i, a );
+        _mm256_stream_ps( dst + i + 8, b );
+    }
+    _mm_sfence();
+    min0 = _mm256_min_ps( min0, min1 );
+    max0 = _mm256_max_ps( max0, max1 );
+    reduceMinMaxSSE2( _mm_min_ps( _mm256_castps256_ps128( min0 ), _mm256_extractf128_ps( min0, 1 ) ),
+                      _mm_max_ps( _mm256_castps256_ps128( max0 ), _mm256_extractf128_ps( max0, 1 ) ),
+                      minimum, maximum );
+
+    float32MinMaxScalar( dst + i, src + 4*i, n - i, minimum, maximum );
+}
+
+__attribute__((target("avx2,popcnt")))
+size_t
+int32ActiveAVX2( int*                   dst,
+                 const unsigned char*   src,
+                 const size_t           n,
+                 uint64_t*              bits,
+                 const size_t           bit )
+{
+    const __m256i mask = _mm256_set_epi8( 12, 13, 14, 15, 8, 9, 10, 11,
+                                          4, 5, 6, 7, 0, 1, 2, 3,
+                                          12, 13, 14, 15, 8, 9, 10, 11,
+                                          4, 5, 6, 7, 0, 1, 2, 3 );
+    const __m256i zero = _mm256_setzero_si256();
+    size_t count = 0;
+    size_t i = 0;
+    for( ; i+64<=n; i+=64 ) {
+        uint64_t word = 0u;
+        for( size_t k=0; k<64; k+=8 ) {
+            __m256i v = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( src + 4*(i+k) ) );
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( dst + i + k ), _mm256_shuffle_epi8( v, mask ) );
+            uint64_t z = _mm256_movemask_ps( _mm256_castsi256_ps( _mm256_cmpeq_epi32( v, zero ) ) );
+            word |= (z ^ 0xffu) << k;
+        }
+        orBits( bits, bit + i, word );
+        count += __builtin_popcountll( word );
+    }
+    return count + int32ActiveScalar( dst + i, src + 4*i, n - i, bits, bit + i );
+}
+
+__attribute__((target("avx2")))
+void
+swap64AVX2( void* dst, const unsigned char* src, const size_t n )
+{
+    const __m256i mask = _mm256_set_epi8( 8, 9, 10, 11, 12, 13, 14, 15,
+                                          0, 1, 2, 3, 4, 5, 6, 7,
+                                          8, 9, 10, 11, 12, 13, 14, 15,
+                                          0, 1, 2, 3, 4, 5, 6, 7 );
+    unsigned char* out = reinterpret_cast<unsigned char*>( dst );
+    size_t i = 0;
+    for( ; i+8<=n; i+=8 ) {
+        __m256i a = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( src + 8*i ) );
+        __m256i b = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( src + 8*i + 32 ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + 8*i ), _mm256_shuffle_epi8( a, mask ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + 8*i + 32 ), _mm256_shuffle_epi8( b, mask ) );
+    }
+    swap64Scalar( out + 8*i, src + 8*i, n - i );
+}
+
+__attribute__((target("avx2")))
+void
+float64MinMaxAVX2( float*                   dst,
+                   const unsigned char*     src,
+                   const size_t             n,
+                   float&                   minimum,
+                   float&                   maximum )
+{
+    const __m256i mask = _mm256_set_epi8( 8, 9, 10, 11, 12, 13, 14, 15,
+                                          0, 1, 2, 3, 4, 5, 6, 7,
+                                          8, 9, 10, 11, 12, 13, 14, 15,
+                                          0, 1, 2, 3, 4, 5, 6, 7 );
+    size_t i = headCount( dst, 32, n );
+    float64MinMaxScalar( dst, src, i, minimum, maximum );
+
+    __m256 min = _mm256_set1_ps( minimum );
+    __m256 max = _mm256_set1_ps( maximum );
+    for( ; i+8<=n; i+=8 ) {
+        __m256d a = _mm256_castsi256_pd( _mm256_shuffle_epi8( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( src + 8*i ) ), mask ) );
+        __m256d b = _mm256_castsi256_pd( _mm256_shuffle_epi8( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( src + 8*i + 32 ) ), mask ) );
+        __m256 f = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm256_cvtpd_ps( a ) ), _mm256_cvtpd_ps( b ), 1 );
+        min = _mm256_min_ps( min, f );
+        max = _mm256_max_ps( max, f );
+        _mm256_stream_ps( dst + i, f );
+    }
+    _mm_sfence();
+    reduceMinMaxSSE2( _mm_min_ps( _mm256_castps256_ps128( min ), _mm256_extractf128_ps( min, 1 ) ),
+                      _mm_max_ps( _mm256_castps256_ps128( max ), _mm256_extractf128_ps( max, 1 ) ),
+                      minimum, maximum );
+
+    float64MinMaxScalar( dst + i, src + 8*i, n - i, minimum, maximum );
+}
+
+// --- AVX-512 -----------------------------------------------------------------
+
+// Some GCC versions warn about the _mm512_undefined_* used inside the
+// AVX-512 intrinsics headers themselves.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+__attribute__((target("avx512f,avx512bw")))
+inline __m512i
+byteMaskAVX512()
+{
+    return _mm512_broadcast_i32x4( _mm_set_epi8( 12, 13, 14, 15, 8, 9, 10, 11,
+                                                 4, 5, 6, 7, 0, 1, 2, 3 ) );
+}
+
+__attribute__((target("avx512f,avx512bw")))
+void
+swap32AVX512( void* dst, const unsigned char* src, const size_t n )
+{
+    const __m512i mask = byteMaskAVX512();
+    unsigned char* out = reinterpret_cast<unsigned char*>( dst );
+    size_t i = 0;
+    for( ; i+32<=n; i+=32 ) {
+        __m512i a = _mm512_loadu_si512( src + 4*i );
+        __m512i b = _mm512_loadu_si512( src + 4*i + 64 );
+        _mm512_storeu_si512( out + 4*i, _mm512_shuffle_epi8( a, mask ) );
+        _mm512_storeu_si512( out + 4*i + 64, _mm512_shuffle_epi8( b, mask ) );
+    }
+    if( i < n ) {
+        // Masked load/store handles the tail without a scalar loop.
+        __mmask16 m = (__mmask16)( (1u<<(n-i < 16 ? n-i : 16)) - 1u );
+        __m512i a = _mm512_maskz_loadu_epi32( m, src + 4*i );
+        _mm512_mask_storeu_epi32( out + 4*i, m, _mm512_shuffle_epi8( a, mask ) );
+        i += 16;
+        if( i < n ) {
+            m = (__mmask16)( (1u<<(n-i)) - 1u );
+            a = _mm512_maskz_loadu_epi32( m, src + 4*i );
+            _mm512_mask_storeu_epi32( out + 4*i, m, _mm512_shuffle_epi8( a, mask ) );
+        }
+    }
+}
+
+__attribute__((target("avx512f,avx512bw")))
+void
+float32MinMaxAVX512( float*                 dst,
+                     const unsigned char*   src,
+                     const size_t           n,
+                     float&                 minimum,
+                     float&                 maximum )
+{
+    const __m512i mask = byteMaskAVX512();
+    size_t i = headCount( dst, 64, n );
+    float32MinMaxScalar( dst, src, i, minimum, maximum );
+
+    __m512 min0 = _mm512_set1_ps( minimum );
+    __m512 max0 = _mm512_set1_ps( maximum );
+    __m512 min1 = min0;
+    __m512 max1 = max0;
+    for( ; i+32<=n; i+=32 ) {
+        __m512 a = _mm512_castsi512_ps( _mm512_shuffle_epi8( _mm512_loadu_si512( src + 4*i ), mask ) );
+        __m512 b = _mm512_castsi512_ps( _mm512_shuffle_epi8( _mm512_loadu_si512( src + 4*i + 64 ), mask ) );
+        min0 = _mm512_min_ps( min0, a );
+        max0 = _mm512_max_ps( max0, a );
+        min1 = _mm512_min_ps( min1, b );
+        max1 = _mm512_max_ps( max1, b );
+        _mm512_stream_ps( dst + i, a );
+        _mm512_stream_ps( dst + i + 16, b );
+    }
+    _mm_sfence();
+    minimum = _mm512_reduce_min_ps( _mm512_min_ps( min0, min1 ) );
+    maximum = _mm512_reduce_max_ps( _mm512_max_ps( max0, max1 ) );
+
+    float32MinMaxScalar( dst + i, src + 4*i, n - i, minimum, maximum );
+}
+
+__attribute__((target("avx512f,avx512bw,popcnt")))
+size_t
+int32ActiveAVX512( int*                 dst,
+                   const unsigned char* src,
+                   const size_t         n,
+                   uint64_t*            bits,
+                   const size_t         bit )
+{
+    const __m512i mask = byteMaskAVX512();
+    size_t count = 0;
+    size_t i = 0;
+    for( ; i+64<=n; i+=64 ) {
+        uint64_t word = 0u;
+        for( size_t k=0; k<64; k+=16 ) {
+            __m512i v = _mm512_loadu_si512( src + 4*(i+k) );
+            _mm512_storeu_si512( dst + i + k, _mm512_shuffle_epi8( v, mask ) );
+            word |= (uint64_t)_mm512_test_epi32_mask( v, v ) << k;
+        }
+        orBits( bits, bit + i, word );
+        count += __builtin_popcountll( word );
+    }
+    return count + int32ActiveScalar( dst + i, src + 4*i, n - i, bits, bit + i );
+}
+
+__attribute__((target("avx512f,avx512bw")))
+void
+swap64AVX512( void* dst, const unsigned char* src, const size_t n )
+{
+    const __m512i mask = _mm512_broadcast_i32x4( _mm_set_epi8( 8, 9, 10, 11, 12, 13, 14, 15,
+                                                               0, 1, 2, 3, 4, 5, 6, 7 ) );
+    unsigned char* out = reinterpret_cast<unsigned char*>( dst );
+    size_t i = 0;
+    for( ; i+16<=n; i+=16 ) {
+        __m512i a = _mm512_loadu_si512( src + 8*i );
+        __m512i b = _mm512_loadu_si512( src + 8*i + 64 );
+        _mm512_storeu_si512( out + 8*i, _mm512_shuffle_epi8( a, mask ) );
+        _mm512_storeu_si512( out + 8*i + 64, _mm512_shuffle_epi8( b, mask ) );
+    }
+    swap64Scalar( out + 8*i, src + 8*i, n - i );
+}
+
+__attribute__((target("avx512f,avx512bw")))
+void
+float64MinMaxAVX512( float*                 dst,
+                     const unsigned char*   src,
+                     const size_t           n,
+                     float&                 minimum,
+                     float&                 maximum )
+{
+    const __m512i mask = _mm512_broadcast_i32x4( _mm_set_epi8( 8, 9, 10, 11, 12, 13, 14, 15,
+                                                               0, 1, 2, 3, 4, 5, 6, 7 ) );
+    size_t i = headCount( dst, 64, n );
+    float64MinMaxScalar( dst, src, i, minimum, maximum );
+
+    __m512 min = _mm512_set1_ps( minimum );
+    __m512 max = _mm512_set1_ps( maximum );
+    for( ; i+16<=n; i+=16 ) {
+        __m512d a = _mm512_castsi512_pd( _mm512_shuffle_epi8( _mm512_loadu_si512( src + 8*i ), mask ) );
+        __m512d b = _mm512_castsi512_pd( _mm512_shuffle_epi8( _mm512_loadu_si512( src + 8*i + 64 ), mask ) );
+        __m512d f = _mm512_insertf64x4( _mm512_castpd256_pd512( _mm256_castps_pd( _mm512_cvtpd_ps( a ) ) ),
+                                        _mm256_castps_pd( _mm512_cvtpd_ps( b ) ), 1 );
+        min = _mm512_min_ps( min, _mm512_castpd_ps( f ) );
+        max = _mm512_max_ps( max, _mm512_castpd_ps( f ) );
+        _mm512_stream_ps( dst + i, _mm512_castpd_ps( f ) );
+    }
+    _mm_sfence();
+    minimum = _mm512_reduce_min_ps( min );
+    maximum = _mm512_reduce_max_ps( max );
+
+    float64MinMaxScalar( dst + i, src + 8*i, n - i, minimum, maximum );
+}
+
+#pragma GCC diagnostic pop
+
+#endif // ECLIPSE_KERNELS_X86
+
+
+const KernelSet kernel_sets[ VARIANT_N ] = {
+    { VARIANT_SCALAR, "scalar", swap32Scalar, swap64Scalar, float32MinMaxScalar, float64MinMaxScalar, int32ActiveScalar },
+#ifdef ECLIPSE_KERNELS_X86
+    { VARIANT_SSE2,   "sse2",   swap32SSE2,   swap64SSE2,   float32MinMaxSSE2,   float64MinMaxSSE2,   int32ActiveSSE2   },
+    { VARIANT_SSSE3,  "ssse3",  swap32SSSE3,  swap64SSSE3,  float32MinMaxSSSE3,  float64MinMaxSSSE3,  int32ActiveSSSE3  },
+    { VARIANT_AVX2,   "avx2",   swap32AVX2,   swap64AVX2,   float32MinMaxAVX2,   float64MinMaxAVX2,   int32ActiveAVX2   },
+    { VARIANT_AVX512, "avx512", swap32AVX512, swap64AVX512, float32MinMaxAVX512, float64MinMaxAVX512, int32ActiveAVX512 },
+#else
+    { VARIANT_SSE2,   "sse2",   NULL, NULL, NULL, NULL, NULL },
+    { VARIANT_SSSE3,  "ssse3",  NULL, NULL, NULL, NULL, NULL },
+    { VARIANT_AVX2,   "avx2",   NULL, NULL, NULL, NULL, NULL },
+    { VARIANT_AVX512, "avx512", NULL, NULL, NULL, NULL, NULL },
+#endif
+};
+
+bool
+supported( Variant v )
+{
+#ifdef ECLIPSE_KERNELS_X86
+    __builtin_cpu_init();
+    switch( v ) {
+    case VARIANT_SCALAR: return true;
+    case VARIANT_SSE2:   return __builtin_cpu_supports( "sse2" );
+    case VARIANT_SSSE3:  return __builtin_cpu_supports( "ssse3" );
+    case VARIANT_AVX2:   return __builtin_cpu_supports( "avx2" );
+    case VARIANT_AVX512: return __builtin_cpu_supports( "avx512f" ) && __builtin_cpu_supports( "avx512bw" );
+    default:             return false;
+    }
+#else
+    return v == VARIANT_SCALAR;
+#endif
+}
+
+const KernelSet&
+detect()
+{
+    for( int v=VARIANT_N-1; v>VARIANT_SCALAR; v-- ) {
+        if( supported( static_cast<Variant>( v ) ) ) {
+            return kernel_sets[ v ];
+        }
+    }
+    return kernel_sets[ VARIANT_SCALAR ];
+}
+
+} // of anonymous namespace
+
+
+const KernelSet&
+best()
+{
+    static const KernelSet& kernels = detect();
+    return kernels;
+}
+
+void
+swap32Records( const KernelSet&       kernels,
+               void*                  dst,
+               const unsigned char*   bytes,
+               const size_t           count )
+{
+    unsigned char* out = reinterpret_cast<unsigned char*>( dst );
+    const unsigned char* src = bytes + 4;   // skip first head
+    for( size_t left = count; left > 0; ) {
+        size_t n = std::min( elements_per_record, left );
+        kernels.m_swap32( out, src, n );
+        out += 4*n;
+        src += 4*n + 8;                     // skip record tail and head
+        left -= n;
+    }
+}
+
+void
+float32MinMaxRecords( const KernelSet&       kernels,
+                      float*                 dst,
+                      const unsigned char*   bytes,
+                      const size_t           count,
+                      float&                 minimum,
+                      float&                 maximum )
+{
+    float min =  std::numeric_limits<float>::max();
+    float max = -std::numeric_limits<float>::max();
+    const unsigned char* src = bytes + 4;   // skip first head
+    for( size_t left = count; left > 0; ) {
+        size_t n = std::min( elements_per_record, left );
+        kernels.m_float32_minmax( dst, src, n, min, max );
+        dst += n;
+        src += 4*n + 8;                     // skip record tail and head
+        left -= n;
+    }
+    minimum = min;
+    maximum = max;
+}
+
+void
+swap64Records( const KernelSet&       kernels,
+               void*                  dst,
+               const unsigned char*   bytes,
+               const size_t           count )
+{
+    unsigned char* out = reinterpret_cast<unsigned char*>( dst );
+    const unsigned char* src = bytes + 4;   // skip first head
+    for( size_t left = count; left > 0; ) {
+        size_t n = std::min( elements_per_record, left );
+        kernels.m_swap64( out, src, n );
+        out += 8*n;
+        src += 8*n + 8;                     // skip record tail and head
+        left -= n;
+    }
+}
+
+void
+float64MinMaxRecords( const KernelSet&       kernels,
+                      float*                 dst,
+                      const unsigned char*   bytes,
+                      const size_t           count,
+                      float&                 minimum,
+                      float&                 maximum )
+{
+    float min =  std::numeric_limits<float>::max();
+    float max = -std::numeric_limits<float>::max();
+    const unsigned char* src = bytes + 4;   // skip first head
+    for( size_t left = count; left > 0; ) {
+        size_t n = std::min( elements_per_record, left );
+        kernels.m_float64_minmax( dst, src, n, min, max );
+        dst += n;
+        src += 8*n + 8;                     // skip record tail and head
+        left -= n;
+    }
+    minimum = min;
+    maximum = max;
+}
+
+size_t
+int32ActiveRecords( const KernelSet&       kernels,
+                    int*                   dst,
+                    const unsigned char*   bytes,
+                    const size_t           count,
+                    uint64_t*              bits )
+{
+    size_t active = 0;
+    const unsigned char* src = bytes + 4;   // skip first head
+    for( size_t offset = 0; offset < count; ) {
+        size_t n = std::min( elements_per_record, count - offset );
+        active += kernels.m_int32_active( dst + offset, src, n, bits, offset );
+        src += 4*n + 8;                     // skip record tail and head
+        offset += n;
+    }
+    return active;
+}
+
+const KernelSet*
+variant( Variant v )
+{
+    if( (v < VARIANT_N) && supported( v ) ) {
+        return &kernel_sets[ v ];
+    }
+    return NULL;
+}
+
+} // of namespace kernels
+} // of namespace eclipse
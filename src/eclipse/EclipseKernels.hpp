@@ -0,0 +1,202 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ *
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <cstddef>
+#include <stdint.h>
+
+namespace eclipse {
+namespace kernels {
+
+/** Number of 4 and 8 byte elements in a record of an unformatted file. */
+static const size_t elements_per_record = 1000u;
+
+/** Instruction set variants of the decoding kernels. */
+enum Variant {
+    VARIANT_SCALAR = 0,
+    VARIANT_SSE2,
+    VARIANT_SSSE3,
+    VARIANT_AVX2,
+    VARIANT_AVX512,
+    VARIANT_N
+};
+
+/** Byte-swap n big-endian 32-bit words at src into dst.
+  *
+  * Used for both integer and float data, as no interpretation is needed.
+  * Neither src nor dst need to be aligned.
+  */
+typedef void (*Swap32Kernel)( void*                 dst,
+                              const unsigned char*  src,
+                              const size_t          n );
+
+/** Byte-swap n big-endian floats at src into dst, updating min and max.
+  *
+  * Uses non-temporal stores when possible, as the destination is typically a
+  * staging buffer for the GPU. Neither src nor dst need to be aligned.
+  *
+  * \param[in,out] minimum  Running minimum, updated with the n values.
+  * \param[in,out] maximum  Running maximum, updated with the n values.
+  */
+typedef void (*Float32MinMaxKernel)( float*                 dst,
+                                     const unsigned char*   src,
+                                     const size_t           n,
+                                     float&                 minimum,
+                                     float&                 maximum );
+
+/** Byte-swap n big-endian 64-bit words at src into dst.
+  *
+  * Used for double data, neither src nor dst need to be aligned.
+  */
+typedef void (*Swap64Kernel)( void*                 dst,
+                              const unsigned char*  src,
+                              const size_t          n );
+
+/** Byte-swap n big-endian doubles at src, convert to float into dst, updating min and max.
+  *
+  * Same store policy as Float32MinMaxKernel, no intermediate double buffer
+  * is used.
+  *
+  * \param[in,out] minimum  Running minimum, updated with the n values.
+  * \param[in,out] maximum  Running maximum, updated with the n values.
+  */
+typedef void (*Float64MinMaxKernel)( float*                 dst,
+                                     const unsigned char*   src,
+                                     const size_t           n,
+                                     float&                 minimum,
+                                     float&                 maximum );
+
+/** Byte-swap n big-endian 32-bit integers and record which are nonzero.
+  *
+  * Used for ACTNUM-like blocks, where the nonzero elements are the active
+  * ones. Bit bit+i of bits is set if element i is nonzero, bits must be
+  * cleared by the caller, as the kernel only sets bits.
+  *
+  * \returns The number of nonzero elements.
+  */
+typedef size_t (*Int32ActiveKernel)( int*                   dst,
+                                     const unsigned char*   src,
+                                     const size_t           n,
+                                     uint64_t*              bits,
+                                     const size_t           bit );
+
+/** A family of kernels for one instruction set. */
+struct KernelSet {
+    Variant                 m_variant;
+    const char*             m_name;
+    Swap32Kernel            m_swap32;
+    Swap64Kernel            m_swap64;
+    Float32MinMaxKernel     m_float32_minmax;
+    Float64MinMaxKernel     m_float64_minmax;
+    Int32ActiveKernel       m_int32_active;
+};
+
+/** Byte-swap the 32-bit words of a block, skipping record heads and tails.
+  *
+  * \param[in] kernels  Kernel set to use.
+  * \param[out] dst     Destination of count words.
+  * \param[in] bytes    Pointer to the head of the first record of the block.
+  * \param[in] count    Number of elements in the block.
+  */
+void
+swap32Records( const KernelSet&       kernels,
+               void*                  dst,
+               const unsigned char*   bytes,
+               const size_t           count );
+
+/** Byte-swap the floats of a block and find min and max, skipping record heads and tails.
+  *
+  * \param[in] kernels  Kernel set to use.
+  * \param[out] dst     Destination of count floats.
+  * \param[in] bytes    Pointer to the head of the first record of the block.
+  * \param[in] count    Number of elements in the block.
+  * \param[out] minimum The smallest value encountered.
+  * \param[out] maximum The largest value encountered.
+  */
+void
+float32MinMaxRecords( const KernelSet&       kernels,
+                      float*                 dst,
+                      const unsigned char*   bytes,
+                      const size_t           count,
+                      float&                 minimum,
+                      float&                 maximum );
+
+/** Byte-swap the 64-bit words of a block, skipping record heads and tails.
+  *
+  * \param[in] kernels  Kernel set to use.
+  * \param[out] dst     Destination of count words.
+  * \param[in] bytes    Pointer to the head of the first record of the block.
+  * \param[in] count    Number of elements in the block.
+  */
+void
+swap64Records( const KernelSet&       kernels,
+               void*                  dst,
+               const unsigned char*   bytes,
+               const size_t           count );
+
+/** Convert the doubles of a block to floats and find min and max, skipping record heads and tails.
+  *
+  * \param[in] kernels  Kernel set to use.
+  * \param[out] dst     Destination of count floats.
+  * \param[in] bytes    Pointer to the head of the first record of the block.
+  * \param[in] count    Number of elements in the block.
+  * \param[out] minimum The smallest value encountered (after conversion).
+  * \param[out] maximum The largest value encountered (after conversion).
+  */
+void
+float64MinMaxRecords( const KernelSet&       kernels,
+                      float*                 dst,
+                      const unsigned char*   bytes,
+                      const size_t           count,
+                      float&                 minimum,
+                      float&                 maximum );
+
+/** Byte-swap the integers of a block and find the nonzero ones, skipping record heads and tails.
+  *
+  * \param[in] kernels  Kernel set to use.
+  * \param[out] dst     Destination of count integers.
+  * \param[in] bytes    Pointer to the head of the first record of the block.
+  * \param[in] count    Number of elements in the block.
+  * \param[out] bits    Zero-initialized array of (count+63)/64 words, bit i
+  *                     is set if element i is nonzero.
+  * \returns The number of nonzero elements.
+  */
+size_t
+int32ActiveRecords( const KernelSet&       kernels,
+                    int*                   dst,
+                    const unsigned char*   bytes,
+                    const size_t           count,
+                    uint64_t*              bits );
+
+/** Returns the fastest kernel set supported by the running CPU.
+  *
+  * Determined once using cpuid, independent of the instruction set the rest
+  * of the code is compiled for.
+  */
+const KernelSet&
+best();
+
+/** Returns the kernel set for a specific variant.
+  *
+  * \returns Pointer to the kernel set, or NULL if the variant is not
+  *          supported by the running CPU (or not compiled in).
+  */
+const KernelSet*
+variant( Variant v );
+
+} // of namespace kernels
+} // of namespace eclipse
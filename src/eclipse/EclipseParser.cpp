@@ -17,6 +17,7 @@
 
 #include <stdexcept>
 #include "utils/Logger.hpp"
+#include "utils/ActiveCells.hpp"
 #include "EclipseReader.hpp"
 #include "EclipseParser.hpp"
 
@@ -27,13 +28,130 @@ namespace eclipse {
 
 
 
+/** True if a float or double block of a report step may hold a per-cell solution. */
+static
+bool
+isSolutionCandidate( const Block& block )
+{
+    switch( block.m_keyword ) {
+    case KEYWORD_INTEHEAD:
+    case KEYWORD_LOGIHEAD:
+    case KEYWORD_DOUBHEAD:
+    case KEYWORD_IGRP:
+    case KEYWORD_ISEG:
+    case KEYWORD_IWEL:
+    case KEYWORD_ZWEL:
+    case KEYWORD_ICON:
+    case KEYWORD_HIDDEN:
+    case KEYWORD_ZTRACER:
+    case KEYWORD_STARTSOL:
+    case KEYWORD_ENDSOL:
+    case KEYWORD_DRAINAGE:
+    case KEYWORD_LGRNAMES:
+    case KEYWORD_LGR:
+    case KEYWORD_LGRHEADI:
+    case KEYWORD_LGRHEADQ:
+    case KEYWORD_LGRHEADD:
+    case KEYWORD_LGRJOIN:
+    case KEYWORD_ENDLGR:
+        return false;
+    default:
+        return block.m_datatype == TYPE_FLOAT || block.m_datatype == TYPE_DOUBLE;
+    }
+}
+
+/** True if a block of a report step holds a per-cell solution.
+  *
+  * \param[in] cells    Number of cells in the grid (nx*ny*nz).
+  * \param[in] nactive  Number of active cells in the grid.
+  */
+static
+bool
+isSolution( const Block& block, const size_t cells, const size_t nactive )
+{
+    return isSolutionCandidate( block ) &&
+           ( block.m_count == cells || block.m_count == nactive );
+}
+
+/** Name of a well from its nzwelz strings in ZWEL, without trailing spaces. */
+static
+std::string
+wellName( const std::vector<std::string>& zwel, const unsigned int offset, const unsigned int nzwelz )
+{
+    std::string name;
+    for(unsigned int k=0; k<nzwelz; k++) {
+        name += zwel[ offset+k ];
+    }
+    size_t pos = name.find_last_not_of( ' ' );
+    if( pos != std::string::npos ) {
+        name = name.substr( 0, pos+1 );
+    }
+    return name;
+}
+
+static
+void
+addSolution( ReportStep& step, const Block& block, const std::string& local_grid )
+{
+    step.m_solutions.push_back( Solution() );
+    Solution& solution = step.m_solutions.back();
+    solution.m_name = block.m_keyword != KEYWORD_UNKNOWN
+                    ? keywordString( block.m_keyword )
+                    : string( block.m_keyword_string, block.m_keyword_string+8 );
+    solution.m_location = block;
+    solution.m_local_grid = local_grid;
+}
+
+/** Name of a local grid, the first string of an LGR block without trailing blanks. */
+static
+std::string
+localGridName( Reader& reader, const Block& block )
+{
+    std::vector<std::string> names;
+    reader.blockContent( names, block );
+    if( names.empty() ) {
+        throw std::runtime_error( "LGR without name" );
+    }
+    size_t np = names[0].find_last_not_of( ' ' );
+    return np != std::string::npos ? names[0].substr( 0, np+1 ) : names[0];
+}
+
+/** Add the solutions of a report step.
+  *
+  * The blocks between an LGR block and the following ENDLGR block belong to
+  * that local grid. The sizes of local grids are not known here, so any float
+  * or double block there is taken as a solution of the local grid.
+  */
+static
+void
+addSolutions( ReportStep&                               step,
+              Reader&                                   reader,
+              const std::list<Block>::const_iterator&   first,
+              const std::list<Block>::const_iterator&   last,
+              const size_t                              cells,
+              const size_t                              nactive )
+{
+    std::string local_grid;
+    for( auto it=first; it!=last; ++it ) {
+        if( it->m_keyword == KEYWORD_LGR ) {
+            local_grid = localGridName( reader, *it );
+        }
+        else if( it->m_keyword == KEYWORD_ENDLGR ) {
+            local_grid.clear();
+        }
+        else if( local_grid.empty() ? isSolution( *it, cells, nactive ) : isSolutionCandidate( *it ) ) {
+            addSolution( step, *it, local_grid );
+        }
+    }
+}
+
 static
 void
-parseRestartStep( std::list<ReportStep>&            report_steps,
-                  Reader&                           reader,
-                  const std::list<Block>::iterator& first,
-                  const std::list<Block>::iterator& last,
-                  const std::vector<int>&           actnum,
+parseRestartStep( std::list<ReportStep>&                    report_steps,
+                  Reader&                                   reader,
+                  const std::list<Block>::const_iterator&   first,
+                  const std::list<Block>::const_iterator&   last,
+                  const utils::ActiveCells&         active_cells,
                   const unsigned int                seqnum )
 {
     Logger log = getLogger( "Eclipse.parseRestartStep" );
@@ -66,8 +184,14 @@ parseRestartStep( std::list<ReportStep>&            report_steps,
     ReportStep& step = report_steps.back();
     step.m_sequence_number = seqnum;
 
+    bool in_local_grid = false;
     for(auto it=first; it!=last; ++it ) {
-        if( it->m_keyword == KEYWORD_INTEHEAD ) {
+        // The headers and wells of local grids are currently ignored,
+        // their solutions are added below.
+        if( in_local_grid ) {
+            in_local_grid = it->m_keyword != KEYWORD_ENDLGR;
+        }
+        else if( it->m_keyword == KEYWORD_INTEHEAD ) {
             std::vector<int> intehead;
             reader.blockContent( intehead, *it );
             if( intehead.size() < 95 ) {
@@ -205,7 +329,7 @@ parseRestartStep( std::list<ReportStep>&            report_steps,
             // currently ignored
         }
         else if( it->m_keyword == KEYWORD_LGR ) {
-            // currently ignored
+            in_local_grid = true;
         }
         else if( it->m_keyword == KEYWORD_LGRHEADI ) {
             // currently ignored
@@ -222,27 +346,18 @@ parseRestartStep( std::list<ReportStep>&            report_steps,
         else if( it->m_keyword == KEYWORD_ENDLGR ) {
             // currently ignored
         }
-        else if( ( it->m_datatype == TYPE_FLOAT || it->m_datatype == TYPE_DOUBLE ) &&
-                 ( it->m_count == nx*ny*nz || it->m_count == nactive ) )
-        {
-            step.m_solutions.push_back( Solution() );
-            Solution& solution = step.m_solutions.back();
-            solution.m_name = it->m_keyword != KEYWORD_UNKNOWN
-                            ? keywordString( it->m_keyword )
-                            : string( it->m_keyword_string, it->m_keyword_string+8 );
-            solution.m_location = *it;
-        }
         else {
             //LOGGER_WARN( log, "Unknown keyword: " << string( it->m_keyword_string, it->m_keyword_string+8 ) );
         }
     }
+    addSolutions( step, reader, first, last, nx*ny*nz, nactive );
 
     LOGGER_INFO( log, "Parsed report step " << step.m_sequence_number );
 
     // extract well info
     if( nwell != 0 ) {
-        if( actnum.size() != nx*ny*nz ) {
-            LOGGER_FATAL( log, "Dimension mismatch, actnum.size()=" << actnum.size() << ", nx*ny*nz=" << (nx*ny*nz) );
+        if( active_cells.size() != nx*ny*nz ) {
+            LOGGER_FATAL( log, "Dimension mismatch, active_cells.size()=" << active_cells.size() << ", nx*ny*nz=" << (nx*ny*nz) );
             return;
         }
 
@@ -293,7 +408,7 @@ parseRestartStep( std::list<ReportStep>&            report_steps,
 
             well.m_head_min_k = well.m_head_max_k = ~0u;
             for( unsigned int k=0; k<nz; k++ ) {
-                if( actnum[well.m_head_i + nx*well.m_head_j + k*nx*ny] != 0 ) {
+                if( active_cells.active( well.m_head_i + nx*well.m_head_j + k*nx*ny ) ) {
                     well.m_head_min_k = k;
                     well.m_head_max_k = k;
                     break;
@@ -305,7 +420,7 @@ parseRestartStep( std::list<ReportStep>&            report_steps,
                 break;
             }
             for( unsigned int k=well.m_head_min_k; k<nz; k++ ) {
-                if( actnum[well.m_head_i + nx*well.m_head_j + k*nx*ny] != 0 ) {
+                if( active_cells.active( well.m_head_i + nx*well.m_head_j + k*nx*ny ) ) {
                     well.m_head_max_k = k;
                 }
             }
@@ -342,14 +457,7 @@ parseRestartStep( std::list<ReportStep>&            report_steps,
 
 
             // well name
-            well.m_name.clear();
-            for(unsigned int k=0; k<nzwelz; k++) {
-                well.m_name += zwel[ zwel_offset+k ];
-            }
-            size_t pos = well.m_name.find_last_not_of( ' ' );
-            if( pos != std::string::npos ) {
-                well.m_name = well.m_name.substr( 0, pos+1 );
-            }
+            well.m_name = wellName( zwel, zwel_offset, nzwelz );
 
             for(int comp_no=0; comp_no<ncomp; comp_no++ ) {
                 Completion completion;
@@ -369,7 +477,7 @@ parseRestartStep( std::list<ReportStep>&            report_steps,
                     continue;
                 }
 
-                if( actnum[ completion.m_i + nx*completion.m_j + nx*ny*completion.m_k ] == 0 ) {
+                if( !active_cells.active( completion.m_i + nx*completion.m_j + nx*ny*completion.m_k ) ) {
                     LOGGER_ERROR( log, "Completion in inactive cell ["  <<
                                   completion.m_i << ", " <<
                                   completion.m_j << ", " <<
@@ -422,9 +530,9 @@ parseRestartStep( std::list<ReportStep>&            report_steps,
 
 
 void
-parseRestartFile( std::list<ReportStep>&  report_steps,
-                  const std::vector<int>& actnum,
-                  const std::string&      path )
+parseRestartFile( std::list<ReportStep>&      report_steps,
+                  const utils::ActiveCells&   active_cells,
+                  const std::string&          path )
 {
     Logger log = getLogger( "Eclipse.parseUnifiedRestartFile" );
     size_t s = path.find_last_not_of( "0123456789" );
@@ -447,14 +555,14 @@ parseRestartFile( std::list<ReportStep>&  report_steps,
                       reader,
                       blocks.begin(),
                       blocks.end(),
-                      actnum,
+                      active_cells,
                       seqnum );
 }
 
 void
-parseUnifiedRestartFile( std::list<ReportStep>&  report_steps,
-                         const std::vector<int>& actnum,
-                         const std::string&      path )
+parseUnifiedRestartFile( std::list<ReportStep>&      report_steps,
+                         const utils::ActiveCells&   active_cells,
+                         const std::string&          path )
 {
     Logger log = getLogger( "Eclipse.parseUnifiedRestartFile" );
     Reader reader( path );
@@ -477,103 +585,202 @@ parseUnifiedRestartFile( std::list<ReportStep>&  report_steps,
                           reader,
                           prev,
                           next,
-                          actnum,
+                          active_cells,
                           seqnum[0] );
         prev = next;
     }
 }
 
-
-
-template<typename REAL>
 void
-parseEGrid( unsigned int&               nx,
-            unsigned int&               ny,
-            unsigned int&               nz,
-            unsigned int&               nr,
-            std::vector<REAL>&          coord,
-            std::vector<REAL>&          zcorn,
-            std::vector<int>&           actnum,
-            Properties&                 properties,
-            const std::string&          path )
+indexUnifiedRestartFile( std::list<ReportStep>&         report_steps,
+                         std::list<ReportStepBlocks>&   step_blocks,
+                         const std::string&             path )
 {
-    Logger log = getLogger( "Eclipse.parseEGrid" );
+    Logger log = getLogger( "Eclipse.indexUnifiedRestartFile" );
     Reader reader( path );
     list<Block> blocks = reader.blocks();
 
+    size_t cells = 0;
+    size_t nactive = 0;
+    bool has_intehead = false;
 
-    auto it = blocks.begin();
-
-    int grid_type;
+    auto prev = blocks.begin();
+    while( prev != blocks.end() ) {
+        if( prev->m_keyword != KEYWORD_SEQNUM ) {
+            throw std::runtime_error( "expected SEQNUM" );
+        }
+        std::vector<int> seqnum;
+        reader.blockContent( seqnum, *prev++ );
+        if( seqnum.size() < 1 ) {
+            throw std::runtime_error( "SEQNUM too small" );
+        }
+        auto next = prev;
+        while( next != blocks.end() && next->m_keyword != KEYWORD_SEQNUM ) {
+            next++;
+        }
 
-    // FILEHEAD
-    if( it != blocks.end() && it->m_keyword == KEYWORD_FILEHEAD ) {
-        vector<int> filehead;
-        reader.blockContent( filehead, *it );
-        if( filehead.size() < 6 ) {
-            throw std::runtime_error( "FILEHEAD too small" );
+        // Grid dimensions are the same for all steps, the well layout is
+        // not. The headers and wells of local grids are skipped.
+        unsigned int nwell = 0;
+        unsigned int nzwelz = 0;
+        std::vector<std::string> zwel;
+        bool in_local_grid = false;
+        for( auto it=prev; it!=next; ++it ) {
+            if( in_local_grid ) {
+                in_local_grid = it->m_keyword != KEYWORD_ENDLGR;
+            }
+            else if( it->m_keyword == KEYWORD_LGR ) {
+                in_local_grid = true;
+            }
+            else if( it->m_keyword == KEYWORD_INTEHEAD ) {
+                std::vector<int> intehead;
+                reader.blockContent( intehead, *it );
+                if( intehead.size() < 95 ) {
+                    throw std::runtime_error( "INTEHEAD < 95 elements" );
+                }
+                if( !has_intehead ) {
+                    cells = (size_t)intehead[ ITEM_INTEHEAD_NX ]
+                          * (size_t)intehead[ ITEM_INTEHEAD_NY ]
+                          * (size_t)intehead[ ITEM_INTEHEAD_NZ ];
+                    nactive = intehead[ ITEM_INTEHEAD_NACTIV ];
+                    has_intehead = true;
+                }
+                nwell  = intehead[ ITEM_INTEHEAD_NWELLS ];
+                nzwelz = intehead[ ITEM_INTEHEAD_NZWELZ ];
+            }
+            else if( it->m_keyword == KEYWORD_ZWEL ) {
+                reader.blockContent( zwel, *it );
+            }
+        }
+        if( !has_intehead ) {
+            throw std::runtime_error( "first report step has no INTEHEAD" );
         }
 
-        properties["version_number"]          = filehead[0];
-        properties["release_year"]            = filehead[1];
-        properties["backwards_compatibility"] = filehead[3];
+        report_steps.push_back( ReportStep() );
+        ReportStep& step = report_steps.back();
+        step.m_sequence_number = seqnum[0];
+        step.m_date.m_day   = 0;
+        step.m_date.m_month = 0;
+        step.m_date.m_year  = 0;
 
-        grid_type = filehead[4];
-        switch( grid_type ) {
-        case 0:
-            properties["grid_type"] = "corner_point";
-            break;
-        case 1:
-            properties["grid_type"] = "unstructured";
-            break;
-        case 2:
-            properties["grid_type"] = "hybrid";
-            break;
-        default:
-            throw std::runtime_error( "unknown grid type" );
-        }
-        switch( filehead[5] ) {
-        case 0:
-            properties["single_porosity"] = 1;
-            break;
-        case 1:
-            properties["dual_porosity"] = 1;
-            break;
-        case 2:
-            properties["dual_permeability"] = 1;
-            break;
-        default:
-            throw std::runtime_error( "unknown porosity" );
+        step_blocks.push_back( ReportStepBlocks() );
+        ReportStepBlocks& location = step_blocks.back();
+        location.m_sequence_number = seqnum[0];
+        location.m_blocks.assign( prev, next );
+        if( (nwell != 0) && (zwel.size() == nzwelz * nwell) ) {
+            for( unsigned int i=0; i<nwell; i++ ) {
+                location.m_well_names.push_back( wellName( zwel, nzwelz*i, nzwelz ) );
+            }
         }
-        it++;
+
+        addSolutions( step, reader, prev, next, cells, nactive );
+        prev = next;
     }
-    else {
-        throw std::runtime_error( "expected FILEHEAD" );
+    LOGGER_DEBUG( log, "Indexed " << report_steps.size() << " report steps of " << path );
+}
+
+bool
+parseAppendedRestartSteps( std::list<ReportStep>&      report_steps,
+                           size_t&                     offset,
+                           size_t&                     end,
+                           const utils::ActiveCells&   active_cells,
+                           const std::string&          path,
+                           const bool                  accept_last )
+{
+    Logger log = getLogger( "Eclipse.parseAppendedRestartSteps" );
+    Reader reader( path );
+    list<Block> blocks;
+    const size_t known_end = end;
+    const size_t blocks_end = reader.appendedBlocks( blocks, offset );
+    if( blocks_end <= known_end ) {
+        return known_end < reader.fileSize();   // nothing appended
+    }
+    if( !blocks.empty() && (blocks.front().m_keyword != KEYWORD_SEQNUM) ) {
+        throw std::runtime_error( "Expected SEQNUM at start of last report step" );
     }
 
-    if( it != blocks.end() && it->m_keyword == KEYWORD_MAPUNITS ) {
-        std::vector<std::string> mapunits;
-        reader.blockContent( mapunits, *it );
-        if( mapunits.size() < 1 ) {
-            throw std::runtime_error( "MAPUNITS too small" );
+    // The blocks start at the SEQNUM of the last known step, if any.
+    bool known = known_end > offset;
+    auto prev = blocks.begin();
+    while( prev != blocks.end() ) {
+        auto next = prev;
+        next++;
+        while( next != blocks.end() && next->m_keyword != KEYWORD_SEQNUM ) {
+            next++;
         }
-        size_t np = mapunits[0].find_last_not_of( ' ' );
-        if( np != std::string::npos ) {
-            properties["map_units"] = mapunits[0].substr(0, np+1 );
+        // The header record of a block precedes its data by 4+16+4 bytes.
+        offset = prev->m_offset - 24;
+        if( (next == blocks.end()) && !known && !(accept_last && (blocks_end == reader.fileSize())) ) {
+            end = offset;
+            break;  // the step might not be completely written yet
         }
-        it++;
+        std::vector<int> seqnum;
+        reader.blockContent( seqnum, *prev );
+        if( seqnum.size() < 1 ) {
+            throw std::runtime_error( "SEQNUM too small" );
+        }
+        auto first = prev;
+        first++;
+        parseRestartStep( report_steps,
+                          reader,
+                          first,
+                          next,
+                          active_cells,
+                          seqnum[0] );
+        auto last = next;
+        last--;
+        end = last->m_offset + last->m_size;
+        known = false;
+        prev = next;
     }
+    LOGGER_DEBUG( log, "Found " << report_steps.size() << " appended report steps in " << path );
+    return end < reader.fileSize();
+}
 
-    if( it != blocks.end() && it->m_keyword == KEYWORD_MAPAXES ) {
-        it++;
-    }
+void
+parseRestartStep( std::list<ReportStep>&      report_steps,
+                  const ReportStepBlocks&     step_blocks,
+                  const utils::ActiveCells&   active_cells,
+                  const std::string&          path )
+{
+    Reader reader( path );
+    parseRestartStep( report_steps,
+                      reader,
+                      step_blocks.m_blocks.begin(),
+                      step_blocks.m_blocks.end(),
+                      active_cells,
+                      step_blocks.m_sequence_number );
+}
 
-    if( it != blocks.end() && it->m_keyword == KEYWORD_GRIDUNIT ) {
-        it++;
-    }
 
 
-    if( it != blocks.end() && it->m_keyword == KEYWORD_GRIDHEAD ) {
+/** Parse the GRIDHEAD, COORD, ZCORN, ACTNUM and HOSTNUM blocks of a grid.
+  *
+  * Shared by the global grid and the local grids of an EGRID file.
+  *
+  * \param[in,out] it       Iterator to the GRIDHEAD block, on return
+  *                         positioned at the first block after the grid.
+  * \param[out]    hostnum  If non-NULL, a HOSTNUM block is required and
+  *                         its contents are stored here.
+  */
+template<typename REAL>
+static
+void
+parseGrid( unsigned int&                       nx,
+           unsigned int&                       ny,
+           unsigned int&                       nz,
+           unsigned int&                       nr,
+           std::vector<REAL>&                  coord,
+           std::vector<REAL>&                  zcorn,
+           utils::ActiveCells&                 active_cells,
+           std::vector<int>*                   hostnum,
+           Properties&                         properties,
+           Reader&                             reader,
+           std::list<Block>::const_iterator&   it,
+           const std::list<Block>::const_iterator& end,
+           Logger&                             log )
+{
+    if( it != end && it->m_keyword == KEYWORD_GRIDHEAD ) {
         std::vector<int> gridhead;
         reader.blockContent( gridhead, *it++ );
         if( gridhead.size() < 100 ) {
@@ -594,7 +801,7 @@ parseEGrid( unsigned int&               nx,
             properties["upper_j"] = gridhead[31];
             properties["upper_k"] = gridhead[32];
 
-            if( it != blocks.end() && it->m_keyword == KEYWORD_BOXORIG ) {
+            if( it != end && it->m_keyword == KEYWORD_BOXORIG ) {
                 std::vector<int> boxorig;
                 reader.blockContent( boxorig, *it++ );
 
@@ -604,10 +811,9 @@ parseEGrid( unsigned int&               nx,
                 properties[ "boxorig_i"] = boxorig[0];
                 properties[ "boxorig_j"] = boxorig[1];
                 properties[ "boxorig_k"] = boxorig[2];
-                it++;
             }
 
-            if( it != blocks.end() && it->m_keyword == KEYWORD_COORD ) {
+            if( it != end && it->m_keyword == KEYWORD_COORD ) {
                 reader.blockContent( coord, *it++ );
 
                 if( coord.size() != 6*(ny+1)*(nx+1)*nr ) {
@@ -618,11 +824,11 @@ parseEGrid( unsigned int&               nx,
                 throw std::runtime_error( "expected COORD" );
             }
 
-            if( it != blocks.end() && it->m_keyword == KEYWORD_COORDSYS ) {
+            if( it != end && it->m_keyword == KEYWORD_COORDSYS ) {
                 it++;
             }
 
-            if( it != blocks.end() && it->m_keyword == KEYWORD_ZCORN ) {
+            if( it != end && it->m_keyword == KEYWORD_ZCORN ) {
                 reader.blockContent( zcorn, *it++ );
                 if( zcorn.size() != 2*nx*2*ny*2*nz ) {
                     throw std::runtime_error( "ZCORN of illegal size" );
@@ -632,51 +838,176 @@ parseEGrid( unsigned int&               nx,
                 throw std::runtime_error( "expected ZCORN" );
             }
 
-            if( it != blocks.end() && it->m_keyword == KEYWORD_ACTNUM ) {
+            if( it != end && it->m_keyword == KEYWORD_ACTNUM ) {
                 if( it->m_count == 0 ) {
                     LOGGER_WARN( log, "Encountered ACTNUM with no entries, assuming all blocks are active." );
-                    actnum.resize( nx*ny*nz );
-                    for(size_t i=0; i<actnum.size(); i++ ) {
-                        actnum[i] = (i+1);
-                    }
+                    active_cells.fill( nx*ny*nz );
+                    it++;
                 }
                 else {
-                    reader.blockContent( actnum, *it++ );
-                    if( actnum.size() != nx*ny*nz ) {
+                    reader.blockContent( active_cells, *it++ );
+                    if( active_cells.size() != nx*ny*nz ) {
                         throw std::runtime_error( "ACTNUM of illegal size" );
                     }
                 }
             }
             else {
-                actnum.resize( nx*ny*nz );
-                std::fill( actnum.begin(), actnum.end(), 1 );
+                active_cells.fill( nx*ny*nz );
             }
 
-            if( it != blocks.end() && it->m_keyword == KEYWORD_CORSNUM ) {
+            if( it != end && it->m_keyword == KEYWORD_CORSNUM ) {
                 it++;
             }
 
-            if( it != blocks.end() && it->m_keyword == KEYWORD_HOSTNUM ) {
+            if( it != end && it->m_keyword == KEYWORD_HOSTNUM ) {
+                if( hostnum != NULL ) {
+                    reader.blockContent( *hostnum, *it );
+                    if( hostnum->size() != nx*ny*nz ) {
+                        throw std::runtime_error( "HOSTNUM of illegal size" );
+                    }
+                }
                 it++;
             }
+            else if( hostnum != NULL ) {
+                throw std::runtime_error( "expected HOSTNUM" );
+            }
 
         }
         else {
             throw std::runtime_error( "unsupported grid type" );
         }
+    }
+    else {
+        throw std::runtime_error( "expected GRIDHEAD" );
+    }
+}
+
+template<typename REAL>
+void
+parseEGrid( unsigned int&               nx,
+            unsigned int&               ny,
+            unsigned int&               nz,
+            unsigned int&               nr,
+            std::vector<REAL>&          coord,
+            std::vector<REAL>&          zcorn,
+            utils::ActiveCells&         active_cells,
+            Properties&                 properties,
+            const std::string&          path,
+            std::vector< LocalGrid<REAL> >* local_grids )
+{
+    Logger log = getLogger( "Eclipse.parseEGrid" );
+    Reader reader( path );
+    const list<Block> blocks = reader.blocks();
 
 
+    auto it = blocks.cbegin();
+
+    int grid_type;
+
+    // FILEHEAD
+    if( it != blocks.end() && it->m_keyword == KEYWORD_FILEHEAD ) {
+        vector<int> filehead;
+        reader.blockContent( filehead, *it );
+        if( filehead.size() < 6 ) {
+            throw std::runtime_error( "FILEHEAD too small" );
+        }
 
+        properties["version_number"]          = filehead[0];
+        properties["release_year"]            = filehead[1];
+        properties["backwards_compatibility"] = filehead[3];
 
+        grid_type = filehead[4];
+        switch( grid_type ) {
+        case 0:
+            properties["grid_type"] = "corner_point";
+            break;
+        case 1:
+            properties["grid_type"] = "unstructured";
+            break;
+        case 2:
+            properties["grid_type"] = "hybrid";
+            break;
+        default:
+            throw std::runtime_error( "unknown grid type" );
+        }
+        switch( filehead[5] ) {
+        case 0:
+            properties["single_porosity"] = 1;
+            break;
+        case 1:
+            properties["dual_porosity"] = 1;
+            break;
+        case 2:
+            properties["dual_permeability"] = 1;
+            break;
+        default:
+            throw std::runtime_error( "unknown porosity" );
+        }
         it++;
     }
     else {
-        throw std::runtime_error( "expected GRIDHEAD" );
+        throw std::runtime_error( "expected FILEHEAD" );
+    }
+
+    if( it != blocks.end() && it->m_keyword == KEYWORD_MAPUNITS ) {
+        std::vector<std::string> mapunits;
+        reader.blockContent( mapunits, *it );
+        if( mapunits.size() < 1 ) {
+            throw std::runtime_error( "MAPUNITS too small" );
+        }
+        size_t np = mapunits[0].find_last_not_of( ' ' );
+        if( np != std::string::npos ) {
+            properties["map_units"] = mapunits[0].substr(0, np+1 );
+        }
+        it++;
+    }
+
+    if( it != blocks.end() && it->m_keyword == KEYWORD_MAPAXES ) {
+        it++;
+    }
+
+    if( it != blocks.end() && it->m_keyword == KEYWORD_GRIDUNIT ) {
+        it++;
+    }
+
+
+    parseGrid( nx, ny, nz, nr, coord, zcorn, active_cells, NULL,
+               properties, reader, it, blocks.cend(), log );
+
+    if( local_grids == NULL ) {
+        return;
+    }
+    local_grids->clear();
+    while( it != blocks.cend() ) {
+        if( it->m_keyword != KEYWORD_LGR ) {
+            it++;
+            continue;
+        }
+        local_grids->push_back( LocalGrid<REAL>() );
+        LocalGrid<REAL>& lgr = local_grids->back();
+        lgr.m_name = localGridName( reader, *it++ );
+        while( it != blocks.cend() && it->m_keyword != KEYWORD_GRIDHEAD && it->m_keyword != KEYWORD_ENDLGR ) {
+            it++;
+        }
+
+        Properties lgr_properties;
+        parseGrid( lgr.m_nx, lgr.m_ny, lgr.m_nz, lgr.m_nr,
+                   lgr.m_coord, lgr.m_zcorn, lgr.m_active_cells, &lgr.m_hostnum,
+                   lgr_properties, reader, it, blocks.cend(), log );
+
+        const int host_cells = nx*ny*nz;
+        for( size_t i=0; i<lgr.m_hostnum.size(); i++ ) {
+            if( (lgr.m_hostnum[i] < 1) || (host_cells < lgr.m_hostnum[i]) ) {
+                throw std::runtime_error( "HOSTNUM of LGR '" + lgr.m_name + "' out of range" );
+            }
+        }
+        LOGGER_DEBUG( log, "LGR '" << lgr.m_name << "' of size "
+                      << lgr.m_nx << "x" << lgr.m_ny << "x" << lgr.m_nz );
     }
 }
 
-template void parseEGrid( unsigned int&, unsigned int&, unsigned int&, unsigned int&, std::vector<float>&, std::vector<float>&, std::vector<int>&, Properties&, const std::string& );
-template void parseEGrid( unsigned int&, unsigned int&, unsigned int&, unsigned int&, std::vector<double>&, std::vector<double>&, std::vector<int>&, Properties&, const std::string& );
+template void parseEGrid( unsigned int&, unsigned int&, unsigned int&, unsigned int&, std::vector<float>&, std::vector<float>&, utils::ActiveCells&, Properties&, const std::string&, std::vector< LocalGrid<float> >* );
+template void parseEGrid( unsigned int&, unsigned int&, unsigned int&, unsigned int&, std::vector<double>&, std::vector<double>&, utils::ActiveCells&, Properties&, const std::string&, std::vector< LocalGrid<double> >* );
 
 
 
@@ -20,6 +20,7 @@
 #include <vector>
 #include <list>
 #include "Eclipse.hpp"
+#include "utils/ActiveCells.hpp"
 
 namespace eclipse {
 
@@ -80,27 +81,114 @@ namespace eclipse {
 
 
 
+/** A local grid refinement (LGR) of an EGRID file.
+  *
+  * A cornerpoint grid of its own, where each cell lies within a host cell of
+  * the global grid.
+  */
 template<typename REAL>
+struct LocalGrid {
+    std::string             m_name;         ///< Name of the LGR, from LGR.
+    unsigned int            m_nx;
+    unsigned int            m_ny;
+    unsigned int            m_nz;
+    unsigned int            m_nr;
+    std::vector<REAL>       m_coord;
+    std::vector<REAL>       m_zcorn;
+    utils::ActiveCells      m_active_cells; ///< Active cells, from ACTNUM.
+    std::vector<int>        m_hostnum;      ///< Global cell index (one-based) of the host of each cell, from HOSTNUM.
+};
+
+/** Parse an EGRID file.
+  *
+  * \param[out] local_grids  If not NULL, the LGRs that follow the global
+  *                          grid are parsed into this, otherwise skipped.
+  * \throws std::runtime_error On malformed files.
+  */
+template<typename REAL>
+void
+parseEGrid( unsigned int&                       nx,
+            unsigned int&                       ny,
+            unsigned int&                       nz,
+            unsigned int&                       nr,
+            std::vector<REAL>&                  coord,
+            std::vector<REAL>&                  zcorn,
+            utils::ActiveCells&                 active_cells,
+            Properties&                         properties,
+            const std::string&                  path,
+            std::vector< LocalGrid<REAL> >*     local_grids = NULL );
+
 void
-parseEGrid( unsigned int&               nx,
-            unsigned int&               ny,
-            unsigned int&               nz,
-            unsigned int&               nr,
-            std::vector<REAL>&          coord,
-            std::vector<REAL>&          zcorn,
-            std::vector<int>&           actnum,
-            Properties&                 properties,
-            const std::string&          path );
+parseRestartFile( std::list<ReportStep>&      report_steps,
+                  const utils::ActiveCells&   active_cells,
+                  const std::string&          path );
 
 void
-parseRestartFile( std::list<ReportStep>&  report_steps,
-                  const std::vector<int>& actnum,
-                  const std::string&      path );
+parseUnifiedRestartFile( std::list<ReportStep>&      report_steps,
+                         const utils::ActiveCells&   active_cells,
+                         const std::string&          path );
+
+/** Index the report steps of a unified restart file without parsing them.
+  *
+  * Only the SEQNUM, INTEHEAD and ZWEL blocks are read, the solutions of each
+  * step are found from the block headers. The well names are read so that
+  * wells can be numbered up front, independent of the order in which the
+  * steps are parsed later.
+  *
+  * \param[out] report_steps  One report step per SEQNUM, with sequence
+  *                           number and solutions, but without date, wells
+  *                           and properties.
+  * \param[out] step_blocks   The blocks of each report step, to be passed
+  *                           to parseRestartStep when the step is needed.
+  * \param[in]  path          Path of the unified restart file.
+  * \throws std::runtime_error On malformed files.
+  */
+void
+indexUnifiedRestartFile( std::list<ReportStep>&         report_steps,
+                         std::list<ReportStepBlocks>&   step_blocks,
+                         const std::string&             path );
+
+/** Parse the report steps appended to a unified restart file.
+  *
+  * Reading starts at the SEQNUM of the last step already known, since the
+  * simulator may still append solutions to it. That step is parsed again
+  * whenever blocks were appended after end, and is meant to be merged with
+  * the known step of the same sequence number. A new report step is
+  * complete when the next SEQNUM has been written, or, if accept_last is
+  * true, when the file ends after its last block.
+  *
+  * \param[out]    report_steps  The last known step followed by the new
+  *                              complete steps, in file order. Empty if
+  *                              nothing was appended after end.
+  * \param[in,out] offset        Offset of the header of the SEQNUM that
+  *                              starts the last step, updated to the start
+  *                              of the last step returned.
+  * \param[in,out] end           End of the blocks processed so far. The
+  *                              step at offset is known if end > offset.
+  * \param[in]     active_cells  Active cells of the grid.
+  * \param[in]     path          Path of the unified restart file.
+  * \param[in]     accept_last   Consider the last step complete, used when
+  *                              the file has stopped growing.
+  * \returns True if there are bytes past end that were not consumed.
+  * \throws std::runtime_error On malformed files.
+  */
+bool
+parseAppendedRestartSteps( std::list<ReportStep>&      report_steps,
+                           size_t&                     offset,
+                           size_t&                     end,
+                           const utils::ActiveCells&   active_cells,
+                           const std::string&          path,
+                           const bool                  accept_last );
 
+/** Parse a single report step previously located by indexUnifiedRestartFile.
+  *
+  * \throws std::runtime_error On malformed files.
+  */
 void
-parseUnifiedRestartFile( std::list<ReportStep>&  report_steps,
-                         const std::vector<int>& actnum,
-                         const std::string&      path );
+parseRestartStep( std::list<ReportStep>&      report_steps,
+                  const ReportStepBlocks&     step_blocks,
+                  const utils::ActiveCells&   active_cells,
+                  const std::string&          path );
 
 
 } // of namespace Eclipse
@@ -24,17 +24,15 @@
 #include <ctype.h>
 #include <cstring>
 #include <limits>
+#include <algorithm>
+#include <boost/shared_ptr.hpp>
 #include "utils/Logger.hpp"
 #include "utils/PerfTimer.hpp"
+#include "utils/ThreadPool.hpp"
+#include "utils/ActiveCells.hpp"
 #include "EclipseReader.hpp"
-#ifdef __SSE2__
-#include <xmmintrin.h>
-/*#warning "Using SSE2 intrinsics"*/
-#endif
-#ifdef __SSSE3__
-#include <tmmintrin.h>
-/*#warning "Using SSSE3 intrinsics"*/
-#endif
+#include "EclipseKernels.hpp"
+#include "EclipseFormatted.hpp"
 
 namespace eclipse {
 
@@ -42,129 +40,21 @@ using std::string;
 using std::vector;
 using std::list;
 
-// --- SSE2 Helpers ------------------------------------------------------------
-#ifdef __SSE2__
-static __m128i endianSwap32( const __m128i byte_mask, const __m128i value )
-__attribute__((always_inline,const,pure));
+/** Files smaller than this are scanned serially. */
+static const size_t parallel_scan_threshold = 64u*1024u*1024u;
 
-/** Swap endianness of four 32-bit values stored in an SSE register. */
+/** Blocks closer than this are read as one range by blockContents(). */
+static const size_t coalesce_gap = 1024u*1024u;
 
-static __m128i endianSwap32( const __m128i byte_mask,
-                             const __m128i value )
-{
-#ifdef __SSSE3__
-    // SSSE3 has a byte-shuffle instruction which does everything.
-    return _mm_shuffle_epi8( value, byte_mask );
-#else
-    // On SSE2, we swap bytes using masks and shifts, and then swap words using
-    // shuffle on the high and low quadwords.
-    __m128i u = _mm_srli_si128( _mm_and_si128( byte_mask, value ), 1 );
-    __m128i l = _mm_and_si128( byte_mask, _mm_slli_si128( value, 1 ) );
-    __m128i r = _mm_or_si128( u, l );
-    r = _mm_shufflehi_epi16( r, _MM_SHUFFLE(2, 3, 0, 1) );
-    r = _mm_shufflelo_epi16( r, _MM_SHUFFLE(2, 3, 0, 1) );
-    return r;
-#endif
-}
-
-/** Copies 20 floats from aligned src to aligned dst, finding min and max. */
-template<unsigned int shift> static void copy32x20s( __m128i*           out,
-                                                     __m128&            minimum,
-                                                     __m128&            maximum,
-                                                     const __m128i*     in,
-                                                     const __m128i      bytemask,
-                                                     const unsigned int qws5 )
-__attribute__((always_inline,hot));
-
-template<unsigned int shift> static void copy32x20s( __m128i*           out,
-                                                     __m128&            minimum,
-                                                     __m128&            maximum,
-                                                     const __m128i*     in,
-                                                     const __m128i      bytemask,
-                                                     const unsigned int qws5 )
-{
-    const unsigned int rshift = 4*shift;
-    const unsigned int lshift = 16-rshift;
-    __m128i rem = endianSwap32( bytemask, _mm_srli_si128( _mm_load_si128( in++ ), rshift ) );
-
-    for(size_t i=0; i<qws5; i++) {
-        __m128i a1 = endianSwap32( bytemask, _mm_load_si128( in++ ) );
-        __m128i a3 = endianSwap32( bytemask, _mm_load_si128( in++ ) );
-        __m128i a5 = endianSwap32( bytemask, _mm_load_si128( in++ ) );
-        __m128i a7 = endianSwap32( bytemask, _mm_load_si128( in++ ) );
-        __m128i a9 = endianSwap32( bytemask, _mm_load_si128( in++ ) );
-//        _mm_prefetch( in+5, _MM_HINT_T0 );
-
-        __m128i a0 = _mm_or_si128( rem,
-                                   _mm_slli_si128( a1, lshift ) );
-        __m128i a2 = _mm_or_si128( _mm_srli_si128( a1, rshift ),
-                                   _mm_slli_si128( a3, lshift ) );
-        __m128i a4 = _mm_or_si128( _mm_srli_si128( a3, rshift ),
-                                   _mm_slli_si128( a5, lshift ) );
-        __m128i a6 = _mm_or_si128( _mm_srli_si128( a5, rshift ),
-                                   _mm_slli_si128( a7, lshift ) );
-        __m128i a8 = _mm_or_si128( _mm_srli_si128( a7, rshift ),
-                                   _mm_slli_si128( a9, lshift ) );
-
-        minimum = _mm_min_ps( minimum, _mm_castsi128_ps(a0) );
-        minimum = _mm_min_ps( minimum, _mm_castsi128_ps(a2) );
-        minimum = _mm_min_ps( minimum, _mm_castsi128_ps(a4) );
-        minimum = _mm_min_ps( minimum, _mm_castsi128_ps(a6) );
-        minimum = _mm_min_ps( minimum, _mm_castsi128_ps(a8) );
-        maximum = _mm_max_ps( maximum, _mm_castsi128_ps(a0) );
-        maximum = _mm_max_ps( maximum, _mm_castsi128_ps(a2) );
-        maximum = _mm_max_ps( maximum, _mm_castsi128_ps(a4) );
-        maximum = _mm_max_ps( maximum, _mm_castsi128_ps(a6) );
-        maximum = _mm_max_ps( maximum, _mm_castsi128_ps(a8) );
-
-        _mm_stream_si128( out++, a0 );
-        _mm_stream_si128( out++, a2 );
-        _mm_stream_si128( out++, a4 );
-        _mm_stream_si128( out++, a6 );
-        _mm_stream_si128( out++, a8 );
-        rem = _mm_srli_si128( a9, rshift );
-    }
-}
-
-template<> void copy32x20s<0>( __m128i* out,
-                                __m128& minimum,
-                                __m128& maximum,
-                                const __m128i* in,
-                                const __m128i bytemask,
-                                const unsigned int qws5 )
-{
-    for(size_t i=0; i<qws5; i++) {
-        __m128i in0 = endianSwap32( bytemask, _mm_load_si128( in++ ) );
-        __m128i in1 = endianSwap32( bytemask, _mm_load_si128( in++ ) );
-        __m128i in2 = endianSwap32( bytemask, _mm_load_si128( in++ ) );
-        __m128i in3 = endianSwap32( bytemask, _mm_load_si128( in++ ) );
-        __m128i in4 = endianSwap32( bytemask, _mm_load_si128( in++ ) );
-//        _mm_prefetch( in+5, _MM_HINT_T0 );
-        minimum = _mm_min_ps( minimum, _mm_castsi128_ps(in0) );
-        minimum = _mm_min_ps( minimum, _mm_castsi128_ps(in1) );
-        minimum = _mm_min_ps( minimum, _mm_castsi128_ps(in2) );
-        minimum = _mm_min_ps( minimum, _mm_castsi128_ps(in3) );
-        minimum = _mm_min_ps( minimum, _mm_castsi128_ps(in4) );
-        maximum = _mm_max_ps( maximum, _mm_castsi128_ps(in0) );
-        maximum = _mm_max_ps( maximum, _mm_castsi128_ps(in1) );
-        maximum = _mm_max_ps( maximum, _mm_castsi128_ps(in2) );
-        maximum = _mm_max_ps( maximum, _mm_castsi128_ps(in3) );
-        maximum = _mm_max_ps( maximum, _mm_castsi128_ps(in4) );
-        _mm_stream_si128( out++, in0 );
-        _mm_stream_si128( out++, in1 );
-        _mm_stream_si128( out++, in2 );
-        _mm_stream_si128( out++, in3 );
-        _mm_stream_si128( out++, in4 );
-    }
-}
-#endif
-// -----------------------------------------------------------------------------
 
 
 
 Reader::Reader(const std::string &path)
     : m_path(path),
-      m_fd(-1)
+      m_fd(-1),
+      m_file_map( NULL ),
+      m_file_map_failed( false ),
+      m_formatted( false )
 {
     m_fd = open( m_path.c_str(), O_RDONLY );
     if( m_fd < 0 ) {
@@ -182,6 +72,17 @@ Reader::Reader(const std::string &path)
 
     m_pagesize = sysconf( _SC_PAGE_SIZE );
 
+    // Identify this version of the file for the persistent block index.
+    unsigned char header[4096];
+    ssize_t header_n = pread( m_fd, header, std::min( sizeof(header), m_filesize ), 0 );
+    m_index_key.m_filesize    = m_filesize;
+    m_index_key.m_mtime_sec   = finfo.st_mtim.tv_sec;
+    m_index_key.m_mtime_nsec  = finfo.st_mtim.tv_nsec;
+    m_index_key.m_header_hash = BlockIndex::hash( header, header_n > 0 ? header_n : 0 );
+
+    // Unformatted files start with a record size, formatted with a quote.
+    m_formatted = formatted::isFormatted( header, header_n > 0 ? header_n : 0 );
+
     //Logger log = getLogger( "Eclipse.Reader.Reader" );
     //LOGGER_DEBUG( log, "page size = " << m_pagesize << " bytes" );
 }
@@ -194,6 +95,7 @@ Reader::~Reader()
 void
 Reader::cleanup()
 {
+    unmapFile();
     if( m_fd >= 0 ) {
         close( m_fd );
         m_fd = -1;
@@ -207,13 +109,308 @@ Reader::blocks()
         throw std::runtime_error( "object in invalid state" );
     }
 
-    Logger log = getLogger( "Eclipse.Reader.blocks" );
     list<Block> blocks;
+    if( BlockIndex::load( blocks, m_seqnum_blocks, m_path, m_index_key ) ) {
+        return blocks;
+    }
+
+    blocks = scanBlocks();
+
+    m_seqnum_blocks.clear();
+    size_t i = 0;
+    for( auto it=blocks.begin(); it!=blocks.end(); ++it, ++i ) {
+        if( it->m_keyword == KEYWORD_SEQNUM ) {
+            m_seqnum_blocks.push_back( i );
+        }
+    }
+    if( blocks.size() >= BlockIndex::minimum_blocks ) {
+        BlockIndex::store( m_path, m_index_key, blocks, m_seqnum_blocks );
+    }
+    return blocks;
+}
+
+size_t
+Reader::appendedBlocks( list<Block>& blocks, size_t offset )
+{
+    if( m_fd < 0 ) {
+        throw std::runtime_error( "object in invalid state" );
+    }
+    if( m_formatted ) {
+        throw std::runtime_error( "appending to formatted files is not supported" );
+    }
+    // A block is the header record (4+16+4 bytes) followed by its data records.
+    while( offset + 24 <= m_filesize ) {
+        char head[16];
+        ssize_t n = pread( m_fd, head, 16, offset + 4 );
+        if( n == -1 ) {
+            if( errno == EINTR ) {
+                continue;
+            }
+            string error(strerror(errno));
+            throw std::runtime_error( "pread() failed: " + error );
+        }
+        else if( n != 16 ) {
+            break;
+        }
+        Block block;
+        parseBlockHeader( block, head, offset + 4 );
+        if( block.m_offset + block.m_size > m_filesize ) {
+            break;  // still being written
+        }
+        blocks.push_back( block );
+        offset = block.m_offset + block.m_size;
+    }
+    return offset;
+}
+
+const unsigned char*
+Reader::mapFile()
+{
+    if( (m_file_map == NULL) && !m_file_map_failed && (m_fd >= 0) && (m_filesize > 0) ) {
+        void* map = mmap( NULL, m_filesize, PROT_READ, MAP_PRIVATE | MAP_NORESERVE, m_fd, 0 );
+        if( map == MAP_FAILED ) {
+            Logger log = getLogger( "Eclipse.Reader.mapFile" );
+            LOGGER_WARN( log, "mmap() of whole file failed, mapping per block: " << strerror(errno) );
+            m_file_map_failed = true;
+        }
+        else {
+            m_file_map = static_cast<unsigned char*>( map );
+        }
+    }
+    return m_file_map;
+}
+
+void
+Reader::unmapFile()
+{
+    if( m_file_map != NULL ) {
+        if( munmap( m_file_map, m_filesize ) != 0 ) {
+            Logger log = getLogger( "Eclipse.Reader.unmapFile" );
+            LOGGER_ERROR( log, "munmap failed: " << strerror( errno ) );
+        }
+        m_file_map = NULL;
+    }
+}
+
+void
+Reader::prefetch( const Block& block )
+{
+    if( (m_fd < 0) || (block.m_offset + block.m_size > m_filesize) ) {
+        return;
+    }
+    size_t page_start = (block.m_offset / m_pagesize) * m_pagesize;
+    size_t length = block.m_offset + block.m_size - page_start;
+
+    if( m_file_map != NULL ) {
+        if( madvise( m_file_map + page_start, length, MADV_WILLNEED ) != 0 ) {
+            Logger log = getLogger( "Eclipse.Reader.prefetch" );
+            LOGGER_WARN( log, "madvice() failed: " << strerror(errno) );
+        }
+    }
+    else {
+        int rv = posix_fadvise( m_fd, page_start, length, POSIX_FADV_WILLNEED );
+        if( rv != 0 ) {
+            Logger log = getLogger( "Eclipse.Reader.prefetch" );
+            LOGGER_WARN( log, "posix_fadvise() failed: " << strerror(rv) );
+        }
+    }
+}
+
+void
+Reader::parseBlockHeader( Block& block, const char* head, size_t offset )
+{
+    // Header:
+    // - size of record (int, 4 bytes)
+    // - chunk keyword (chars, 8 bytes)
+    // - number of elements in block (int, 4 bytes)
+    // - data type of elements in block (chars, 4 bytes)
+    // - size of record repeated (int, 4 bytes)
+
+    memcpy( block.m_keyword_string, head, 8 );
+    block.m_keyword = keyword( head );
+    //if( block.m_keyword == KEYWORD_UNKNOWN ) {
+    //    LOGGER_DEBUG( log, "'" << string( head, head+8 ) << "'" );
+    //}
+    block.m_count =
+            0x01000000u*(unsigned int)(((unsigned char*)head)[8+0]) +
+            0x00010000u*(unsigned int)(((unsigned char*)head)[8+1]) +
+            0x00000100u*(unsigned int)(((unsigned char*)head)[8+2]) +
+            0x00000001u*(unsigned int)(((unsigned char*)head)[8+3]);
+
+    if( strncmp( "INTE", head+12, 4 ) == 0 ) {
+        block.m_datatype    = TYPE_INTEGER;
+        block.m_typesize    = 4;
+        block.m_record_size = 1000;
+    }
+    else if( strncmp( "REAL", head+12, 4 ) == 0 ) {
+        block.m_datatype    = TYPE_FLOAT;
+        block.m_typesize    = 4;
+        block.m_record_size = 1000;
+    }
+    else if( strncmp( "LOGI", head+12, 4 ) == 0) {
+        block.m_datatype    = TYPE_BOOL;
+        block.m_typesize    = 4;
+        block.m_record_size = 1000;
+    }
+    else if( strncmp( "DOUB", head+12, 4  ) == 0 ) {
+        block.m_datatype    = TYPE_DOUBLE;
+        block.m_typesize    = 8;
+        block.m_record_size = 1000;
+    }
+    else if( strncmp( "CHAR", head+12, 4  ) == 0 ) {
+        block.m_datatype    = TYPE_STRING;
+        block.m_typesize    = 8;
+        block.m_record_size = 105;
+    }
+    else if( strncmp( "MESS", head+12, 4  ) == 0 ) {
+        block.m_datatype    = TYPE_MESSAGE;
+        block.m_typesize    = 8;
+        block.m_record_size = 105;
+    }
+    else if( (strncmp( "C0", head+12, 2 ) == 0 ) &&
+             isdigit( head[ 14 ] ) &&
+             isdigit( head[ 15 ] ) )
+    {
+        block.m_datatype    = TYPE_STRING;
+        block.m_typesize    = (head[14]-'0')*10 + (head[15]-'0');
+        block.m_record_size = 105;
+    }
+    else {
+        throw std::runtime_error( "unknown type '" + string( head+12, head+16 ) + "'" );
+    }
+    block.m_offset = offset + 16 + 4;
+    block.m_records = (block.m_count + block.m_record_size - 1)/block.m_record_size;
+    block.m_size = 8*block.m_records                // records head and tail
+                 + block.m_count*block.m_typesize;  // block data contents
+}
+
+bool
+Reader::scanRange( list<Block>&           blocks,
+                   const unsigned char*   bytes,
+                   size_t                 begin,
+                   size_t                 end )
+{
+    size_t offset = begin;
+    while( offset < end ) {
+        if( offset + 16 > m_filesize ) {
+            throw std::runtime_error( "premature end of file" );
+        }
+        Block block;
+        parseBlockHeader( block, reinterpret_cast<const char*>( bytes + offset ), offset );
+        offset += 24 + block.m_size;
+        blocks.push_back( block );
+    }
+    return offset == end;
+}
+
+bool
+Reader::scanSegments( list<Block>& blocks, const unsigned char* bytes )
+{
+    Logger log = getLogger( "Eclipse.Reader.scanSegments" );
+
+    // A SEQNUM header is the record size (16, big endian) followed by the
+    // keyword, which is a pattern that is unlikely to occur by chance, and
+    // the record tail must repeat the size. Segment starts are offsets of
+    // the header payload, as in scanRange.
+    static const unsigned char pattern[12] = { 0, 0, 0, 16,
+                                               'S', 'E', 'Q', 'N', 'U', 'M', ' ', ' ' };
+    static const unsigned char tail[4] = { 0, 0, 0, 16 };
+
+    utils::ThreadPool& pool = utils::ThreadPool::instance();
+    const size_t ranges = 4*pool.concurrency();
+    const size_t range_size = (m_filesize + ranges - 1)/ranges;
+
+    // Find the first SEQNUM header of each range.
+    vector<size_t> starts( ranges, ~(size_t)0 );
+    starts[0] = 4u;
+    pool.run( ranges-1, [&]( size_t t ) {
+        size_t r = t + 1;
+        size_t b = r*range_size;
+        size_t e = std::min( m_filesize, b + range_size + sizeof(pattern) - 1 );
+        if( b >= e ) {
+            return;
+        }
+        while( b < e ) {
+            const void* hit = memmem( bytes + b, e - b, pattern, sizeof(pattern) );
+            if( hit == NULL ) {
+                return;
+            }
+            const size_t h = reinterpret_cast<const unsigned char*>( hit ) - bytes;
+            if( (h + 24 <= m_filesize) && (memcmp( bytes + h + 20, tail, sizeof(tail) ) == 0) ) {
+                starts[r] = h + 4u;
+                return;
+            }
+            b = h + 1;
+        }
+    } );
+    vector<size_t> segments;
+    for( size_t r=0; r<ranges; r++ ) {
+        if( (starts[r] != ~(size_t)0) && (segments.empty() || (segments.back() < starts[r]) ) ) {
+            segments.push_back( starts[r] );
+        }
+    }
+    // Header payloads are preceeded by the 4-byte record size, so a scan of
+    // a complete file stops 4 bytes past its end.
+    segments.push_back( m_filesize + 4u );
+
+    // Walk each segment, a walk must end exactly where the next begins. A
+    // start found by chance inside block data may not parse at all.
+    const size_t N = segments.size()-1;
+    vector< list<Block> > segment_blocks( N );
+    vector<char> segment_ok( N, 0 );
+    pool.run( N, [&]( size_t s ) {
+        try {
+            segment_ok[s] = scanRange( segment_blocks[s], bytes, segments[s], segments[s+1] );
+        }
+        catch( std::runtime_error& ) {
+            segment_ok[s] = 0;
+        }
+    } );
+    for( size_t s=0; s<N; s++ ) {
+        if( !segment_ok[s] ) {
+            LOGGER_DEBUG( log, "Segment " << s << " at " << segments[s] << " misaligned, falling back to serial scan." );
+            return false;
+        }
+    }
+    for( size_t s=0; s<N; s++ ) {
+        blocks.splice( blocks.end(), segment_blocks[s] );
+    }
+    LOGGER_DEBUG( log, "Scanned " << N << " segments in parallel." );
+    return true;
+}
+
+list<Block>
+Reader::scanBlocks()
+{
+    Logger log = getLogger( "Eclipse.Reader.scanBlocks" );
+    list<Block> blocks;
+
+    if( m_formatted ) {
+        return scanFormattedBlocks();
+    }
 
+    const unsigned char* bytes = mapFile();
+    if( bytes != NULL ) {
+        PerfTimer start;
+        bool done = false;
+        if( (m_filesize >= parallel_scan_threshold) && (utils::ThreadPool::instance().concurrency() > 1) ) {
+            done = scanSegments( blocks, bytes );
+        }
+        if( !done ) {
+            blocks.clear();
+            if( !scanRange( blocks, bytes, 4u, m_filesize + 4u ) ) {
+                throw std::runtime_error( "premature end of file" );
+            }
+        }
+        PerfTimer stop;
+        LOGGER_DEBUG( log, "Found " << blocks.size() << " blocks ("
+                      << (1000.0*PerfTimer::delta( start, stop )) << "ms)" );
+        return blocks;
+    }
+
+    // Unable to map file, fall back to reading the headers.
     size_t offset = 4u;
     while( offset < m_filesize) {
-//        LOGGER_DEBUG( log, "checking at " << offset );
-
         // Seek to payload of block header
         off_t o = lseek( m_fd, offset, SEEK_SET );
         if( o == -1 ) {
@@ -226,14 +423,6 @@ Reader::blocks()
             throw std::runtime_error( "lseek() returned wrong offset" );
         }
 
-
-        // Header:
-        // - size of record (int, 4 bytes)
-        // - chunk keyword (chars, 8 bytes)
-        // - number of elements in block (int, 4 bytes)
-        // - data type of elements in block (chars, 4 bytes)
-        // - size of record repeated (int, 4 bytes)
-
         char head[16];
         ssize_t n = read( m_fd, head, 16 );
         if( n == -1 ) {
@@ -246,99 +435,101 @@ Reader::blocks()
             throw std::runtime_error( "premature end of file" );
         }
 
-        // Populate block
         Block block;
-        memcpy( block.m_keyword_string, head, 8 );
-        block.m_keyword = keyword( head );
-        //if( block.m_keyword == KEYWORD_UNKNOWN ) {
-        //    LOGGER_DEBUG( log, "'" << string( head, head+8 ) << "'" );
-        //}
-        block.m_count =
-                0x01000000u*(unsigned int)(((unsigned char*)head)[8+0]) +
-                0x00010000u*(unsigned int)(((unsigned char*)head)[8+1]) +
-                0x00000100u*(unsigned int)(((unsigned char*)head)[8+2]) +
-                0x00000001u*(unsigned int)(((unsigned char*)head)[8+3]);
-
-        if( strncmp( "INTE", head+12, 4 ) == 0 ) {
-            block.m_datatype    = TYPE_INTEGER;
-            block.m_typesize    = 4;
-            block.m_record_size = 1000;
-        }
-        else if( strncmp( "REAL", head+12, 4 ) == 0 ) {
-            block.m_datatype    = TYPE_FLOAT;
-            block.m_typesize    = 4;
-            block.m_record_size = 1000;
-        }
-        else if( strncmp( "LOGI", head+12, 4 ) == 0) {
-            block.m_datatype    = TYPE_BOOL;
-            block.m_typesize    = 4;
-            block.m_record_size = 1000;
-        }
-        else if( strncmp( "DOUB", head+12, 4  ) == 0 ) {
-            block.m_datatype    = TYPE_DOUBLE;
-            block.m_typesize    = 8;
-            block.m_record_size = 1000;
-        }
-        else if( strncmp( "CHAR", head+12, 4  ) == 0 ) {
-            block.m_datatype    = TYPE_STRING;
-            block.m_typesize    = 8;
-            block.m_record_size = 105;
-        }
-        else if( strncmp( "MESS", head+12, 4  ) == 0 ) {
-            block.m_datatype    = TYPE_MESSAGE;
-            block.m_typesize    = 8;
-            block.m_record_size = 105;
-        }
-        else if( (strncmp( "C0", head+12, 2 ) == 0 ) &&
-                 isdigit( head[ 14 ] ) &&
-                 isdigit( head[ 15 ] ) )
-        {
-            block.m_datatype    = TYPE_STRING;
-            block.m_typesize    = (head[14]-'0')*10 + (head[15]-'0');
-            block.m_record_size = 105;
-        }
-        else {
-            throw std::runtime_error( "unknown type '" + string( head+12, head+16 ) + "'" );
-        }
-        block.m_offset = offset + 16 + 4;
-        block.m_records = (block.m_count + block.m_record_size - 1)/block.m_record_size;
-        block.m_size = 8*block.m_records                // records head and tail
-                     + block.m_count*block.m_typesize;  // block data contents
-
+        parseBlockHeader( block, head, offset );
         offset += 24 + block.m_size;
 
 //        LOGGER_DEBUG( log, "keyword=" << keywordString(block.m_keyword) << ", next at " << offset );
 
         blocks.push_back( block );
-
     }
     return blocks;
 }
 
+list<Block>
+Reader::scanFormattedBlocks()
+{
+    Logger log = getLogger( "Eclipse.Reader.scanFormattedBlocks" );
+
+    Block file;
+    file.m_offset = 0;
+    file.m_size = m_filesize;
+    Map map( *this, file );
+
+    PerfTimer start;
+    vector<formatted::Header> headers;
+    formatted::scanHeaders( headers, reinterpret_cast<const char*>( map.bytes() ), m_filesize );
+
+    list<Block> blocks;
+    for( size_t i=0; i<headers.size(); i++ ) {
+        // Pass the header through the unformatted header parser, so that
+        // keywords and types are interpreted identically.
+        const formatted::Header& h = headers[i];
+        char head[16];
+        memcpy( head, h.m_keyword, 8 );
+        head[ 8] = (h.m_count >> 24u) & 0xffu;
+        head[ 9] = (h.m_count >> 16u) & 0xffu;
+        head[10] = (h.m_count >>  8u) & 0xffu;
+        head[11] = (h.m_count       ) & 0xffu;
+        memcpy( head + 12, h.m_type, 4 );
+
+        Block block;
+        parseBlockHeader( block, head, 0 );
+        block.m_offset = h.m_data;
+        block.m_size = ( i+1 < headers.size() ? headers[i+1].m_offset : m_filesize ) - h.m_data;
+        blocks.push_back( block );
+    }
+    PerfTimer stop;
+    LOGGER_DEBUG( log, "Found " << blocks.size() << " formatted blocks ("
+                  << (1000.0*PerfTimer::delta( start, stop )) << "ms)" );
+    return blocks;
+}
 
 
 Reader::Map::Map(Reader& parent, const Block& block)
-    : m_page( block.m_offset / parent.m_pagesize ),
-      m_page_start( m_page * parent.m_pagesize ),
-      m_page_offset( block.m_offset - m_page_start ),
-      m_bytes_to_map( m_page_offset + block.m_size )
+    : m_bytes_to_map( 0 ),
+      m_map( static_cast<unsigned char*>( MAP_FAILED ) ),
+      m_bytes( NULL )
 {
     static const std::string func = "Eclipse.Reader.Map.Map";
 
     if( parent.m_fd < 0 ) {
         throw std::runtime_error( func + ": Invalid file descriptor." );
     }
+    if( block.m_offset + block.m_size > parent.m_filesize ) {
+        throw std::runtime_error( func + ": Block extends beyond end of file." );
+    }
+
+    size_t page_start = (block.m_offset / parent.m_pagesize) * parent.m_pagesize;
+    size_t page_offset = block.m_offset - page_start;
+
+    const unsigned char* file = parent.mapFile();
+    if( file != NULL ) {
+        m_bytes = file + block.m_offset;
+
+        // hint to the kernel that we will read this range sequentially
+        if( madvise( const_cast<unsigned char*>( file ) + page_start,
+                     page_offset + block.m_size,
+                     MADV_SEQUENTIAL ) != 0 )
+        {
+            Logger log = getLogger( func );
+            LOGGER_WARN( log, "madvice() failed: " << strerror(errno) );
+        }
+        return;
+    }
 
+    m_bytes_to_map = page_offset + block.m_size;
     m_map = static_cast<unsigned char*>( mmap( NULL,
                                                m_bytes_to_map,
                                                PROT_READ,
                                                MAP_PRIVATE | MAP_NORESERVE,
                                                parent.m_fd,
-                                               m_page_start ) );
+                                               page_start ) );
     if( m_map == MAP_FAILED ) {
         std::string error(strerror(errno));
         throw std::runtime_error( func  + ": mmap() failed: " + error );
     }
+    m_bytes = m_map + page_offset;
 
     // hint to the kernel that we will read this memory sequentially
     if( madvise( m_map, m_bytes_to_map, MADV_SEQUENTIAL ) != 0 ) {
@@ -353,8 +544,8 @@ Reader::Map::~Map()
 
     if( m_map != MAP_FAILED ) {
         if( munmap( m_map, m_bytes_to_map ) != 0 ) {
-            std::string error( strerror( errno ) );
-            throw std::runtime_error( func + "; munmap failed: " + error );
+            Logger log = getLogger( func );
+            LOGGER_ERROR( log, "munmap failed: " << strerror( errno ) );
         }
     }
 }
@@ -373,22 +564,22 @@ Reader::blockContent( std::vector<bool>& content, const Block& block )
         if( block.m_datatype != TYPE_BOOL ) {
             throw std::runtime_error( func + ": Illegal block type: " + typeString(block.m_datatype) );
         }
-        content.resize( block.m_count );
         Map map( *this, block );
+        if( m_formatted ) {
+            const char* text = reinterpret_cast<const char*>( map.bytes() );
+            formatted::parseLogicals( content, text, text + block.m_size, block.m_count );
+            return;
+        }
 
-        static const size_t  elements_per_record = 1000u;
-
-        const unsigned int* src =  reinterpret_cast<const unsigned int*>( map.bytes() + 4 );   // first head
-        size_t elements_left = block.m_count;
+        // Logicals are 32-bit words where only zero is false, so they are
+        // decoded along with the set bits and expanded from those.
+        std::vector<int> words( block.m_count );
+        std::vector<uint64_t> bits( (block.m_count+63u)/64u, 0u );
+        kernels::int32ActiveRecords( kernels::best(), words.data(), map.bytes(), block.m_count, bits.data() );
 
-        size_t offset = 0u;
-        for( unsigned int r=0; r<block.m_records; r++ ) {
-            unsigned int n = std::min( elements_per_record, elements_left );
-            for( unsigned int i=0; i<n; i++ ) {
-                content[ offset++ ] = (*src++ != 0u);
-            }
-            src += 2; // skip record head and tail
-            elements_left -= elements_per_record;
+        content.resize( block.m_count );
+        for( size_t i=0; i<block.m_count; i++ ) {
+            content[i] = ((bits[ i>>6u ] >> (i&63u)) & 1u) != 0u;
         }
     }
     catch( std::runtime_error& e ) {
@@ -409,6 +600,11 @@ Reader::blockContent( std::vector<std::string>& content, const Block& block )
         }
         content.resize( block.m_count );
         Map map( *this, block );
+        if( m_formatted ) {
+            const char* text = reinterpret_cast<const char*>( map.bytes() );
+            formatted::parseStrings( content, text, text + block.m_size, block.m_count, block.m_typesize );
+            return;
+        }
 
         const unsigned char* src =  map.bytes() + 4;
         size_t elements_left = block.m_count;
@@ -447,33 +643,19 @@ Reader::blockContent( std::vector<int>& content, const Block& block )
 
         Map map( *this, block );
 
-        static const size_t  elements_per_record = 1000u;
-        int* dst = content.data();
-        const unsigned int* src =  reinterpret_cast<const unsigned int*>( map.bytes() + 4 );   // first head
-        size_t elements_left = block.m_count;
-
         PerfTimer start;
-        for( unsigned int r=0; r<block.m_records; r++ ) {
-            unsigned int n = std::min( elements_per_record, elements_left );
-            for( unsigned int i=0; i<n; i++ ) {
-                union {
-                    unsigned int    ui;
-                    int             i;
-                } v;
-                v.ui = *src++;
-#if LITTLE_ENDIAN
-                v.ui = ((v.ui >> 16u)&0x0000ffffu) | ((v.ui << 16u)&0xffff0000u);
-                v.ui = ((v.ui >> 8u )&0x00ff00ffu) | ((v.ui << 8u )&0xff00ff00u);
-#endif
-                *dst++ = v.i;
-            }
-            src += 2; // skip record head and tail
-            elements_left -= elements_per_record;
+        if( m_formatted ) {
+            const char* text = reinterpret_cast<const char*>( map.bytes() );
+            formatted::parseIntegers( content.data(), text, text + block.m_size, block.m_count );
+        }
+        else {
+            kernels::swap32Records( kernels::best(), content.data(), map.bytes(), block.m_count );
         }
         PerfTimer stop;
         double dt = PerfTimer::delta( start, stop );
         LOGGER_DEBUG( log, "invoked on " << typeString(block.m_datatype)
-                      << " (" << ((double)(block.m_count*sizeof(float))/dt)/(1024*1024) << " mb/s)" );
+                      << " (" << ((double)(block.m_count*sizeof(float))/dt)/(1024*1024) << " mb/s, "
+                      << kernels::best().m_name << ")" );
 
     }
     catch( std::runtime_error& e ) {
@@ -486,6 +668,47 @@ Reader::blockContent( std::vector<int>& content, const Block& block )
 
 
 
+void
+Reader::blockContent( utils::ActiveCells&   active,
+                      const Block&          block )
+{
+    static const std::string func = "Eclipse.Reader.blockContent.int.active";
+    Logger log = getLogger( func );
+    try {
+        if( block.m_datatype != TYPE_INTEGER ) {
+            throw std::runtime_error( func + ": Illegal block type: " + typeString(block.m_datatype) );
+        }
+        std::vector<int> content( block.m_count );
+        std::vector<uint64_t> bits( (block.m_count+63u)/64u, 0u );
+
+        Map map( *this, block );
+
+        PerfTimer start;
+        size_t count = 0;
+        if( m_formatted ) {
+            const char* text = reinterpret_cast<const char*>( map.bytes() );
+            formatted::parseIntegers( content.data(), text, text + block.m_size, block.m_count );
+            active.build( content.data(), block.m_count );
+            count = active.count();
+        }
+        else {
+            count = kernels::int32ActiveRecords( kernels::best(), content.data(), map.bytes(),
+                                                 block.m_count, bits.data() );
+            active.assign( bits, block.m_count );
+        }
+        PerfTimer stop;
+        double dt = PerfTimer::delta( start, stop );
+        LOGGER_DEBUG( log, "invoked on " << typeString(block.m_datatype)
+                      << ", " << count << " nonzero ("
+                      << ((double)(block.m_count*sizeof(int))/dt)/(1024*1024) << " mb/s, "
+                      << kernels::best().m_name << ")" );
+    }
+    catch( std::runtime_error& e ) {
+        cleanup();
+        throw e;
+    }
+}
+
 void
 Reader::blockContent( float*  __attribute__((aligned(16))) content,
                       float&                               minimum,
@@ -503,150 +726,101 @@ Reader::blockContent( float*  __attribute__((aligned(16))) content,
     }
 
     try {
+        if( (block.m_datatype != TYPE_FLOAT) && (block.m_datatype != TYPE_DOUBLE) ) {
+            throw std::runtime_error( func + ": Illegal block type: " + typeString(block.m_datatype) );
+        }
         Map map( *this, block );
-        if( block.m_datatype == TYPE_FLOAT ) {
-            static const size_t  elements_per_record = 1000u;
-
-            PerfTimer start;
-
-#ifdef __SSE2__
-            // sse2-optimized copy loop ----------------------------------------
-            __m128  min = _mm_set1_ps(  std::numeric_limits<float>::max() );
-            __m128  max = _mm_set1_ps( -std::numeric_limits<float>::max() );
-#ifdef __SSSE3__
-            static const __m128i bytemask = _mm_set_epi8( 12, 13, 14, 15,
-                                                          8, 9, 10, 11,
-                                                          4, 5, 6, 7,
-                                                          0, 1, 2, 3 );
-#else
-            static const __m128i bytemask = _mm_set1_epi32( 0xff00ff00u );
-#endif
-            __m128i* out = reinterpret_cast<__m128i*>( content );
-            size_t N = block.m_count;
-            unsigned int records = (N + elements_per_record - 1u)/elements_per_record;
-            const float* in_u = reinterpret_cast<const float*>( map.bytes() + 4 );
-            for(unsigned int r=0; r<records; r++ ) {
-                unsigned int shift = (reinterpret_cast<unsigned long int>( in_u )>>2)&0x3;
-                const __m128i* in = reinterpret_cast<const __m128i*>( in_u - shift );
-                unsigned int chunks = (r+1<records) ? elements_per_record/(4*5) : N/(4*5);
-                switch( shift ) {
-                case 0: copy32x20s<0>( out, min, max, in, bytemask, chunks ); break;
-                case 1: copy32x20s<1>( out, min, max, in, bytemask, chunks ); break;
-                case 2: copy32x20s<2>( out, min, max, in, bytemask, chunks ); break;
-                case 3: copy32x20s<3>( out, min, max, in, bytemask, chunks ); break;
-                }
-                out += 5*chunks;
-                in_u += 4*5*chunks+2;
-                N -= 4*5*chunks;
+        PerfTimer start;
+        decodeFloats( content, minimum, maximum, block, map.bytes() );
+        PerfTimer stop;
+        double dt = PerfTimer::delta( start, stop );
+        LOGGER_DEBUG( log, "invoked on " << typeString(block.m_datatype)
+                      << " (" << ((double)(block.m_count*block.m_typesize)/dt)/(1024*1024) << " mb/s, "
+                      << (m_formatted ? "formatted" : kernels::best().m_name) << ")" );
+    }
+    catch( std::runtime_error& e ) {
+        cleanup();
+        throw e;
+    }
+
+}
+
+void
+Reader::decodeFloats( float*                content,
+                      float&                minimum,
+                      float&                maximum,
+                      const Block&          block,
+                      const unsigned char*  bytes ) const
+{
+    if( m_formatted ) {
+        const char* text = reinterpret_cast<const char*>( bytes );
+        formatted::parseFloats( content, text, text + block.m_size, block.m_count, minimum, maximum );
+    }
+    else if( block.m_datatype == TYPE_FLOAT ) {
+        kernels::float32MinMaxRecords( kernels::best(), content, bytes, block.m_count, minimum, maximum );
+    }
+    else {
+        // Converted to float on the fly, no intermediate double buffer.
+        kernels::float64MinMaxRecords( kernels::best(), content, bytes, block.m_count, minimum, maximum );
+    }
+}
+
+void
+Reader::blockContents( std::vector<BlockRead>& reads )
+{
+    static const std::string func = "Eclipse.Reader.blockContents";
+    Logger log = getLogger( func );
+
+    try {
+        vector<size_t> order;
+        for( size_t i=0; i<reads.size(); i++ ) {
+            const Block& block = reads[i].m_block;
+            if( (block.m_datatype != TYPE_FLOAT) && (block.m_datatype != TYPE_DOUBLE) ) {
+                throw std::runtime_error( func + ": Illegal block type: " + typeString(block.m_datatype) );
             }
-            if( N > 0 ) {   // have trailing quad-floats
-                in_u -= 2;
-                for( size_t i=0; i<N/4; i++ ) {
-                    __m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( in_u ) );
-                    a = endianSwap32( bytemask, a );
-                    min = _mm_min_ps( min, _mm_castsi128_ps(a) );
-                    max = _mm_max_ps( max, _mm_castsi128_ps(a) );
-                    _mm_stream_si128( out++, a );
-                    in_u += 4;
-                }
-                size_t tail_n = N & 3;
-                if( tail_n ) {  // have trailing floats
-                    __m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( in_u ) );
-                    a = endianSwap32( bytemask, a );
-                    switch( tail_n ) {
-                    case 1: a = _mm_shuffle_epi32( a, _MM_SHUFFLE(0,0,0,0)); break;
-                    case 2: a = _mm_shuffle_epi32( a, _MM_SHUFFLE(1,1,1,0)); break;
-                    case 3: a = _mm_shuffle_epi32( a, _MM_SHUFFLE(2,2,1,0)); break;
-                    }
-                    min = _mm_min_ps( min, _mm_castsi128_ps(a) );
-                    max = _mm_max_ps( max, _mm_castsi128_ps(a) );
-                    _mm_stream_si128( out++, a );
-                }
+            if( block.m_count > 0 ) {
+                order.push_back( i );
             }
-            min = _mm_min_ps( _mm_shuffle_ps( min, min, _MM_SHUFFLE( 2, 3, 0, 1) ), min );
-            min = _mm_min_ss( _mm_shuffle_ps( min, min, _MM_SHUFFLE( 2, 2, 2, 2) ), min );
-            _mm_store_ss( &minimum, min );
-            max = _mm_max_ps( _mm_shuffle_ps( max, max, _MM_SHUFFLE( 2, 3, 0, 1) ), max );
-            max = _mm_max_ss( _mm_shuffle_ps( max, max, _MM_SHUFFLE( 2, 2, 2, 2) ), max );
-            _mm_store_ss( &maximum, max );
-
-            if( 0 ) {
-                const unsigned int* src =  reinterpret_cast<const unsigned int*>( map.bytes() + 4 );
-                float* dst = content;
-                size_t elements_left = block.m_count;
-                float min =  std::numeric_limits<float>::max();
-                float max = -std::numeric_limits<float>::max();
-                for( unsigned int r=0; r<block.m_records; r++ ) {
-                    unsigned int n = std::min( elements_per_record, elements_left );
-                    for( unsigned int i=0; i<n; i++ ) {
-                        union {
-                            unsigned int    ui;
-                            float           f;
-                        } v;
-                        v.ui = *src++;
-                        v.ui = ((v.ui >> 16u)&0x0000ffffu) | ((v.ui << 16u)&0xffff0000u);
-                        v.ui = ((v.ui >> 8u )&0x00ff00ffu) | ((v.ui << 8u )&0xff00ff00u);
-                        if( *dst++ != v.f ) {
-                            LOGGER_ERROR( log, "Failed at r=" << r << ", i=" << i );
-                            break;
-                        }
-                        min = v.f < min ? v.f : min;
-                        max = max < v.f ? v.f : max;
-                    }
-                    src += 2; // skip record head and tail
-                    elements_left -= elements_per_record;
-                }
-                if( minimum != min ) {
-                    LOGGER_ERROR( log, "min is wrong" );
-                }
-                if( maximum != max ) {
-                    LOGGER_ERROR( log, "max is wrong" );
-                }
-                LOGGER_DEBUG( log, "Checked output." );
+        }
+        std::sort( order.begin(), order.end(), [&]( size_t a, size_t b ) {
+            return reads[a].m_block.m_offset < reads[b].m_block.m_offset;
+        } );
+
+        // Coalesce blocks into ranges, reading the bytes between two blocks is
+        // cheaper than another mapping when the gap is small.
+        vector<Block> ranges;
+        vector<size_t> range_of( reads.size() );
+        for( auto it=order.begin(); it!=order.end(); ++it ) {
+            const Block& block = reads[*it].m_block;
+            if( ranges.empty() || (ranges.back().m_offset + ranges.back().m_size + coalesce_gap < block.m_offset ) ) {
+                ranges.push_back( block );
             }
-#else
-            // non-specialized copy loop ---------------------------------------
-            const unsigned int* src =  reinterpret_cast<const unsigned int*>( map.bytes() + 4 );
-            float* dst = content;
-            size_t elements_left = block.m_count;
-            float min =  std::numeric_limits<float>::max();
-            float max = -std::numeric_limits<float>::max();
-            for( unsigned int r=0; r<block.m_records; r++ ) {
-                unsigned int n = std::min( elements_per_record, elements_left );
-                for( unsigned int i=0; i<n; i++ ) {
-                    union {
-                        unsigned int    ui;
-                        float           f;
-                    } v;
-                    v.ui = *src++;
-#if LITTLE_ENDIAN
-                    v.ui = ((v.ui >> 16u)&0x0000ffffu) | ((v.ui << 16u)&0xffff0000u);
-                    v.ui = ((v.ui >> 8u )&0x00ff00ffu) | ((v.ui << 8u )&0xff00ff00u);
-#endif
-                    *dst++ = v.f;
-                    min = v.f < min ? v.f : min;
-                    max = max < v.f ? v.f : max;
-                }
-                src += 2; // skip record head and tail
-                elements_left -= elements_per_record;
+            else {
+                Block& range = ranges.back();
+                range.m_size = std::max( range.m_offset + range.m_size, block.m_offset + block.m_size ) - range.m_offset;
             }
-            minimum = min;
-            maximum = max;
-#endif
-            PerfTimer stop;
-            double dt = PerfTimer::delta( start, stop );
-            LOGGER_DEBUG( log, "invoked on " << typeString(block.m_datatype)
-                          << " (" << ((double)(block.m_count*sizeof(float))/dt)/(1024*1024) << " mb/s)" );
+            range_of[*it] = ranges.size()-1;
         }
-        else {
-            throw std::runtime_error( func + ": Illegal block type: " + typeString(block.m_datatype) );
+        vector< boost::shared_ptr<Map> > maps( ranges.size() );
+        for( size_t r=0; r<ranges.size(); r++ ) {
+            maps[r].reset( new Map( *this, ranges[r] ) );
         }
+
+        PerfTimer start;
+        utils::ThreadPool::instance().run( order.size(), [&]( size_t j ) {
+            BlockRead& read = reads[ order[j] ];
+            const size_t r = range_of[ order[j] ];
+            decodeFloats( read.m_content, read.m_minimum, read.m_maximum, read.m_block,
+                          maps[r]->bytes() + (read.m_block.m_offset - ranges[r].m_offset) );
+        } );
+        PerfTimer stop;
+        LOGGER_DEBUG( log, "Read " << order.size() << " blocks in " << ranges.size() << " ranges ("
+                      << (1000.0*PerfTimer::delta( start, stop )) << "ms)" );
     }
     catch( std::runtime_error& e ) {
         cleanup();
         throw e;
     }
-
 }
 
 
@@ -664,57 +838,19 @@ Reader::blockContent( std::vector<float>& content, const Block& block )
         content.resize( block.m_count );
 
         Map map( *this, block );
-        static const size_t  elements_per_record = 1000u;
-        float* dst = content.data();
-        size_t elements_left = block.m_count;
-
-        const unsigned int* src =  reinterpret_cast<const unsigned int*>( map.bytes() + 4 );   // first head
-        if( block.m_datatype == TYPE_FLOAT ) {
-            for( unsigned int r=0; r<block.m_records; r++ ) {
-                unsigned int n = std::min( elements_per_record, elements_left );
-                for( unsigned int i=0; i<n; i++ ) {
-                    union {
-                        unsigned int    ui;
-                        float           f;
-                    } v;
-                    v.ui = *src++;
-#if LITTLE_ENDIAN
-                    v.ui = ((v.ui >> 16u)&0x0000ffffu) | ((v.ui << 16u)&0xffff0000u);
-                    v.ui = ((v.ui >> 8u )&0x00ff00ffu) | ((v.ui << 8u )&0xff00ff00u);
-#endif
-                    *dst++ = v.f;
-                }
-                src += 2; // skip record head and tail
-                elements_left -= elements_per_record;
-            }
+        if( m_formatted && ((block.m_datatype == TYPE_FLOAT) || (block.m_datatype == TYPE_DOUBLE)) ) {
+            float minimum, maximum;
+            const char* text = reinterpret_cast<const char*>( map.bytes() );
+            formatted::parseFloats( content.data(), text, text + block.m_size, block.m_count, minimum, maximum );
+        }
+        else if( block.m_datatype == TYPE_FLOAT ) {
+            kernels::swap32Records( kernels::best(), content.data(), map.bytes(), block.m_count );
         }
-
         else if( block.m_datatype == TYPE_DOUBLE ) {
-            for( unsigned int r=0; r<block.m_records; r++ ) {
-                unsigned int n = std::min( elements_per_record, elements_left );
-                for( unsigned int i=0; i<n; i++ ) {
-                    union {
-                        unsigned int    ui[2];
-                        double          d;
-                    } v;
-                    v.ui[0] = *src++;
-                    v.ui[1] = *src++;
-#if LITTLE_ENDIAN
-                    unsigned int t = v.ui[0];
-                    v.ui[0] = v.ui[1];
-                    v.ui[1] = t;
-                    v.ui[0] = ((v.ui[0] >> 16u)&0x0000ffffu) | ((v.ui[0] << 16u)&0xffff0000u);
-                    v.ui[1] = ((v.ui[1] >> 16u)&0x0000ffffu) | ((v.ui[1] << 16u)&0xffff0000u);
-                    v.ui[0] = ((v.ui[0] >> 8u )&0x00ff00ffu) | ((v.ui[0] << 8u )&0xff00ff00u);
-                    v.ui[1] = ((v.ui[1] >> 8u )&0x00ff00ffu) | ((v.ui[1] << 8u )&0xff00ff00u);
-#endif
-                    *dst++ = v.d;
-                }
-                src += 2; // skip record head and tail
-                elements_left -= elements_per_record;
-            }
+            float minimum, maximum;
+            kernels::float64MinMaxRecords( kernels::best(), content.data(), map.bytes(),
+                                           block.m_count, minimum, maximum );
         }
-
         else {
             throw std::runtime_error( func + ": Illegal block type: " + typeString(block.m_datatype) );
         }
@@ -742,7 +878,11 @@ Reader::blockContent( std::vector<double>& content, const Block& block )
         size_t elements_left = block.m_count;
 
         const unsigned int* src =  reinterpret_cast<const unsigned int*>( map.bytes() + 4 );   // first head
-        if( block.m_datatype == TYPE_FLOAT ) {
+        if( m_formatted && ((block.m_datatype == TYPE_FLOAT) || (block.m_datatype == TYPE_DOUBLE)) ) {
+            const char* text = reinterpret_cast<const char*>( map.bytes() );
+            formatted::parseDoubles( dst, text, text + block.m_size, block.m_count );
+        }
+        else if( block.m_datatype == TYPE_FLOAT ) {
             for( unsigned int r=0; r<block.m_records; r++ ) {
                 unsigned int n = std::min( elements_per_record, elements_left );
                 for( unsigned int i=0; i<n; i++ ) {
@@ -763,29 +903,7 @@ Reader::blockContent( std::vector<double>& content, const Block& block )
         }
 
         else if( block.m_datatype == TYPE_DOUBLE ) {
-            for( unsigned int r=0; r<block.m_records; r++ ) {
-                unsigned int n = std::min( elements_per_record, elements_left );
-                for( unsigned int i=0; i<n; i++ ) {
-                    union {
-                        unsigned int    ui[2];
-                        double          d;
-                    } v;
-                    v.ui[0] = *src++;
-                    v.ui[1] = *src++;
-#if LITTLE_ENDIAN
-                    unsigned int t = v.ui[0];
-                    v.ui[0] = v.ui[1];
-                    v.ui[1] = t;
-                    v.ui[0] = ((v.ui[0] >> 16u)&0x0000ffffu) | ((v.ui[0] << 16u)&0xffff0000u);
-                    v.ui[1] = ((v.ui[1] >> 16u)&0x0000ffffu) | ((v.ui[1] << 16u)&0xffff0000u);
-                    v.ui[0] = ((v.ui[0] >> 8u )&0x00ff00ffu) | ((v.ui[0] << 8u )&0xff00ff00u);
-                    v.ui[1] = ((v.ui[1] >> 8u )&0x00ff00ffu) | ((v.ui[1] << 8u )&0xff00ff00u);
-#endif
-                    *dst++ = v.d;
-                }
-                src += 2; // skip record head and tail
-                elements_left -= elements_per_record;
-            }
+            kernels::swap64Records( kernels::best(), dst, map.bytes(), block.m_count );
         }
 
         else {
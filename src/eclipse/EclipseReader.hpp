@@ -21,6 +21,11 @@
 #include <list>
 
 #include "Eclipse.hpp"
+#include "EclipseBlockIndex.hpp"
+
+namespace utils {
+    class ActiveCells;
+}
 
 namespace eclipse {
 
@@ -31,11 +36,23 @@ namespace eclipse {
   * as well as endianess. Does not in any way actually interpret the contents of
   * the blocks (which is handled by the parser).
   *
+  * Formatted (ASCII) files, e.g. .FEGRID and .FUNRST, are detected from their
+  * first bytes and read through the same interface. For those, the offset and
+  * size of a block designate the text between its header line and the next.
+  *
   */
 class Reader : public boost::noncopyable
 {
 public:
 
+    /** A block and its destination in a batched read, see blockContents(). */
+    struct BlockRead {
+        Block           m_block;        ///< Block of floats or doubles.
+        float*          m_content;      ///< Destination of m_block.m_count floats.
+        float           m_minimum;      ///< Smallest value, set by blockContents().
+        float           m_maximum;      ///< Largest value, set by blockContents().
+    };
+
     /** Create a reader for the file at a specific path. */
     Reader( const std::string& path );
 
@@ -43,13 +60,84 @@ public:
 
     /** Get the blocks that this file contains.
       *
-      * Scans through the file, determining the set of blocks the file contains.
+      * Uses the persistent block index (see BlockIndex) if a valid one exists,
+      * otherwise scans through the file, determining the set of blocks the file
+      * contains, and writes an index for subsequent opens.
       *
       * \returns The list of blocks that this file contains.
       */
     std::list<Block>
     blocks();
 
+    /** Get the complete blocks of a file that is being appended to.
+      *
+      * Reads the block headers from offset and onwards, stopping before a
+      * block that is not yet completely written. Neither the whole-file
+      * mapping nor the persistent block index is used.
+      *
+      * \param[out] blocks  Complete blocks, appended in file order.
+      * \param[in]  offset  End of the last block already known, that is, the
+      *                     offset of the next block header record.
+      * \returns The end of the last complete block, where the next
+      *          invocation should continue.
+      * \throws std::runtime_error If a block header is malformed.
+      * \throws std::runtime_error If the file is formatted.
+      */
+    size_t
+    appendedBlocks( std::list<Block>& blocks, size_t offset );
+
+    /** Get the positions of the SEQNUM blocks in the list returned by blocks().
+      *
+      * Each SEQNUM block starts a report step in a unified restart file.
+      *
+      * \note Only valid after blocks() has been invoked.
+      */
+    const std::vector<size_t>&
+    sequenceBlocks() const
+    { return m_seqnum_blocks; }
+
+    /** Size of the file when the reader was created. */
+    size_t
+    fileSize() const
+    { return m_filesize; }
+
+    /** True if the file is a formatted (ASCII) file. */
+    bool
+    formatted() const
+    { return m_formatted; }
+
+    /** Path of the file this reader reads. */
+    const std::string&
+    path() const
+    { return m_path; }
+
+    /** True if the file is open, a failed read leaves the reader invalid. */
+    bool
+    valid() const
+    { return m_fd >= 0; }
+
+    /** Hint the kernel that a block will be read soon.
+      *
+      * Issues asynchronous readahead of the pages of the block, using
+      * MADV_WILLNEED if the file is mapped and posix_fadvise otherwise.
+      *
+      * \note Never throws, failure is only logged.
+      */
+    void
+    prefetch( const Block& block );
+
+    /** Number of bytes of address space held by the whole-file mapping. */
+    size_t
+    mappedBytes() const
+    { return m_file_map != NULL ? m_filesize : 0u; }
+
+    /** Release the whole-file mapping, it is recreated on demand.
+      *
+      * \note Must not be invoked while a read is in progress.
+      */
+    void
+    unmapFile();
+
     /** Read a block of booleans from file.
       *
       * \param[out] content  Data storage.
@@ -83,6 +171,21 @@ public:
     void
     blockContent( std::vector<int>& content, const Block& block );
 
+    /** Read a block of integers from file, determining which are nonzero.
+      *
+      * Intended for ACTNUM, the active set is found in the same pass as the
+      * integers are decoded. Only the bits are kept, the decoded integers
+      * are scratch storage that is released before returning.
+      *
+      * \param[out] active   The set of nonzero elements.
+      * \param[in]  block    Specifies position of data in file.
+      * \throws std::runtime_error If block contents are not integers.
+      * \throws std::runtime_error If unable to mmap the file.
+      */
+    void
+    blockContent( utils::ActiveCells&   active,
+                  const Block&          block );
+
     /** Read a block of floats or doubles from file.
       *
       * \param[out] content  Data storage.
@@ -120,12 +223,28 @@ public:
                   float&                                maximum,
                   const Block&                          block );
 
+    /** Read several blocks of floats or doubles in one pass, determining min and max.
+      *
+      * The blocks are sorted by file offset, and blocks that are close in the
+      * file are coalesced into a single range that is mapped (or hinted, if
+      * the whole file is mapped) once. The blocks are then decoded
+      * concurrently. Intended for fetching several fields of a report step.
+      *
+      * \param[in,out] reads  Blocks and destinations, min and max are set.
+      * \throws std::runtime_error If a block is not float or doubles.
+      * \throws std::runtime_error If unable to mmap the file.
+      */
+    void
+    blockContents( std::vector<BlockRead>& reads );
+
 
 private:
-    /** RAII helper class to mmap a block.
+    /** RAII helper class to access the bytes of a block.
       *
-      * Mmap requires that the map'ed region starts at a page boundary, so we
-      * find the last page boundary before the block's data.
+      * Points into the mapping of the whole file when available (see
+      * mapFile()). Otherwise, the block is mmap'ed on its own, and since mmap
+      * requires that the map'ed region starts at a page boundary, we find the
+      * last page boundary before the block's data.
       */
     class Map
     {
@@ -137,14 +256,12 @@ private:
 
         const unsigned char*
         bytes() const
-        { return m_map + m_page_offset; }
+        { return m_bytes; }
 
     private:
-        size_t          m_page;
-        size_t          m_page_start;
-        size_t          m_page_offset;
-        size_t          m_bytes_to_map;
-        unsigned char*  m_map;
+        size_t                  m_bytes_to_map;
+        unsigned char*          m_map;
+        const unsigned char*    m_bytes;
     };
 
     Reader();
@@ -152,10 +269,80 @@ private:
     void
     cleanup();
 
+    /** Map the whole file read-only, once.
+      *
+      * \returns Pointer to the first byte of the file, or NULL if the file
+      *          could not be mapped (e.g. exhausted address space).
+      */
+    const unsigned char*
+    mapFile();
+
+    /** Scan the file header by header to determine the blocks.
+      *
+      * Large files are split at SEQNUM boundaries and the segments are walked
+      * concurrently (see scanSegments()), small files or files where this
+      * fails are scanned serially.
+      */
+    std::list<Block>
+    scanBlocks();
+
+    /** Decode a block of floats or doubles, determining min and max.
+      *
+      * \param[in] bytes  The bytes of the block, i.e. at block.m_offset.
+      */
+    void
+    decodeFloats( float*                content,
+                  float&                minimum,
+                  float&                maximum,
+                  const Block&          block,
+                  const unsigned char*  bytes ) const;
+
+    /** Determine the blocks of a formatted file from its header lines. */
+    std::list<Block>
+    scanFormattedBlocks();
+
+    /** Walk blocks from begin, expecting to end exactly at end.
+      *
+      * \param[out] blocks  Blocks encountered, appended in file order.
+      * \param[in]  bytes   Mapping of the whole file.
+      * \param[in]  begin   Offset of the first block header payload.
+      * \param[in]  end     Offset where the walk is expected to stop.
+      * \returns True if the walk ended exactly at end.
+      */
+    bool
+    scanRange( std::list<Block>&      blocks,
+               const unsigned char*   bytes,
+               size_t                 begin,
+               size_t                 end );
+
+    /** Split the file at SEQNUM headers and scan the segments in parallel.
+      *
+      * \returns True on success, false if the segments didn't line up and the
+      *          caller should fall back to a serial scan.
+      */
+    bool
+    scanSegments( std::list<Block>& blocks, const unsigned char* bytes );
+
+    /** Populate a block from the 16 bytes of a block header payload.
+      *
+      * \param[out] block   The block to populate.
+      * \param[in]  head    Pointer to the block header payload.
+      * \param[in]  offset  File offset of the header payload.
+      * \throws std::runtime_error If data type is unknown.
+      */
+    static
+    void
+    parseBlockHeader( Block& block, const char* head, size_t offset );
+
     const std::string   m_path;
     int                 m_fd;
     size_t              m_filesize;
     size_t              m_pagesize;
+    unsigned char*      m_file_map;
+    bool                m_file_map_failed;
+    bool                m_formatted;
+    BlockIndexKey       m_index_key;
+    std::vector<size_t> m_seqnum_blocks;
 };
 
 } // of namespace Eclipse
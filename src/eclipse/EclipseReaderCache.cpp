@@ -0,0 +1,146 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ *
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+#include "utils/Logger.hpp"
+#include "EclipseReaderCache.hpp"
+
+namespace eclipse {
+
+using std::string;
+
+ReaderCache::ReaderCache( size_t budget )
+    : m_budget( budget == 0u ? defaultBudget() : budget )
+{
+}
+
+size_t
+ReaderCache::defaultBudget()
+{
+    // Leave most of a 32-bit address space to the rest of the application.
+    return sizeof(void*) >= 8 ? (size_t)8u*1024u*1024u*1024u
+                              : (size_t)512u*1024u*1024u;
+}
+
+void
+ReaderCache::setBudget( size_t budget )
+{
+    std::lock_guard<std::mutex> guard( m_lock );
+    m_budget = budget == 0u ? defaultBudget() : budget;
+    evict();
+}
+
+boost::shared_ptr<Reader>
+ReaderCache::acquire( const string& path )
+{
+    auto it = m_lookup.find( path );
+    if( it != m_lookup.end() ) {
+        if( (*it->second)->valid() ) {
+            m_lru.splice( m_lru.begin(), m_lru, it->second );
+            return m_lru.front();
+        }
+        // A failed read closes the reader, open it anew.
+        m_lru.erase( it->second );
+        m_lookup.erase( it );
+    }
+    boost::shared_ptr<Reader> reader( new Reader( path ) );
+    m_lru.push_front( reader );
+    m_lookup[ path ] = m_lru.begin();
+    return reader;
+}
+
+boost::shared_ptr<Reader>
+ReaderCache::reader( const string& path )
+{
+    std::lock_guard<std::mutex> guard( m_lock );
+    boost::shared_ptr<Reader> reader = acquire( path );
+    evict();
+    return reader;
+}
+
+void
+ReaderCache::prefetch( const string& path, const Block& block )
+{
+    std::lock_guard<std::mutex> guard( m_lock );
+    try {
+        acquire( path )->prefetch( block );
+        evict();
+    }
+    catch( std::runtime_error& e ) {
+        Logger log = getLogger( "Eclipse.ReaderCache.prefetch" );
+        LOGGER_DEBUG( log, path << ": " << e.what() );
+    }
+}
+
+void
+ReaderCache::invalidate( const std::string& path )
+{
+    std::lock_guard<std::mutex> guard( m_lock );
+    auto it = m_lookup.find( path );
+    if( it != m_lookup.end() ) {
+        m_lru.erase( it->second );
+        m_lookup.erase( it );
+    }
+}
+
+void
+ReaderCache::clear()
+{
+    std::lock_guard<std::mutex> guard( m_lock );
+    for( auto it=m_lru.begin(); it!=m_lru.end(); ) {
+        if( it->unique() ) {
+            m_lookup.erase( (*it)->path() );
+            it = m_lru.erase( it );
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+void
+ReaderCache::evict()
+{
+    Logger log = getLogger( "Eclipse.ReaderCache.evict" );
+
+    size_t mapped = 0u;
+    for( auto it=m_lru.begin(); it!=m_lru.end(); ++it ) {
+        mapped += (*it)->mappedBytes();
+    }
+
+    // Release mappings of the least recently used readers not in use.
+    for( auto it=m_lru.rbegin(); (it!=m_lru.rend()) && (mapped > m_budget); ++it ) {
+        if( it->unique() && ((*it)->mappedBytes() > 0u) ) {
+            mapped -= (*it)->mappedBytes();
+            LOGGER_DEBUG( log, "Unmapping " << (*it)->path() );
+            (*it)->unmapFile();
+        }
+    }
+
+    // Close the least recently used readers not in use beyond max_readers.
+    size_t open = m_lru.size();
+    for( auto it=m_lru.end(); (open > max_readers) && (it != m_lru.begin()); ) {
+        --it;
+        if( it->unique() ) {
+            m_lookup.erase( (*it)->path() );
+            it = m_lru.erase( it );
+            open--;
+        }
+    }
+}
+
+} // of namespace eclipse
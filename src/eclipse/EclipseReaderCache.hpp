@@ -0,0 +1,113 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ *
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <string>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <boost/utility.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "EclipseReader.hpp"
+
+namespace eclipse {
+
+/** Keeps readers of a set of files open between reads.
+  *
+  * Repeated reads from the same files (e.g. when scrubbing through the report
+  * steps of a restart file) reuse one Reader, and thus one file descriptor and
+  * one whole-file mapping, per file. Mappings of the least recently used files
+  * are released when the total exceeds the address-space budget, and readers
+  * are closed when more than max_readers files are open. The budget is
+  * enforced when readers are handed out, so the file just handed out may
+  * exceed it until the next call.
+  *
+  * A reader handed out by reader() is never unmapped or closed by the cache
+  * while the caller holds on to it.
+  */
+class ReaderCache : public boost::noncopyable
+{
+public:
+    /** Maximum number of files kept open. */
+    static const size_t max_readers = 64u;
+
+    /** Create a cache.
+      *
+      * \param[in] budget  Address space budget in bytes, 0 selects a default
+      *                    suitable for the platform (see defaultBudget()).
+      */
+    ReaderCache( size_t budget = 0u );
+
+    /** Default address space budget, a fraction of the address space. */
+    static
+    size_t
+    defaultBudget();
+
+    /** Set the address space budget in bytes, evicting if needed. */
+    void
+    setBudget( size_t budget );
+
+    size_t
+    budget() const
+    { return m_budget; }
+
+    /** Get the reader of the file at path, opening it if needed.
+      *
+      * \throws std::runtime_error If the file cannot be opened.
+      */
+    boost::shared_ptr<Reader>
+    reader( const std::string& path );
+
+    /** Issue readahead of a block of the file at path.
+      *
+      * \note Never throws, e.g. a missing file is silently ignored.
+      */
+    void
+    prefetch( const std::string& path, const Block& block );
+
+    /** Forget the reader of a file, e.g. when the file has grown.
+      *
+      * The next invocation of reader() opens the file anew, while readers
+      * already handed out stay valid until released.
+      */
+    void
+    invalidate( const std::string& path );
+
+    /** Close all readers not in use. */
+    void
+    clear();
+
+private:
+    typedef std::list< boost::shared_ptr<Reader> >   LRU;
+
+    std::mutex                                      m_lock;
+    size_t                                          m_budget;
+    LRU                                             m_lru;      ///< Most recently used first.
+    std::unordered_map<std::string,LRU::iterator>   m_lookup;
+
+    /** Get reader for path, most recent first in m_lru, invoked with m_lock held. */
+    boost::shared_ptr<Reader>
+    acquire( const std::string& path );
+
+    /** Release mappings and readers until within budget, invoked with m_lock held. */
+    void
+    evict();
+
+};
+
+} // of namespace eclipse
@@ -0,0 +1,254 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ *
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Microbenchmark of the block decoding kernels used by eclipse::Reader.
+//
+// Builds synthetic REAL and DOUB blocks in memory, laid out as in an
+// unformatted Eclipse file (big-endian values in records of 1000 elements
+// framed by 4-byte heads and tails), and decodes them with every kernel
+// variant supported by the CPU, reporting throughput in GB/s of file data.
+//
+// The REAL block is also written as in a formatted file and parsed, where
+// throughput is reported both in GB/s of text and of the equivalent
+// unformatted data, the latter being comparable to the kernels.
+//
+// Usage: eclipsebench [elements] [repetitions]
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cmath>
+#include <stdint.h>
+#include "eclipse/EclipseKernels.hpp"
+#include "eclipse/EclipseFormatted.hpp"
+#include "utils/PerfTimer.hpp"
+
+namespace {
+
+using namespace eclipse::kernels;
+
+void
+store32be( unsigned char* dst, uint32_t v )
+{
+    dst[0] = (v>>24u) & 0xffu;
+    dst[1] = (v>>16u) & 0xffu;
+    dst[2] = (v>> 8u) & 0xffu;
+    dst[3] = (v     ) & 0xffu;
+}
+
+void
+store64be( unsigned char* dst, uint64_t v )
+{
+    store32be( dst, v>>32u );
+    store32be( dst + 4, v & 0xffffffffu );
+}
+
+/** Create record-framed REAL and DOUB blocks of count big-endian values. */
+void
+makeBlocks( std::vector<unsigned char>& bytes32,
+            std::vector<unsigned char>& bytes64,
+            const size_t count )
+{
+    size_t records = (count + elements_per_record - 1)/elements_per_record;
+    bytes32.resize( 8*records + 4*count );
+    bytes64.resize( 8*records + 8*count );
+    unsigned char* p = bytes32.data();
+    unsigned char* q = bytes64.data();
+    srand( 42 );
+    for( size_t left=count; left > 0; ) {
+        size_t n = std::min( elements_per_record, left );
+        store32be( p, 4*n );
+        store32be( q, 8*n );
+        p += 4;
+        q += 4;
+        for( size_t i=0; i<n; i++ ) {
+            union {
+                uint32_t    ui;
+                float       f;
+            } v;
+            union {
+                uint64_t    ui;
+                double      d;
+            } w;
+            w.d = 1000.0*( (double)rand()/RAND_MAX ) - 500.0;
+            v.f = w.d;
+            store32be( p, v.ui );
+            store64be( q, w.ui );
+            p += 4;
+            q += 8;
+        }
+        store32be( p, 4*n );
+        store32be( q, 8*n );
+        p += 4;
+        q += 4;
+        left -= n;
+    }
+}
+
+/** Write floats as Eclipse does in formatted files, four per line. */
+void
+makeFormatted( std::string& text, const float* values, const size_t count )
+{
+    text.clear();
+    text.reserve( 17*count + count/4 + 1 );
+    for( size_t i=0; i<count; i++ ) {
+        // 0.ddddddddE+xx from d.dddddddE+xx
+        char sci[32];
+        snprintf( sci, sizeof(sci), "%.7E", std::fabs( values[i] ) );
+        int exponent = atoi( strchr( sci, 'E' ) + 1 ) + (values[i] != 0.f ? 1 : 0);
+        char field[32];
+        snprintf( field, sizeof(field), "%s0.%c%.7sE%c%02d",
+                  values[i] < 0.f ? "-" : "", sci[0], sci+2,
+                  exponent < 0 ? '-' : '+', std::abs( exponent ) );
+        char padded[32];
+        snprintf( padded, sizeof(padded), "%17s", field );
+        text += padded;
+        if( (i % 4) == 3 ) {
+            text += '\n';
+        }
+    }
+    text += '\n';
+}
+
+} // of anonymous namespace
+
+int
+main( int argc, char** argv )
+{
+    size_t count = argc > 1 ? strtoul( argv[1], NULL, 10 ) : 16u*1024u*1024u;
+    size_t reps  = argc > 2 ? strtoul( argv[2], NULL, 10 ) : 10u;
+
+    std::vector<unsigned char> bytes;
+    std::vector<unsigned char> bytes64;
+    makeBlocks( bytes, bytes64, count );
+
+    // Destination buffers are 64-byte aligned, as FieldBridge buffers.
+    std::vector<float> reference( count );
+    std::vector<double> reference64( count );
+    std::vector<double> storage( count + 8 );
+    float* dst = reinterpret_cast<float*>( (reinterpret_cast<uintptr_t>( storage.data() ) + 63u) & ~(uintptr_t)63u );
+
+    float ref_min, ref_max;
+    float32MinMaxRecords( *variant( VARIANT_SCALAR ), reference.data(), bytes.data(), count, ref_min, ref_max );
+    swap64Records( *variant( VARIANT_SCALAR ), reference64.data(), bytes64.data(), count );
+
+    // The REAL block doubles as an integer block for the nonzero scan.
+    std::vector<uint64_t> ref_bits( (count+63)/64, 0u );
+    std::vector<uint64_t> bits( (count+63)/64, 0u );
+    size_t ref_active = int32ActiveRecords( *variant( VARIANT_SCALAR ), reinterpret_cast<int*>( dst ),
+                                            bytes.data(), count, ref_bits.data() );
+
+    std::cout << "elements=" << count << ", repetitions=" << reps
+              << ", dispatched=" << best().m_name << std::endl;
+    std::cout << std::left << std::setw( 10 ) << "variant"
+              << std::right << std::setw( 14 ) << "swap32 GB/s"
+              << std::setw( 14 ) << "minmax GB/s"
+              << std::setw( 14 ) << "swap64 GB/s"
+              << std::setw( 14 ) << "d2f mm GB/s"
+              << std::setw( 14 ) << "active GB/s" << "  check" << std::endl;
+
+    int failures = 0;
+    for( int v=VARIANT_SCALAR; v<VARIANT_N; v++ ) {
+        const KernelSet* kernels = variant( static_cast<Variant>( v ) );
+        if( kernels == NULL ) {
+            continue;
+        }
+        double gb = (reps*count*sizeof(float))/1e9;
+
+        PerfTimer swap_start;
+        for( size_t r=0; r<reps; r++ ) {
+            swap32Records( *kernels, dst, bytes.data(), count );
+        }
+        PerfTimer swap_stop;
+        bool ok = memcmp( dst, reference.data(), count*sizeof(float) ) == 0;
+
+        float min = 0.f, max = 0.f;
+        PerfTimer minmax_start;
+        for( size_t r=0; r<reps; r++ ) {
+            float32MinMaxRecords( *kernels, dst, bytes.data(), count, min, max );
+        }
+        PerfTimer minmax_stop;
+        ok = ok && (memcmp( dst, reference.data(), count*sizeof(float) ) == 0)
+                && (min == ref_min) && (max == ref_max);
+
+        PerfTimer swap64_start;
+        for( size_t r=0; r<reps; r++ ) {
+            swap64Records( *kernels, dst, bytes64.data(), count );
+        }
+        PerfTimer swap64_stop;
+        ok = ok && (memcmp( dst, reference64.data(), count*sizeof(double) ) == 0);
+
+        // The DOUB block holds the same values as the REAL block, so the
+        // converted floats must match the REAL reference exactly.
+        PerfTimer d2f_start;
+        for( size_t r=0; r<reps; r++ ) {
+            float64MinMaxRecords( *kernels, dst, bytes64.data(), count, min, max );
+        }
+        PerfTimer d2f_stop;
+        ok = ok && (memcmp( dst, reference.data(), count*sizeof(float) ) == 0)
+                && (min == ref_min) && (max == ref_max);
+
+        size_t active = 0;
+        PerfTimer active_start;
+        for( size_t r=0; r<reps; r++ ) {
+            std::fill( bits.begin(), bits.end(), 0u );
+            active = int32ActiveRecords( *kernels, reinterpret_cast<int*>( dst ), bytes.data(), count, bits.data() );
+        }
+        PerfTimer active_stop;
+        ok = ok && (memcmp( dst, reference.data(), count*sizeof(float) ) == 0)
+                && (active == ref_active) && (bits == ref_bits);
+        if( !ok ) {
+            failures++;
+        }
+
+        std::cout << std::left << std::setw( 10 ) << kernels->m_name << std::right << std::fixed << std::setprecision( 2 )
+                  << std::setw( 14 ) << gb/PerfTimer::delta( swap_start, swap_stop )
+                  << std::setw( 14 ) << gb/PerfTimer::delta( minmax_start, minmax_stop )
+                  << std::setw( 14 ) << 2.0*gb/PerfTimer::delta( swap64_start, swap64_stop )
+                  << std::setw( 14 ) << 2.0*gb/PerfTimer::delta( d2f_start, d2f_stop )
+                  << std::setw( 14 ) << gb/PerfTimer::delta( active_start, active_stop )
+                  << "  " << (ok ? "ok" : "MISMATCH") << std::endl;
+    }
+
+    std::string text;
+    makeFormatted( text, reference.data(), count );
+    float min = 0.f, max = 0.f;
+    PerfTimer formatted_start;
+    for( size_t r=0; r<reps; r++ ) {
+        eclipse::formatted::parseFloats( dst, text.data(), text.data() + text.size(), count, min, max );
+    }
+    PerfTimer formatted_stop;
+    // Eight significant digits don't round-trip floats, allow an ulp or two.
+    bool ok = true;
+    for( size_t i=0; i<count; i++ ) {
+        ok = ok && ( std::fabs( dst[i] - reference[i] ) <= 2e-7f*std::fabs( reference[i] ) );
+    }
+    if( !ok ) {
+        failures++;
+    }
+    double dt = PerfTimer::delta( formatted_start, formatted_stop );
+    std::cout << std::left << std::setw( 10 ) << "formatted" << std::right << std::fixed << std::setprecision( 2 )
+              << std::setw( 14 ) << (reps*text.size())/1e9/dt << " GB/s text, "
+              << (reps*count*sizeof(float))/1e9/dt << " GB/s unformatted equivalent"
+              << "  " << (ok ? "ok" : "MISMATCH") << std::endl;
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
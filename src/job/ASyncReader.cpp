@@ -15,10 +15,12 @@
  * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <chrono>
 #include "utils/Logger.hpp"
 #include "ASyncReader.hpp"
 #include "cornerpoint/Tessellator.hpp"
 #include "bridge/PolygonMeshBridge.hpp"
+#include "bridge/PolyhedralMeshCache.hpp"
 #include "dataset/VTKXMLSourceFactory.hpp"
 #include "dataset/CornerpointGrid.hpp"
 #include "dataset/PolygonDataInterface.hpp"
@@ -30,6 +32,8 @@ namespace {
     const std::string package = "ASyncReader";
     const std::string progress_description_key = "asyncreader_what";
     const std::string progress_counter_key     = "asyncreader_progress";
+    /** Interval between checks of followed restart files, in milliseconds. */
+    const unsigned int follow_poll_interval = 1000;
 }
 
 ASyncReader::ASyncReader( boost::shared_ptr<tinia::model::ExposedModel> model )
@@ -49,7 +53,8 @@ ASyncReader::issueOpenSource( const std::string& file,
                               int refine_i,
                               int refine_j,
                               int refine_k,
-                              bool triangulate)
+                              bool triangulate,
+                              bool follow )
 {
     Logger log = getLogger( package + ".read" );
     Command cmd;
@@ -59,6 +64,7 @@ ASyncReader::issueOpenSource( const std::string& file,
     cmd.m_refine_j = refine_j;
     cmd.m_refine_k = refine_k;
     cmd.m_triangulate = triangulate;
+    cmd.m_follow = follow;
     postCommand( cmd, false );
     return true;
 }
@@ -70,6 +76,7 @@ ASyncReader::issueFetchField(boost::shared_ptr<dataset::AbstractDataSource> sour
 {
     Command cmd;
     cmd.m_type = COMMAND_FETCH_FIELD;
+    cmd.m_follow = false;
     cmd.m_source = source;
     cmd.m_field_index = field_index;
     cmd.m_timestep_index = timestep_index;
@@ -91,9 +98,10 @@ ASyncReader::checkForResponse()
 
 
 bool
-ASyncReader::getSource( boost::shared_ptr<dataset::AbstractDataSource>&  source,
-                        std::string&                                     source_file,
-                        boost::shared_ptr<bridge::AbstractMeshBridge>&   mesh_bridge )
+ASyncReader::getSource( boost::shared_ptr<dataset::AbstractDataSource>&                source,
+                        std::string&                                                     source_file,
+                        boost::shared_ptr<bridge::AbstractMeshBridge>&                   mesh_bridge,
+                        boost::shared_ptr<const bridge::PolyhedralMeshBridge::Part>&     mesh_part )
 {
     std::unique_lock<std::mutex> lock( m_rsp_queue_lock );
     for(auto it = m_rsp_queue.begin(); it!=m_rsp_queue.end(); ++it ) {
@@ -101,6 +109,7 @@ ASyncReader::getSource( boost::shared_ptr<dataset::AbstractDataSource>&  source,
             source      = it->m_source;
             source_file = it->m_source_file;
             mesh_bridge = it->m_mesh_bridge;
+            mesh_part   = it->m_mesh_part;
             m_rsp_queue.erase( it );
             return true;
         }
@@ -130,12 +139,31 @@ ASyncReader::getField( boost::shared_ptr<const dataset::AbstractDataSource>&  so
 
 
 
+bool
+ASyncReader::getTimesteps( boost::shared_ptr<dataset::AbstractDataSource>&  source )
+{
+    std::unique_lock<std::mutex> lock( m_rsp_queue_lock );
+    for( auto it = m_rsp_queue.begin(); it != m_rsp_queue.end(); ++it ) {
+        if( it->m_type == RESPONSE_TIMESTEPS ) {
+            source = it->m_source;
+            m_rsp_queue.erase( it );
+            return true;
+        }
+    }
+    return false;
+}
+
 bool
 ASyncReader::getCommand( Command& cmd )
 {
     std::unique_lock< std::mutex > lock( m_cmd_queue_lock );
     while( m_cmd_queue.empty() ) {
-        m_cmd_queue_wait.wait( lock );
+        if( m_followed.empty() ) {
+            m_cmd_queue_wait.wait( lock );
+        }
+        else if( m_cmd_queue_wait.wait_for( lock, std::chrono::milliseconds( follow_poll_interval ) ) == std::cv_status::timeout ) {
+            return false;
+        }
     }
     cmd = m_cmd_queue.front();
     m_cmd_queue.pop_front();
@@ -189,7 +217,7 @@ ASyncReader::handleOpenSource( const Command& cmd )
                                                 cmd.m_refine_j,
                                                 cmd.m_refine_k ) );            
         }
-        else if( suffix == "EGRID" ) {
+        else if( (suffix == "EGRID") || (suffix == "FEGRID") ) {
             source.reset( new dataset::CornerpointGrid( cmd.m_source_file,
                                                 cmd.m_refine_i,
                                                 cmd.m_refine_j,
@@ -203,22 +231,94 @@ ASyncReader::handleOpenSource( const Command& cmd )
             boost::shared_ptr<dataset::PolygonDataInterface> polygon_source =
                     boost::dynamic_pointer_cast<dataset::PolygonDataInterface>( source );
             
+            if( cmd.m_follow ) {
+                boost::shared_ptr<dataset::CornerpointGrid> grid =
+                        boost::dynamic_pointer_cast<dataset::CornerpointGrid>( source );
+                if( grid ) {
+                    m_followed.push_back( grid );
+                }
+                else {
+                    LOGGER_WARN( log, "Source does not support following, ignoring." );
+                }
+            }
+
             if( polyhedron_source ) {
                 boost::shared_ptr< bridge::PolyhedralMeshBridge > bridge( new bridge::PolyhedralMeshBridge( cmd.m_triangulate ) );
-                
-                polyhedron_source->geometry( *bridge,
-                                             m_model,
-                                             progress_description_key,
-                                             progress_counter_key );
-                
-                m_model->updateElement<std::string>( progress_description_key, "Organizing data..." );
-                m_model->updateElement<int>( progress_counter_key, 0 );
-                bridge->process();
-                
+
+                // A previous tessellation of the same geometry with the same
+                // options can be reused, see bridge::PolyhedralMeshCache.
+                uint64_t key = 0u;
+                bool cacheable = polyhedron_source->geometryKey( key );
+                if( cacheable ) {
+                    m_model->updateElement<std::string>( progress_description_key, "Loading cached tessellation..." );
+                    key = bridge::PolyhedralMeshCache::hash( &cmd.m_triangulate, sizeof(cmd.m_triangulate), key );
+#ifdef FRVIEW_REORDER_MESH
+                    const bool reordered = true;
+                    key = bridge::PolyhedralMeshCache::hash( &reordered, sizeof(reordered), key );
+#endif
+                }
+                // The geometry is posted in parts as it is tessellated, so
+                // that the first rows can be shown long before the last.
+                typedef bridge::PolyhedralMeshBridge::Part Part;
+                bridge::PolyhedralMeshBridge::Mark posted = bridge->mark();
+                bool parts = false;
+                size_t posted_cells = 0;
+                // Reordered output is posted as a whole, as parts would
+                // refer to the order of the tessellator, see
+                // bridge::PolyhedralMeshBridge::reorder().
+#ifndef FRVIEW_REORDER_MESH
+                bridge->setPartListener( [&]( const std::vector<bridge::PolyhedralMeshBridge::Index>& cell_ranges )
+                {
+                    boost::shared_ptr<Part> part( new Part );
+                    bridge->extract( *part, posted, cell_ranges );
+                    posted = bridge->mark();
+                    posted_cells += part->m_cell_index.size();
+                    parts = true;
+
+                    Response rsp;
+                    rsp.m_type = RESPONSE_SOURCE;
+                    rsp.m_source = source;
+                    rsp.m_mesh_part = part;
+                    postResponse( cmd, rsp );
+                } );
+#endif
+
+                if( !cacheable || !bridge::PolyhedralMeshCache::load( *bridge, cmd.m_source_file, key ) ) {
+                    polyhedron_source->geometry( *bridge,
+                                                 m_model,
+                                                 progress_description_key,
+                                                 progress_counter_key );
+
+                    m_model->updateElement<std::string>( progress_description_key, "Organizing data..." );
+                    m_model->updateElement<int>( progress_counter_key, 0 );
+                    bridge->process();
+
+                    if( cacheable && (bridge->cellCount() >= bridge::PolyhedralMeshCache::minimum_cells) ) {
+                        m_model->updateElement<std::string>( progress_description_key, "Caching tessellation..." );
+                        bridge::PolyhedralMeshCache::store( cmd.m_source_file, key, *bridge );
+                    }
+                }
+
+                bridge->setPartListener( bridge::PolyhedralMeshBridge::PartListener() );
+
                 Response rsp;
                 rsp.m_type = RESPONSE_SOURCE;
                 rsp.m_source = source;
-                rsp.m_mesh_bridge = bridge;
+                if( parts ) {
+                    // The last part has the rest of the output, and all the
+                    // cells unless every cell was in a part already.
+                    boost::shared_ptr<Part> part( new Part );
+                    std::vector<bridge::PolyhedralMeshBridge::Index> cell_ranges;
+                    if( posted_cells != bridge->cellCount() ) {
+                        cell_ranges.push_back( 0 );
+                        cell_ranges.push_back( bridge->cellCount() );
+                    }
+                    bridge->extract( *part, posted, cell_ranges );
+                    rsp.m_mesh_part = part;
+                }
+                else {
+                    rsp.m_mesh_bridge = bridge;
+                }
                 postResponse( cmd, rsp );
             }
             else if( polygon_source ) {
@@ -292,6 +392,32 @@ ASyncReader::handleReadSolution( const Command& cmd )
 }
 
 
+void
+ASyncReader::handleFollow()
+{
+    Logger log = getLogger( package + ".handleFollow" );
+    for( auto it=m_followed.begin(); it!=m_followed.end(); ) {
+        boost::shared_ptr<dataset::CornerpointGrid> grid = it->lock();
+        if( !grid ) {
+            // Source has been closed.
+            it = m_followed.erase( it );
+            continue;
+        }
+        if( grid->pollRestart() ) {
+            Command cmd;
+            {
+                std::unique_lock<std::mutex> lock( m_cmd_queue_lock );
+                cmd.m_ticket = m_ticket_counter++;
+            }
+            Response rsp;
+            rsp.m_type = RESPONSE_TIMESTEPS;
+            rsp.m_source = grid;
+            postResponse( cmd, rsp );
+        }
+        ++it;
+    }
+}
+
 void
 ASyncReader::worker( ASyncReader* that )
 {
@@ -313,6 +439,9 @@ ASyncReader::worker( ASyncReader* that )
                 break;
             }
         }
+        else {
+            that->handleFollow();
+        }
     }
     LOGGER_DEBUG( log, "weee!" );
 }
@@ -16,15 +16,21 @@
  */
 
 #pragma once
+#include <list>
 #include <memory>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <boost/weak_ptr.hpp>
 #include <tinia/model/ExposedModel.hpp>
 #include "dataset/AbstractDataSource.hpp"
 #include "bridge/PolyhedralMeshBridge.hpp"
 #include "bridge/FieldBridge.hpp"
 
+namespace dataset {
+    class CornerpointGrid;
+}
+
 class ASyncReader
 {
 public:
@@ -34,7 +40,8 @@ public:
     enum ResponseType {
         RESPONSE_NONE,
         RESPONSE_SOURCE,
-        RESPONSE_FIELD
+        RESPONSE_FIELD,
+        RESPONSE_TIMESTEPS
     };
     
     
@@ -44,23 +51,37 @@ public:
      *
      * creates and updates 'asyncreader_progress' which is used to notify
      * progress and that reading is finished.
+     *
+     * If follow is set, the restart file of the source is watched, and a
+     * RESPONSE_TIMESTEPS is posted when a running simulation has appended
+     * report steps.
      */
     bool
     issueOpenSource( const std::string&  file,
                      int                 refine_i = 1,
                      int                 refine_j = 1,
                      int                 refine_k = 1,
-                     bool                triangulate = false );
+                     bool                triangulate = false,
+                     bool                follow = false );
     
     bool
     issueFetchField( boost::shared_ptr<dataset::AbstractDataSource> source,
                      size_t                                               field_index,
                      size_t                                               timestep_index );
 
+    /** Get the geometry of an opened source.
+     *
+     * The geometry of a polyhedral source is delivered in parts while it is
+     * tessellated, a part has a null mesh_bridge and a mesh_part that is to
+     * be appended to the parts before it. If any parts were delivered, the
+     * last part completes the geometry and no mesh_bridge follows, otherwise
+     * the whole geometry is delivered as a mesh_bridge.
+     */
     bool
-    getSource( boost::shared_ptr< dataset::AbstractDataSource >&  source,
-               std::string&                                       source_file,
-               boost::shared_ptr<bridge::AbstractMeshBridge>&     mesh_bridge );
+    getSource( boost::shared_ptr< dataset::AbstractDataSource >&                  source,
+               std::string&                                                       source_file,
+               boost::shared_ptr<bridge::AbstractMeshBridge>&                     mesh_bridge,
+               boost::shared_ptr<const bridge::PolyhedralMeshBridge::Part>&       mesh_part );
 
 
     bool
@@ -69,6 +90,10 @@ public:
               size_t&                                                 timestep_index,
               boost::shared_ptr< bridge::FieldBridge >&               field_bridge );
 
+    /** Get a source that has new report steps, see dataset::CornerpointGrid::appendRestartSteps. */
+    bool
+    getTimesteps( boost::shared_ptr< dataset::AbstractDataSource >&  source );
+
     /** Check if there are any responses pending, and if so, return type of the oldest. */
     ResponseType
     checkForResponse();
@@ -90,6 +115,7 @@ protected:
         int                                             m_refine_j;
         int                                             m_refine_k;
         bool                                            m_triangulate;
+        bool                                            m_follow;
         boost::shared_ptr<dataset::AbstractDataSource>  m_source;
         size_t                                          m_field_index;
         size_t                                          m_timestep_index;
@@ -100,6 +126,7 @@ protected:
         ResponseType                                    m_type;
         boost::shared_ptr<dataset::AbstractDataSource>  m_source;
         boost::shared_ptr<bridge::AbstractMeshBridge>   m_mesh_bridge;
+        boost::shared_ptr<const bridge::PolyhedralMeshBridge::Part>  m_mesh_part;
         boost::shared_ptr<bridge::FieldBridge>          m_field_bridge;
         std::string                                     m_source_file;
         size_t                                          m_field_index;
@@ -115,6 +142,9 @@ protected:
     std::list<Response>                            m_rsp_queue;
     std::mutex                                     m_rsp_queue_lock;
 
+    /** Sources whose restart files are followed, only accessed by the worker. */
+    std::list< boost::weak_ptr<dataset::CornerpointGrid> >   m_followed;
+
     std::thread                                    m_worker;
 
     void
@@ -123,6 +153,16 @@ protected:
     void
     handleReadSolution( const Command& cmd );
 
+    /** Poll followed sources for new report steps. */
+    void
+    handleFollow();
+
+    /** Get the next command.
+     *
+     * Waits for a command, but only for a while when sources are followed.
+     *
+     * \returns False if no command arrived in time.
+     */
     bool
     getCommand( Command& cmd );
 
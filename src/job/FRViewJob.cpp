@@ -448,7 +448,8 @@ FRViewJob::loadFile( const std::string& filename )
                                      m_source_selector.file().refineI(),
                                      m_source_selector.file().refineJ(),
                                      m_source_selector.file().refineK(),
-                                     m_source_selector.file().triangulate() );
+                                     m_source_selector.file().triangulate(),
+                                     m_source_selector.file().follow() );
 }
 
 void
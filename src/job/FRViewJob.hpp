@@ -241,6 +241,10 @@ private:
     void
     handleFetchField();
 
+    /** Make report steps appended to a followed restart file visible. */
+    void
+    handleFetchTimesteps();
+
     /** Performs the GPGPU passes, if needed. */
     void
     doCompute();
@@ -71,10 +71,48 @@ FRViewJob::handleFetchSource()
     shared_ptr< AbstractDataSource > source;
     std::string source_file;
     shared_ptr< AbstractMeshBridge > mesh_bridge;
-    if( !m_async_reader->getSource( source, source_file, mesh_bridge ) ) {
+    shared_ptr< const PolyhedralMeshBridge::Part > mesh_part;
+    if( !m_async_reader->getSource( source, source_file, mesh_bridge, mesh_part ) ) {
         return; // Nothing.
     }
 
+    if( mesh_part ) {
+        // A part of a geometry that is being tessellated, the first part
+        // adds the source, the following parts grow its mesh in place.
+        bool found = false;
+        for( size_t i=0; i<m_source_items.size(); i++ ) {
+            boost::shared_ptr<SourceItem> si = m_source_items[i];
+            if( si->m_source != source ) {
+                continue;
+            }
+            if( !found ) {
+                shared_ptr<PolyhedralMeshGPUModel> gpu_polyhedronmesh =
+                        dynamic_pointer_cast<PolyhedralMeshGPUModel>( si->m_grid_tess );
+                if( gpu_polyhedronmesh ) {
+                    gpu_polyhedronmesh->append( *mesh_part );
+                }
+                found = true;
+            }
+            si->m_do_update_subset = true;
+            si->m_do_update_renderlist = true;
+            if( i == m_current_item ) {
+                m_grid_stats.update( si->m_source, si->m_grid_tess );
+            }
+        }
+        if( found ) {
+            m_renderlist_update_revision = true;
+        }
+        else {
+            LOGGER_DEBUG( log, "Adding polyhedral mesh in parts (source " << m_source_items.size() << ")." );
+
+            shared_ptr<PolyhedralMeshGPUModel> gpu_polyhedronmesh( new PolyhedralMeshGPUModel );
+            gpu_polyhedronmesh->append( *mesh_part );
+
+            addSource( source, source_file, gpu_polyhedronmesh );
+        }
+        return;
+    }
+
 
     shared_ptr<PolyhedralMeshBridge> polyhedral_bridge =
             dynamic_pointer_cast<PolyhedralMeshBridge>( mesh_bridge );
@@ -233,6 +271,58 @@ FRViewJob::handleFetchField()
 }
 
 
+void
+FRViewJob::handleFetchTimesteps()
+{
+    Logger log = getLogger( package + ".handleFetchTimesteps" );
+
+    shared_ptr<AbstractDataSource> source;
+    if( !m_async_reader->getTimesteps( source ) ) {
+        return;
+    }
+    shared_ptr<dataset::CornerpointGrid> grid = dynamic_pointer_cast<dataset::CornerpointGrid>( source );
+    if( !grid ) {
+        return;
+    }
+    const size_t imported = grid->appendRestartSteps();
+    if( imported == 0 ) {
+        return;
+    }
+    LOGGER_DEBUG( log, "Imported " << imported << " report steps [source=" << source->name() << "]" );
+
+    for( size_t i=0; i<m_source_items.size(); i++ ) {
+        boost::shared_ptr<SourceItem> si = m_source_items[i];
+        if( si->m_source != source ) {
+            continue;
+        }
+        si->m_timestep_num = (int)grid->timesteps();
+        if( (int)grid->fields() != si->m_field_num ) {
+            si->m_field_num = grid->fields();
+            si->m_field_names.resize( 1 );  // keep [none]
+            for( int k=0; k<si->m_field_num; k++ ) {
+                si->m_field_names.push_back( grid->fieldName(k) );
+            }
+        }
+        if( i == m_current_item ) {
+            int timestep_max = std::max( 1, si->m_timestep_num )-1;
+            m_model->updateRestrictions( "field_solution",
+                                         si->m_field_names[ si->m_field_current ],
+                                         si->m_field_names );
+            m_model->updateRestrictions( "field_select_solution",
+                                         si->m_field_names[ si->m_field_current ],
+                                         si->m_field_names );
+            m_model->updateConstraints<int>( "field_report_step",
+                                             si->m_timestep_current,
+                                             0,
+                                             timestep_max );
+            m_model->updateConstraints<int>( "field_select_report_step",
+                                             si->m_timestep_current,
+                                             0,
+                                             timestep_max );
+        }
+    }
+}
+
 void
 FRViewJob::fetchData()
 {
@@ -255,6 +345,9 @@ FRViewJob::fetchData()
         case ASyncReader::RESPONSE_FIELD:
             handleFetchField();
             break;
+        case ASyncReader::RESPONSE_TIMESTEPS:
+            handleFetchTimesteps();
+            break;
         }
     }
 }
@@ -30,6 +30,7 @@ namespace models {
     static const string file_refine_k_key = "file_refine_k";
     static const string file_preprocess_label_key = "file_preprocess";
     static const string file_triangulate_option_key = "file_triangulate";
+    static const string file_follow_option_key = "file_follow";
 //    static const std::string _key = "";
 
 
@@ -40,7 +41,8 @@ File::File( boost::shared_ptr<tinia::model::ExposedModel>& model, Logic& logic )
       m_refine_i( 1 ),
       m_refine_j( 1 ),
       m_refine_k( 1 ),
-      m_triangulate( true )
+      m_triangulate( true ),
+      m_follow( false )
 {
     m_model->addElement<bool>( file_tab_key, false, "Add source" );
 //    m_model->addElement<bool>( file_tab_visible_key, false );
@@ -67,6 +69,8 @@ File::File( boost::shared_ptr<tinia::model::ExposedModel>& model, Logic& logic )
     m_model->addElement<bool>( file_triangulate_option_key, m_triangulate, "Triangulate" );
     m_model->addStateListener( file_triangulate_option_key, this );
 
+    m_model->addElement<bool>( file_follow_option_key, m_follow, "Follow running simulation" );
+    m_model->addStateListener( file_follow_option_key, this );
 }
 
 File::~File()
@@ -128,6 +132,9 @@ File::stateElementModified( tinia::model::StateElement * stateElement )
     else if( key == file_triangulate_option_key ) {
         stateElement->getValue( m_triangulate );
     }
+    else if( key == file_follow_option_key ) {
+        stateElement->getValue( m_follow );
+    }
 }
 
 tinia::model::gui::Element*
@@ -165,10 +172,11 @@ File::guiFactory() const
 
     ElementGroup* pre_grp = new ElementGroup( file_preprocess_label_key );
     wrap->addChild( pre_grp );
-    Grid* pre_grid = new Grid( 2, 1 );
+    Grid* pre_grid = new Grid( 3, 1 );
     pre_grp->setChild( pre_grid );
     pre_grid->setChild( 0, 0, new CheckBox( file_triangulate_option_key ) );
-    pre_grid->setChild( 1, 0, new VerticalExpandingSpace );
+    pre_grid->setChild( 1, 0, new CheckBox( file_follow_option_key ) );
+    pre_grid->setChild( 2, 0, new VerticalExpandingSpace );
 
     return root;
 }
@@ -50,6 +50,10 @@ public:
     
     bool
     triangulate() const { return m_triangulate; }
+
+    /** True if the restart file should be followed while a simulation runs. */
+    bool
+    follow() const { return m_follow; }
     
     const std::string&
     titleKey() const;
@@ -74,6 +78,7 @@ protected:
     int                                             m_refine_j;
     int                                             m_refine_k;
     bool                                            m_triangulate;
+    bool                                            m_follow;
 
 
 };
@@ -0,0 +1,491 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ *
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Microbenchmark of the polygon triangulation of the polyhedral mesh bridge.
+//
+// Tessellates synthetic cornerpoint grids without triangulation and records
+// the polygons that the tessellator passes to the bridge, so that the mix of
+// polygon sizes is the one of tessellated grids: an unfaulted grid with only
+// quads and triangles, a faulted grid as in tessbench, and a grid with high
+// throws and many pinched cells, which produce polygons with many corners
+// along the faults. The polygons are then replayed into bridges, with and
+// without triangulation, by PolyhedralMeshBridge::addPolygon and by the
+// former implementation that allocated its scratch arrays for each polygon
+// and shifted them down for each ear. The time per polygon is reported and
+// the output of the two is compared.
+//
+// Usage: polybench [nx] [ny] [nz] [repetitions]
+
+#include <cstdlib>
+#include <limits>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <boost/shared_ptr.hpp>
+#include <glm/glm.hpp>
+#include <tinia/model/ExposedModel.hpp>
+#include "bridge/PolyhedralMeshBridge.hpp"
+#include "cornerpoint/Tessellator.hpp"
+#include "utils/ActiveCells.hpp"
+#include "utils/Logger.hpp"
+#include "utils/PerfTimer.hpp"
+
+namespace {
+
+typedef bridge::PolyhedralMeshBridge                Bridge;
+typedef Bridge::Index                               Index;
+typedef cornerpoint::Tessellator<Bridge>            Tessellator;
+
+/** Create a grid with slanted pillars, faults and pinched and inactive cells.
+  *
+  * With faults, the grid is also split by a fault through the middle, as in
+  * tessbench.
+  *
+  * \param faults   Percentage of the pillars that are faulted.
+  * \param pinches  Percentage of the cells that are pinched.
+  * \param throw_   Throw of the faulted pillars, the grid is 10 deep.
+  */
+void
+makeGrid( std::vector<float>&  coord,
+          std::vector<float>&  zcorn,
+          std::vector<int>&    actnum,
+          const unsigned int   nx,
+          const unsigned int   ny,
+          const unsigned int   nz,
+          const unsigned int   faults,
+          const unsigned int   pinches,
+          const float          throw_ )
+{
+    srand( 42 );
+    coord.resize( 6*(nx+1)*(ny+1) );
+    zcorn.resize( 8*nx*ny*nz );
+    actnum.resize( nx*ny*nz );
+    for( unsigned int j=0; j<=ny; j++ ) {
+        for( unsigned int i=0; i<=nx; i++ ) {
+            float* p = coord.data() + 6*(j*(nx+1)+i);
+            p[0] = i;
+            p[1] = j;
+            p[2] = 0.f;
+            p[3] = i + 0.1f*(j%3);
+            p[4] = j + 0.05f*(i%2);
+            p[5] = 1.f;
+        }
+    }
+    std::vector<float> throws( nx*ny );
+    for( size_t i=0; i<throws.size(); i++ ) {
+        throws[i] = (unsigned int)(rand()%100) < faults ? throw_*(rand()%3) : 0.f;
+    }
+    for( unsigned int k=0; k<nz; k++ ) {
+        for( unsigned int j=0; j<ny; j++ ) {
+            for( unsigned int i=0; i<nx; i++ ) {
+                const float base = throws[ i + nx*j ] + ( (faults != 0u) && (i >= nx/2) ? 0.5f : 0.f );
+                for( unsigned int kk=0; kk<2; kk++ ) {
+                    const bool pinch = (kk == 1) && ((unsigned int)(rand()%100) < pinches);
+                    for( unsigned int jj=0; jj<2; jj++ ) {
+                        for( unsigned int ii=0; ii<2; ii++ ) {
+                            const unsigned int l = pinch ? k : k + kk;
+                            zcorn[ 2*nx*2*ny*(2*k+kk) + 2*nx*(2*j+jj) + 2*i+ii ] =
+                                    base + (10.f*l)/nz + 0.01f*((i+ii)+(j+jj));
+                        }
+                    }
+                }
+                actnum[ i + nx*j + nx*ny*k ] = (rand()%6 != 0) ? 1 : 0;
+            }
+        }
+    }
+}
+
+/** Bridge that records the polygons it has been given. */
+class Recorder : public Bridge
+{
+public:
+    Recorder() : Bridge( false ) {}
+
+    /** Extract the arguments of each addPolygon call from the output. */
+    void
+    record()
+    {
+        m_interfaces.clear();
+        m_segments.clear();
+        m_segment_offsets.assign( 1, 0u );
+        for( size_t p=0; p+1<m_polygon_offset.size(); p++ ) {
+            const Index a = m_polygon_info[ 2*p+0 ];
+            const Index b = m_polygon_info[ 2*p+1 ];
+            m_interfaces.push_back( Interface( a & IndexMask, b & IndexMask, ORIENTATION_I,
+                                               (a & IndexFlagHi) != 0u ) );
+            for( Index i=m_polygon_offset[p]; i<m_polygon_offset[p+1]; i++ ) {
+                const Index n = m_polygon_nrm_ix[i];
+                m_segments.push_back( Segment( n & IndexMask, m_polygon_vtx_ix[i],
+                                               ((n & IndexFlagHi) != 0u ? 1u : 0u) |
+                                               ((n & IndexFlagLo) != 0u ? 2u : 0u) ) );
+            }
+            m_segment_offsets.push_back( m_segments.size() );
+        }
+    }
+
+    /** Give a bridge the vertices and room for the polygons, as the tessellator would. */
+    void
+    prepare( Bridge& target, const bool triangulate ) const
+    {
+        target.reserveVertices( m_vertices.size() );
+        for( size_t i=0; i<m_vertices.size(); i++ ) {
+            target.addVertex( m_vertices[i] );
+        }
+        Mark sizes = target.mark();
+        sizes.m_vertices = 0u;
+        sizes.m_polygons = polygons();
+        sizes.m_indices = m_segments.size();
+        if( triangulate ) {
+            sizes.m_polygons = m_segments.size() - 2u*polygons();
+            sizes.m_indices = 3u*sizes.m_polygons;
+        }
+        target.reserve( sizes );
+    }
+
+    /** Pass the recorded polygons to a bridge. */
+    template<typename Target>
+    void
+    replay( Target& target ) const
+    {
+        for( size_t p=0; p<m_interfaces.size(); p++ ) {
+            target.addPolygon( m_interfaces[p],
+                               m_segments.data() + m_segment_offsets[p],
+                               m_segment_offsets[p+1] - m_segment_offsets[p] );
+        }
+    }
+
+    /** Number of polygons with n corners, for n < 17, and with more in the last. */
+    std::vector<size_t>
+    histogram() const
+    {
+        std::vector<size_t> h( 18, 0u );
+        for( size_t p=0; p<m_interfaces.size(); p++ ) {
+            h[ std::min( size_t(17), m_segment_offsets[p+1]-m_segment_offsets[p] ) ]++;
+        }
+        return h;
+    }
+
+    size_t
+    polygons() const
+    { return m_interfaces.size(); }
+
+private:
+    std::vector<Interface>  m_interfaces;
+    std::vector<Segment>    m_segments;
+    std::vector<size_t>     m_segment_offsets;
+};
+
+/** Bridge with the former triangulation of polygons. */
+class ReferenceBridge : public Bridge
+{
+public:
+    ReferenceBridge( bool triangulate ) : Bridge( triangulate ) {}
+
+    void
+    addPolygon( const Interface interface,
+                const Segment* segments,
+                const Index N );
+
+    /** True if the polygons are the same as in a bridge. */
+    bool
+    same( const ReferenceBridge& other ) const
+    {
+        return (m_polygon_info == other.m_polygon_info)
+            && (m_polygon_offset == other.m_polygon_offset)
+            && (m_polygon_vtx_ix == other.m_polygon_vtx_ix)
+            && (m_polygon_nrm_ix == other.m_polygon_nrm_ix);
+    }
+};
+
+void
+ReferenceBridge::addPolygon( const Interface interface,
+                            const Segment* segments,
+                            const Index no )
+{
+    uint N = no;
+    Logger log = getLogger( "polybench.addPolygon" );
+    if( N < 3 ) {
+        LOGGER_ERROR( log, "Got polygon with " << N << " vertices." );
+        return;
+    }
+
+    Index cell_a = interface.m_value[0];
+    Index cell_b = interface.m_value[1];
+
+    std::vector<Index> vtx_ix( N );
+    std::vector<Index> nrm_ix( N );
+    std::vector<glm::vec3> pos(N);
+    for(uint i=0; i<N; i++ ) {
+        vtx_ix[i] = segments[i].vertex();
+        nrm_ix[i] = segments[i].normal()
+                  | (segments[i].edgeA() ? IndexFlagHi : 0u)
+                  | (segments[i].edgeB() ? IndexFlagLo : 0u);
+        pos[i] = glm::vec3( m_vertices[ vtx_ix[i] ].x(),
+                            m_vertices[ vtx_ix[i] ].y(),
+                            m_vertices[ vtx_ix[i] ].z() );
+    }
+
+    // compute approximate normal and barycenter
+    // Newell's method (GPU gems III)
+    glm::vec3 n(0.f);
+    for(uint i=0; i<N; i++) {
+        glm::vec3 q = pos[i];
+        glm::vec3 r = pos[(i+1)%N];
+        n += glm::vec3( (q.y-r.y)*(q.z+r.z),
+                        (q.z-r.z)*(q.x+r.x),
+                        (q.x-r.x)*(q.y+r.y) );
+    }
+
+    // Check if polygon is convex
+    bool convex = true;
+    for( uint i=0; i<N && convex; i++ ) {
+        glm::vec3 q = pos[i];
+        glm::vec3 r = pos[(i+2)%N];
+        glm::vec3 b = r - q;
+        glm::vec3 m = glm::normalize( glm::cross( b, n ) );
+        float d = glm::dot( m, q );
+        if( glm::dot( pos[(i+1)%N], m ) - d < std::numeric_limits<float>::epsilon() ) {
+            convex = false;
+        }
+        for( uint k=3; k<N && convex; k++) {
+            if( glm::dot( pos[(i+k)%N], m ) - d > -std::numeric_limits<float>::epsilon() ) {
+                convex = false;
+            }
+        }
+    }
+    if( convex ) {
+        cell_a = cell_a | IndexFlagLo;
+        cell_b = cell_b | IndexFlagLo;
+    }
+
+    if( !m_triangulate ) {
+        m_polygon_info.push_back( cell_a );
+        m_polygon_info.push_back( cell_b );
+        std::copy_n( nrm_ix.begin(), N, std::back_inserter( m_polygon_nrm_ix ) );
+        std::copy_n( vtx_ix.begin(), N, std::back_inserter( m_polygon_vtx_ix ) );
+        m_polygon_offset.push_back( m_polygon_vtx_ix.size() );
+    }
+    else {
+
+        uint s = 0;
+        if( N > 3) {
+            if( N > 4 ) {
+                glm::vec3 b(0.f);
+                for(uint i=0; i<N; i++) {
+                    b += pos[i];
+                }
+                b = (1.f/N)*b;
+                glm::vec3 na = glm::abs(n);
+                glm::vec3 m;
+                if( (na.x < na.y) && (na.x < na.z) ) {
+                    m = glm::vec3( 1.f, 0.f, 0.f );
+                }
+                else if( na.y < na.z ) {
+                    m = glm::vec3( 0.f, 1.f, 0.f );
+                }
+                else {
+                    m = glm::vec3( 0.f, 0.f, 1.f );
+                }
+                glm::vec3 u = glm::normalize( m - (glm::dot(m,n)/glm::dot(n,n))*n );
+                glm::vec3 v = glm::normalize( glm::cross( n,u ) );
+                // project to plane
+                std::vector<glm::vec2> pos2( N );
+                for( uint i=0; i<N; i++ ) {
+                    glm::vec3 t = pos[i]-b;
+                    pos2[i] = glm::vec2( glm::dot(u, t), glm::dot(v, t) );
+                }
+
+                while( N > 4 ) {
+                    glm::uvec3 ear(0,1,2);
+                    // Search backwards so we minimize the amount data shift
+                    for(uint i=N; i>0; i--) {
+                        glm::uvec3 j( i-1, i%N, (i+1)%N );
+                        glm::vec2 a = pos2[ j.x ];
+                        glm::vec2 b = pos2[ j.y ];
+                        glm::vec2 c = pos2[ j.z ];
+                        glm::vec2 ab = b-a;
+                        glm::vec2 ac = c-a;
+                        float det = (ab.x*ac.y) - (ac.x*ab.y);
+                        // Is current triangle a convex corner?
+                        if( det > 1e-6 ) {
+                            bool success = true;
+                            // Is current triangle void of other points?
+                            for(uint k=3; k<N; k++) {
+                                uint l = (j.x+k)%N;
+                                glm::vec2 p = pos2[ l ];
+
+                                if( ((p.x-a.x)*ab.y) - (ab.x*(p.y-a.y)) > 0.f ) {   // ab
+                                    if( ((p.x-c.x)*ac.y) - (ac.x*(p.y-c.y)) < 0.f ) {   // ca
+                                        glm::vec2 bc = c-b;
+                                        if( ((p.x-b.x)*bc.y) - (bc.x*(p.y-b.y)) > 0.f ) {   // bc
+                                            success = false;
+                                            break;
+                                        }
+                                    }
+                                }
+                            }
+                            if( success ) {
+                                ear = j;
+                                break;
+                            }
+                        }
+                    }
+
+                    // emit ear
+                    m_polygon_info.push_back( cell_a );
+                    m_polygon_info.push_back( cell_b );
+                    m_polygon_nrm_ix.push_back( nrm_ix[ ear.x ] );
+                    m_polygon_nrm_ix.push_back( nrm_ix[ ear.y ] );
+                    m_polygon_nrm_ix.push_back( nrm_ix[ ear.x ] & IndexMask );
+                    m_polygon_vtx_ix.push_back( vtx_ix[ ear.x ] );
+                    m_polygon_vtx_ix.push_back( vtx_ix[ ear.y ] );
+                    m_polygon_vtx_ix.push_back( vtx_ix[ ear.z ] );
+                    m_polygon_offset.push_back( m_polygon_vtx_ix.size() );
+
+                    // Decrease polygon count and shift data
+                    N--;
+                    nrm_ix[ ear.x ] = nrm_ix[ ear.x ] & IndexMask;
+                    for( uint k=ear.y; k<N; k++ ) {
+                        nrm_ix[k] = nrm_ix[k+1];
+                        vtx_ix[k] = vtx_ix[k+1];
+                        pos2[k] = pos2[k+1];
+                    }
+                }
+            }
+            glm::vec3 ab = pos[1]-pos[0];
+            glm::vec3 bc = pos[2]-pos[1];
+            glm::vec3 cd = pos[3]-pos[2];
+            glm::vec3 da = pos[0]-pos[3];
+            float c0 = glm::dot( glm::cross( ab, bc ), glm::cross( cd, da ) );
+            float c1 = glm::dot( glm::cross( bc, cd ), glm::cross( da, ab ) );
+            if( c1 > c0 ) {
+                s = 1;
+            }
+            // emit first triangle of quad
+            m_polygon_info.push_back( cell_a );
+            m_polygon_info.push_back( cell_b );
+            m_polygon_nrm_ix.push_back( nrm_ix[ 2+s     ] );
+            m_polygon_nrm_ix.push_back( nrm_ix[ (3+s)%4 ] );
+            m_polygon_nrm_ix.push_back( nrm_ix[ 0+s     ]  & IndexMask );
+            m_polygon_vtx_ix.push_back( vtx_ix[ 2+s     ] );
+            m_polygon_vtx_ix.push_back( vtx_ix[ (3+s)%4 ] );
+            m_polygon_vtx_ix.push_back( vtx_ix[ 0+s     ] );
+            m_polygon_offset.push_back( m_polygon_vtx_ix.size() );
+
+            nrm_ix[ 2+s ] = nrm_ix[ 2+s ] & IndexMask;
+        }
+        m_polygon_info.push_back( cell_a );
+        m_polygon_info.push_back( cell_b );
+        m_polygon_nrm_ix.push_back( nrm_ix[ 0+s ] );
+        m_polygon_nrm_ix.push_back( nrm_ix[ 1+s ] );
+        m_polygon_nrm_ix.push_back( nrm_ix[ 2+s ] );
+        m_polygon_vtx_ix.push_back( vtx_ix[ 0+s ] );
+        m_polygon_vtx_ix.push_back( vtx_ix[ 1+s ] );
+        m_polygon_vtx_ix.push_back( vtx_ix[ 2+s ] );
+        m_polygon_offset.push_back( m_polygon_vtx_ix.size() );
+    }
+}
+
+
+/** Replay the polygons into a bridge and return the time in seconds. */
+template<typename Target>
+double
+replay( boost::shared_ptr<ReferenceBridge>& bridge,
+        const Recorder&                     recorder,
+        const bool                          triangulate,
+        const unsigned int                  repetitions )
+{
+    double t = std::numeric_limits<double>::max();
+    for( unsigned int r=0; r<repetitions; r++ ) {
+        bridge.reset( new ReferenceBridge( triangulate ) );
+        recorder.prepare( *bridge, triangulate );
+        PerfTimer start;
+        recorder.replay( static_cast<Target&>( *bridge ) );
+        PerfTimer stop;
+        t = std::min( t, PerfTimer::delta( start, stop ) );
+    }
+    return t;
+}
+
+} // of anonymous namespace
+
+int
+main( int argc, char** argv )
+{
+    const unsigned int nx = argc > 1 ? atoi( argv[1] ) : 100;
+    const unsigned int ny = argc > 2 ? atoi( argv[2] ) : 100;
+    const unsigned int nz = argc > 3 ? atoi( argv[3] ) : 50;
+    const unsigned int repetitions = argc > 4 ? atoi( argv[4] ) : 5;
+
+    struct Case {
+        const char*     m_name;
+        unsigned int    m_faults;
+        unsigned int    m_pinches;
+        float           m_throw;
+    };
+    const Case cases[] = {
+        { "unfaulted", 0, 0, 0.f },
+        { "faulted", 20, 5, 0.37f },
+        { "pinched", 50, 30, 1.1f }
+    };
+
+    bool ok = true;
+    for( unsigned int c=0; c<sizeof(cases)/sizeof(cases[0]); c++ ) {
+        std::vector<float> coord;
+        std::vector<float> zcorn;
+        std::vector<int> actnum;
+        makeGrid( coord, zcorn, actnum, nx, ny, nz,
+                  cases[c].m_faults, cases[c].m_pinches, cases[c].m_throw );
+        utils::ActiveCells active_cells;
+        active_cells.build( actnum.data(), actnum.size() );
+
+        Recorder recorder;
+        {
+            boost::shared_ptr<tinia::model::ExposedModel> model( new tinia::model::ExposedModel );
+            Tessellator tessellator( recorder );
+            tessellator.tessellate( model, "what", "progress",
+                                    nx, ny, nz, 1,
+                                    coord, zcorn, active_cells );
+        }
+        recorder.record();
+
+        const std::vector<size_t> h = recorder.histogram();
+        std::cout << cases[c].m_name << ": " << recorder.polygons() << " polygons, corners:";
+        for( size_t n=3; n<h.size(); n++ ) {
+            if( h[n] != 0u ) {
+                std::cout << " " << n << (n+1 == h.size() ? "+" : "" ) << "="
+                          << std::setprecision(3) << (100.0*h[n])/recorder.polygons() << "%";
+            }
+        }
+        std::cout << std::endl;
+
+        for( int triangulate=0; triangulate<2; triangulate++ ) {
+            boost::shared_ptr<ReferenceBridge> a;
+            boost::shared_ptr<ReferenceBridge> b;
+            const double t_ref = replay<ReferenceBridge>( a, recorder, triangulate != 0, repetitions );
+            const double t_new = replay<Bridge>( b, recorder, triangulate != 0, repetitions );
+            const bool equal = a->same( *b );
+            ok = ok && equal;
+            std::cout << "    " << (triangulate ? "triangulated" : "polygons    ")
+                      << std::setw(10) << std::setprecision(4) << (1e9*t_ref)/recorder.polygons() << " ns"
+                      << std::setw(10) << std::setprecision(4) << (1e9*t_new)/recorder.polygons() << " ns"
+                      << std::setw(8) << std::setprecision(3) << (t_ref/t_new) << "x"
+                      << (equal ? "" : "  output differs!" ) << std::endl;
+        }
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -45,7 +45,25 @@ GridField::import(boost::shared_ptr<const bridge::FieldBridge> bridge,
 
     LOGGER_DEBUG( log, "bridge->count=" << bridge->count() << ", cellCount=" << m_cell_set->cellCount() );
 
-    if( true || bridge->count() == m_cell_set->cellCount() ) {
+    const std::vector<GLuint>& order = m_cell_set->cellOrderInHostMemory();
+    if( !order.empty() ) {
+        // compacted data of cells that have been reordered
+        std::vector<GLfloat> values( order.size() );
+        const float* data = bridge->values();
+        for(size_t i=0; i<values.size(); i++ ) {
+            values[i] = order[i] < bridge->count() ? data[ order[i] ] : 0.f;
+        }
+        glBindBuffer( GL_TEXTURE_BUFFER, m_buffer.get() );
+        glBufferData( GL_TEXTURE_BUFFER,
+                      sizeof(float)*values.size(),
+                      values.data(),
+                      GL_STATIC_DRAW );
+        glBindBuffer( GL_TEXTURE_BUFFER, 0 );
+
+        m_min_value = bridge->minimum();
+        m_max_value = bridge->maximum();
+    }
+    else if( true || bridge->count() == m_cell_set->cellCount() ) {
         // compacted data
         glBindBuffer( GL_TEXTURE_BUFFER, m_buffer.get() );
         glBufferData( GL_TEXTURE_BUFFER,
@@ -15,14 +15,117 @@
  * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
 #include "render/mesh/AbstractMeshGPUModel.hpp"
 
+namespace {
+
+/** Round v in [0,1] to a normalized 16-bit integer. */
+GLushort
+quantize( const GLfloat v )
+{
+    return (GLushort)std::floor( 65535.f*std::max( 0.f, std::min( 1.f, v ) ) + 0.5f );
+}
+
+}
+
 namespace render {
 namespace mesh {
 
+const GLfloat AbstractMeshGPUModel::identity_decode[16] = {
+    1.f, 0.f, 0.f, 0.f,
+    0.f, 1.f, 0.f, 0.f,
+    0.f, 0.f, 1.f, 0.f,
+    0.f, 0.f, 0.f, 1.f
+};
+
 AbstractMeshGPUModel::~AbstractMeshGPUModel()
 {
 }
 
+const GLuint*
+AbstractMeshGPUModel::gpuIndices( std::vector<GLuint>&  scratch,
+                                  const Index*          src,
+                                  const size_t          n,
+                                  const bool            flagged )
+{
+#ifdef FRVIEW_INDEX64
+    typedef bridge::AbstractMeshBridge Bridge;
+    scratch.resize( n );
+    if( flagged ) {
+        for( size_t i=0; i<n; i++ ) {
+            const Index ix = src[i] & Bridge::IndexMask;
+            if( (0x3fffffffu <= ix) && (ix != Bridge::IndexMask) ) {
+                throw std::runtime_error( "AbstractMeshGPUModel: index too large for the GPU" );
+            }
+            scratch[i] = (ix == Bridge::IndexMask ? 0x3fffffffu : (GLuint)ix)
+                       | ((GLuint)(src[i] >> (Bridge::IndexBits-2u)) << 30u);
+        }
+    }
+    else {
+        for( size_t i=0; i<n; i++ ) {
+            if( 0xffffffffu < src[i] ) {
+                throw std::runtime_error( "AbstractMeshGPUModel: index too large for the GPU" );
+            }
+            scratch[i] = (GLuint)src[i];
+        }
+    }
+    return scratch.data();
+#else
+    return src;
+#endif
+}
+
+void
+AbstractMeshGPUModel::positionFrame( GLfloat*        decode,
+                                     const GLfloat*  minimum,
+                                     const GLfloat*  maximum )
+{
+    std::copy( identity_decode, identity_decode + 16, decode );
+    for( unsigned int k=0; k<3; k++ ) {
+        const GLfloat extent = maximum[k] - minimum[k];
+        decode[ 5*k ] = extent > 0.f ? extent : 1.f;
+        decode[ 12+k ] = minimum[k];
+    }
+}
+
+void
+AbstractMeshGPUModel::encodePosition( GLushort*       dst,
+                                      const GLfloat*  decode,
+                                      const GLfloat   x,
+                                      const GLfloat   y,
+                                      const GLfloat   z )
+{
+    dst[0] = quantize( (x - decode[12])/decode[0] );
+    dst[1] = quantize( (y - decode[13])/decode[5] );
+    dst[2] = quantize( (z - decode[14])/decode[10] );
+    dst[3] = 65535u;
+}
+
+void
+AbstractMeshGPUModel::encodeNormal( GLushort*      dst,
+                                    const GLfloat  x,
+                                    const GLfloat  y,
+                                    const GLfloat  z )
+{
+    const GLfloat l1 = std::fabs( x ) + std::fabs( y ) + std::fabs( z );
+    if( !(l1 > 0.f) ) {
+        dst[0] = dst[1] = quantize( 0.5f );
+        return;
+    }
+    GLfloat u = x/l1;
+    GLfloat v = y/l1;
+    if( z < 0.f ) {
+        // fold the lower hemisphere over the diagonals
+        const GLfloat t = u;
+        u = (1.f - std::fabs( v ))*(t >= 0.f ? 1.f : -1.f);
+        v = (1.f - std::fabs( t ))*(v >= 0.f ? 1.f : -1.f);
+    }
+    dst[0] = quantize( 0.5f*u + 0.5f );
+    dst[1] = quantize( 0.5f*v + 0.5f );
+}
+
 } // of namespace mesh
 } // of namespace render
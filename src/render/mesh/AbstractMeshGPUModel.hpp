@@ -16,7 +16,9 @@
  * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <GL/glew.h>
+#include <vector>
 #include <boost/utility.hpp>
+#include "bridge/AbstractMeshBridge.hpp"
 
 namespace render {
 namespace mesh {
@@ -28,8 +30,76 @@ public:
     ~AbstractMeshGPUModel();
     
 protected:
-    
-    
+    typedef bridge::AbstractMeshBridge::Index Index;
+
+    /** Get indices of a mesh bridge in the layout of the GPU buffers.
+     *
+     * The GPU buffers hold 32-bit indices, as buffer textures cannot address
+     * more texels anyway. Indices with flags have them in bits 30 and 31, and
+     * the index in bits 0..29, where 0x3fffffffu means no cell. This is the
+     * layout of the bridges with 32-bit indices, which is passed through as
+     * is. With 64-bit indices (FRVIEW_INDEX64), the indices are packed into
+     * scratch.
+     *
+     * \param scratch  Storage for the packed indices.
+     * \param src      The n indices of the bridge.
+     * \param flagged  True if the indices carry flags in the two upper bits.
+     * \returns        The n indices in the GPU layout.
+     * \throws std::runtime_error if an index does not fit the GPU layout.
+     */
+    static const GLuint*
+    gpuIndices( std::vector<GLuint>&  scratch,
+                const Index*          src,
+                const size_t          n,
+                const bool            flagged );
+
+    /** Column-major matrix that maps positions stored as floats to themselves. */
+    static const GLfloat    identity_decode[16];
+
+    /** Set up the frame of positions stored compactly within a box.
+     *
+     * \param decode   Column-major matrix that maps [0,1]^3 onto the box, a
+     *                 box without extent along an axis is given extent 1.
+     * \param minimum  Minimum corner of the box.
+     * \param maximum  Maximum corner of the box.
+     */
+    static void
+    positionFrame( GLfloat*        decode,
+                   const GLfloat*  minimum,
+                   const GLfloat*  maximum );
+
+    /** Encode a position as four normalized 16-bit integers in a frame.
+     *
+     * The position is rounded to the nearest of 65536 steps along each axis
+     * of the box, so the error is half a step, i.e., the extent of the box
+     * over 131070 along each axis (plus float rounding), and positions outside
+     * the box are clamped to it. W is encoded as 1.
+     *
+     * \param dst     Storage for the four integers.
+     * \param decode  The frame, see positionFrame().
+     */
+    static void
+    encodePosition( GLushort*       dst,
+                    const GLfloat*  decode,
+                    const GLfloat   x,
+                    const GLfloat   y,
+                    const GLfloat   z );
+
+    /** Encode a normal vector as two normalized 16-bit integers.
+     *
+     * The vector is normalized and mapped onto the octahedron and unfolded
+     * onto the unit square, which is rounded to 65536 steps along each axis.
+     * The angle between the original and the decoded vector is less than
+     * 0.004 degrees. A zero vector is encoded as [0,0,1].
+     *
+     * \param dst  Storage for the two integers.
+     */
+    static void
+    encodeNormal( GLushort*      dst,
+                  const GLfloat  x,
+                  const GLfloat  y,
+                  const GLfloat  z );
+
 };
 
 
@@ -48,6 +48,14 @@ public:
     virtual
     const std::vector<GLuint>&
     cellGlobalIndicesInHostMemory() const = 0;
+
+    /** Get the index in the order of the source, e.g., of field values, of each cell.
+      *
+      * Empty if the cells are in the order of the source.
+      */
+    virtual
+    const std::vector<GLuint>&
+    cellOrderInHostMemory() const = 0;
     
 };
 
@@ -27,15 +27,19 @@ public:
     virtual
     ~NormalVectorInterface();
 
-    /** Get 4-component normal vectors through a GL_RGBA32F buffer texture. */
+    /** Get normal vectors through a buffer texture, see normalVectorsOctahedral(). */
     virtual
     GLuint
     normalVectorsAsBufferTexture() const = 0;
 
-    /** Get 4-component normal vectors stored in host memory. */
+    /** True if normal vectors are octahedral maps in a GL_RG16 buffer texture instead of 4-component vectors in a GL_RGBA32F buffer texture.
+     *
+     * The map f in [0,1]^2 is decoded by letting n = [2f-1, 1-|2f_x-1|-|2f_y-1|]
+     * and, if n_z < 0, n_xy = (1-|n_yx|)*sign(n_xy), and then normalizing n.
+     */
     virtual
-    const std::vector<float>&
-    normalVectorsInHostMemory() const = 0;
+    bool
+    normalVectorsOctahedral() const = 0;
     
 };
 
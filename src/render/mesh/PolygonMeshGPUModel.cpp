@@ -257,12 +257,14 @@ PolygonMeshGPUModel::updatePolygons( boost::shared_ptr<const bridge::PolygonMesh
     }
 
     // --- per polygon data ----------------------------------------------------
+    std::vector<GLuint> scratch;
     glBindVertexArray( m_polygon_vao.get() );
     
     // polygon cell index data
     glBindBuffer( GL_ARRAY_BUFFER, m_polygon_cell_buf.get() );
     glBufferData( GL_ARRAY_BUFFER, sizeof(GLuint)*m_polygons_N,
-                  mesh_bridge->m_polygon_cell.data(), GL_STATIC_DRAW );
+                  gpuIndices( scratch, mesh_bridge->m_polygon_cell.data(), m_polygons_N, false ),
+                  GL_STATIC_DRAW );
 
     // enable fetch from VAO binding point 0
     glVertexAttribIPointer( 0, 1, GL_UNSIGNED_INT, 0, NULL );
@@ -271,7 +273,8 @@ PolygonMeshGPUModel::updatePolygons( boost::shared_ptr<const bridge::PolygonMesh
     // polygon offset data
     glBindBuffer( GL_ARRAY_BUFFER, m_polygon_offset_buf.get() );
     glBufferData( GL_ARRAY_BUFFER, sizeof(GLuint)*(m_polygons_N+1),
-                  mesh_bridge->m_polygon_offset.data(), GL_STATIC_DRAW );
+                  gpuIndices( scratch, mesh_bridge->m_polygon_offset.data(), m_polygons_N+1, false ),
+                  GL_STATIC_DRAW );
     
     // enable fetch of offset from VAO binding point 1
     glVertexAttribIPointer( 1, 1, GL_UNSIGNED_INT, sizeof(GLuint), NULL );
@@ -289,7 +292,8 @@ PolygonMeshGPUModel::updatePolygons( boost::shared_ptr<const bridge::PolygonMesh
     // vertex indices data
     glBindBuffer( GL_TEXTURE_BUFFER, m_polygon_vtx_buf.get() );
     glBufferData( GL_TEXTURE_BUFFER, sizeof(GLuint)*3*m_triangles_N,
-                  mesh_bridge->m_polygon_vtx_ix.data(), GL_STATIC_DRAW );
+                  gpuIndices( scratch, mesh_bridge->m_polygon_vtx_ix.data(), 3*m_triangles_N, false ),
+                  GL_STATIC_DRAW );
     glBindBuffer( GL_TEXTURE_BUFFER, 0 );
 
     // set up texture fetching vertex indices
@@ -300,7 +304,8 @@ PolygonMeshGPUModel::updatePolygons( boost::shared_ptr<const bridge::PolygonMesh
     // normal indices data
     glBindBuffer( GL_TEXTURE_BUFFER, m_polygon_nrm_buf.get() );
     glBufferData( GL_TEXTURE_BUFFER, sizeof(GLuint)*3*m_triangles_N,
-                  mesh_bridge->m_polygon_nrm_ix.data(), GL_STATIC_DRAW );
+                  gpuIndices( scratch, mesh_bridge->m_polygon_nrm_ix.data(), 3*m_triangles_N, true ),
+                  GL_STATIC_DRAW );
     glBindBuffer( GL_TEXTURE_BUFFER, 0 );
 
     // set up texture fetching normal indices
@@ -348,13 +353,16 @@ PolygonMeshGPUModel::updateCells( shared_ptr<const PolygonMeshBridge> mesh_bridg
     
     // currently assumed to be 8. If less, we duplicate vertices, if more, we
     // omit some (yes, incorrect result).
+    std::vector<GLuint> scratch;
+    const GLuint* cell_corners = gpuIndices( scratch, mesh_bridge->m_cell_corners.data(),
+                                             mesh_bridge->m_cell_corners.size(), false );
     m_cell_vertex_indices_host.resize( 8*m_cells_num );
 
     for(size_t c=0; c<(size_t)m_cells_num; c++ ) {
         size_t o = mesh_bridge->m_cell_offset[c];
         size_t n = mesh_bridge->m_cell_offset[c+1] - o;
         for( size_t i=0; i<8; i++ ) {
-            m_cell_vertex_indices_host[ 8*c + i ] = mesh_bridge->m_cell_corners[ o + (i%n) ];
+            m_cell_vertex_indices_host[ 8*c + i ] = cell_corners[ o + (i%n) ];
         }
     }
     
@@ -63,8 +63,8 @@ public:
     GLuint
     vertexPositionsAsBufferTexture() const { return m_vertex_positions_tex.get(); }
 
-    const std::vector<float>&
-    vertexPositionsInHostMemory() const { return m_vertex_positions_host; }
+    const float*
+    vertexPositionDecode() const { return identity_decode; }
     
     /** @} */
     // -------------------------------------------------------------------------
@@ -76,8 +76,8 @@ public:
     GLuint
     normalVectorsAsBufferTexture() const { return m_normal_vectors_tex.get(); }
 
-    const std::vector<float>&
-    normalVectorsInHostMemory() const { return m_normal_vectors_host; }
+    bool
+    normalVectorsOctahedral() const { return false; }
 
     /** @} */
     // -------------------------------------------------------------------------
@@ -98,6 +98,9 @@ public:
     const std::vector<GLuint>&
     cellGlobalIndicesInHostMemory() const { return m_cell_global_index_host; }
 
+    const std::vector<GLuint>&
+    cellOrderInHostMemory() const { return m_cell_order_host; }
+
     /** @} */
     // -------------------------------------------------------------------------
 
@@ -181,6 +184,7 @@ protected:
     /** @{ */
     GLsizei                 m_cells_num;                    ///< Number of cells.
     std::vector<GLuint>     m_cell_global_index_host;       ///< Host copy of global cell indices.
+    std::vector<GLuint>     m_cell_order_host;              ///< Always empty, the cells are in the order of the source.
     GLBuffer                m_cell_global_index_buf;        ///< Buffer object with global cell indices.
     GLTexture               m_cell_global_index_tex;        ///< Texture sampling \ref m_cell_global_index_buf.
     std::vector<GLuint>     m_cell_vertex_indices_host;     ///< Host copy of cell vertex indices.
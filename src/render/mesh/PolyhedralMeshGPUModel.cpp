@@ -20,6 +20,7 @@
 #include <stdlib.h>
 #include <algorithm>
 #include <tuple>
+#include <stdexcept>
 #include "bridge/PolyhedralMeshBridge.hpp"
 #include "render/mesh/PolyhedralMeshGPUModel.hpp"
 #include "render/GridField.hpp"
@@ -29,6 +30,57 @@
 
 namespace {
 const std::string package = "render.mesh.PolyhedralMeshGPUModel";
+
+/** Make room for count items in a buffer, keeping the first used items.
+ *
+ * The buffer is grown to at least hint items, and at least doubled, with the
+ * contents copied on the GPU.
+ *
+ * \returns The new capacity.
+ */
+GLsizei
+reserveBuffer( GLuint buffer,
+               const size_t item_size,
+               const GLsizei used,
+               const GLsizei capacity,
+               const GLsizei count,
+               const GLsizei hint )
+{
+    if( count <= capacity ) {
+        return capacity;
+    }
+    const GLsizei new_capacity = std::max( std::max( count, hint ), 2*capacity );
+    if( used > 0 ) {
+        render::GLBuffer tmp;
+        glBindBuffer( GL_COPY_READ_BUFFER, buffer );
+        glBindBuffer( GL_COPY_WRITE_BUFFER, tmp.get() );
+        glBufferData( GL_COPY_WRITE_BUFFER, item_size*used, NULL, GL_STREAM_COPY );
+        glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, item_size*used );
+        glBufferData( GL_COPY_READ_BUFFER, item_size*new_capacity, NULL, GL_STATIC_DRAW );
+        glCopyBufferSubData( GL_COPY_WRITE_BUFFER, GL_COPY_READ_BUFFER, 0, 0, item_size*used );
+        glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+        glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+    }
+    else {
+        glBindBuffer( GL_COPY_WRITE_BUFFER, buffer );
+        glBufferData( GL_COPY_WRITE_BUFFER, item_size*new_capacity, NULL, GL_STATIC_DRAW );
+        glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+    }
+    return new_capacity;
+}
+
+/** Copy count items to offset in a buffer. */
+template<typename T>
+void
+uploadRange( GLuint buffer, const GLsizei offset, const T* data, const size_t count )
+{
+    if( count > 0 ) {
+        glBindBuffer( GL_COPY_WRITE_BUFFER, buffer );
+        glBufferSubData( GL_COPY_WRITE_BUFFER, sizeof(T)*offset, sizeof(T)*count, data );
+        glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+    }
+}
+
 }
 
 namespace render {
@@ -36,20 +88,29 @@ namespace mesh {
 
 PolyhedralMeshGPUModel::PolyhedralMeshGPUModel()
     : m_vertices_num( 0 ),
+      m_vertices_capacity( 0 ),
+      m_vertices_compact( false ),
       m_vertex_positions_buf( package + ".m_vertex_positions_buf" ),
       m_vertex_positions_tex( package + ".m_vertex_positions_tex" ),
       m_vertex_positions_vao( package + ".m_vertex_positions_vao" ),
       m_normals_num( 0 ),
+      m_normals_capacity( 0 ),
+      m_normals_octahedral( false ),
       m_normal_vectors_buf( package + ".m_normal_vectors_buf" ),
       m_normal_vectors_tex( package + ".m_normal_vectors_tex" ),
       m_cells_num(0),
+      m_cells_capacity( 0 ),
       m_cell_global_index_buf( package + ".m_cell_global_index_buf" ),
       m_cell_global_index_tex( package + ".m_cell_global_index_tex" ),
       m_cell_vertex_indices_buf( package + ".m_cell_vertex_indices_buf" ),
       m_cell_vertex_indices_tex( package + ".m_cell_vertex_indices_tex" ),
       m_triangles_N(0),
       m_polygons_N( 0 ),
+      m_polygons_capacity( 0 ),
+      m_polygon_indices_N( 0 ),
+      m_polygon_indices_capacity( 0 ),
       m_polygon_vao( package + ".m_polygon_vao" ),
+      m_polygon_max_n( 0 ),
       m_polygon_info_buf( package + ".m_polygon_info_buf" ),
       m_polygon_offset_buf( package + ".m_polygon_offset_buf" ),
       m_polygon_vtx_buf( package + ".m_polygon_vtx_buf" ),
@@ -69,6 +130,7 @@ PolyhedralMeshGPUModel::PolyhedralMeshGPUModel()
     m_shift[0] = 0.f;
     m_shift[1] = 0.f;
     m_shift[2] = 0.f;
+    std::copy( identity_decode, identity_decode + 16, m_vertex_positions_decode );
 }
 
 PolyhedralMeshGPUModel::~PolyhedralMeshGPUModel()
@@ -83,18 +145,222 @@ PolyhedralMeshGPUModel::update( bridge::PolyhedralMeshBridge& bridge )
     if( bridge.m_vertices.empty() ) {
         return;
     }
+    updateBoundingBox( bridge );
     updateVertices( bridge );
     updateNormals( bridge );
-    updateBoundingBox( bridge );
     updateCells( bridge );
     updatePolygons( bridge );
 }
 
+void
+PolyhedralMeshGPUModel::append( const bridge::PolyhedralMeshBridge::Part& part )
+{
+    Logger log = getLogger( package + ".append" );
+
+    if( (part.m_from.m_vertices != (Index)m_vertices_num) ||
+        (part.m_from.m_normals  != (Index)m_normals_num) ||
+        (part.m_from.m_polygons != (Index)m_polygons_N) ||
+        (part.m_from.m_indices  != (Index)m_polygon_indices_N) )
+    {
+        throw std::runtime_error( "PolyhedralMeshGPUModel: part does not follow the mesh" );
+    }
+
+    // vertices, positions are stored compactly if the bridge knows a box that
+    // all vertices lie within up front, which fixes the frame.
+    if( m_vertices_num == 0 ) {
+        m_vertices_compact = false;
+#ifdef FRVIEW_COMPACT_GEOMETRY
+        m_vertices_compact = (part.m_bounds[0].x() <= part.m_bounds[1].x()) &&
+                             (part.m_bounds[0].y() <= part.m_bounds[1].y()) &&
+                             (part.m_bounds[0].z() <= part.m_bounds[1].z());
+#endif
+        if( m_vertices_compact ) {
+            positionFrame( m_vertex_positions_decode, part.m_bounds[0].v, part.m_bounds[1].v );
+        }
+        else {
+            std::copy( identity_decode, identity_decode + 16, m_vertex_positions_decode );
+        }
+    }
+    else if( m_vertices_compact ) {
+        growPositionFrame( part.m_bounds[0], part.m_bounds[1] );
+    }
+    const GLsizei vertices = m_vertices_num + part.m_vertices.size();
+    encodeVertices( part.m_vertices, m_vertices_num );
+    m_vertices_capacity = reserveBuffer( m_vertex_positions_buf.get(),
+                                         m_vertices_compact ? 4*sizeof(GLushort) : 4*sizeof(GLfloat),
+                                         m_vertices_num, m_vertices_capacity,
+                                         vertices, part.m_reserved.m_vertices );
+    uploadVertices( m_vertices_num, part.m_vertices.size() );
+
+    // the bounding box only grows
+    for( GLsizei i=m_vertices_num; i<vertices; i++ ) {
+        for( unsigned int k=0; k<3; k++ ) {
+            const float v = part.m_vertices[ i-m_vertices_num ].v[k];
+            m_bb_min[k] = i == 0 ? v : std::min( m_bb_min[k], v );
+            m_bb_max[k] = i == 0 ? v : std::max( m_bb_max[k], v );
+        }
+    }
+    m_vertices_num = vertices;
+    if( m_vertices_num > 0 ) {
+        updateScaleAndShift();
+    }
+
+    // normals
+    if( m_normals_num == 0 ) {
+        m_normals_octahedral = false;
+#ifdef FRVIEW_COMPACT_GEOMETRY
+        m_normals_octahedral = true;
+#endif
+    }
+    const GLsizei normals = m_normals_num + part.m_normals.size();
+    encodeNormals( part.m_normals, m_normals_num );
+    m_normals_capacity = reserveBuffer( m_normal_vectors_buf.get(),
+                                        m_normals_octahedral ? 2*sizeof(GLushort) : 4*sizeof(GLfloat),
+                                        m_normals_num, m_normals_capacity,
+                                        normals, part.m_reserved.m_normals );
+    uploadNormals( m_normals_num, part.m_normals.size() );
+    m_normals_num = normals;
+
+    // cells, the cell count is known up front but may grow, e.g., with the
+    // cells of local grid refinements. Parts are never reordered.
+    m_cell_order_host.clear();
+    if( m_cells_num < (GLsizei)part.m_cell_count ) {
+        m_cell_global_index_host.resize( part.m_cell_count );
+        m_cell_vertex_indices_host.resize( 8*part.m_cell_count );
+        const GLsizei capacity = m_cells_capacity;
+        reserveBuffer( m_cell_global_index_buf.get(), sizeof(GLuint),
+                       m_cells_num, capacity, part.m_cell_count, part.m_cell_count );
+        m_cells_capacity = reserveBuffer( m_cell_vertex_indices_buf.get(), 8*sizeof(GLuint),
+                                          m_cells_num, capacity, part.m_cell_count, part.m_cell_count );
+        // cells that are not delivered yet have no corners
+        uploadRange( m_cell_global_index_buf.get(), m_cells_num,
+                     m_cell_global_index_host.data() + m_cells_num, part.m_cell_count - m_cells_num );
+        uploadRange( m_cell_vertex_indices_buf.get(), 8*m_cells_num,
+                     m_cell_vertex_indices_host.data() + 8*m_cells_num, 8*(part.m_cell_count - m_cells_num) );
+        m_cells_num = part.m_cell_count;
+    }
+    std::vector<GLuint> scratch;
+    const GLuint* cell_index = gpuIndices( scratch, part.m_cell_index.data(), part.m_cell_index.size(), false );
+    std::vector<GLuint> scratch_corner;
+    const GLuint* cell_corner = gpuIndices( scratch_corner, part.m_cell_corner.data(), part.m_cell_corner.size(), false );
+    size_t o = 0;
+    for( size_t r=0; r+1<part.m_cell_ranges.size(); r+=2 ) {
+        const GLsizei b = part.m_cell_ranges[r];
+        const GLsizei e = part.m_cell_ranges[r+1];
+        if( (e < b) || (m_cells_num < e) ) {
+            throw std::runtime_error( "PolyhedralMeshGPUModel: cell range out of range" );
+        }
+        std::copy( cell_index + o,
+                   cell_index + o + (e-b),
+                   m_cell_global_index_host.begin() + b );
+        std::copy( cell_corner + 8*o,
+                   cell_corner + 8*(o + (e-b)),
+                   m_cell_vertex_indices_host.begin() + 8*b );
+        uploadRange( m_cell_global_index_buf.get(), b,
+                     m_cell_global_index_host.data() + b, e-b );
+        uploadRange( m_cell_vertex_indices_buf.get(), 8*b,
+                     m_cell_vertex_indices_host.data() + 8*b, 8*(e-b) );
+        o += e-b;
+    }
+
+    // polygons, the offsets of the part are past the end of each polygon,
+    // and the first offset is zero.
+    const GLsizei polygons = m_polygons_N + part.m_polygon_offset.size();
+    const GLsizei indices = m_polygon_indices_N + part.m_polygon_vtx_ix.size();
+    const GLsizei polygons_capacity = m_polygons_capacity;
+    reserveBuffer( m_polygon_info_buf.get(), 2*sizeof(GLuint),
+                   m_polygons_N, polygons_capacity, polygons, part.m_reserved.m_polygons );
+    m_polygons_capacity = reserveBuffer( m_polygon_offset_buf.get(), sizeof(GLuint),
+                                         m_polygons_N+1, polygons_capacity+1, polygons+1,
+                                         part.m_reserved.m_polygons+1 ) - 1;
+    const GLsizei indices_capacity = m_polygon_indices_capacity;
+    reserveBuffer( m_polygon_vtx_buf.get(), sizeof(GLuint),
+                   m_polygon_indices_N, indices_capacity, indices, part.m_reserved.m_indices );
+    m_polygon_indices_capacity = reserveBuffer( m_polygon_nrm_buf.get(), sizeof(GLuint),
+                                                m_polygon_indices_N, indices_capacity,
+                                                indices, part.m_reserved.m_indices );
+    if( m_polygons_N == 0 ) {
+        const GLuint zero = 0u;
+        uploadRange( m_polygon_offset_buf.get(), 0, &zero, 1 );
+    }
+    uploadRange( m_polygon_info_buf.get(), 2*m_polygons_N,
+                 gpuIndices( scratch, part.m_polygon_info.data(), part.m_polygon_info.size(), true ),
+                 part.m_polygon_info.size() );
+    uploadRange( m_polygon_offset_buf.get(), m_polygons_N+1,
+                 gpuIndices( scratch, part.m_polygon_offset.data(), part.m_polygon_offset.size(), false ),
+                 part.m_polygon_offset.size() );
+    uploadRange( m_polygon_vtx_buf.get(), m_polygon_indices_N,
+                 gpuIndices( scratch, part.m_polygon_vtx_ix.data(), part.m_polygon_vtx_ix.size(), false ),
+                 part.m_polygon_vtx_ix.size() );
+    uploadRange( m_polygon_nrm_buf.get(), m_polygon_indices_N,
+                 gpuIndices( scratch, part.m_polygon_nrm_ix.data(), part.m_polygon_nrm_ix.size(), true ),
+                 part.m_polygon_nrm_ix.size() );
+    Index begin = part.m_from.m_indices;
+    for( size_t i=0; i<part.m_polygon_offset.size(); i++ ) {
+        GLsizei N = (GLsizei)(part.m_polygon_offset[i] - begin);
+        m_triangles_N += (N-2);
+        m_polygon_max_n = std::max( m_polygon_max_n, N );
+        begin = part.m_polygon_offset[i];
+    }
+    m_polygons_N = polygons;
+    m_polygon_indices_N = indices;
+
+    bindBuffers();
+
+    LOGGER_DEBUG( log, "appended " << part.m_vertices.size() << " vertices, "
+                  << part.m_polygon_offset.size() << " polygons, "
+                  << (part.m_cell_index.size()) << " cells." );
+}
+
+void
+PolyhedralMeshGPUModel::bindBuffers()
+{
+    glBindVertexArray( m_vertex_positions_vao.get() );
+    glBindBuffer( GL_ARRAY_BUFFER, m_vertex_positions_buf.get() );
+    if( m_vertices_compact ) {
+        glVertexAttribPointer( 0, 4, GL_UNSIGNED_SHORT, GL_TRUE, 0, NULL );
+    }
+    else {
+        glVertexAttribPointer( 0, 4, GL_FLOAT, GL_FALSE, 0, NULL );
+    }
+    glEnableVertexAttribArray( 0 );
+    glBindVertexArray( 0 );
+
+    glBindVertexArray( m_polygon_vao.get() );
+    glBindBuffer( GL_ARRAY_BUFFER, m_polygon_info_buf.get() );
+    glVertexAttribIPointer( 0, 2, GL_UNSIGNED_INT, 0, NULL );
+    glEnableVertexAttribArray( 0 );
+    glBindBuffer( GL_ARRAY_BUFFER, m_polygon_offset_buf.get() );
+    glVertexAttribIPointer( 1, 1, GL_UNSIGNED_INT, 1*sizeof(GLuint), NULL );
+    glEnableVertexAttribArray( 1 );
+    glVertexAttribIPointer( 2, 1, GL_UNSIGNED_INT, 1*sizeof(GLuint), reinterpret_cast<const GLvoid*>( sizeof(GLuint) ) );
+    glEnableVertexAttribArray( 2 );
+    glBindVertexArray( 0 );
+    glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+    glBindTexture( GL_TEXTURE_BUFFER, m_vertex_positions_tex.get() );
+    glTexBuffer( GL_TEXTURE_BUFFER, m_vertices_compact ? GL_RGBA16 : GL_RGBA32F, m_vertex_positions_buf.get() );
+    glBindTexture( GL_TEXTURE_BUFFER, m_normal_vectors_tex.get() );
+    glTexBuffer( GL_TEXTURE_BUFFER, m_normals_octahedral ? GL_RG16 : GL_RGBA32F, m_normal_vectors_buf.get() );
+    glBindTexture( GL_TEXTURE_BUFFER, m_cell_global_index_tex.get() );
+    glTexBuffer( GL_TEXTURE_BUFFER, GL_R32UI, m_cell_global_index_buf.get() );
+    glBindTexture( GL_TEXTURE_BUFFER, m_cell_vertex_indices_tex.get() );
+    glTexBuffer( GL_TEXTURE_BUFFER, GL_RGBA32UI, m_cell_vertex_indices_buf.get() );
+    glBindTexture( GL_TEXTURE_BUFFER, m_polygon_vtx_tex.get() );
+    glTexBuffer( GL_TEXTURE_BUFFER, GL_R32UI, m_polygon_vtx_buf.get() );
+    glBindTexture( GL_TEXTURE_BUFFER, m_polygon_nrm_tex.get() );
+    glTexBuffer( GL_TEXTURE_BUFFER, GL_R32UI, m_polygon_nrm_buf.get() );
+    glBindTexture( GL_TEXTURE_BUFFER, 0 );
+}
+
 void
 PolyhedralMeshGPUModel::updatePolygons( bridge::PolyhedralMeshBridge& bridge )
 {
     Logger log = getLogger( "GridTess.updatePolygons" );
     m_polygons_N = bridge.m_polygon_info.size()/2;
+    m_polygons_capacity = m_polygons_N;
+    m_polygon_indices_N = bridge.m_polygon_vtx_ix.size();
+    m_polygon_indices_capacity = m_polygon_indices_N;
 
     m_polygon_max_n = 0;
     m_triangles_N = 0;
@@ -103,7 +369,7 @@ PolyhedralMeshGPUModel::updatePolygons( bridge::PolyhedralMeshBridge& bridge )
         GLsizei N = (GLsizei)(bridge.m_polygon_offset[i+1]-bridge.m_polygon_offset[i]);
         m_triangles_N += (N-2);
         m_polygon_max_n = std::max( m_polygon_max_n, N );
-        if( (bridge.m_polygon_info[2*i]&0x80000000) != 0 ) {
+        if( (bridge.m_polygon_info[2*i] & bridge::PolyhedralMeshBridge::IndexFlagHi) != 0u ) {
             faults++;
         }
 
@@ -112,12 +378,13 @@ PolyhedralMeshGPUModel::updatePolygons( bridge::PolyhedralMeshBridge& bridge )
     LOGGER_DEBUG( log, "Number of fault polygons: " << faults );
 
 
+    std::vector<GLuint> scratch;
     glBindVertexArray( m_polygon_vao.get() );
 
     glBindBuffer( GL_ARRAY_BUFFER, m_polygon_info_buf.get() );
     glBufferData( GL_ARRAY_BUFFER,
                   sizeof(GLuint)*bridge.m_polygon_info.size(),
-                  bridge.m_polygon_info.data(),
+                  gpuIndices( scratch, bridge.m_polygon_info.data(), bridge.m_polygon_info.size(), true ),
                   GL_STATIC_DRAW );
     glVertexAttribIPointer( 0, 2, GL_UNSIGNED_INT, 0, NULL );
     glEnableVertexAttribArray( 0 );
@@ -125,7 +392,7 @@ PolyhedralMeshGPUModel::updatePolygons( bridge::PolyhedralMeshBridge& bridge )
     glBindBuffer( GL_ARRAY_BUFFER, m_polygon_offset_buf.get() );
     glBufferData( GL_ARRAY_BUFFER,
                   sizeof(GLuint)*bridge.m_polygon_offset.size(),
-                  bridge.m_polygon_offset.data(),
+                  gpuIndices( scratch, bridge.m_polygon_offset.data(), bridge.m_polygon_offset.size(), false ),
                   GL_STATIC_DRAW );
     glVertexAttribIPointer( 1, 1, GL_UNSIGNED_INT, 1*sizeof(GLuint), NULL );
     glEnableVertexAttribArray( 1 );
@@ -137,7 +404,7 @@ PolyhedralMeshGPUModel::updatePolygons( bridge::PolyhedralMeshBridge& bridge )
     glBindBuffer( GL_TEXTURE_BUFFER, m_polygon_vtx_buf.get() );
     glBufferData( GL_TEXTURE_BUFFER,
                   sizeof(GLuint)*bridge.m_polygon_vtx_ix.size(),
-                  bridge.m_polygon_vtx_ix.data(),
+                  gpuIndices( scratch, bridge.m_polygon_vtx_ix.data(), bridge.m_polygon_vtx_ix.size(), false ),
                   GL_STATIC_DRAW );
     glBindBuffer( GL_TEXTURE_BUFFER, 0 );
 
@@ -149,7 +416,7 @@ PolyhedralMeshGPUModel::updatePolygons( bridge::PolyhedralMeshBridge& bridge )
     glBindBuffer( GL_TEXTURE_BUFFER, m_polygon_nrm_buf.get() );
     glBufferData( GL_TEXTURE_BUFFER,
                   sizeof(GLuint)*bridge.m_polygon_nrm_ix.size(),
-                  bridge.m_polygon_nrm_ix.data(),
+                  gpuIndices( scratch, bridge.m_polygon_nrm_ix.data(), bridge.m_polygon_nrm_ix.size(), true ),
                   GL_STATIC_DRAW );
     glBindBuffer( GL_TEXTURE_BUFFER, 0 );
 
@@ -251,6 +518,16 @@ PolyhedralMeshGPUModel::updateBoundingBox( bridge::PolyhedralMeshBridge& bridge
         m_bb_min[2] = std::min( m_bb_min[2], bridge.m_vertices[j].z() );
         m_bb_max[2] = std::max( m_bb_max[2], bridge.m_vertices[j].z() );
     }
+    updateScaleAndShift();
+
+    LOGGER_DEBUG( log, "bbox = ["
+                  << m_bb_min[0] << ", " << m_bb_min[1] << ", " << m_bb_min[2] << "] x ["
+                  << m_bb_max[0] << ", " << m_bb_max[1] << ", " << m_bb_max[2] << "]." );
+}
+
+void
+PolyhedralMeshGPUModel::updateScaleAndShift()
+{
     for(unsigned int i=0; i<3; i++) {
         m_scale[i] = 1.f/(m_bb_max[i]-m_bb_min[i]);
     }
@@ -261,86 +538,206 @@ PolyhedralMeshGPUModel::updateBoundingBox( bridge::PolyhedralMeshBridge& bridge
     for(unsigned int i=0; i<3; i++) {
         m_shift[i] = -0.5f*(m_bb_max[i]+m_bb_min[i]) + 0.5f/m_scale[i];
     }
-
-    LOGGER_DEBUG( log, "bbox = ["
-                  << m_bb_min[0] << ", " << m_bb_min[1] << ", " << m_bb_min[2] << "] x ["
-                  << m_bb_max[0] << ", " << m_bb_max[1] << ", " << m_bb_max[2] << "]." );
 }
 
 void
 PolyhedralMeshGPUModel::updateVertices( bridge::PolyhedralMeshBridge& bridge )
 {
     m_vertices_num = bridge.m_vertices.size();
+    m_vertices_capacity = m_vertices_num;
+#ifdef FRVIEW_COMPACT_GEOMETRY
+    m_vertices_compact = true;
+    positionFrame( m_vertex_positions_decode, m_bb_min, m_bb_max );
+#else
+    m_vertices_compact = false;
+    std::copy( identity_decode, identity_decode + 16, m_vertex_positions_decode );
+#endif
     if( m_vertices_num > 0 ) {
         // host data
-        m_vertex_positions_host.resize( 4*m_vertices_num );
-        for( GLsizei i=0; i<m_vertices_num; i++ ) {
-            m_vertex_positions_host[ 4*i+0 ] = bridge.m_vertices[i].x();
-            m_vertex_positions_host[ 4*i+1 ] = bridge.m_vertices[i].y();
-            m_vertex_positions_host[ 4*i+2 ] = bridge.m_vertices[i].z();
-            m_vertex_positions_host[ 4*i+3 ] = 1.f;
-        }
+        encodeVertices( bridge.m_vertices, 0 );
         // buffer object
         glBindBuffer( GL_ARRAY_BUFFER, m_vertex_positions_buf.get() );
         glBufferData( GL_ARRAY_BUFFER,
-                      4*sizeof(float)*m_vertices_num,
-                      m_vertex_positions_host.data(),
+                      (m_vertices_compact ? 4*sizeof(GLushort) : 4*sizeof(GLfloat))*m_vertices_num,
+                      NULL,
                       GL_STATIC_DRAW );
         glBindBuffer( GL_ARRAY_BUFFER, 0 );
+        uploadVertices( 0, m_vertices_num );
         // vertex array object
         glBindVertexArray( m_vertex_positions_vao.get() );
         glBindBuffer( GL_ARRAY_BUFFER, m_vertex_positions_buf.get() );
-        glVertexAttribPointer( 0, 4, GL_FLOAT, GL_FALSE, 0, NULL );
+        if( m_vertices_compact ) {
+            glVertexAttribPointer( 0, 4, GL_UNSIGNED_SHORT, GL_TRUE, 0, NULL );
+        }
+        else {
+            glVertexAttribPointer( 0, 4, GL_FLOAT, GL_FALSE, 0, NULL );
+        }
         glEnableVertexAttribArray( 0 );
         //glVertexPointer( 4, GL_FLOAT, 0, NULL );
         //glEnableClientState( GL_VERTEX_ARRAY );
         glBindVertexArray( 0 );
         // texture
         glBindTexture( GL_TEXTURE_BUFFER, m_vertex_positions_tex.get() );
-        glTexBuffer( GL_TEXTURE_BUFFER, GL_RGBA32F, m_vertex_positions_buf.get() );
+        glTexBuffer( GL_TEXTURE_BUFFER, m_vertices_compact ? GL_RGBA16 : GL_RGBA32F, m_vertex_positions_buf.get() );
         glBindTexture( GL_TEXTURE_BUFFER, 0 );
     }
 
 }
 
+void
+PolyhedralMeshGPUModel::encodeVertices( const std::vector<bridge::PolyhedralMeshBridge::Real4>& vertices,
+                                        const GLsizei                                           offset )
+{
+    const size_t n = offset + vertices.size();
+    if( m_vertices_compact ) {
+        m_vertex_positions_compact.resize( 4*n );
+        for( size_t i=0; i<vertices.size(); i++ ) {
+            encodePosition( m_vertex_positions_compact.data() + 4*(offset+i),
+                            m_vertex_positions_decode,
+                            vertices[i].x(), vertices[i].y(), vertices[i].z() );
+        }
+    }
+    else {
+        m_vertex_positions_host.resize( 4*n );
+        for( size_t i=0; i<vertices.size(); i++ ) {
+            m_vertex_positions_host[ 4*(offset+i)+0 ] = vertices[i].x();
+            m_vertex_positions_host[ 4*(offset+i)+1 ] = vertices[i].y();
+            m_vertex_positions_host[ 4*(offset+i)+2 ] = vertices[i].z();
+            m_vertex_positions_host[ 4*(offset+i)+3 ] = 1.f;
+        }
+    }
+}
+
+void
+PolyhedralMeshGPUModel::growPositionFrame( const bridge::PolyhedralMeshBridge::Real4& minimum,
+                                           const bridge::PolyhedralMeshBridge::Real4& maximum )
+{
+    const GLfloat* decode = m_vertex_positions_decode;
+    bool grow = false;
+    GLfloat frame_min[3];
+    GLfloat frame_max[3];
+    for( unsigned int k=0; k<3; k++ ) {
+        frame_min[k] = decode[ 12+k ];
+        frame_max[k] = decode[ 12+k ] + decode[ 5*k ];
+        if( minimum.v[k] <= maximum.v[k] ) {
+            if( minimum.v[k] < frame_min[k] ) {
+                frame_min[k] = minimum.v[k];
+                grow = true;
+            }
+            if( frame_max[k] < maximum.v[k] ) {
+                frame_max[k] = maximum.v[k];
+                grow = true;
+            }
+        }
+    }
+    if( !grow ) {
+        return;
+    }
+
+    // re-encoding adds at most half a step of the new frame to the error
+    GLfloat new_decode[16];
+    positionFrame( new_decode, frame_min, frame_max );
+    for( GLsizei i=0; i<m_vertices_num; i++ ) {
+        GLushort* p = m_vertex_positions_compact.data() + 4*i;
+        encodePosition( p, new_decode,
+                        decode[12] + decode[ 0]*(p[0]/65535.f),
+                        decode[13] + decode[ 5]*(p[1]/65535.f),
+                        decode[14] + decode[10]*(p[2]/65535.f) );
+    }
+    std::copy( new_decode, new_decode + 16, m_vertex_positions_decode );
+    uploadVertices( 0, m_vertices_num );
+}
+
+void
+PolyhedralMeshGPUModel::uploadVertices( const GLsizei offset, const GLsizei count )
+{
+    if( m_vertices_compact ) {
+        uploadRange( m_vertex_positions_buf.get(), 4*offset,
+                     m_vertex_positions_compact.data() + 4*offset, 4*count );
+    }
+    else {
+        uploadRange( m_vertex_positions_buf.get(), 4*offset,
+                     m_vertex_positions_host.data() + 4*offset, 4*count );
+    }
+}
+
 void
 PolyhedralMeshGPUModel::updateNormals( bridge::PolyhedralMeshBridge& bridge )
 {
     // Normal vectors
     m_normals_num = bridge.m_normals.size();
+    m_normals_capacity = m_normals_num;
+#ifdef FRVIEW_COMPACT_GEOMETRY
+    m_normals_octahedral = true;
+#else
+    m_normals_octahedral = false;
+#endif
     if( m_normals_num > 0 ) {
-        m_normal_vectors_host.resize( 4*m_normals_num );
-        for(GLsizei i=0; i<m_normals_num; i++ ) {
-            m_normal_vectors_host[ 4*i+0 ] = bridge.m_normals[i].x();
-            m_normal_vectors_host[ 4*i+1 ] = bridge.m_normals[i].y();
-            m_normal_vectors_host[ 4*i+2 ] = bridge.m_normals[i].z();
-            m_normal_vectors_host[ 4*i+3 ] = bridge.m_normals[i].w();
-        }
+        encodeNormals( bridge.m_normals, 0 );
         // buffer
         glBindBuffer( GL_TEXTURE_BUFFER, m_normal_vectors_buf.get() );
         glBufferData( GL_TEXTURE_BUFFER,
-                      4*sizeof(float)*m_normals_num,
-                      m_normal_vectors_host.data(),
+                      (m_normals_octahedral ? 2*sizeof(GLushort) : 4*sizeof(GLfloat))*m_normals_num,
+                      NULL,
                       GL_STATIC_DRAW );
         glBindBuffer( GL_TEXTURE_BUFFER, 0 );
+        uploadNormals( 0, m_normals_num );
         // texture
         glBindTexture( GL_TEXTURE_BUFFER, m_normal_vectors_tex.get() );
-        glTexBuffer( GL_TEXTURE_BUFFER, GL_RGBA32F, m_normal_vectors_buf.get() );
+        glTexBuffer( GL_TEXTURE_BUFFER, m_normals_octahedral ? GL_RG16 : GL_RGBA32F, m_normal_vectors_buf.get() );
         glBindTexture( GL_TEXTURE_BUFFER, 0 );
     }
 
 
 }
 
+void
+PolyhedralMeshGPUModel::encodeNormals( const std::vector<bridge::PolyhedralMeshBridge::Real4>& normals,
+                                       const GLsizei                                           offset )
+{
+    const size_t n = offset + normals.size();
+    if( m_normals_octahedral ) {
+        m_normal_vectors_octahedral.resize( 2*n );
+        for( size_t i=0; i<normals.size(); i++ ) {
+            encodeNormal( m_normal_vectors_octahedral.data() + 2*(offset+i),
+                          normals[i].x(), normals[i].y(), normals[i].z() );
+        }
+    }
+    else {
+        m_normal_vectors_host.resize( 4*n );
+        for( size_t i=0; i<normals.size(); i++ ) {
+            m_normal_vectors_host[ 4*(offset+i)+0 ] = normals[i].x();
+            m_normal_vectors_host[ 4*(offset+i)+1 ] = normals[i].y();
+            m_normal_vectors_host[ 4*(offset+i)+2 ] = normals[i].z();
+            m_normal_vectors_host[ 4*(offset+i)+3 ] = normals[i].w();
+        }
+    }
+}
+
+void
+PolyhedralMeshGPUModel::uploadNormals( const GLsizei offset, const GLsizei count )
+{
+    if( m_normals_octahedral ) {
+        uploadRange( m_normal_vectors_buf.get(), 2*offset,
+                     m_normal_vectors_octahedral.data() + 2*offset, 2*count );
+    }
+    else {
+        uploadRange( m_normal_vectors_buf.get(), 4*offset,
+                     m_normal_vectors_host.data() + 4*offset, 4*count );
+    }
+}
+
 void
 PolyhedralMeshGPUModel::updateCells( bridge::PolyhedralMeshBridge& bridge )
 {
     m_cells_num = bridge.m_cell_index.size();
+    m_cells_capacity = m_cells_num;
 
-    m_cell_global_index_host.resize( m_cells_num );
-    for(GLsizei i=0; i<m_cells_num; i++ ) {
-        m_cell_global_index_host[i] = bridge.m_cell_index[i];
-    }
+    std::vector<GLuint> scratch;
+    const GLuint* cell_index = gpuIndices( scratch, bridge.m_cell_index.data(), m_cells_num, false );
+    m_cell_global_index_host.assign( cell_index, cell_index + m_cells_num );
+    const GLuint* cell_order = gpuIndices( scratch, bridge.m_cell_order.data(), bridge.m_cell_order.size(), false );
+    m_cell_order_host.assign( cell_order, cell_order + bridge.m_cell_order.size() );
     glBindBuffer( GL_TEXTURE_BUFFER, m_cell_global_index_buf.get() );
     glBufferData( GL_TEXTURE_BUFFER,
                   sizeof(GLuint)*m_cell_global_index_host.size(),
@@ -350,10 +747,8 @@ PolyhedralMeshGPUModel::updateCells( bridge::PolyhedralMeshBridge& bridge )
     glBindTexture( GL_TEXTURE_BUFFER, m_cell_global_index_tex.get() );
     glTexBuffer( GL_TEXTURE_BUFFER, GL_R32UI, m_cell_global_index_buf.get() );
 
-    m_cell_vertex_indices_host.resize( 8*m_cells_num );
-    for(GLsizei i=0; i<8*m_cells_num; i++ ) {
-        m_cell_vertex_indices_host[i] = bridge.m_cell_corner[i];
-    }
+    const GLuint* cell_corner = gpuIndices( scratch, bridge.m_cell_corner.data(), 8*m_cells_num, false );
+    m_cell_vertex_indices_host.assign( cell_corner, cell_corner + 8*m_cells_num );
     glBindBuffer( GL_TEXTURE_BUFFER, m_cell_vertex_indices_buf.get() );
     glBufferData( GL_TEXTURE_BUFFER,
                   sizeof(GLuint)*m_cell_vertex_indices_host.size(),
@@ -27,9 +27,7 @@
 #include "render/mesh/PolygonSetInterface.hpp"
 #include "render/mesh/BoundingBoxInterface.hpp"
 
-namespace bridge {
-    class PolyhedralMeshBridge;
-}
+#include "bridge/PolyhedralMeshBridge.hpp"
 
 namespace render {
     class GridField;
@@ -47,9 +45,13 @@ namespace render {
  *
  * It contains the following structures:
  * - A set of vertex positions, as XYZW coordinates (W=1 only to make them
- *   4-component).
+ *   4-component). With FRVIEW_COMPACT_GEOMETRY, and a box that the vertices
+ *   lie within, the coordinates are normalized 16-bit integers within the box,
+ *   see vertexPositionDecode().
  * - A set of independently indexed normal vectors, as 4-component vectors (W=1
- *   only to make them 4-component).
+ *   only to make them 4-component). With FRVIEW_COMPACT_GEOMETRY, the vectors
+ *   are octahedral maps as two normalized 16-bit integers, see
+ *   normalVectorsOctahedral().
  * - A set of cells, where we have:
  *   - The global index
  *   - The index of the eight vertices spanning the cell (this representation is
@@ -109,8 +111,8 @@ public:
     GLuint
     vertexPositionsAsBufferTexture() const { return m_vertex_positions_tex.get(); }
 
-    const std::vector<float>&
-    vertexPositionsInHostMemory() const { return m_vertex_positions_host; }
+    const float*
+    vertexPositionDecode() const { return m_vertex_positions_decode; }
     
     /** @} */
     // -------------------------------------------------------------------------
@@ -122,8 +124,8 @@ public:
     GLuint
     normalVectorsAsBufferTexture() const { return m_normal_vectors_tex.get(); }
 
-    const std::vector<float>&
-    normalVectorsInHostMemory() const { return m_normal_vectors_host; }
+    bool
+    normalVectorsOctahedral() const { return m_normals_octahedral; }
 
     /** @} */
     // -------------------------------------------------------------------------
@@ -144,6 +146,9 @@ public:
     const std::vector<GLuint>&
     cellGlobalIndicesInHostMemory() const { return m_cell_global_index_host; }
 
+    const std::vector<GLuint>&
+    cellOrderInHostMemory() const { return m_cell_order_host; }
+
     /** @} */
     // -------------------------------------------------------------------------
 
@@ -207,6 +212,23 @@ public:
     void
     update( bridge::PolyhedralMeshBridge& bridge );
 
+    /** Append a part of the output of a bridge that is still being produced.
+      *
+      * The parts must be appended in the order they were extracted, starting
+      * with an empty model, see bridge::PolyhedralMeshBridge::extract(). The
+      * buffers are sized from the room reserved in the bridge, so that the
+      * parts usually go straight into the existing buffers, and are grown on
+      * the GPU otherwise. Cells outside the ranges delivered so far have no
+      * corners. Positions are only stored compactly if the first part has
+      * bounds, and are re-encoded if a later part has bounds outside of them,
+      * which adds at most half a step to their error.
+      *
+      * \throws std::runtime_error if the part does not follow the output
+      *         already in the model.
+      */
+    void
+    append( const bridge::PolyhedralMeshBridge::Part& part );
+
 protected:
     /** @{ */
     float                   m_bb_min[3];                    ///< AABB min corner.
@@ -216,20 +238,29 @@ protected:
     /** @} */
     /** @{ */
     GLsizei                 m_vertices_num;                 ///< Number of vertices in grid.
-    std::vector<GLfloat>    m_vertex_positions_host;        ///< Host copy of vertex positions.
+    GLsizei                 m_vertices_capacity;            ///< Number of vertices \ref m_vertex_positions_buf has room for.
+    bool                    m_vertices_compact;             ///< Positions are stored as normalized 16-bit integers.
+    GLfloat                 m_vertex_positions_decode[16];  ///< Map from stored to actual positions.
+    std::vector<GLfloat>    m_vertex_positions_host;        ///< Host copy of vertex positions, unless compact.
+    std::vector<GLushort>   m_vertex_positions_compact;     ///< Host copy of compact vertex positions.
     GLBuffer                m_vertex_positions_buf;         ///< Buffer object with vertex positions.
     GLTexture               m_vertex_positions_tex;         ///< Texture sampling \ref m_vertex_positions_buf.
     GLVertexArrayObject     m_vertex_positions_vao;         ///< Vertex array object streaming location 0 from \ref m_vertex_positions_buf.
     /** @} */
     /** @{ */
     GLsizei                 m_normals_num;                  ///< Number of normal vectors in grid.
-    std::vector<GLfloat>    m_normal_vectors_host;          ///< Host copy of normal vectors.
+    GLsizei                 m_normals_capacity;             ///< Number of normal vectors \ref m_normal_vectors_buf has room for.
+    bool                    m_normals_octahedral;           ///< Normal vectors are stored as octahedral maps.
+    std::vector<GLfloat>    m_normal_vectors_host;          ///< Host copy of normal vectors, unless octahedral.
+    std::vector<GLushort>   m_normal_vectors_octahedral;    ///< Host copy of octahedral normal vectors.
     GLBuffer                m_normal_vectors_buf;           ///< Buffer object with normal vectors.
     GLTexture               m_normal_vectors_tex;           ///< Texture sampling \ref m_normal_vectors_buf.
     /** @} */
     /** @{ */
     GLsizei                 m_cells_num;                    ///< Number of cells.
+    GLsizei                 m_cells_capacity;               ///< Number of cells the cell buffers have room for.
     std::vector<GLuint>     m_cell_global_index_host;       ///< Host copy of global cell indices.
+    std::vector<GLuint>     m_cell_order_host;              ///< Index in the source of each cell, empty if not reordered.
     GLBuffer                m_cell_global_index_buf;        ///< Buffer object with global cell indices.
     GLTexture               m_cell_global_index_tex;        ///< Texture sampling \ref m_cell_global_index_buf.
     std::vector<GLuint>     m_cell_vertex_indices_host;  ///< Host copy of cell vertex indices.
@@ -251,6 +282,15 @@ protected:
     /** Number of polygons in set. */
     GLsizei                 m_polygons_N;
 
+    /** Number of polygons the polygon buffers have room for. */
+    GLsizei                 m_polygons_capacity;
+
+    /** Number of vertex (and normal) indices of the polygons. */
+    GLsizei                 m_polygon_indices_N;
+
+    /** Number of indices \ref m_polygon_vtx_buf and \ref m_polygon_nrm_buf have room for. */
+    GLsizei                 m_polygon_indices_capacity;
+
     /** Vertex array object with per polygon info.
      *
      * - Binding 0: \ref m_polygon_info_buf
@@ -290,10 +330,33 @@ protected:
     /** @} */
 
 
-    /** Pull vertex data from bridge. */
+    /** Pull vertex data from bridge, the bounding box must be up to date. */
     void
     updateVertices( bridge::PolyhedralMeshBridge& bridge );
 
+    /** Store vertex positions in the host copy, starting at vertex offset. */
+    void
+    encodeVertices( const std::vector<bridge::PolyhedralMeshBridge::Real4>& vertices,
+                    const GLsizei                                           offset );
+
+    /** Re-encode the compact positions in a box that also covers minimum and maximum. */
+    void
+    growPositionFrame( const bridge::PolyhedralMeshBridge::Real4& minimum,
+                       const bridge::PolyhedralMeshBridge::Real4& maximum );
+
+    /** Store normal vectors in the host copy, starting at normal offset. */
+    void
+    encodeNormals( const std::vector<bridge::PolyhedralMeshBridge::Real4>& normals,
+                   const GLsizei                                           offset );
+
+    /** Copy count vertex positions starting at offset from the host copy to \ref m_vertex_positions_buf. */
+    void
+    uploadVertices( const GLsizei offset, const GLsizei count );
+
+    /** Copy count normal vectors starting at offset from the host copy to \ref m_normal_vectors_buf. */
+    void
+    uploadNormals( const GLsizei offset, const GLsizei count );
+
     /** Pull normal vectors from bridge. */
     void
     updateNormals( bridge::PolyhedralMeshBridge& bridge );
@@ -302,6 +365,14 @@ protected:
     void
     updateBoundingBox( bridge::PolyhedralMeshBridge& bridge );
 
+    /** Calculate the map to the unit cube from the bounding box. */
+    void
+    updateScaleAndShift();
+
+    /** Bind the buffers to the textures and vertex array objects. */
+    void
+    bindBuffers();
+
     /** Pull cell data from bridge. */
     void
     updateCells( bridge::PolyhedralMeshBridge& bridge );
@@ -32,20 +32,25 @@ public:
     GLsizei
     vertexCount() const = 0;
 
-    /** Get 4-component vertex positions through a vertex array object with positions at index 0. */
+    /** Get 4-component vertex positions through a vertex array object with positions at index 0, see vertexPositionDecode(). */
     virtual
     GLuint
     vertexPositonsAsVertexArrayObject() const = 0;
 
-    /** Get 4-component vertex positions through a GL_RGBA32F buffer texture. */
+    /** Get 4-component vertex positions through a GL_RGBA32F or GL_RGBA16 buffer texture, see vertexPositionDecode(). */
     virtual
     GLuint
     vertexPositionsAsBufferTexture() const = 0;
-    
-    /** Get 4-component vertex positions stored in host memory. */
+
+    /** Get the column-major matrix that maps fetched vertex positions to actual positions.
+     *
+     * Positions may be stored as normalized 16-bit integers in the unit cube
+     * of a box, which the vertex array object and the buffer texture deliver
+     * in [0,1]. The matrix is the identity for positions stored as floats.
+     */
     virtual
-    const std::vector<float>&
-    vertexPositionsInHostMemory() const = 0;
+    const float*
+    vertexPositionDecode() const = 0;
     
 };
 
@@ -15,6 +15,8 @@
  * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
 #include "utils/Logger.hpp"
 #include "utils/GLSLTools.hpp"
 #include "render/mesh/CellSetInterface.hpp"
@@ -81,7 +83,9 @@ SplatCompacter::process(boost::shared_ptr<Splats>                        splats,
     glBindTexture( GL_TEXTURE_BUFFER, cells->cellCornerTexture() );
 
     glUseProgram( m_compacter.get() );
-    glUniformMatrix4fv( m_local_to_world_loc, 1, GL_FALSE, world_from_local );
+    const glm::mat4 world_from_stored = glm::make_mat4( world_from_local )
+                                      * glm::make_mat4( vertices->vertexPositionDecode() );
+    glUniformMatrix4fv( m_local_to_world_loc, 1, GL_FALSE, glm::value_ptr( world_from_stored ) );
     glUniform3fv( m_min_size_loc, 1, min_size );
 
 
@@ -55,8 +55,17 @@ BuilderSelectInsideHalfplane::apply( boost::shared_ptr<Representation>
         return;
     }
     
+    // fold the map from stored to actual positions into the equation
+    const float* decode = vertices->vertexPositionDecode();
+    GLfloat stored_equation[4];
+    for( unsigned int j=0; j<4; j++ ) {
+        stored_equation[j] = 0.f;
+        for( unsigned int i=0; i<4; i++ ) {
+            stored_equation[j] += decode[ 4*j+i ]*equation[i];
+        }
+    }
     glUseProgram( m_program );
-    glUniform4fv( m_loc_halfplane_eq, 1, equation );
+    glUniform4fv( m_loc_halfplane_eq, 1, stored_equation );
     glActiveTexture( GL_TEXTURE0 );
     glBindTexture( GL_TEXTURE_BUFFER, vertices->vertexPositionsAsBufferTexture() );
     glActiveTexture( GL_TEXTURE1 );
@@ -454,6 +454,8 @@ GridTessSurfBuilder::runIndexedTriangulatePasses( GridTessSurf** surfaces,
     glActiveTexture( GL_TEXTURE1 );  glBindTexture( GL_TEXTURE_BUFFER, polygon_set->polygonNormalIndexTexture() );
     glActiveTexture( GL_TEXTURE2 );  glBindTexture( GL_TEXTURE_BUFFER, polygon_set->polygonVertexIndexTexture() );
     glActiveTexture( GL_TEXTURE3 );  glBindTexture( GL_TEXTURE_BUFFER, vertex_positions->vertexPositionsAsBufferTexture() );
+    glUniformMatrix4fv( glGetUniformLocation( m_triangulate_indexed_prog.get(), "position_decode" ),
+                        1, GL_FALSE, vertex_positions->vertexPositionDecode() );
     
 
     for( int i=0; i<SURFACE_N; i++ ) {
@@ -501,6 +503,11 @@ GridTessSurfBuilder::runTriSoupTriangulatePasses( TriangleSoup** surfaces,
     glActiveTexture( GL_TEXTURE4 );
     glBindTexture( GL_TEXTURE_BUFFER, normal_vectors->normalVectorsAsBufferTexture() );
 
+    glUniformMatrix4fv( glGetUniformLocation( m_triangulate_trisoup_prog.get(), "position_decode" ),
+                        1, GL_FALSE, vertex_positions->vertexPositionDecode() );
+    glUniform1i( glGetUniformLocation( m_triangulate_trisoup_prog.get(), "octahedral_normals" ),
+                 normal_vectors->normalVectorsOctahedral() ? GL_TRUE : GL_FALSE );
+
 //    glActiveTexture( GL_TEXTURE1 );
 //    glBindTexture( GL_TEXTURE_BUFFER, normals->normalVectorsAsBufferTexture() );
 
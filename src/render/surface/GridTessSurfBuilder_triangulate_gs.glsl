@@ -24,6 +24,7 @@ layout(binding=1)   uniform usamplerBuffer  normal_ix;
 layout(binding=2)   uniform usamplerBuffer  vertex_ix;
 #ifndef POSITIONS_DECLARED
 layout(binding=3)   uniform samplerBuffer   positions;
+                    uniform mat4            position_decode;
 #endif
 
 void
@@ -84,7 +85,7 @@ main()
         if( N > 3 ) {
             vec3 pos[MAX_OUT+2];
             for(int i=0; i<N; i++) {
-                pos[i] = texelFetch( positions, int(vtx_ix[i]) ).rgb;
+                pos[i] = (position_decode*vec4( texelFetch( positions, int(vtx_ix[i]) ).rgb, 1.f )).xyz;
             }
 
             // If we have more than four vertices, do elaborate triangulation
@@ -29,20 +29,37 @@ layout(stream=1) out vec4    out_edge_position;
 #define POSITIONS_DECLARED
 layout(binding=3)   uniform samplerBuffer   positions;
 layout(binding=4)   uniform samplerBuffer   normals;
+                    uniform mat4            position_decode;
+                    uniform bool            octahedral_normals;
 
+vec3
+fetchNormal( uint ix )
+{
+    vec4 t = texelFetch( normals, int(ix & 0x0fffffffu) );
+    if( !octahedral_normals ) {
+        return t.rgb;
+    }
+    // unfold octahedral map
+    vec3 n = vec3( 2.f*t.xy - vec2(1.f), 0.f );
+    n.z = 1.f - abs( n.x ) - abs( n.y );
+    float f = max( -n.z, 0.f );
+    n.x += n.x >= 0.f ? -f : f;
+    n.y += n.y >= 0.f ? -f : f;
+    return n;
+}
 
 void
 emit_triangle( in uint cell_ix,
                in uvec3 nrm_ix,
                in uvec3 vtx_ix )
 {
-    vec4 pa = vec4( texelFetch( positions, int(vtx_ix.x) ).rgb, 1.f);
-    vec4 pb = vec4( texelFetch( positions, int(vtx_ix.y) ).rgb, 1.f);
-    vec4 pc = vec4( texelFetch( positions, int(vtx_ix.z) ).rgb, 1.f);
+    vec4 pa = position_decode*vec4( texelFetch( positions, int(vtx_ix.x) ).rgb, 1.f);
+    vec4 pb = position_decode*vec4( texelFetch( positions, int(vtx_ix.y) ).rgb, 1.f);
+    vec4 pc = position_decode*vec4( texelFetch( positions, int(vtx_ix.z) ).rgb, 1.f);
 
-    vec3 na = normalize( texelFetch( normals, int(nrm_ix.x & 0x0fffffffu) ).rgb );
-    vec3 nb = normalize( texelFetch( normals, int(nrm_ix.y & 0x0fffffffu) ).rgb );
-    vec3 nc = normalize( texelFetch( normals, int(nrm_ix.z & 0x0fffffffu) ).rgb );
+    vec3 na = normalize( fetchNormal( nrm_ix.x ) );
+    vec3 nb = normalize( fetchNormal( nrm_ix.y ) );
+    vec3 nc = normalize( fetchNormal( nrm_ix.z ) );
 
     if( (cell_ix & 0x80000000u) == 0u ) {
         na = -na;
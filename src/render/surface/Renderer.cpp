@@ -188,15 +188,20 @@ Renderer::draw( const GLfloat*                            modelview,
                 continue;
             }
 
+            // positions may be stored compactly, fold the decode into MV and MVP
+            const glm::mat4 D = glm::make_mat4( vertices->vertexPositionDecode() );
+
             glUseProgram( m_main.get() );
             glUniform1i( m_loc_solid_pass, solid_pass ? GL_TRUE : GL_FALSE );
-            glUniformMatrix4fv( m_loc_mvp, 1, GL_FALSE, glm::value_ptr( MVP ) );
+            glUniformMatrix4fv( m_loc_mvp, 1, GL_FALSE, glm::value_ptr( MVP*D ) );
             glUniformMatrix3fv( m_loc_nm, 1, GL_FALSE, nm3 );
-            glUniformMatrix4fv( m_loc_mv, 1, GL_FALSE, modelview );
+            glUniformMatrix4fv( m_loc_mv, 1, GL_FALSE, glm::value_ptr( M*D ) );
             glUniform2f( m_loc_screen_size, width, height );
 
             glActiveTexture( GL_TEXTURE1 );
             glBindTexture( GL_TEXTURE_BUFFER, normals->normalVectorsAsBufferTexture() );
+            glUniform1i( glGetUniformLocation( m_main.get(), "octahedral_normals" ),
+                         normals->normalVectorsOctahedral() ? GL_TRUE : GL_FALSE );
 
             glBindVertexArray( vertices->vertexPositonsAsVertexArrayObject() );
 
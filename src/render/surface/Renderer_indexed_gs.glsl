@@ -48,6 +48,23 @@ layout(binding=3)   uniform sampler1D       color_map;
                     uniform bool            log_map;
                     uniform bool            solid_pass;
                     uniform vec4            surface_color;
+                    uniform bool            octahedral_normals;
+
+vec3
+fetchNormal( uint ix )
+{
+    vec4 t = texelFetch( normals, int(ix & 0x0fffffffu) );
+    if( !octahedral_normals ) {
+        return t.rgb;
+    }
+    // unfold octahedral map
+    vec3 n = vec3( 2.f*t.xy - vec2(1.f), 0.f );
+    n.z = 1.f - abs( n.x ) - abs( n.y );
+    float f = max( -n.z, 0.f );
+    n.x += n.x >= 0.f ? -f : f;
+    n.y += n.y >= 0.f ? -f : f;
+    return n;
+}
 
 void
 main()
@@ -57,9 +74,9 @@ main()
     uint cell = indices.r;
 
     // fetch and transform normal vectors
-    vec3 n0 = normalize( NM*texelFetch( normals, int(indices.y & 0x0fffffffu) ).rgb );
-    vec3 n1 = normalize( NM*texelFetch( normals, int(indices.z & 0x0fffffffu) ).rgb );
-    vec3 n2 = normalize( NM*texelFetch( normals, int(indices.w & 0x0fffffffu) ).rgb );
+    vec3 n0 = normalize( NM*fetchNormal( indices.y ) );
+    vec3 n1 = normalize( NM*fetchNormal( indices.z ) );
+    vec3 n2 = normalize( NM*fetchNormal( indices.w ) );
 
 
     bool flip = false;
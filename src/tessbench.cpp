@@ -0,0 +1,253 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ *
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Benchmark of the band-parallel cornerpoint tessellator.
+//
+// Builds a synthetic cornerpoint grid with faults, pinched cells and
+// inactive cells, and tessellates it with a single band and then with 2, 4,
+// ... threads up to the hardware concurrency, reporting the time and the
+// speedup over the single band. Every output array of each run is checked
+// against the output of the single band.
+//
+// Usage: tessbench [nx] [ny] [nz] [triangulate]
+
+#include <cstdlib>
+#include <algorithm>
+#include <list>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <boost/shared_ptr.hpp>
+#include <tinia/model/ExposedModel.hpp>
+#include "bridge/PolyhedralMeshBridge.hpp"
+#include "cornerpoint/Tessellator.hpp"
+#include "utils/ActiveCells.hpp"
+#include "utils/ThreadPool.hpp"
+#include "utils/PerfTimer.hpp"
+
+namespace {
+
+typedef cornerpoint::Tessellator<bridge::PolyhedralMeshBridge>  Tessellator;
+
+/** Polyhedral mesh bridge that can compare its output with another. */
+class Bridge : public bridge::PolyhedralMeshBridge
+{
+public:
+    Bridge( bool triangulate )
+        : bridge::PolyhedralMeshBridge( triangulate )
+    {}
+
+    /** True if every output array is the same as in another bridge. */
+    bool
+    same( const Bridge& other ) const;
+
+protected:
+    static bool
+    same( const std::vector<Real4>& a, const std::vector<Real4>& b );
+
+    /** Compare the first N triangles of two lists of triangle chunks. */
+    static bool
+    same( const std::list<Index*>& a, const std::list<Index*>& b,
+          const Index N, const Index stride );
+};
+
+bool
+Bridge::same( const Bridge& other ) const
+{
+    if( !same( m_vertices, other.m_vertices )
+            || !same( m_normals, other.m_normals )
+            || (m_cell_index != other.m_cell_index)
+            || (m_cell_corner != other.m_cell_corner)
+            || (m_cell_order != other.m_cell_order)
+            || (m_edges.size() != other.m_edges.size())
+            || (m_polygon_info != other.m_polygon_info)
+            || (m_polygon_offset != other.m_polygon_offset)
+            || (m_polygon_vtx_ix != other.m_polygon_vtx_ix)
+            || (m_polygon_nrm_ix != other.m_polygon_nrm_ix)
+            || (m_tri_N != other.m_tri_N) )
+    {
+        return false;
+    }
+    for( size_t i=0; i<m_edges.size(); i++ ) {
+        const Edge& e = m_edges[i];
+        const Edge& f = other.m_edges[i];
+        if( (e.m_cp[0] != f.m_cp[0]) || (e.m_cp[1] != f.m_cp[1])
+                || (e.m_cells[0] != f.m_cells[0]) || (e.m_cells[1] != f.m_cells[1])
+                || (e.m_cells[2] != f.m_cells[2]) || (e.m_cells[3] != f.m_cells[3]) )
+        {
+            return false;
+        }
+    }
+    return same( m_tri_info_chunks, other.m_tri_info_chunks, m_tri_N, 2 )
+        && same( m_tri_vtx_chunks, other.m_tri_vtx_chunks, m_tri_N, 3 )
+        && same( m_tri_nrm_ix_chunks, other.m_tri_nrm_ix_chunks, m_tri_N, 3 );
+}
+
+bool
+Bridge::same( const std::vector<Real4>& a, const std::vector<Real4>& b )
+{
+    if( a.size() != b.size() ) {
+        return false;
+    }
+    for( size_t i=0; i<a.size(); i++ ) {
+        const Real4& p = a[i];
+        const Real4& q = b[i];
+        if( (p.x() != q.x()) || (p.y() != q.y()) || (p.z() != q.z()) || (p.w() != q.w()) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+Bridge::same( const std::list<Index*>& a, const std::list<Index*>& b,
+              const Index N, const Index stride )
+{
+    auto it = a.begin();
+    auto jt = b.begin();
+    for( Index t=0; t<N; t += m_chunk_size, ++it, ++jt ) {
+        const Index n = (N - t) < m_chunk_size ? (N - t) : m_chunk_size;
+        if( !std::equal( *it, *it + stride*n, *jt ) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Create a grid with slanted pillars, faults along random pillars and some pinched and inactive cells. */
+void
+makeGrid( std::vector<float>&  coord,
+          std::vector<float>&  zcorn,
+          std::vector<int>&    actnum,
+          const unsigned int   nx,
+          const unsigned int   ny,
+          const unsigned int   nz )
+{
+    srand( 42 );
+    coord.resize( 6*(nx+1)*(ny+1) );
+    zcorn.resize( 8*nx*ny*nz );
+    actnum.resize( nx*ny*nz );
+    for( unsigned int j=0; j<=ny; j++ ) {
+        for( unsigned int i=0; i<=nx; i++ ) {
+            float* p = coord.data() + 6*(j*(nx+1)+i);
+            p[0] = i;
+            p[1] = j;
+            p[2] = 0.f;
+            p[3] = i + 0.1f*(j%3);
+            p[4] = j + 0.05f*(i%2);
+            p[5] = 1.f;
+        }
+    }
+    std::vector<float> throws( nx*ny );
+    for( size_t i=0; i<throws.size(); i++ ) {
+        throws[i] = (rand()%5 == 0) ? 0.37f*(rand()%3) : 0.f;
+    }
+    for( unsigned int k=0; k<nz; k++ ) {
+        for( unsigned int j=0; j<ny; j++ ) {
+            for( unsigned int i=0; i<nx; i++ ) {
+                const float base = throws[ i + nx*j ] + ( i >= nx/2 ? 0.5f : 0.f );
+                for( unsigned int kk=0; kk<2; kk++ ) {
+                    const bool pinch = (kk == 1) && (rand()%20 == 0);
+                    for( unsigned int jj=0; jj<2; jj++ ) {
+                        for( unsigned int ii=0; ii<2; ii++ ) {
+                            const unsigned int l = pinch ? k : k + kk;
+                            zcorn[ 2*nx*2*ny*(2*k+kk) + 2*nx*(2*j+jj) + 2*i+ii ] =
+                                    base + (10.f*l)/nz + 0.01f*((i+ii)+(j+jj));
+                        }
+                    }
+                }
+                actnum[ i + nx*j + nx*ny*k ] = (rand()%6 != 0) ? 1 : 0;
+            }
+        }
+    }
+}
+
+/** Tessellate and return the time in seconds. */
+double
+run( boost::shared_ptr<Bridge>&  bridge,
+     const bool                  triangulate,
+     utils::ThreadPool*          pool,
+     const unsigned int          band_rows,
+     const unsigned int          nx,
+     const unsigned int          ny,
+     const unsigned int          nz,
+     const std::vector<float>&   coord,
+     const std::vector<float>&   zcorn,
+     const utils::ActiveCells&   active_cells )
+{
+    boost::shared_ptr<tinia::model::ExposedModel> model( new tinia::model::ExposedModel );
+    bridge.reset( new Bridge( triangulate ) );
+    Tessellator tessellator( *bridge, pool );
+    tessellator.setBandRows( band_rows );
+
+    PerfTimer start;
+    tessellator.tessellate( model, "what", "progress",
+                            nx, ny, nz, 1,
+                            coord, zcorn, active_cells );
+    PerfTimer stop;
+    return PerfTimer::delta( start, stop );
+}
+
+} // of anonymous namespace
+
+int
+main( int argc, char** argv )
+{
+    const unsigned int nx = argc > 1 ? atoi( argv[1] ) : 200;
+    const unsigned int ny = argc > 2 ? atoi( argv[2] ) : 200;
+    const unsigned int nz = argc > 3 ? atoi( argv[3] ) : 50;
+    const bool triangulate = argc > 4 ? atoi( argv[4] ) != 0 : false;
+
+    std::vector<float> coord;
+    std::vector<float> zcorn;
+    std::vector<int> actnum;
+    makeGrid( coord, zcorn, actnum, nx, ny, nz );
+    utils::ActiveCells active_cells;
+    active_cells.build( actnum.data(), actnum.size() );
+
+    std::cout << "grid " << nx << "x" << ny << "x" << nz
+              << ", " << active_cells.count() << " active cells"
+              << (triangulate ? ", triangulated" : "" ) << std::endl;
+
+    // single band, i.e., the sequential sweep
+    boost::shared_ptr<Bridge> reference;
+    const double t1 = run( reference, triangulate, NULL, ny+1,
+                           nx, ny, nz, coord, zcorn, active_cells );
+    std::cout << std::setw(8) << "threads"
+              << std::setw(12) << "seconds"
+              << std::setw(10) << "speedup" << std::endl;
+    std::cout << std::setw(8) << 1
+              << std::setw(12) << std::setprecision(4) << t1
+              << std::setw(10) << 1.0 << std::endl;
+
+    const unsigned int hardware = std::max( 2u, std::thread::hardware_concurrency() );
+    bool ok = true;
+    for( unsigned int threads=2; threads<=hardware; threads*=2 ) {
+        utils::ThreadPool pool( threads-1 );
+        boost::shared_ptr<Bridge> bridge;
+        const double t = run( bridge, triangulate, &pool, 0,
+                              nx, ny, nz, coord, zcorn, active_cells );
+        const bool equal = reference->same( *bridge );
+        ok = ok && equal;
+        std::cout << std::setw(8) << threads
+                  << std::setw(12) << std::setprecision(4) << t
+                  << std::setw(10) << std::setprecision(3) << (t1/t)
+                  << (equal ? "" : "  output differs!" ) << std::endl;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
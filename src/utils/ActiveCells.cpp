@@ -0,0 +1,106 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ *
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include "utils/ActiveCells.hpp"
+
+namespace utils {
+
+ActiveCells::ActiveCells()
+    : m_size( 0 ),
+      m_count( 0 )
+{}
+
+void
+ActiveCells::build( const int* actnum, const size_t n )
+{
+    m_size = n;
+    m_bits.assign( (n+63u)/64u, 0u );
+    for( size_t w=0; w<m_bits.size(); w++ ) {
+        const size_t o = 64u*w;
+        const size_t m = (n - o) < 64u ? (n - o) : 64u;
+        uint64_t word = 0u;
+        for( size_t b=0; b<m; b++ ) {
+            word |= uint64_t( actnum[o+b] != 0 ) << b;
+        }
+        m_bits[w] = word;
+    }
+    computeRanks();
+}
+
+void
+ActiveCells::fill( const size_t n )
+{
+    m_size = n;
+    m_bits.assign( (n+63u)/64u, ~uint64_t(0u) );
+    if( (n & 63u) != 0u ) {
+        m_bits.back() = (uint64_t(1u) << (n & 63u)) - 1u;
+    }
+    computeRanks();
+}
+
+void
+ActiveCells::assign( std::vector<uint64_t>& bits, const size_t n )
+{
+    m_size = n;
+    m_bits.swap( bits );
+    m_bits.resize( (n+63u)/64u, 0u );
+    computeRanks();
+}
+
+size_t
+ActiveCells::select( const size_t r ) const
+{
+    // last word with no more than r active cells before it
+    const size_t w = (std::upper_bound( m_word_rank.begin(), m_word_rank.end(), r ) - m_word_rank.begin()) - 1u;
+    uint64_t remaining = m_bits[w];
+    for( size_t n=r-m_word_rank[w]; n>0; n-- ) {
+        remaining &= remaining - 1u;  // clear lowest set bit
+    }
+    return 64u*w + __builtin_ctzll( remaining );
+}
+
+void
+ActiveCells::summarizeColumns( ActiveCells& columns, const size_t layer_size ) const
+{
+    std::vector<uint64_t> bits( (layer_size+63u)/64u, 0u );
+    for( size_t o=0; o<m_size; o+=layer_size ) {
+        for( size_t w=0; w<bits.size(); w++ ) {
+            bits[w] |= word( o + 64u*w );
+        }
+    }
+    // the last word also picked up the start of the next layer.
+    if( (layer_size & 63u) != 0u ) {
+        bits.back() &= (uint64_t(1u) << (layer_size & 63u)) - 1u;
+    }
+    columns.assign( bits, layer_size );
+}
+
+void
+ActiveCells::computeRanks()
+{
+    m_word_rank.resize( m_bits.size() + 1u );
+    size_t r = 0;
+    for( size_t w=0; w<m_bits.size(); w++ ) {
+        m_word_rank[w] = r;
+        r += __builtin_popcountll( m_bits[w] );
+    }
+    m_word_rank.back() = r;
+    m_count = r;
+}
+
+} // of namespace utils
@@ -0,0 +1,181 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ *
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+namespace utils {
+
+/** Bit-packed set of the active cells of a grid, with rank and select.
+  *
+  * Bit i is set if cell i is active. The compact index of an active cell,
+  * i.e., the number of active cells preceding it, is found from a prefix sum
+  * of active cells per 64-bit word and a popcount within the word, so no
+  * full-size index map is needed to translate between enumerations. Select
+  * goes the other way by a binary search over the same prefix sums.
+  */
+class ActiveCells
+{
+public:
+    ActiveCells();
+
+    /** Build from an ACTNUM-style array, where nonzero entries are active. */
+    void
+    build( const int* actnum, const size_t n );
+
+    /** Mark all of n cells as active. */
+    void
+    fill( const size_t n );
+
+    /** Adopt a bit array built elsewhere, e.g. by eclipse::Reader.
+      *
+      * \param[in,out] bits  (n+63)/64 words with no bits set beyond n, the
+      *                      contents are swapped into this object.
+      * \param[in] n         Number of cells.
+      */
+    void
+    assign( std::vector<uint64_t>& bits, const size_t n );
+
+    /** Total number of cells, active or not. */
+    size_t
+    size() const { return m_size; }
+
+    /** Number of active cells. */
+    size_t
+    count() const { return m_count; }
+
+    /** Returns true if cell i is active. */
+    bool
+    active( const size_t i ) const
+    { return ((m_bits[ i>>6u ] >> (i&63u)) & 1u) != 0u; }
+
+    /** Number of active cells before cell i, the compact index of i if active.
+      *
+      * \param[in] i  Cell, at most size(), so that rank(size()) == count()
+      *               ends a range of cells.
+      */
+    size_t
+    rank( const size_t i ) const
+    {
+        const size_t w = i>>6u;
+        const unsigned int s = i&63u;
+        // a cell at a word boundary needs no bits, and may be past the last word.
+        return m_word_rank[w] + (s != 0u ? __builtin_popcountll( m_bits[w] & ((uint64_t(1u) << s) - 1u) ) : 0u);
+    }
+
+    /** Index of the active cell with compact index r, the inverse of rank().
+      *
+      * \param[in] r  Compact index, less than count().
+      * \returns The cell i where active(i) and rank(i) == r.
+      */
+    size_t
+    select( const size_t r ) const;
+
+    /** The 64 cells starting at cell i as a word, cells past size() are inactive. */
+    uint64_t
+    word( const size_t i ) const
+    {
+        const size_t w = i>>6u;
+        const unsigned int s = i&63u;
+        const uint64_t lo = w < m_bits.size() ? m_bits[w] >> s : 0u;
+        const uint64_t hi = (s != 0u) && (w+1u < m_bits.size()) ? m_bits[w+1u] << (64u-s) : 0u;
+        return lo | hi;
+    }
+
+    /** Write the compact index of every cell, or illegal for inactive cells.
+      *
+      * \param[out] dst  Storage for size() indices.
+      */
+    template<typename Index>
+    void
+    compactIndices( Index* dst, const Index illegal ) const
+    {
+        compactIndices( dst, illegal, 0u, m_size );
+    }
+
+    /** Write the compact index of cells begin to begin+n-1, or illegal for inactive cells.
+      *
+      * Lets a consumer that visits the grid a row at a time translate a row
+      * without a full-size index map.
+      *
+      * \param[out] dst    Storage for n indices.
+      * \param[in] begin   First cell.
+      * \param[in] n       Number of cells, begin+n must not exceed size().
+      */
+    template<typename Index>
+    void
+    compactIndices( Index* dst, const Index illegal, const size_t begin, const size_t n ) const
+    {
+        if( n == 0u ) {
+            return;
+        }
+        Index r = rank( begin );
+        for( size_t o=0; o<n; o+=64u ) {
+            const size_t m = (n - o) < 64u ? (n - o) : 64u;
+            const uint64_t bits = word( begin + o ) & (m < 64u ? (uint64_t(1u) << m) - 1u : ~uint64_t(0u));
+            if( bits == 0u ) {
+                for( size_t b=0; b<m; b++ ) {
+                    dst[o+b] = illegal;
+                }
+            }
+            else if( (m == 64u) && (bits == ~uint64_t(0u)) ) {
+                for( size_t b=0; b<m; b++ ) {
+                    dst[o+b] = r + b;
+                }
+                r += 64u;
+            }
+            else {
+                for( size_t b=0; b<m; b++ ) {
+                    const Index bit = (bits >> b) & 1u;
+                    dst[o+b] = bit ? r : illegal;
+                    r += bit;
+                }
+            }
+        }
+    }
+
+    /** Find the columns that hold at least one active cell.
+      *
+      * The cells are seen as layers of layer_size cells, and bit c of
+      * columns is set if cell c of any layer is active. Lets a sweep over
+      * columns skip the empty ones without visiting their cells.
+      *
+      * \param[out] columns     Set of layer_size columns.
+      * \param[in]  layer_size  Number of cells per layer, e.g. nx*ny.
+      */
+    void
+    summarizeColumns( ActiveCells& columns, const size_t layer_size ) const;
+
+    /** The underlying bit array, (size()+63)/64 words. */
+    const std::vector<uint64_t>&
+    bits() const { return m_bits; }
+
+private:
+    size_t                  m_size;
+    size_t                  m_count;
+    std::vector<uint64_t>   m_bits;         ///< Bit i is set if cell i is active.
+    std::vector<size_t>     m_word_rank;    ///< Number of active cells before each word, and count() last.
+
+    /** Populate m_word_rank and m_count from m_bits. */
+    void
+    computeRanks();
+
+};
+
+} // of namespace utils
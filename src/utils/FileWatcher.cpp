@@ -0,0 +1,109 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ *
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include "utils/Logger.hpp"
+#include "utils/FileWatcher.hpp"
+
+namespace utils {
+
+FileWatcher::FileWatcher( const std::string& path )
+    : m_path( path ),
+      m_inotify_fd( -1 ),
+      m_watch( -1 ),
+      m_size( -1 ),
+      m_mtime_sec( 0 ),
+      m_mtime_nsec( 0 )
+{
+    Logger log = getLogger( "utils.FileWatcher" );
+
+    statChanged();
+
+    m_inotify_fd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+    if( m_inotify_fd < 0 ) {
+        LOGGER_WARN( log, "inotify_init1() failed, polling " << m_path << ": " << strerror(errno) );
+        return;
+    }
+    m_watch = inotify_add_watch( m_inotify_fd, m_path.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB );
+    if( m_watch < 0 ) {
+        LOGGER_WARN( log, "inotify_add_watch() failed, polling " << m_path << ": " << strerror(errno) );
+        close( m_inotify_fd );
+        m_inotify_fd = -1;
+    }
+}
+
+FileWatcher::~FileWatcher()
+{
+    if( m_inotify_fd >= 0 ) {
+        close( m_inotify_fd );
+    }
+}
+
+bool
+FileWatcher::changed()
+{
+    if( m_inotify_fd < 0 ) {
+        return statChanged();
+    }
+    // Drain all pending events, any event means that the file was touched.
+    bool events = false;
+    char buffer[ 4096 ] __attribute__((aligned(__alignof__(struct inotify_event))));
+    while( 1 ) {
+        ssize_t n = read( m_inotify_fd, buffer, sizeof(buffer) );
+        if( n > 0 ) {
+            events = true;
+            continue;
+        }
+        if( (n < 0) && (errno == EINTR) ) {
+            continue;
+        }
+        if( (n < 0) && (errno != EAGAIN) ) {
+            Logger log = getLogger( "utils.FileWatcher.changed" );
+            LOGGER_WARN( log, "read() from inotify failed, polling " << m_path << ": " << strerror(errno) );
+            close( m_inotify_fd );
+            m_inotify_fd = -1;
+            return true;
+        }
+        break;
+    }
+    // Events may be delivered late, and file systems with coarse timestamps
+    // may hide a write from stat, so both are needed to never miss a write.
+    bool stat_changed = statChanged();
+    return events || stat_changed;
+}
+
+bool
+FileWatcher::statChanged()
+{
+    struct stat finfo;
+    if( stat( m_path.c_str(), &finfo ) != 0 ) {
+        return false;
+    }
+    bool changed = (finfo.st_size != m_size)
+                || (finfo.st_mtim.tv_sec != m_mtime_sec)
+                || (finfo.st_mtim.tv_nsec != m_mtime_nsec);
+    m_size       = finfo.st_size;
+    m_mtime_sec  = finfo.st_mtim.tv_sec;
+    m_mtime_nsec = finfo.st_mtim.tv_nsec;
+    return changed;
+}
+
+} // of namespace utils
@@ -0,0 +1,72 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ *
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <string>
+#include <boost/utility.hpp>
+
+namespace utils {
+
+/** Detects modifications of a file that is being written by another process.
+  *
+  * Uses inotify when available, in addition to comparing the size and
+  * modification time of the file, which is all that is done when inotify is
+  * not supported (e.g. on network file systems). Never blocks.
+  */
+class FileWatcher : public boost::noncopyable
+{
+public:
+    /** Start watching a file.
+      *
+      * \param[in] path  Path of the file to watch.
+      */
+    FileWatcher( const std::string& path );
+
+    ~FileWatcher();
+
+    /** Path of the file being watched. */
+    const std::string&
+    path() const
+    { return m_path; }
+
+    /** True if inotify is used, false if the file is polled. */
+    bool
+    usingInotify() const
+    { return m_inotify_fd >= 0; }
+
+    /** Check if the file may have changed since the previous invocation.
+      *
+      * \note Spurious positives are possible, but a modification is never
+      *       missed.
+      */
+    bool
+    changed();
+
+private:
+    const std::string   m_path;
+    int                 m_inotify_fd;
+    int                 m_watch;
+    long long           m_size;
+    long long           m_mtime_sec;
+    long long           m_mtime_nsec;
+
+    /** Compare size and modification time with what was seen last time. */
+    bool
+    statChanged();
+};
+
+} // of namespace utils
@@ -18,14 +18,32 @@
 #pragma once
 #include <GL/glew.h>
 
-// Define blank macros if we aren't debugging.
-// These will be identical in log4cxx and std::cout
-#ifndef DEBUG
-// Detailed logging removed for release builds
-#define LOGGER_TRACE(a,b)
-#define LOGGER_INFO(a,b)
-#define LOGGER_DEBUG(a,b)
+// Log levels, from the least to the most detailed.
+#define LOGGER_LEVEL_FATAL  0
+#define LOGGER_LEVEL_ERROR  1
+#define LOGGER_LEVEL_WARN   2
+#define LOGGER_LEVEL_INFO   3
+#define LOGGER_LEVEL_DEBUG  4
+#define LOGGER_LEVEL_TRACE  5
+
+// The most detailed level that is compiled in. Log statements above this
+// level expand to nothing, so neither the message nor the level check is
+// evaluated. Detailed logging is only compiled into debug builds unless the
+// threshold is set explicitly.
+#ifndef FRVIEW_LOG_LEVEL
+#ifdef DEBUG
+#define FRVIEW_LOG_LEVEL    LOGGER_LEVEL_TRACE
+#else
+#define FRVIEW_LOG_LEVEL    LOGGER_LEVEL_WARN
 #endif
+#endif
+
+// Looking up a logger builds the name string and, with log4cxx, searches the
+// logger hierarchy under a lock. Functions that are called per element should
+// hold the handle in a function-local static, which is looked up once
+// (thread-safe) on the first call:
+//
+//     static const Logger log = getLogger( package + ".addTriangle" );
 
 
 #ifdef FRVIEW_HAS_LOG4CXX
@@ -38,17 +56,12 @@ static inline Logger getLogger( const std::string name )
     return log4cxx::Logger::getLogger( name );
 }
 
-#ifdef DEBUG
-// Detailed logging only enabled for debug builds
-#define LOGGER_TRACE(a,b)   LOG4CXX_TRACE(a,b)
-#define LOGGER_INFO(a,b)    LOG4CXX_INFO(a,b)
-#define LOGGER_DEBUG(a,b)   LOG4CXX_DEBUG(a,b)
-#endif
-
-// Warnings and up are always logged
-#define LOGGER_WARN(a,b)    LOG4CXX_WARN(a,b)
-#define LOGGER_ERROR(a,b)   LOG4CXX_ERROR(a,b)
-#define LOGGER_FATAL(a,b)   LOG4CXX_FATAL(a,b)
+#define LOGGER_LOG_TRACE(a,b)   LOG4CXX_TRACE(a,b)
+#define LOGGER_LOG_INFO(a,b)    LOG4CXX_INFO(a,b)
+#define LOGGER_LOG_DEBUG(a,b)   LOG4CXX_DEBUG(a,b)
+#define LOGGER_LOG_WARN(a,b)    LOG4CXX_WARN(a,b)
+#define LOGGER_LOG_ERROR(a,b)   LOG4CXX_ERROR(a,b)
+#define LOGGER_LOG_FATAL(a,b)   LOG4CXX_FATAL(a,b)
 
 
 
@@ -62,19 +75,44 @@ static inline Logger getLogger(const std::string name)
     return name;
 }
 
-#ifdef DEBUG
-// Detailed logging only enabled for debug builds
-#define LOGGER_TRACE(a,b)   std::cout << "TRACE(" << a << "): " << b << std::endl;
-#define LOGGER_INFO(a,b)    std::cout << "INFO(" << a << "): " << b << std::endl;
-#define LOGGER_DEBUG(a,b)   std::cout << "DEBUG("<< a << "): " << b << std::endl;
-#endif
-
-// Warnings and up are always logged
-#define LOGGER_WARN(a,b)    std::cerr << "WARN(" << a << "): " << b << std::endl;
-#define LOGGER_ERROR(a,b)   std::cerr << "ERROR(" << a << "): " << b << std::endl;
-#define LOGGER_FATAL(a,b)   std::cerr << "FATAL(" << a << "): " << b << std::endl;
+#define LOGGER_LOG_TRACE(a,b)   std::cout << "TRACE(" << a << "): " << b << std::endl;
+#define LOGGER_LOG_INFO(a,b)    std::cout << "INFO(" << a << "): " << b << std::endl;
+#define LOGGER_LOG_DEBUG(a,b)   std::cout << "DEBUG("<< a << "): " << b << std::endl;
+#define LOGGER_LOG_WARN(a,b)    std::cerr << "WARN(" << a << "): " << b << std::endl;
+#define LOGGER_LOG_ERROR(a,b)   std::cerr << "ERROR(" << a << "): " << b << std::endl;
+#define LOGGER_LOG_FATAL(a,b)   std::cerr << "FATAL(" << a << "): " << b << std::endl;
 #endif // ifdef FRVIEW_HAS_LOG4CXX
 
+// Levels above the threshold expand to blank macros.
+// These will be identical in log4cxx and std::cout
+#if FRVIEW_LOG_LEVEL >= LOGGER_LEVEL_TRACE
+#define LOGGER_TRACE(a,b)   LOGGER_LOG_TRACE(a,b)
+#else
+#define LOGGER_TRACE(a,b)
+#endif
+#if FRVIEW_LOG_LEVEL >= LOGGER_LEVEL_DEBUG
+#define LOGGER_DEBUG(a,b)   LOGGER_LOG_DEBUG(a,b)
+#else
+#define LOGGER_DEBUG(a,b)
+#endif
+#if FRVIEW_LOG_LEVEL >= LOGGER_LEVEL_INFO
+#define LOGGER_INFO(a,b)    LOGGER_LOG_INFO(a,b)
+#else
+#define LOGGER_INFO(a,b)
+#endif
+#if FRVIEW_LOG_LEVEL >= LOGGER_LEVEL_WARN
+#define LOGGER_WARN(a,b)    LOGGER_LOG_WARN(a,b)
+#else
+#define LOGGER_WARN(a,b)
+#endif
+#if FRVIEW_LOG_LEVEL >= LOGGER_LEVEL_ERROR
+#define LOGGER_ERROR(a,b)   LOGGER_LOG_ERROR(a,b)
+#else
+#define LOGGER_ERROR(a,b)
+#endif
+// Fatal messages are always logged
+#define LOGGER_FATAL(a,b)   LOGGER_LOG_FATAL(a,b)
+
 // Check invariants are logger agnostic
 #ifdef CHECK_INVARIANTS
 #define LOGGER_INVARIANT(a,b) if(!(b)) { \
@@ -0,0 +1,149 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ *
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include "utils/ThreadPool.hpp"
+
+namespace utils {
+
+ThreadPool::ThreadPool( unsigned int threads )
+    : m_die( false )
+{
+    if( threads == 0 ) {
+        unsigned int hw = std::thread::hardware_concurrency();
+        threads = hw > 1 ? hw - 1 : 0;
+    }
+    for( unsigned int i=0; i<threads; i++ ) {
+        m_workers.push_back( std::thread( worker, this ) );
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::unique_lock<std::mutex> lock( m_lock );
+        m_die = true;
+        m_job_wait.notify_all();
+    }
+    for( auto it=m_workers.begin(); it!=m_workers.end(); ++it ) {
+        it->join();
+    }
+}
+
+ThreadPool&
+ThreadPool::instance()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+size_t
+ThreadPool::work( Job* job )
+{
+    size_t done = 0;
+    while( 1 ) {
+        size_t i = job->m_next++;
+        if( i >= job->m_tasks ) {
+            break;
+        }
+        try {
+            (*job->m_task)( i );
+        }
+        catch( ... ) {
+            std::unique_lock<std::mutex> lock( m_lock );
+            if( !job->m_error ) {
+                job->m_error = std::current_exception();
+            }
+        }
+        done++;
+    }
+    return done;
+}
+
+void
+ThreadPool::run( const size_t tasks, const std::function<void(size_t)>& task )
+{
+    if( tasks == 0 ) {
+        return;
+    }
+    if( (tasks == 1) || m_workers.empty() ) {
+        for( size_t i=0; i<tasks; i++ ) {
+            task( i );
+        }
+        return;
+    }
+
+    Job job;
+    job.m_task = &task;
+    job.m_tasks = tasks;
+    job.m_next = 0;
+    job.m_done = 0;
+    job.m_active = 0;
+    {
+        std::unique_lock<std::mutex> lock( m_lock );
+        m_jobs.push_back( &job );
+        m_job_wait.notify_all();
+    }
+
+    size_t done = work( &job );
+
+    std::unique_lock<std::mutex> lock( m_lock );
+    job.m_done += done;
+    auto it = std::find( m_jobs.begin(), m_jobs.end(), &job );
+    if( it != m_jobs.end() ) {
+        m_jobs.erase( it );
+    }
+    while( (job.m_done < job.m_tasks) || (job.m_active > 0) ) {
+        m_finished_wait.wait( lock );
+    }
+    if( job.m_error ) {
+        std::rethrow_exception( job.m_error );
+    }
+}
+
+void
+ThreadPool::worker( ThreadPool* that )
+{
+    std::unique_lock<std::mutex> lock( that->m_lock );
+    while( 1 ) {
+        while( !that->m_die && that->m_jobs.empty() ) {
+            that->m_job_wait.wait( lock );
+        }
+        if( that->m_die ) {
+            break;
+        }
+        Job* job = that->m_jobs.front();
+        if( job->m_next >= job->m_tasks ) {
+            // all tasks have been handed out, no point in joining.
+            that->m_jobs.pop_front();
+            continue;
+        }
+        job->m_active++;
+        lock.unlock();
+
+        size_t done = that->work( job );
+
+        lock.lock();
+        job->m_done += done;
+        job->m_active--;
+        if( (job->m_done == job->m_tasks) && (job->m_active == 0) ) {
+            that->m_finished_wait.notify_all();
+        }
+    }
+}
+
+} // of namespace utils
@@ -0,0 +1,95 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ *
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <list>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+#include <boost/utility.hpp>
+
+namespace utils {
+
+/** Fixed-size pool of worker threads for data-parallel loops.
+  *
+  * A job is a number of independent tasks identified by their index. The
+  * thread invoking run() participates in the work, so nested invocations of
+  * run() (e.g. from within a task) do not deadlock.
+  */
+class ThreadPool : public boost::noncopyable
+{
+public:
+    /** Create a pool.
+      *
+      * \param[in] threads  Number of worker threads, 0 means one per hardware
+      *                     thread minus the thread that invokes run().
+      */
+    ThreadPool( unsigned int threads = 0 );
+
+    ~ThreadPool();
+
+    /** Number of threads that can work on a job, including the caller. */
+    unsigned int
+    concurrency() const
+    { return m_workers.size() + 1; }
+
+    /** Run task(0), ..., task(tasks-1) and wait for all of them to finish.
+      *
+      * Tasks may be executed in any order and concurrently.
+      *
+      * \throws Rethrows the first exception thrown by a task, after all tasks
+      *         have finished.
+      */
+    void
+    run( const size_t tasks, const std::function<void(size_t)>& task );
+
+    /** Process-wide pool sized to the hardware. */
+    static
+    ThreadPool&
+    instance();
+
+private:
+    struct Job {
+        const std::function<void(size_t)>*     m_task;
+        size_t                                  m_tasks;
+        std::atomic<size_t>                     m_next;
+        size_t                                  m_done;
+        unsigned int                            m_active;
+        std::exception_ptr                      m_error;
+    };
+
+    std::vector<std::thread>    m_workers;
+    std::list<Job*>             m_jobs;
+    std::mutex                  m_lock;
+    std::condition_variable     m_job_wait;
+    std::condition_variable     m_finished_wait;
+    bool                        m_die;
+
+    /** Execute tasks of job until it is exhausted, returns tasks finished. */
+    size_t
+    work( Job* job );
+
+    static
+    void
+    worker( ThreadPool* that );
+};
+
+} // of namespace utils
@@ -0,0 +1,236 @@
+/* Copyright STIFTELSEN SINTEF 2013
+ *
+ * This file is part of FRView.
+ * FRView is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FRView is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with the FRView.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Stress benchmark of the search for crossing boundary lines on pillar walls.
+//
+// Builds synthetic pillar walls as seen by Tessellator::intersectWallLines,
+// where one side has many thin layers and the other side has a few thick
+// layers offset by a fault with a high throw that varies along the wall, so
+// that a few steep lines cross most of the thin layers. Such walls make the
+// direct scan for crossings quadratic in the number of layers. The crossings
+// are found with the direct scan and with cornerpoint::WallLineCrossings,
+// and both the time and the crossings are compared. Random walls are also
+// compared to verify that the crossings are identical.
+//
+// Usage: wallbench [layers] [repetitions]
+
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include "bridge/PolyhedralMeshBridge.hpp"
+#include "cornerpoint/WallLineCrossings.hpp"
+#include "utils/PerfTimer.hpp"
+
+namespace {
+
+typedef bridge::PolyhedralMeshBridge                    Bridge;
+typedef Bridge::Index                                   Index;
+typedef cornerpoint::WallLineCrossings<Bridge>          Crossings;
+
+/** The lines of a wall, sorted by the vertex index at pillar 0. */
+struct Wall {
+    std::vector<Index>  m_p0;
+    std::vector<Index>  m_p1;
+    std::vector<Index>  m_cutoff;
+};
+
+/** Index of each value among the sorted unique values. */
+std::vector<Index>
+ranks( const std::vector<float>& z )
+{
+    std::vector<float> sorted( z );
+    std::sort( sorted.begin(), sorted.end() );
+    sorted.erase( std::unique( sorted.begin(), sorted.end() ), sorted.end() );
+    std::vector<Index> r( z.size() );
+    for( size_t i=0; i<z.size(); i++ ) {
+        r[i] = std::lower_bound( sorted.begin(), sorted.end(), z[i] ) - sorted.begin();
+    }
+    return r;
+}
+
+/** Build a wall from the depths of the lines of each side at the two pillars.
+  *
+  * The lines of each side are sorted, and the sides are merged and given
+  * cutoffs as in Tessellator::extractWallLines.
+  */
+void
+makeWall( Wall&                        wall,
+          const std::vector<float>     (&z0)[2],
+          const std::vector<float>     (&z1)[2] )
+{
+    std::vector<float> all0( z0[0] );
+    all0.insert( all0.end(), z0[1].begin(), z0[1].end() );
+    std::vector<float> all1( z1[0] );
+    all1.insert( all1.end(), z1[1].begin(), z1[1].end() );
+    const std::vector<Index> r0 = ranks( all0 );
+    const std::vector<Index> r1 = ranks( all1 );
+
+    std::vector<Index> p0[2];
+    std::vector<Index> p1[2];
+    p0[0].assign( r0.begin(), r0.begin() + z0[0].size() );
+    p0[1].assign( r0.begin() + z0[0].size(), r0.end() );
+    p1[0].assign( r1.begin(), r1.begin() + z1[0].size() );
+    p1[1].assign( r1.begin() + z1[0].size(), r1.end() );
+
+    wall.m_p0.clear();
+    wall.m_p1.clear();
+    wall.m_cutoff.clear();
+    size_t i[2] = { 0, 0 };
+    while( (i[0] < p0[0].size()) || (i[1] < p0[1].size()) ) {
+        Index cutoff = ~Index(0);
+        int side = -1;
+        for( int s=0; s<2; s++ ) {
+            if( i[s] < p0[s].size() ) {
+                cutoff = std::min( cutoff, p1[s][i[s]] );
+                if( (side < 0)
+                        || (p0[s][i[s]] < p0[side][i[side]])
+                        || ((p0[s][i[s]] == p0[side][i[side]]) && (p1[s][i[s]] <= p1[side][i[side]])) )
+                {
+                    side = s;
+                }
+            }
+        }
+        wall.m_p0.push_back( p0[side][i[side]] );
+        wall.m_p1.push_back( p1[side][i[side]] );
+        wall.m_cutoff.push_back( cutoff );
+        i[side]++;
+    }
+}
+
+/** A side of thin layers and a side of a few thick layers with a varying throw. */
+void
+makeFaultedWall( Wall& wall, const unsigned int layers, const unsigned int thick )
+{
+    std::vector<float> z0[2];
+    std::vector<float> z1[2];
+    for( unsigned int k=0; k<=layers; k++ ) {
+        z0[0].push_back( k );
+        z1[0].push_back( k );
+    }
+    // Thick layers start at the top at pillar 0 and are thrown down past
+    // the thin layers at pillar 1.
+    for( unsigned int k=0; k<=thick; k++ ) {
+        const float z = layers - 0.5f*thick + 0.5f*k + 0.25f;
+        z0[1].push_back( z );
+        z1[1].push_back( z - 0.9f*layers );
+    }
+    makeWall( wall, z0, z1 );
+}
+
+/** Two sides of random monotone layers. */
+void
+makeRandomWall( Wall& wall, const unsigned int layers )
+{
+    std::vector<float> z0[2];
+    std::vector<float> z1[2];
+    for( int s=0; s<2; s++ ) {
+        const unsigned int n = 1 + rand()%layers;
+        const float throw_0 = (rand()%(2*layers)) - float(layers);
+        const float throw_1 = (rand()%(2*layers)) - float(layers);
+        float a = throw_0;
+        float b = throw_1;
+        for( unsigned int k=0; k<n; k++ ) {
+            a += 0.5f + (rand()%4);
+            b += 0.5f + (rand()%4);
+            z0[s].push_back( a );
+            z1[s].push_back( b );
+        }
+    }
+    makeWall( wall, z0, z1 );
+}
+
+/** The direct scan formerly used by Tessellator::intersectWallLines. */
+void
+directScan( std::vector<Index>& pairs, const Wall& wall )
+{
+    pairs.clear();
+    const size_t n = wall.m_p1.size();
+    for( size_t lower=0; lower<n; lower++ ) {
+        for( size_t upper=lower+1; upper<n; upper++ ) {
+            if( wall.m_cutoff[upper] >= wall.m_p1[lower] ) {
+                break;
+            }
+            if( wall.m_p1[upper] < wall.m_p1[lower] ) {
+                pairs.push_back( lower );
+                pairs.push_back( upper );
+            }
+        }
+    }
+}
+
+} // of anonymous namespace
+
+int
+main( int argc, char** argv )
+{
+    const unsigned int layers = argc > 1 ? atoi( argv[1] ) : 5000;
+    const unsigned int repetitions = argc > 2 ? atoi( argv[2] ) : 20;
+
+    bool ok = true;
+    Crossings crossings;
+    std::vector<Index> a;
+    std::vector<Index> b;
+
+    // verify on random walls
+    srand( 42 );
+    Wall wall;
+    for( unsigned int w=0; w<2000; w++ ) {
+        makeRandomWall( wall, 1 + (w % 200) );
+        directScan( a, wall );
+        crossings.find( b, wall.m_p1.data(), wall.m_cutoff.data(), wall.m_p1.size() );
+        if( a != b ) {
+            std::cout << "random wall " << w << ": crossings differ!" << std::endl;
+            ok = false;
+        }
+    }
+    std::cout << "2000 random walls " << (ok ? "identical" : "differ") << std::endl;
+
+    std::cout << std::setw(8) << "thick"
+              << std::setw(10) << "lines"
+              << std::setw(12) << "crossings"
+              << std::setw(12) << "direct ms"
+              << std::setw(12) << "sweep ms"
+              << std::setw(10) << "speedup" << std::endl;
+    const unsigned int thicks[] = { 1, 4, 16, 64 };
+    for( unsigned int t=0; t<sizeof(thicks)/sizeof(thicks[0]); t++ ) {
+        makeFaultedWall( wall, layers, thicks[t] );
+
+        PerfTimer start;
+        for( unsigned int r=0; r<repetitions; r++ ) {
+            directScan( a, wall );
+        }
+        PerfTimer middle;
+        for( unsigned int r=0; r<repetitions; r++ ) {
+            crossings.find( b, wall.m_p1.data(), wall.m_cutoff.data(), wall.m_p1.size() );
+        }
+        PerfTimer stop;
+        const double t_direct = 1000.0*PerfTimer::delta( start, middle )/repetitions;
+        const double t_sweep = 1000.0*PerfTimer::delta( middle, stop )/repetitions;
+        const bool equal = a == b;
+        ok = ok && equal;
+        std::cout << std::setw(8) << thicks[t]
+                  << std::setw(10) << wall.m_p1.size()
+                  << std::setw(12) << a.size()/2
+                  << std::setw(12) << std::setprecision(4) << t_direct
+                  << std::setw(12) << std::setprecision(4) << t_sweep
+                  << std::setw(10) << std::setprecision(3) << (t_direct/t_sweep)
+                  << (equal ? "" : "  crossings differ!" ) << std::endl;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}